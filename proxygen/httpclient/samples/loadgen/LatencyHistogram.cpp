@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpclient/samples/loadgen/LatencyHistogram.h>
+
+#include <algorithm>
+#include <folly/lang/Bits.h>
+#include <glog/logging.h>
+
+namespace LoadGenService {
+
+LatencyHistogram::LatencyHistogram(uint64_t highestValue,
+                                   uint8_t significantDigits)
+    : highestValue_(std::max<uint64_t>(highestValue, 2)),
+      significantDigits_(significantDigits) {
+  CHECK(significantDigits_ >= 1 && significantDigits_ <= 5);
+  uint64_t largestSingleUnitResolution = 2;
+  for (uint8_t i = 0; i < significantDigits_; i++) {
+    largestSingleUnitResolution *= 10;
+  }
+  auto subBucketCountMagnitude =
+      folly::findLastSet(largestSingleUnitResolution - 1);
+  subBucketHalfCountMagnitude_ = subBucketCountMagnitude - 1;
+  uint64_t subBucketCount = uint64_t(1) << subBucketCountMagnitude;
+  subBucketHalfCount_ = subBucketCount / 2;
+  subBucketMask_ = subBucketCount - 1;
+
+  uint64_t smallestUntrackable = subBucketCount;
+  uint32_t bucketCount = 1;
+  while (smallestUntrackable <= highestValue_) {
+    if (smallestUntrackable > std::numeric_limits<uint64_t>::max() / 2) {
+      bucketCount++;
+      break;
+    }
+    smallestUntrackable <<= 1;
+    bucketCount++;
+  }
+  counts_.resize((bucketCount + 1) * subBucketHalfCount_);
+}
+
+uint32_t LatencyHistogram::getBucketIndex(uint64_t value) const {
+  // Position of the highest set bit, relative to the first bucket
+  return folly::findLastSet(value | subBucketMask_) -
+         (subBucketHalfCountMagnitude_ + 1);
+}
+
+size_t LatencyHistogram::getCountsIndex(uint64_t value) const {
+  auto bucketIndex = getBucketIndex(value);
+  auto subBucketIndex = value >> bucketIndex;
+  return ((bucketIndex + 1) << subBucketHalfCountMagnitude_) +
+         (subBucketIndex - subBucketHalfCount_);
+}
+
+uint64_t LatencyHistogram::getValueFromIndex(size_t index) const {
+  int64_t bucketIndex = int64_t(index >> subBucketHalfCountMagnitude_) - 1;
+  uint64_t subBucketIndex =
+      (index & (subBucketHalfCount_ - 1)) + subBucketHalfCount_;
+  if (bucketIndex < 0) {
+    subBucketIndex -= subBucketHalfCount_;
+    bucketIndex = 0;
+  }
+  return subBucketIndex << bucketIndex;
+}
+
+uint64_t LatencyHistogram::getHighestEquivalentValue(uint64_t value) const {
+  auto bucketIndex = getBucketIndex(value);
+  uint64_t lowest = (value >> bucketIndex) << bucketIndex;
+  return lowest + (uint64_t(1) << bucketIndex) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+  value = std::min(value, highestValue_);
+  auto index = getCountsIndex(value);
+  DCHECK_LT(index, counts_.size());
+  counts_[index]++;
+  count_++;
+  sum_ += value;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  CHECK_EQ(highestValue_, other.highestValue_);
+  CHECK_EQ(significantDigits_, other.significantDigits_);
+  for (size_t i = 0; i < counts_.size(); i++) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  auto target = static_cast<uint64_t>(percentile / 100.0 * count_ + 0.5);
+  target = std::max<uint64_t>(target, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    seen += counts_[i];
+    if (seen >= target) {
+      return std::min(getHighestEquivalentValue(getValueFromIndex(i)), max_);
+    }
+  }
+  return max_;
+}
+
+folly::dynamic LatencyHistogram::toDynamic() const {
+  return folly::dynamic::object("count", count_)("min", getMin())(
+      "max", getMax())("mean", getMean())("p50", getValueAtPercentile(50))(
+      "p90", getValueAtPercentile(90))("p99", getValueAtPercentile(99))(
+      "p99.9", getValueAtPercentile(99.9))("p99.99",
+                                           getValueAtPercentile(99.99));
+}
+
+} // namespace LoadGenService
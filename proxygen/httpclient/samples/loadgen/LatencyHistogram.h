@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/dynamic.h>
+#include <limits>
+#include <vector>
+
+namespace LoadGenService {
+
+/**
+ * High dynamic range latency histogram using the HdrHistogram bucket
+ * layout: values are grouped into power of two buckets, each split into
+ * enough linear sub-buckets to keep the relative error of any recorded
+ * value below 10^-significantDigits. Recording is O(1) and allocation
+ * free; memory is fixed at construction.
+ *
+ * Values are unitless, the load generator records microseconds. Values
+ * above highestValue are clamped.
+ */
+class LatencyHistogram {
+ public:
+  explicit LatencyHistogram(uint64_t highestValue = 60 * 1000 * 1000,
+                            uint8_t significantDigits = 3);
+
+  void record(uint64_t value);
+
+  // Both histograms must have been constructed with the same parameters
+  void merge(const LatencyHistogram& other);
+
+  uint64_t getCount() const {
+    return count_;
+  }
+
+  uint64_t getMin() const {
+    return count_ ? min_ : 0;
+  }
+
+  uint64_t getMax() const {
+    return max_;
+  }
+
+  double getMean() const {
+    return count_ ? static_cast<double>(sum_) / count_ : 0;
+  }
+
+  /**
+   * Returns the highest value equivalent to the recorded value at the
+   * given percentile (0-100].
+   */
+  uint64_t getValueAtPercentile(double percentile) const;
+
+  // count, min, max, mean and the usual percentiles
+  folly::dynamic toDynamic() const;
+
+ private:
+  uint32_t getBucketIndex(uint64_t value) const;
+  size_t getCountsIndex(uint64_t value) const;
+  uint64_t getValueFromIndex(size_t index) const;
+  uint64_t getHighestEquivalentValue(uint64_t value) const;
+
+  uint64_t highestValue_;
+  uint8_t significantDigits_;
+  uint32_t subBucketHalfCountMagnitude_;
+  uint64_t subBucketHalfCount_;
+  uint64_t subBucketMask_;
+  std::vector<uint64_t> counts_;
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t min_{std::numeric_limits<uint64_t>::max()};
+  uint64_t max_{0};
+};
+
+} // namespace LoadGenService
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/json.h>
+#include <folly/portability/GFlags.h>
+#include <folly/ssl/Init.h>
+#include <iostream>
+#include <proxygen/httpclient/samples/curl/CurlClient.h>
+#include <proxygen/httpclient/samples/loadgen/LoadGenerator.h>
+#include <thread>
+
+using namespace LoadGenService;
+
+DEFINE_string(host, "::1", "Server address");
+DEFINE_int32(port, 443, "Server port");
+DEFINE_string(authority, "", "Host header and SNI, defaults to --host");
+DEFINE_string(protocol, "h2", "h1, h2 or h3");
+DEFINE_bool(plaintext, false, "Use cleartext HTTP/1.1 or HTTP/2");
+DEFINE_string(http_method, "GET", "HTTP method");
+DEFINE_string(path, "/", "Request path");
+DEFINE_string(headers, "", "List of N=V headers separated by ,");
+DEFINE_uint64(body_size, 0, "Request body size in bytes");
+DEFINE_double(rate, 1000, "Total requests per second across all threads");
+DEFINE_bool(poisson, false, "Use exponentially distributed arrivals");
+DEFINE_int32(threads, 1, "Load generating threads");
+DEFINE_int32(connections, 10, "Connections per thread");
+DEFINE_int32(warmup_s, 1, "Seconds of load before measuring");
+DEFINE_int32(duration_s, 10, "Seconds of measured load");
+DEFINE_int32(connect_timeout_ms, 1000, "Connect timeout in milliseconds");
+DEFINE_int32(request_timeout_ms, 5000, "Request timeout in milliseconds");
+DEFINE_uint64(max_backlog,
+              10000,
+              "Per thread limit of requests waiting for a stream");
+DEFINE_string(output, "", "Write the JSON report here instead of stdout");
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  // Enable glog logging to stderr by default.
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  folly::init(&argc, &argv, false);
+  folly::ssl::init();
+
+  auto protocol = parseProtocol(FLAGS_protocol);
+  if (!protocol) {
+    LOG(ERROR) << "protocol must be h1, h2 or h3";
+    return EXIT_FAILURE;
+  }
+  auto method = proxygen::stringToMethod(FLAGS_http_method);
+  if (!method) {
+    LOG(ERROR) << "Unknown http_method " << FLAGS_http_method;
+    return EXIT_FAILURE;
+  }
+  if (FLAGS_threads <= 0 || FLAGS_connections <= 0 || FLAGS_rate <= 0) {
+    LOG(ERROR) << "threads, connections and rate must be positive";
+    return EXIT_FAILURE;
+  }
+
+  LoadGenConfig config;
+  config.protocol = *protocol;
+  config.server = folly::SocketAddress(FLAGS_host, FLAGS_port, true);
+  config.authority = FLAGS_authority.empty() ? FLAGS_host : FLAGS_authority;
+  config.useTLS = !FLAGS_plaintext;
+  config.method = *method;
+  config.path = FLAGS_path;
+  config.headers = CurlService::CurlClient::parseHeaders(FLAGS_headers);
+  config.bodySize = FLAGS_body_size;
+  config.requestsPerSec = FLAGS_rate / FLAGS_threads;
+  config.poissonArrivals = FLAGS_poisson;
+  config.connections = FLAGS_connections;
+  config.warmup = std::chrono::seconds(FLAGS_warmup_s);
+  config.duration = std::chrono::seconds(FLAGS_duration_s);
+  config.connectTimeout = std::chrono::milliseconds(FLAGS_connect_timeout_ms);
+  config.requestTimeout = std::chrono::milliseconds(FLAGS_request_timeout_ms);
+  config.maxBacklog = FLAGS_max_backlog;
+
+  std::vector<LoadGenStats> threadStats(FLAGS_threads);
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < FLAGS_threads; i++) {
+    threads.emplace_back([&config, &stats = threadStats[i]] {
+      folly::EventBase evb;
+      {
+        LoadGenerator generator(&evb, config);
+        generator.run();
+        stats = generator.getStats();
+      }
+      // Let closing sessions finish
+      evb.loop();
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  LoadGenStats total;
+  folly::dynamic perThread = folly::dynamic::array;
+  for (const auto& stats : threadStats) {
+    total.merge(stats);
+    perThread.push_back(stats.toDynamic(config.duration));
+  }
+  auto report = folly::dynamic::object(
+      "config",
+      folly::dynamic::object("protocol", toString(config.protocol))(
+          "server", config.server.describe())("path", config.path)(
+          "method", FLAGS_http_method)("body_size", config.bodySize)(
+          "rate", FLAGS_rate)("poisson", config.poissonArrivals)(
+          "threads", FLAGS_threads)("connections_per_thread",
+                                    config.connections)(
+          "warmup_s", FLAGS_warmup_s)("duration_s", FLAGS_duration_s))(
+      "total", total.toDynamic(config.duration))("threads",
+                                                  std::move(perThread));
+  auto json = folly::toPrettyJson(report);
+  if (FLAGS_output.empty()) {
+    std::cout << json << std::endl;
+  } else if (!folly::writeFile(json, FLAGS_output.c_str())) {
+    LOG(ERROR) << "Failed to write " << FLAGS_output;
+    return EXIT_FAILURE;
+  }
+  return total.errors == 0 && total.connectErrors == 0 ? EXIT_SUCCESS
+                                                        : EXIT_FAILURE;
+}
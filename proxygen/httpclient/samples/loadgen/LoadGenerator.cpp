@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpclient/samples/loadgen/LoadGenerator.h>
+
+#include <algorithm>
+
+#include <proxygen/httpserver/samples/hq/InsecureVerifierDangerousDoNotUseInProduction.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+
+using namespace proxygen;
+using std::chrono::microseconds;
+
+namespace {
+// Resolution of the request scheduler
+constexpr std::chrono::milliseconds kTickInterval{1};
+
+uint64_t usBetween(TimePoint end, TimePoint start) {
+  return end > start
+             ? std::chrono::duration_cast<microseconds>(end - start).count()
+             : 0;
+}
+} // namespace
+
+namespace LoadGenService {
+
+folly::Optional<Protocol> parseProtocol(folly::StringPiece str) {
+  if (str == "h1" || str == "http/1.1") {
+    return Protocol::HTTP1;
+  } else if (str == "h2") {
+    return Protocol::HTTP2;
+  } else if (str == "h3") {
+    return Protocol::HTTP3;
+  }
+  return folly::none;
+}
+
+folly::StringPiece toString(Protocol protocol) {
+  switch (protocol) {
+    case Protocol::HTTP1:
+      return "h1";
+    case Protocol::HTTP2:
+      return "h2";
+    case Protocol::HTTP3:
+      return "h3";
+  }
+  return "unknown";
+}
+
+void LoadGenStats::merge(const LoadGenStats& other) {
+  scheduled += other.scheduled;
+  sent += other.sent;
+  completed += other.completed;
+  errors += other.errors;
+  timeouts += other.timeouts;
+  dropped += other.dropped;
+  connections += other.connections;
+  connectErrors += other.connectErrors;
+  bodyBytes += other.bodyBytes;
+  for (size_t i = 0; i < statusClasses.size(); i++) {
+    statusClasses[i] += other.statusClasses[i];
+  }
+  latency.merge(other.latency);
+  serviceTime.merge(other.serviceTime);
+}
+
+folly::dynamic LoadGenStats::toDynamic(
+    std::chrono::milliseconds duration) const {
+  double seconds = duration.count() / 1000.0;
+  folly::dynamic status = folly::dynamic::object;
+  for (size_t i = 1; i < statusClasses.size(); i++) {
+    status[folly::to<std::string>(i, "xx")] = statusClasses[i];
+  }
+  return folly::dynamic::object("scheduled", scheduled)("sent", sent)(
+      "completed", completed)("errors", errors)("timeouts", timeouts)(
+      "dropped", dropped)("connections", connections)(
+      "connect_errors", connectErrors)("body_bytes", bodyBytes)(
+      "status", std::move(status))(
+      "completed_per_sec", seconds > 0 ? completed / seconds : 0.0)(
+      "latency_us", latency.toDynamic())("service_time_us",
+                                         serviceTime.toDynamic());
+}
+
+/**
+ * One connection slot. Reused for a new connection once the previous one
+ * has been handed to the pool or failed.
+ */
+class LoadGenerator::Connector
+    : public HTTPConnector::Callback
+    , public HQConnector::Callback {
+ public:
+  explicit Connector(LoadGenerator& parent) : parent_(parent) {
+    if (parent_.config_.protocol == Protocol::HTTP3) {
+      hqConnector_ = std::make_unique<HQConnector>(
+          this, parent_.config_.requestTimeout);
+      hqConnector_->setTransportSettings(parent_.config_.transportSettings);
+    } else {
+      httpConnector_ =
+          std::make_unique<HTTPConnector>(this, parent_.timer_.get());
+      if (parent_.config_.protocol == Protocol::HTTP2 &&
+          !parent_.config_.useTLS) {
+        httpConnector_->setPlaintextProtocol(http2::kProtocolCleartextString);
+      }
+    }
+  }
+
+  bool isBusy() const {
+    return hqConnector_ ? hqConnector_->isBusy() : httpConnector_->isBusy();
+  }
+
+  void connect() {
+    const auto& config = parent_.config_;
+    if (hqConnector_) {
+      hqConnector_->connect(parent_.evb_,
+                            folly::none,
+                            config.server,
+                            parent_.fizzContext_,
+                            parent_.verifier_,
+                            config.connectTimeout,
+                            folly::emptySocketOptionMap,
+                            config.authority);
+    } else if (config.useTLS) {
+      httpConnector_->connectSSL(parent_.evb_,
+                                 config.server,
+                                 parent_.sslContext_,
+                                 nullptr,
+                                 config.connectTimeout,
+                                 folly::emptySocketOptionMap,
+                                 folly::AsyncSocket::anyAddress(),
+                                 config.authority);
+    } else {
+      httpConnector_->connect(
+          parent_.evb_, config.server, config.connectTimeout);
+    }
+  }
+
+  // HTTPConnector::Callback
+  void connectSuccess(HTTPUpstreamSession* session) override {
+    parent_.onConnected(session);
+  }
+
+  void connectError(const folly::AsyncSocketException& ex) override {
+    VLOG(2) << "Connect error: " << ex.what();
+    parent_.onConnectError();
+  }
+
+  // HQConnector::Callback
+  void connectSuccess(HQUpstreamSession* session) override {
+    parent_.onConnected(session);
+  }
+
+  void connectError(const quic::QuicErrorCode& code) override {
+    VLOG(2) << "Connect error: " << quic::toString(code);
+    parent_.onConnectError();
+  }
+
+ private:
+  LoadGenerator& parent_;
+  std::unique_ptr<HTTPConnector> httpConnector_;
+  std::unique_ptr<HQConnector> hqConnector_;
+};
+
+/**
+ * Handler for a single request, deletes itself when the transaction
+ * detaches.
+ */
+class LoadGenerator::RequestHandler : public HTTPTransactionHandler {
+ public:
+  RequestHandler(LoadGenerator& parent, TimePoint intended)
+      : intended_(intended), parent_(parent) {
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    parent_.onRequestDone(*this);
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    status_ = msg->getStatusCode();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    bodyBytes_ += chain->computeChainDataLength();
+  }
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept override {
+  }
+
+  void onEOM() noexcept override {
+    eomTime_ = getCurrentTime();
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const HTTPException& error) noexcept override {
+    VLOG(3) << "Request error: " << error.what();
+    errored_ = true;
+    timedOut_ = error.getProxygenError() == kErrorTimeout;
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+  void send(HTTPMessage& request, const folly::IOBuf* body) {
+    sendTime_ = getCurrentTime();
+    if (!body) {
+      txn_->sendHeadersWithEOM(request);
+      return;
+    }
+    txn_->sendHeaders(request);
+    txn_->sendBody(body->clone());
+    txn_->sendEOM();
+  }
+
+  TimePoint intended_;
+  TimePoint sendTime_;
+  folly::Optional<TimePoint> eomTime_;
+  uint64_t bodyBytes_{0};
+  uint16_t status_{0};
+  bool errored_{false};
+  bool timedOut_{false};
+
+ private:
+  LoadGenerator& parent_;
+  HTTPTransaction* txn_{nullptr};
+};
+
+LoadGenerator::LoadGenerator(folly::EventBase* evb,
+                             const LoadGenConfig& config)
+    : evb_(evb),
+      config_(config),
+      rng_(std::random_device()()),
+      arrivals_(config.requestsPerSec),
+      timer_(folly::HHWheelTimer::newTimer(
+          evb,
+          std::chrono::milliseconds(folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+          folly::AsyncTimeout::InternalEnum::NORMAL,
+          config.requestTimeout)),
+      // Sessions stay pooled for the whole run
+      pool_(nullptr,
+            config.connections,
+            config.warmup + config.duration + config.requestTimeout),
+      ticker_(evb, *this) {
+  CHECK_GT(config_.requestsPerSec, 0);
+  if (config_.protocol == Protocol::HTTP3) {
+    auto fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+    fizzContext->setSupportedAlpns({kH3});
+    fizzContext->setDefaultShares(
+        {fizz::NamedGroup::x25519, fizz::NamedGroup::secp256r1});
+    fizzContext->setSendEarlyData(false);
+    fizzContext_ = std::move(fizzContext);
+    // Load testing only, the server is trusted
+    verifier_ =
+        std::make_shared<InsecureVerifierDangerousDoNotUseInProduction>();
+  } else if (config_.useTLS) {
+    sslContext_ = std::make_shared<folly::SSLContext>();
+    sslContext_->setOptions(SSL_OP_NO_COMPRESSION);
+    sslContext_->setAdvertisedNextProtocols(
+        {config_.protocol == Protocol::HTTP2 ? http2::kProtocolString
+                                             : "http/1.1"});
+    sslContext_->setVerificationOption(
+        folly::SSLContext::SSLVerifyPeerEnum::NO_VERIFY);
+  }
+  if (config_.bodySize > 0) {
+    body_ = folly::IOBuf::create(config_.bodySize);
+    memset(body_->writableData(), 'a', config_.bodySize);
+    body_->append(config_.bodySize);
+  }
+  for (uint32_t i = 0; i < config_.connections; i++) {
+    connectors_.emplace_back(std::make_unique<Connector>(*this));
+  }
+}
+
+LoadGenerator::~LoadGenerator() {
+  cancelLoopCallback();
+}
+
+void LoadGenerator::run() {
+  auto now = getCurrentTime();
+  nextArrival_ = now;
+  measureStart_ = now + config_.warmup;
+  measureEnd_ = measureStart_ + config_.duration;
+  maintainConnections();
+  ticker_.scheduleTimeout(kTickInterval);
+  evb_->loop();
+}
+
+std::chrono::nanoseconds LoadGenerator::nextInterArrival() {
+  double seconds = config_.poissonArrivals ? arrivals_(rng_)
+                                           : 1.0 / config_.requestsPerSec;
+  return std::chrono::nanoseconds(static_cast<int64_t>(seconds * 1e9));
+}
+
+void LoadGenerator::onTick() {
+  auto now = getCurrentTime();
+  if (!stopping_) {
+    maintainConnections();
+    auto end = std::min(now, measureEnd_);
+    while (nextArrival_ <= end) {
+      scheduleRequest(nextArrival_);
+      nextArrival_ += nextInterArrival();
+    }
+    drainBacklog();
+    if (now >= measureEnd_) {
+      stopping_ = true;
+      // Whatever could not be sent in the window is never sent
+      stats_.dropped += std::count_if(
+          backlog_.begin(), backlog_.end(), [this](TimePoint intended) {
+            return isMeasured(intended);
+          });
+      backlog_.clear();
+    }
+  }
+  if (stopping_ &&
+      (outstanding_ == 0 || now >= measureEnd_ + config_.requestTimeout)) {
+    finish();
+    return;
+  }
+  ticker_.scheduleTimeout(kTickInterval);
+}
+
+void LoadGenerator::maintainConnections() {
+  auto numSessions = pool_.getNumSessions();
+  for (auto& connector : connectors_) {
+    if (numSessions + numConnecting_ >= config_.connections) {
+      break;
+    }
+    if (!connector->isBusy()) {
+      numConnecting_++;
+      connector->connect();
+    }
+  }
+}
+
+void LoadGenerator::scheduleRequest(TimePoint intended) {
+  bool measured = isMeasured(intended);
+  if (measured) {
+    stats_.scheduled++;
+  }
+  if (backlog_.size() >= config_.maxBacklog) {
+    if (measured) {
+      stats_.dropped++;
+    }
+    return;
+  }
+  backlog_.push_back(intended);
+}
+
+bool LoadGenerator::sendRequest(TimePoint intended) {
+  auto handler = new RequestHandler(*this, intended);
+  auto txn = pool_.getTransaction(handler);
+  if (!txn) {
+    delete handler;
+    return false;
+  }
+  outstanding_++;
+  if (isMeasured(intended)) {
+    stats_.sent++;
+  }
+  HTTPMessage request;
+  request.setMethod(config_.method);
+  request.setURL(config_.path);
+  request.setHTTPVersion(1, 1);
+  request.getHeaders() = config_.headers;
+  request.getHeaders().set(HTTP_HEADER_HOST, config_.authority);
+  if (body_) {
+    request.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                             folly::to<std::string>(config_.bodySize));
+  }
+  handler->send(request, body_.get());
+  return true;
+}
+
+void LoadGenerator::drainBacklog() {
+  while (!backlog_.empty() && sendRequest(backlog_.front())) {
+    backlog_.pop_front();
+  }
+}
+
+void LoadGenerator::finish() {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  ticker_.cancelTimeout();
+  cancelLoopCallback();
+  // Idle sessions close, the loop exits once they are gone
+  pool_.drainAllSessions();
+}
+
+void LoadGenerator::onConnected(HTTPSessionBase* session) {
+  DCHECK_GT(numConnecting_, 0);
+  numConnecting_--;
+  stats_.connections++;
+  if (finished_) {
+    session->drain();
+    session->closeWhenIdle();
+    return;
+  }
+  pool_.putSession(session);
+  drainBacklog();
+}
+
+void LoadGenerator::onConnectError() {
+  DCHECK_GT(numConnecting_, 0);
+  numConnecting_--;
+  stats_.connectErrors++;
+}
+
+void LoadGenerator::onRequestDone(const RequestHandler& handler) {
+  DCHECK_GT(outstanding_, 0);
+  outstanding_--;
+  if (isMeasured(handler.intended_)) {
+    stats_.bodyBytes += handler.bodyBytes_;
+    if (handler.eomTime_ && !handler.errored_) {
+      stats_.completed++;
+      stats_.latency.record(usBetween(*handler.eomTime_, handler.intended_));
+      stats_.serviceTime.record(
+          usBetween(*handler.eomTime_, handler.sendTime_));
+      auto statusClass = handler.status_ / 100;
+      if (statusClass < stats_.statusClasses.size()) {
+        stats_.statusClasses[statusClass]++;
+      }
+    } else {
+      stats_.errors++;
+      if (handler.timedOut_) {
+        stats_.timeouts++;
+      }
+    }
+  }
+  // A stream may have freed up. Don't start a new transaction from inside
+  // the session's detach callback.
+  if (!finished_ && !backlog_.empty() && !isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void LoadGenerator::runLoopCallback() noexcept {
+  drainBacklog();
+}
+
+} // namespace LoadGenService
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <deque>
+#include <random>
+
+#include <fizz/client/FizzClientContext.h>
+#include <fizz/protocol/CertificateVerifier.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/io/async/SSLContext.h>
+#include <proxygen/httpclient/samples/loadgen/LatencyHistogram.h>
+#include <proxygen/lib/http/HQConnector.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace LoadGenService {
+
+enum class Protocol { HTTP1, HTTP2, HTTP3 };
+
+folly::Optional<Protocol> parseProtocol(folly::StringPiece str);
+folly::StringPiece toString(Protocol protocol);
+
+struct LoadGenConfig {
+  Protocol protocol{Protocol::HTTP2};
+  folly::SocketAddress server;
+  // Host header and SNI
+  std::string authority;
+  // HTTP/1.1 and HTTP/2 only, HTTP/3 always uses TLS
+  bool useTLS{true};
+  proxygen::HTTPMethod method{proxygen::HTTPMethod::GET};
+  std::string path{"/"};
+  proxygen::HTTPHeaders headers;
+  size_t bodySize{0};
+  // Requests are started at this rate regardless of how quickly responses
+  // arrive (open loop). Per LoadGenerator.
+  double requestsPerSec{1000};
+  // Exponentially distributed inter-arrival times instead of fixed ones
+  bool poissonArrivals{false};
+  // Connections kept open per LoadGenerator
+  uint32_t connections{10};
+  std::chrono::milliseconds warmup{0};
+  std::chrono::milliseconds duration{std::chrono::seconds(10)};
+  std::chrono::milliseconds connectTimeout{std::chrono::seconds(1)};
+  std::chrono::milliseconds requestTimeout{std::chrono::seconds(5)};
+  // Requests waiting for a free stream beyond this many are dropped
+  size_t maxBacklog{10000};
+  quic::TransportSettings transportSettings;
+};
+
+struct LoadGenStats {
+  // Requests whose scheduled start fell inside the measurement window
+  uint64_t scheduled{0};
+  uint64_t sent{0};
+  uint64_t completed{0};
+  uint64_t errors{0};
+  uint64_t timeouts{0};
+  // Never sent because the backlog was full or the run ended
+  uint64_t dropped{0};
+  uint64_t connections{0};
+  uint64_t connectErrors{0};
+  uint64_t bodyBytes{0};
+  // Indexed by status code / 100
+  std::array<uint64_t, 6> statusClasses{};
+  // Microseconds from the scheduled start, includes time in the backlog
+  LatencyHistogram latency;
+  // Microseconds from when the request was actually sent
+  LatencyHistogram serviceTime;
+
+  void merge(const LoadGenStats& other);
+  folly::dynamic toDynamic(std::chrono::milliseconds duration) const;
+};
+
+/**
+ * Drives open-loop HTTP load from a single EventBase thread. Connections
+ * are created with HTTPConnector (HTTP/1.1, HTTP/2) or HQConnector
+ * (HTTP/3) and handed to a SessionPool, which multiplexes requests over
+ * them. Requests that cannot get a stream wait in a backlog; their latency
+ * is measured from the scheduled start so a saturated server cannot hide
+ * queueing delay (coordinated omission).
+ */
+class LoadGenerator : private folly::EventBase::LoopCallback {
+ public:
+  LoadGenerator(folly::EventBase* evb, const LoadGenConfig& config);
+  ~LoadGenerator() override;
+
+  // Runs the event base until the measurement window has elapsed and
+  // outstanding requests have finished or timed out
+  void run();
+
+  const LoadGenStats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  class Connector;
+  class RequestHandler;
+
+  class Ticker : public folly::AsyncTimeout {
+   public:
+    Ticker(folly::EventBase* evb, LoadGenerator& parent)
+        : folly::AsyncTimeout(evb), parent_(parent) {
+    }
+
+    void timeoutExpired() noexcept override {
+      parent_.onTick();
+    }
+
+   private:
+    LoadGenerator& parent_;
+  };
+
+  void onTick();
+  void maintainConnections();
+  void scheduleRequest(proxygen::TimePoint intended);
+  bool sendRequest(proxygen::TimePoint intended);
+  void drainBacklog();
+  void finish();
+  std::chrono::nanoseconds nextInterArrival();
+  bool isMeasured(proxygen::TimePoint intended) const {
+    return intended >= measureStart_ && intended < measureEnd_;
+  }
+
+  void onConnected(proxygen::HTTPSessionBase* session);
+  void onConnectError();
+  void onRequestDone(const RequestHandler& handler);
+
+  // EventBase::LoopCallback, drains the backlog after a stream frees up
+  void runLoopCallback() noexcept override;
+
+  folly::EventBase* evb_;
+  const LoadGenConfig& config_;
+  std::shared_ptr<folly::SSLContext> sslContext_;
+  std::shared_ptr<const fizz::client::FizzClientContext> fizzContext_;
+  std::shared_ptr<const fizz::CertificateVerifier> verifier_;
+  std::unique_ptr<folly::IOBuf> body_;
+  std::mt19937_64 rng_;
+  std::exponential_distribution<double> arrivals_;
+  // Declared before pool_ so sessions are destroyed first
+  folly::HHWheelTimer::UniquePtr timer_;
+  proxygen::SessionPool pool_;
+  std::vector<std::unique_ptr<Connector>> connectors_;
+  Ticker ticker_;
+  std::deque<proxygen::TimePoint> backlog_;
+  proxygen::TimePoint nextArrival_;
+  proxygen::TimePoint measureStart_;
+  proxygen::TimePoint measureEnd_;
+  uint32_t numConnecting_{0};
+  uint64_t outstanding_{0};
+  LoadGenStats stats_;
+  bool stopping_{false};
+  bool finished_{false};
+};
+
+} // namespace LoadGenService
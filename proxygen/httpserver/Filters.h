@@ -93,6 +93,10 @@ class Filter
     downstream_->sendHeaders(msg);
   }
 
+  bool sendEarlyHints(const HTTPMessage& hints) noexcept override {
+    return downstream_->sendEarlyHints(hints);
+  }
+
   void sendChunkHeader(size_t len) noexcept override {
     downstream_->sendChunkHeader(len);
   }
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/HQServer.h>
+
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <quic/congestion_control/ServerCongestionControllerFactory.h>
+#include <quic/server/QuicReusePortUDPSocketFactory.h>
+#include <quic/server/QuicSharedUDPSocketFactory.h>
+#include <thread>
+
+using quic::QuicServerTransport;
+
+namespace proxygen {
+
+namespace {
+
+// State shared by the transport factory and every session controller. Kept
+// in a shared_ptr so sessions draining on a worker do not depend on the
+// HQServer object.
+struct SessionContext {
+  HQServer::HandlerProvider handlerProvider;
+  HQServer::SessionCallback onTransportReady;
+  HQServer::TransportCallback onNewTransport;
+  std::chrono::milliseconds txnTimeout;
+  std::function<void(int64_t)> onSessionCountChange;
+};
+
+} // namespace
+
+/**
+ * Controller for a single HQDownstreamSession. It is self owning and is
+ * destroyed when the session detaches.
+ */
+class HQServer::SessionController
+    : public HTTPSessionController
+    , public HTTPSessionBase::InfoCallback {
+ public:
+  explicit SessionController(std::shared_ptr<const SessionContext> ctx)
+      : ctx_(std::move(ctx)) {
+  }
+
+  HQSession* createSession() {
+    wangle::TransportInfo tinfo;
+    session_ = new HQDownstreamSession(ctx_->txnTimeout, this, tinfo, this);
+    return session_;
+  }
+
+  void startSession(std::shared_ptr<quic::QuicSocket> sock) {
+    CHECK(session_);
+    session_->setSocket(std::move(sock));
+    session_->startNow();
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction& /*txn*/,
+                                            HTTPMessage* msg) override {
+    return ctx_->handlerProvider(msg);
+  }
+
+  HTTPTransactionHandler* FOLLY_NULLABLE
+  getParseErrorHandler(HTTPTransaction* /*txn*/,
+                       const HTTPException& /*error*/,
+                       const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  HTTPTransactionHandler* FOLLY_NULLABLE getTransactionTimeoutHandler(
+      HTTPTransaction* /*txn*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  void attachSession(HTTPSessionBase* /*session*/) override {
+    ctx_->onSessionCountChange(1);
+  }
+
+  void detachSession(const HTTPSessionBase* /*session*/) override {
+    ctx_->onSessionCountChange(-1);
+    delete this;
+  }
+
+  void onTransportReady(HTTPSessionBase* /*session*/) override {
+    if (ctx_->onTransportReady) {
+      ctx_->onTransportReady(session_);
+    }
+  }
+
+  void onTransportReady(const HTTPSessionBase&) override {
+  }
+
+  void onDestroy(const HTTPSessionBase&) override {
+  }
+
+ private:
+  ~SessionController() override = default;
+
+  // The owning session. NOTE: this must be a plain pointer to avoid
+  // circular references
+  HQSession* session_{nullptr};
+  std::shared_ptr<const SessionContext> ctx_;
+};
+
+class HQServer::TransportFactory : public quic::QuicServerTransportFactory {
+ public:
+  explicit TransportFactory(std::shared_ptr<const SessionContext> ctx)
+      : ctx_(std::move(ctx)) {
+  }
+
+  // Called on the worker that owns the new connection
+  QuicServerTransport::Ptr make(
+      folly::EventBase* evb,
+      std::unique_ptr<folly::AsyncUDPSocket> socket,
+      const folly::SocketAddress& /* peerAddr */,
+      quic::QuicVersion,
+      std::shared_ptr<const fizz::server::FizzServerContext> ctx) noexcept
+      override {
+    CHECK_EQ(evb, socket->getEventBase());
+    auto controller = new SessionController(ctx_);
+    auto session = controller->createSession();
+    auto transport = QuicServerTransport::make(
+        evb, std::move(socket), session, session, std::move(ctx));
+    if (ctx_->onNewTransport) {
+      ctx_->onNewTransport(*transport);
+    }
+    controller->startSession(transport);
+    return transport;
+  }
+
+ private:
+  std::shared_ptr<const SessionContext> ctx_;
+};
+
+HQServer::HQServer(Options options, HandlerProvider handlerProvider)
+    : options_(std::move(options)),
+      server_(quic::QuicServer::createQuicServer()),
+      stats_(std::make_shared<Stats>()) {
+  CHECK(options_.fizzContext) << "HQServer requires a fizz context";
+  CHECK(handlerProvider);
+  numWorkers_ = options_.threads > 0
+                    ? options_.threads
+                    : std::max(std::thread::hardware_concurrency(), 1u);
+
+  auto& settings = options_.transportSettings;
+  if (options_.useGSO &&
+      settings.batchingMode == quic::QuicBatchingMode::BATCHING_MODE_NONE) {
+    // Falls back to unbatched writes if the kernel lacks UDP_SEGMENT
+    settings.batchingMode = quic::QuicBatchingMode::BATCHING_MODE_GSO;
+  }
+
+  auto ctx = std::make_shared<SessionContext>();
+  ctx->handlerProvider = std::move(handlerProvider);
+  ctx->onTransportReady = options_.onTransportReady;
+  ctx->onNewTransport = options_.onNewTransport;
+  ctx->txnTimeout = options_.txnTimeout;
+  ctx->onSessionCountChange = [stats = stats_](int64_t delta) {
+    if (delta > 0) {
+      stats->sessionsCreated.fetch_add(1, std::memory_order_relaxed);
+      stats->activeSessions.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      stats->activeSessions.fetch_sub(1, std::memory_order_relaxed);
+    }
+  };
+
+  server_->setBindV6Only(false);
+  server_->setHostId(options_.hostId);
+  server_->setCongestionControllerFactory(
+      std::make_shared<quic::ServerCongestionControllerFactory>());
+  server_->setTransportSettings(settings);
+  server_->setQuicServerTransportFactory(
+      std::make_unique<TransportFactory>(std::move(ctx)));
+  if (options_.reusePortPerWorker) {
+    server_->setQuicUDPSocketFactory(
+        std::make_unique<quic::QuicReusePortUDPSocketFactory>());
+  } else {
+    server_->setQuicUDPSocketFactory(
+        std::make_unique<quic::QuicSharedUDPSocketFactory>());
+  }
+  if (!options_.healthCheckToken.empty()) {
+    server_->setHealthCheckToken(options_.healthCheckToken);
+  }
+  server_->setSupportedVersion(options_.supportedVersions);
+  server_->setFizzContext(options_.fizzContext);
+  if (options_.rateLimitPerThread) {
+    server_->setRateLimit(
+        [rateLimitPerThread = *options_.rateLimitPerThread]() {
+          return rateLimitPerThread;
+        },
+        std::chrono::seconds(1));
+  }
+}
+
+HQServer::~HQServer() {
+  stop();
+}
+
+void HQServer::start() {
+  CHECK(!started_);
+  started_ = true;
+  server_->start(options_.address, numWorkers_);
+}
+
+const folly::SocketAddress& HQServer::getAddress() const {
+  server_->waitUntilInitialized();
+  return server_->getAddress();
+}
+
+void HQServer::stop() {
+  if (!started_ || stopped_) {
+    return;
+  }
+  stopped_ = true;
+  server_->shutdown();
+}
+
+void HQServer::rejectNewConnections(bool reject) {
+  server_->rejectNewConnections([reject]() { return reject; });
+}
+
+} // namespace proxygen
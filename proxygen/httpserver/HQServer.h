@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <quic/server/QuicServer.h>
+
+namespace proxygen {
+
+class HQSession;
+
+/**
+ * HTTP/3 server built on mvfst's QuicServer.
+ *
+ * The server runs one QUIC worker per thread, each with its own EventBase.
+ * With reusePortPerWorker (the default) every worker binds its own
+ * SO_REUSEPORT socket so the kernel spreads ingress across workers. The
+ * server-chosen connection IDs encode the owning worker, and packets that
+ * land on another worker (eg: after a client address change) are routed to
+ * the owner by QuicServer. An HQDownstreamSession is created on the owning
+ * worker's EventBase for every accepted transport and never leaves it, so
+ * no session state is shared between threads.
+ *
+ * Egress uses UDP GSO batched writes by default.
+ */
+class HQServer {
+ public:
+  using HandlerProvider =
+      std::function<HTTPTransactionHandler*(HTTPMessage* /* msg */)>;
+  using SessionCallback = std::function<void(HQSession* /* session */)>;
+  using TransportCallback =
+      std::function<void(quic::QuicServerTransport& /* transport */)>;
+
+  struct Options {
+    folly::SocketAddress address;
+    // Number of worker threads, 0 means one per CPU
+    size_t threads{0};
+    quic::TransportSettings transportSettings;
+    std::vector<quic::QuicVersion> supportedVersions{
+        quic::QuicVersion::MVFST, quic::QuicVersion::QUIC_V1};
+    // Must advertise the HTTP/3 ALPNs the server accepts
+    std::shared_ptr<const fizz::server::FizzServerContext> fizzContext;
+    std::chrono::milliseconds txnTimeout{std::chrono::seconds(5)};
+    // Bind one SO_REUSEPORT socket per worker instead of sharing one socket
+    bool reusePortPerWorker{true};
+    // Switch to GSO batched writes when transportSettings does not select a
+    // batching mode
+    bool useGSO{true};
+    // Host id encoded in connection IDs, for L4 load balancers
+    uint32_t hostId{0};
+    std::string healthCheckToken{"health"};
+    // New connections accepted per second per worker
+    folly::Optional<int64_t> rateLimitPerThread;
+    // Invoked on the worker thread for each new transport, eg: to attach a
+    // QLogger
+    TransportCallback onNewTransport;
+    // Invoked on the worker thread once a session's transport is ready
+    SessionCallback onTransportReady;
+  };
+
+  HQServer(Options options, HandlerProvider handlerProvider);
+  ~HQServer();
+
+  HQServer(const HQServer&) = delete;
+  HQServer& operator=(const HQServer&) = delete;
+
+  // Starts the workers in background threads
+  void start();
+
+  // Returns the listening address of the server
+  // NOTE: blocks until the server has started
+  const folly::SocketAddress& getAddress() const;
+
+  // Stops the workers. Open sessions are closed.
+  void stop();
+
+  // Sets/unsets "reject connections" flag on the QUIC server
+  void rejectNewConnections(bool reject);
+
+  // For settings not covered by Options, eg: CCP. Must be called before
+  // start().
+  quic::QuicServer& getQuicServer() {
+    return *server_;
+  }
+
+  size_t getNumWorkers() const {
+    return numWorkers_;
+  }
+
+  uint64_t getNumSessionsCreated() const {
+    return stats_->sessionsCreated.load(std::memory_order_relaxed);
+  }
+
+  uint64_t getNumActiveSessions() const {
+    return stats_->activeSessions.load(std::memory_order_relaxed);
+  }
+
+ private:
+  class TransportFactory;
+  class SessionController;
+
+  // Shared with the worker threads, which may outlive stop() briefly
+  struct Stats {
+    std::atomic<uint64_t> sessionsCreated{0};
+    std::atomic<uint64_t> activeSessions{0};
+  };
+
+  Options options_;
+  std::shared_ptr<quic::QuicServer> server_;
+  std::shared_ptr<Stats> stats_;
+  size_t numWorkers_{0};
+  bool started_{false};
+  bool stopped_{false};
+};
+
+} // namespace proxygen
@@ -29,6 +29,8 @@ AcceptorConfiguration HTTPServerAcceptor::makeConfig(
   conf.initialReceiveWindow = opts.initialReceiveWindow;
   conf.receiveStreamWindowSize = opts.receiveStreamWindowSize;
   conf.receiveSessionWindowSize = opts.receiveSessionWindowSize;
+  conf.maxActiveWrites = opts.maxActiveWrites;
+  conf.egressNotSentLowat = opts.egressNotSentLowat;
   conf.acceptBacklog = opts.listenBacklog;
   conf.maxConcurrentIncomingStreams = opts.maxConcurrentIncomingStreams;
 
@@ -104,6 +104,15 @@ class HTTPServerOptions {
   size_t receiveStreamWindowSize{65536};
   size_t receiveSessionWindowSize{65536};
 
+  /**
+   * Number of writes each HTTP/1.1 or HTTP/2 session may have outstanding on
+   * its socket, and the TCP_NOTSENT_LOWAT to apply (0 = leave unset).  A
+   * small low water mark with 2-4 writes in flight keeps high-BDP paths busy
+   * without moving priority decisions into the kernel send buffer.
+   */
+  uint32_t maxActiveWrites{1};
+  uint32_t egressNotSentLowat{0};
+
   /**
    * The maximum number of transactions the remote could initiate
    * per connection on protocols that allow multiplexing.
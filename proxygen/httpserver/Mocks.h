@@ -38,6 +38,7 @@ class MockResponseHandler : public ResponseHandler {
   MOCK_METHOD((void), sendChunkTerminator, (), (noexcept));
   MOCK_METHOD((void), sendEOM, (), (noexcept));
   MOCK_METHOD((void), sendHeaders, (HTTPMessage&), (noexcept));
+  MOCK_METHOD((bool), sendEarlyHints, (const HTTPMessage&), (noexcept));
   MOCK_METHOD((void), sendTrailers, (const HTTPHeaders&), (noexcept));
   MOCK_METHOD((folly::Expected<ResponseHandler*, ProxygenError>),
               newPushedResponse,
@@ -169,6 +169,10 @@ void RequestHandlerAdaptor::sendHeaders(HTTPMessage& msg) noexcept {
   txn_->sendHeaders(msg);
 }
 
+bool RequestHandlerAdaptor::sendEarlyHints(const HTTPMessage& hints) noexcept {
+  return txn_->sendEarlyHints(hints);
+}
+
 void RequestHandlerAdaptor::sendChunkHeader(size_t len) noexcept {
   txn_->sendChunkHeader(len);
 }
@@ -56,6 +56,7 @@ class RequestHandlerAdaptor
 
   // ResponseHandler
   void sendHeaders(HTTPMessage& msg) noexcept override;
+  bool sendEarlyHints(const HTTPMessage& hints) noexcept override;
   void sendChunkHeader(size_t len) noexcept override;
   void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
   void sendChunkTerminator() noexcept override;
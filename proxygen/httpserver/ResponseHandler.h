@@ -59,6 +59,16 @@ class ResponseHandler {
    */
   virtual void sendHeaders(HTTPMessage& msg) noexcept = 0;
 
+  /**
+   * Send a 103 (Early Hints) response before the final response headers.
+   * The message is shared and must not be modified by filters. Returns
+   * false if the hints could not be sent (eg: HTTP/1.0 client, or the final
+   * response has already started).
+   */
+  virtual bool sendEarlyHints(const HTTPMessage& /*hints*/) noexcept {
+    return false;
+  }
+
   virtual void sendChunkHeader(size_t len) noexcept = 0;
 
   virtual void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept = 0;
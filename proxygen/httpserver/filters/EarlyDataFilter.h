@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/http/EarlyDataPolicy.h>
+
+namespace proxygen {
+
+/**
+ * A filter that answers 425 (Too Early) to early data requests its
+ * EarlyDataPolicy refuses, so the client retries after the handshake.
+ * Others pass through.
+ */
+class EarlyDataFilter : public Filter {
+ public:
+  EarlyDataFilter(RequestHandler* upstream,
+                  std::shared_ptr<EarlyDataPolicy> policy)
+      : Filter(upstream), policy_(std::move(policy)) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    if (policy_->shouldProcess(*msg)) {
+      Filter::onRequest(std::move(msg));
+      return;
+    }
+    upstream_->onError(kErrorEarlyDataRejected);
+    upstream_ = nullptr;
+
+    ResponseBuilder(downstream_).status(425, "Too Early").sendWithEOM();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (upstream_) {
+      Filter::onBody(std::move(body));
+    }
+  }
+
+  void onUpgrade(UpgradeProtocol protocol) noexcept override {
+    if (upstream_) {
+      Filter::onUpgrade(protocol);
+    }
+  }
+
+  void onEOM() noexcept override {
+    if (upstream_) {
+      Filter::onEOM();
+    }
+  }
+
+  void requestComplete() noexcept override {
+    if (upstream_) {
+      Filter::requestComplete();
+      return;
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    if (upstream_) {
+      Filter::onError(err);
+      return;
+    }
+    delete this;
+  }
+
+  void onGoaway(ErrorCode code) noexcept override {
+    if (upstream_) {
+      Filter::onGoaway(code);
+    }
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      Filter::onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      Filter::onEgressResumed();
+    }
+  }
+
+ private:
+  std::shared_ptr<EarlyDataPolicy> policy_;
+};
+
+class EarlyDataFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit EarlyDataFilterFactory(std::shared_ptr<EarlyDataPolicy> policy)
+      : policy_(std::move(policy)) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    if (EarlyDataPolicy::isEarlyData(*msg)) {
+      return new EarlyDataFilter(h, policy_);
+    }
+
+    // No need to insert this filter
+    return h;
+  }
+
+ private:
+  std::shared_ptr<EarlyDataPolicy> policy_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/filters/EarlyDataFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+class EarlyDataFilterTest : public Test {
+ public:
+  void SetUp() override {
+    // requestHandler_ is the server, responseHandler_ the client
+    requestHandler_ = new StrictMock<MockRequestHandler>();
+    responseHandler_ =
+        std::make_unique<StrictMock<MockResponseHandler>>(requestHandler_);
+  }
+
+  void TearDown() override {
+    Mock::VerifyAndClear(requestHandler_);
+    Mock::VerifyAndClear(responseHandler_.get());
+
+    delete requestHandler_;
+  }
+
+ protected:
+  static HTTPMessage makeRequest(HTTPMethod method, bool earlyData = true) {
+    HTTPMessage msg;
+    msg.setMethod(method);
+    msg.setURL("/resource");
+    msg.getHeaders().set(HTTP_HEADER_HOST, "www.example.com");
+    msg.setEarlyData(earlyData);
+    return msg;
+  }
+
+  // Build the filter for msg and connect it to the mock handlers
+  RequestHandler* makeFilter(HTTPMessage& msg) {
+    auto filter = factory_->onRequest(requestHandler_, &msg);
+    EXPECT_NE(filter, requestHandler_);
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_))
+        .WillOnce(SaveArg<0>(&downstream_));
+    filter->setResponseHandler(responseHandler_.get());
+    return filter;
+  }
+
+  void expectTooEarly() {
+    EXPECT_CALL(*requestHandler_, onError(kErrorEarlyDataRejected));
+    EXPECT_CALL(*responseHandler_, sendHeaders(_))
+        .WillOnce(Invoke([](HTTPMessage& response) {
+          EXPECT_EQ(response.getStatusCode(), 425);
+        }));
+    EXPECT_CALL(*responseHandler_, sendEOM());
+  }
+
+  std::shared_ptr<EarlyDataPolicy> policy_{
+      std::make_shared<EarlyDataPolicy>(EarlyDataPolicy::Options())};
+  std::unique_ptr<EarlyDataFilterFactory> factory_{
+      std::make_unique<EarlyDataFilterFactory>(policy_)};
+  StrictMock<MockRequestHandler>* requestHandler_;
+  std::unique_ptr<StrictMock<MockResponseHandler>> responseHandler_;
+  ResponseHandler* downstream_{nullptr};
+};
+
+TEST_F(EarlyDataFilterTest, NotInstalledAfterHandshake) {
+  auto msg = makeRequest(HTTPMethod::POST, false);
+  EXPECT_EQ(factory_->onRequest(requestHandler_, &msg), requestHandler_);
+}
+
+TEST_F(EarlyDataFilterTest, EarlyDataHeader) {
+  // Forwarded by an intermediary that received it in early data
+  auto msg = makeRequest(HTTPMethod::POST, false);
+  msg.getHeaders().set("Early-Data", "1");
+  auto filter = makeFilter(msg);
+
+  expectTooEarly();
+  filter->onRequest(std::make_unique<HTTPMessage>(msg));
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, AcceptedRequestPassesThrough) {
+  auto msg = makeRequest(HTTPMethod::GET);
+  auto filter = makeFilter(msg);
+
+  EXPECT_CALL(*requestHandler_, onRequest(An<std::shared_ptr<HTTPMessage>>()));
+  EXPECT_CALL(*requestHandler_, onEOM());
+  filter->onRequest(std::make_unique<HTTPMessage>(msg));
+  filter->onEOM();
+
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke([](HTTPMessage& response) {
+        EXPECT_EQ(response.getStatusCode(), 200);
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+  ResponseBuilder(downstream_).status(200, "OK").sendWithEOM();
+
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, RefusedRequestGetsTooEarly) {
+  // POST is not allowed in early data by default
+  auto msg = makeRequest(HTTPMethod::POST);
+  auto filter = makeFilter(msg);
+
+  expectTooEarly();
+  filter->onRequest(std::make_unique<HTTPMessage>(msg));
+
+  // The handler has been told; nothing more reaches it
+  filter->onBody(folly::IOBuf::copyBuffer("body"));
+  filter->onEOM();
+  filter->onEgressPaused();
+  filter->onEgressResumed();
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, RefusedRequestError) {
+  auto msg = makeRequest(HTTPMethod::POST);
+  auto filter = makeFilter(msg);
+
+  expectTooEarly();
+  filter->onRequest(std::make_unique<HTTPMessage>(msg));
+  // The 425 could not be sent; the filter cleans up without the handler
+  filter->onError(kErrorWrite);
+}
+
+TEST_F(EarlyDataFilterTest, ReplayGetsTooEarly) {
+  EarlyDataPolicy::Options options;
+  options.methods.push_back(HTTPMethod::POST);
+  policy_ = std::make_shared<EarlyDataPolicy>(options);
+  factory_ = std::make_unique<EarlyDataFilterFactory>(policy_);
+
+  auto msg = makeRequest(HTTPMethod::POST);
+  auto filter = makeFilter(msg);
+  EXPECT_CALL(*requestHandler_, onRequest(An<std::shared_ptr<HTTPMessage>>()));
+  filter->onRequest(std::make_unique<HTTPMessage>(msg));
+  EXPECT_CALL(*requestHandler_, onError(kErrorConnectionReset));
+  filter->onError(kErrorConnectionReset);
+
+  // The same request again within the window may be a replay
+  auto replay = makeRequest(HTTPMethod::POST);
+  filter = makeFilter(replay);
+  expectTooEarly();
+  filter->onRequest(std::make_unique<HTTPMessage>(replay));
+  filter->requestComplete();
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Loopback load benchmark for proxygen::HQServer.
+ *
+ * Starts an HQServer on ::1 with the sample request handlers and drives it
+ * with HQClient instances running on --bench_client_threads threads. Every
+ * connection performs a full handshake, sends --bench_requests_per_conn
+ * concurrent requests for --bench_path and closes. Reports connections/sec
+ * and requests/sec.
+ *
+ * The regular hq flags (eg: --congestion, --quic_batching_mode) apply to
+ * both sides.
+ */
+
+#include <folly/portability/GFlags.h>
+
+#include <folly/init/Init.h>
+#include <folly/ssl/Init.h>
+
+#include <proxygen/httpserver/HQServer.h>
+#include <proxygen/httpserver/samples/hq/FizzContext.h>
+#include <proxygen/httpserver/samples/hq/HQClient.h>
+#include <proxygen/httpserver/samples/hq/HQCommandLine.h>
+#include <proxygen/httpserver/samples/hq/SampleHandlers.h>
+
+#include <atomic>
+#include <thread>
+
+DEFINE_int32(bench_connections, 1000, "Total connections to open");
+DEFINE_int32(bench_client_threads, 4, "Client threads");
+DEFINE_int32(bench_server_threads, 0, "Server worker threads, 0 = nCPUs");
+// Must not exceed the server's initial stream limit, HQClient only sends
+// more requests on a connection when run sequentially
+DEFINE_int32(bench_requests_per_conn, 10, "Requests sent on each connection");
+DEFINE_string(bench_path, "/1024", "Path requested on each connection");
+DEFINE_bool(bench_gso, true, "Use GSO batched writes on the server");
+
+using namespace quic::samples;
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+  // HQClient logs every connection attempt at INFO
+  gflags::SetCommandLineOptionWithMode(
+      "minloglevel", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  folly::init(&argc, &argv, false);
+  folly::ssl::init();
+
+  auto expectedServerParams =
+      initializeParamsFromCmdline({{"mode", "server"}, {"port", "0"}});
+  auto expectedClientParams = initializeParamsFromCmdline(
+      {{"mode", "client"},
+       {"log_response", "false"},
+       {"log_response_headers", "false"},
+       {"sequential", "false"},
+       {"outdir", ""}});
+  for (auto* expected : {&expectedServerParams, &expectedClientParams}) {
+    if (expected->hasError()) {
+      for (auto& param : expected->error()) {
+        LOG(ERROR) << "Invalid param: " << param.name << " " << param.value
+                   << " " << param.errorMsg;
+      }
+      return -1;
+    }
+  }
+  auto& serverParams =
+      boost::get<HQToolServerParams>(expectedServerParams->params);
+  auto& clientParams =
+      boost::get<HQToolClientParams>(expectedClientParams->params);
+
+  Dispatcher dispatcher(HandlerParams(serverParams.protocol,
+                                      serverParams.port,
+                                      serverParams.httpVersion.canonical));
+  proxygen::HQServer::Options options;
+  options.address.setFromIpPort("::1", 0);
+  options.threads = FLAGS_bench_server_threads;
+  options.transportSettings = serverParams.transportSettings;
+  options.supportedVersions = serverParams.quicVersions;
+  options.fizzContext = createFizzServerContext(serverParams);
+  options.txnTimeout = serverParams.txnTimeout;
+  options.useGSO = FLAGS_bench_gso;
+  proxygen::HQServer server(std::move(options),
+                            [&dispatcher](proxygen::HTTPMessage* msg) {
+                              return dispatcher.getRequestHandler(msg);
+                            });
+  server.start();
+  auto serverAddr = server.getAddress();
+  LOG(WARNING) << "Server listening on " << serverAddr.describe() << " with "
+               << server.getNumWorkers() << " workers";
+
+  clientParams.remoteAddress = serverAddr;
+  clientParams.httpPaths.assign(FLAGS_bench_requests_per_conn,
+                                folly::StringPiece(FLAGS_bench_path));
+
+  std::atomic<int32_t> nextConn{0};
+  std::atomic<uint64_t> succeeded{0};
+  std::atomic<uint64_t> failed{0};
+  std::vector<std::thread> clients;
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i < FLAGS_bench_client_threads; i++) {
+    clients.emplace_back([&] {
+      while (nextConn.fetch_add(1) < FLAGS_bench_connections) {
+        HQClient client(clientParams);
+        if (client.start() == 0) {
+          succeeded++;
+        } else {
+          failed++;
+        }
+      }
+    });
+  }
+  for (auto& t : clients) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  server.stop();
+
+  auto conns = succeeded.load();
+  std::cout << "connections: " << conns << " failed: " << failed.load()
+            << " elapsed: " << elapsed << "s" << std::endl;
+  std::cout << "connections/sec: " << conns / elapsed << std::endl;
+  std::cout << "requests/sec: "
+            << conns * FLAGS_bench_requests_per_conn / elapsed << std::endl;
+  return failed.load() == 0 ? 0 : 1;
+}
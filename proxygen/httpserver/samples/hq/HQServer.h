@@ -11,19 +11,13 @@
 #include <iostream>
 #include <string>
 
+#include <proxygen/httpserver/HQServer.h>
 #include <proxygen/httpserver/samples/hq/HQParams.h>
-#include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <quic/server/QuicCcpThreadLauncher.h>
-#include <quic/server/QuicServer.h>
-
-namespace proxygen {
-class HQSession;
-}
 
 namespace quic::samples {
 
-using HTTPTransactionHandlerProvider =
-    std::function<proxygen::HTTPTransactionHandler*(proxygen::HTTPMessage*)>;
+using HTTPTransactionHandlerProvider = proxygen::HQServer::HandlerProvider;
 
 class HQServer {
  public:
@@ -47,7 +41,7 @@ class HQServer {
 
  private:
   HQServerParams params_;
-  std::shared_ptr<quic::QuicServer> server_;
+  std::unique_ptr<proxygen::HQServer> server_;
   QuicCcpThreadLauncher quicCcpThreadLauncher_;
 };
 
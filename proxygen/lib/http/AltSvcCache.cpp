@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/AltSvcCache.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+
+using folly::StringPiece;
+using std::chrono::system_clock;
+
+namespace proxygen {
+
+namespace {
+
+// The RFC 7838 default for ma
+constexpr std::chrono::seconds kDefaultMaxAge{86400};
+// Keeps time_point arithmetic far from overflow
+constexpr uint64_t kMaxMaxAgeSeconds = 365 * 86400;
+
+// Split value on sep, ignoring separators inside quoted strings
+std::vector<StringPiece> splitUnquoted(StringPiece value, char sep) {
+  std::vector<StringPiece> out;
+  bool quoted = false;
+  size_t start = 0;
+  for (size_t i = 0; i < value.size(); i++) {
+    if (quoted && value[i] == '\\') {
+      i++;
+    } else if (value[i] == '"') {
+      quoted = !quoted;
+    } else if (!quoted && value[i] == sep) {
+      out.push_back(value.subpiece(start, i - start));
+      start = i + 1;
+    }
+  }
+  out.push_back(value.subpiece(start));
+  return out;
+}
+
+StringPiece unquote(StringPiece value) {
+  value = folly::trimWhitespace(value);
+  if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+    value = value.subpiece(1, value.size() - 2);
+  }
+  return value;
+}
+
+folly::Optional<AltService> parseAlternative(StringPiece item,
+                                             system_clock::time_point now) {
+  auto params = splitUnquoted(item, ';');
+  auto alternative = folly::trimWhitespace(params[0]);
+  auto eq = alternative.find('=');
+  if (eq == StringPiece::npos) {
+    return folly::none;
+  }
+
+  AltService service;
+  try {
+    service.protocolId = folly::uriUnescape<std::string>(
+        folly::trimWhitespace(alternative.subpiece(0, eq)),
+        folly::UriEscapeMode::ALL);
+  } catch (const std::exception&) {
+    return folly::none;
+  }
+  auto authority = unquote(alternative.subpiece(eq + 1));
+  auto colon = authority.rfind(':');
+  if (service.protocolId.empty() || colon == StringPiece::npos) {
+    return folly::none;
+  }
+  auto port = folly::tryTo<uint16_t>(authority.subpiece(colon + 1));
+  if (!port.hasValue() || *port == 0) {
+    return folly::none;
+  }
+  service.port = *port;
+  auto host = authority.subpiece(0, colon);
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.subpiece(1, host.size() - 2);
+  }
+  service.host = host.str();
+
+  std::chrono::seconds maxAge = kDefaultMaxAge;
+  for (size_t i = 1; i < params.size(); i++) {
+    auto param = folly::trimWhitespace(params[i]);
+    auto paramEq = param.find('=');
+    if (paramEq == StringPiece::npos) {
+      continue;
+    }
+    auto name = folly::trimWhitespace(param.subpiece(0, paramEq));
+    if (name == "ma") {
+      auto ma = folly::tryTo<uint64_t>(unquote(param.subpiece(paramEq + 1)));
+      if (!ma.hasValue()) {
+        return folly::none;
+      }
+      maxAge = std::chrono::seconds(std::min(*ma, kMaxMaxAgeSeconds));
+    }
+    // persist only matters across network changes, which we don't track
+  }
+  if (maxAge.count() == 0) {
+    return folly::none;
+  }
+  service.expires = now + maxAge;
+  return service;
+}
+
+} // namespace
+
+std::vector<AltService> parseAltSvc(StringPiece value,
+                                    system_clock::time_point now) {
+  std::vector<AltService> services;
+  for (auto item : splitUnquoted(value, ',')) {
+    auto service = parseAlternative(item, now);
+    if (service) {
+      services.push_back(std::move(*service));
+    }
+  }
+  return services;
+}
+
+bool isAltSvcClear(StringPiece value) {
+  return folly::trimWhitespace(value) == "clear";
+}
+
+std::string AltSvcCache::originKey(StringPiece host, uint16_t port) {
+  return folly::to<std::string>("https://", host, ":", port);
+}
+
+void AltSvcCache::processAltSvc(const std::string& origin, StringPiece value) {
+  auto currentTime = now();
+  std::vector<AltService> services;
+  if (!isAltSvcClear(value)) {
+    services = parseAltSvc(value, currentTime);
+    if (services.empty()) {
+      VLOG(4) << "Ignoring unusable Alt-Svc for " << origin << ": " << value;
+      return;
+    }
+  }
+  // A new advertisement replaces everything from the previous one
+  auto record = getRecord(origin).value_or(AltSvcRecord());
+  record.services = std::move(services);
+  prune(record, currentTime);
+  store(origin, std::move(record));
+}
+
+folly::Optional<AltService> AltSvcCache::getAlternative(
+    const std::string& origin, StringPiece protocolId) {
+  auto record = getRecord(origin);
+  if (!record) {
+    return folly::none;
+  }
+  auto currentTime = now();
+  for (const auto& broken : record->broken) {
+    if (broken.protocolId == protocolId && broken.until > currentTime) {
+      return folly::none;
+    }
+  }
+  for (auto& service : record->services) {
+    if (service.protocolId == protocolId && service.expires > currentTime) {
+      return std::move(service);
+    }
+  }
+  return folly::none;
+}
+
+bool AltSvcCache::isBroken(const std::string& origin, StringPiece protocolId) {
+  auto record = getRecord(origin);
+  if (!record) {
+    return false;
+  }
+  auto currentTime = now();
+  for (const auto& broken : record->broken) {
+    if (broken.protocolId == protocolId) {
+      return broken.until > currentTime;
+    }
+  }
+  return false;
+}
+
+void AltSvcCache::markBroken(const std::string& origin,
+                             StringPiece protocolId) {
+  auto currentTime = now();
+  auto record = getRecord(origin).value_or(AltSvcRecord());
+  auto it = std::find_if(record.broken.begin(),
+                         record.broken.end(),
+                         [&](const AltSvcRecord::Broken& b) {
+                           return b.protocolId == protocolId;
+                         });
+  if (it == record.broken.end()) {
+    record.broken.push_back({protocolId.str(), 0, {}});
+    it = record.broken.end() - 1;
+  }
+  it->failures++;
+  auto backoff = initialBrokenBackoff_;
+  for (uint32_t i = 1; i < it->failures && backoff < maxBrokenBackoff_; i++) {
+    backoff *= 2;
+  }
+  it->until = currentTime + std::min(backoff, maxBrokenBackoff_);
+  VLOG(3) << "Alternative " << protocolId << " for " << origin
+          << " broken, failures=" << it->failures;
+  prune(record, currentTime);
+  store(origin, std::move(record));
+}
+
+void AltSvcCache::markWorking(const std::string& origin,
+                              StringPiece protocolId) {
+  auto record = getRecord(origin);
+  if (!record) {
+    return;
+  }
+  auto& broken = record->broken;
+  auto it = std::remove_if(
+      broken.begin(), broken.end(), [&](const AltSvcRecord::Broken& b) {
+        return b.protocolId == protocolId;
+      });
+  if (it == broken.end()) {
+    return;
+  }
+  broken.erase(it, broken.end());
+  prune(*record, now());
+  store(origin, std::move(*record));
+}
+
+bool AltSvcCache::prune(AltSvcRecord& record,
+                        system_clock::time_point now) const {
+  auto& services = record.services;
+  services.erase(std::remove_if(services.begin(),
+                                services.end(),
+                                [now](const AltService& service) {
+                                  return service.expires <= now;
+                                }),
+                 services.end());
+  // Failure counts are kept past the backoff so the next one doubles it,
+  // but not forever
+  auto& broken = record.broken;
+  broken.erase(std::remove_if(broken.begin(),
+                              broken.end(),
+                              [&](const AltSvcRecord::Broken& b) {
+                                return b.until + maxBrokenBackoff_ <= now;
+                              }),
+               broken.end());
+  return !services.empty() || !broken.empty();
+}
+
+void AltSvcCache::store(const std::string& origin, AltSvcRecord record) {
+  if (record.services.empty() && record.broken.empty()) {
+    removeRecord(origin);
+  } else {
+    putRecord(origin, std::move(record));
+  }
+}
+
+SynchronizedLruAltSvcCache::SynchronizedLruAltSvcCache(uint64_t mapMax)
+    : cache_(EvictingRecordMap(mapMax)) {
+}
+
+folly::Optional<AltSvcRecord> SynchronizedLruAltSvcCache::getRecord(
+    const std::string& origin) {
+  auto cacheMap = cache_.wlock();
+  auto result = cacheMap->find(origin);
+  if (result == cacheMap->end()) {
+    return folly::none;
+  }
+  return result->second;
+}
+
+void SynchronizedLruAltSvcCache::putRecord(const std::string& origin,
+                                           AltSvcRecord record) {
+  auto cacheMap = cache_.wlock();
+  cacheMap->set(origin, std::move(record));
+}
+
+void SynchronizedLruAltSvcCache::removeRecord(const std::string& origin) {
+  auto cacheMap = cache_.wlock();
+  cacheMap->erase(origin);
+}
+
+} // namespace proxygen
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+// One alternative from an Alt-Svc advertisement (RFC 7838)
+struct AltService {
+  // ALPN protocol id, e.g. "h3"
+  std::string protocolId;
+  // Empty means the origin's own host
+  std::string host;
+  uint16_t port{0};
+  std::chrono::system_clock::time_point expires;
+};
+
+// Everything cached for one origin
+struct AltSvcRecord {
+  struct Broken {
+    std::string protocolId;
+    // Consecutive failures, which double the backoff
+    uint32_t failures{0};
+    std::chrono::system_clock::time_point until;
+  };
+
+  std::vector<AltService> services;
+  std::vector<Broken> broken;
+};
+
+/**
+ * Parse an Alt-Svc header value. Malformed alternatives are skipped, so the
+ * result may be empty. "clear" also parses to an empty list; check for it
+ * with isAltSvcClear.
+ */
+std::vector<AltService> parseAltSvc(folly::StringPiece value,
+                                    std::chrono::system_clock::time_point now);
+bool isAltSvcClear(folly::StringPiece value);
+
+/**
+ * Records which alternative services an origin has advertised, so that
+ * later connections to it can go straight to (say) HTTP/3.
+ *
+ * An alternative that fails to connect is marked broken and not offered
+ * again until its backoff expires; the backoff doubles with each
+ * consecutive failure, and a successful connection resets it.
+ *
+ * Origins are keyed by originKey(). Subclasses provide storage; each call
+ * does one read and at most one write of an origin's record, so concurrent
+ * updates to the same origin are last-writer-wins.
+ */
+class AltSvcCache {
+ public:
+  virtual ~AltSvcCache() = default;
+
+  static std::string originKey(folly::StringPiece host, uint16_t port);
+
+  void setBrokenBackoff(std::chrono::seconds initial,
+                        std::chrono::seconds max) {
+    initialBrokenBackoff_ = initial;
+    maxBrokenBackoff_ = max;
+  }
+
+  // Apply an Alt-Svc header received in a response from origin
+  void processAltSvc(const std::string& origin, folly::StringPiece value);
+
+  /**
+   * The first unexpired alternative for origin with the given protocol, or
+   * none if there is none or the protocol is broken for origin.
+   */
+  folly::Optional<AltService> getAlternative(const std::string& origin,
+                                             folly::StringPiece protocolId);
+
+  bool isBroken(const std::string& origin, folly::StringPiece protocolId);
+  void markBroken(const std::string& origin, folly::StringPiece protocolId);
+  void markWorking(const std::string& origin, folly::StringPiece protocolId);
+
+ protected:
+  virtual std::chrono::system_clock::time_point now() const {
+    return std::chrono::system_clock::now();
+  }
+
+  virtual folly::Optional<AltSvcRecord> getRecord(
+      const std::string& origin) = 0;
+  virtual void putRecord(const std::string& origin, AltSvcRecord record) = 0;
+  virtual void removeRecord(const std::string& origin) = 0;
+
+ private:
+  // Drop what has expired; returns false if nothing is left
+  bool prune(AltSvcRecord& record,
+             std::chrono::system_clock::time_point now) const;
+  void store(const std::string& origin, AltSvcRecord record);
+
+  std::chrono::seconds initialBrokenBackoff_{std::chrono::minutes(5)};
+  std::chrono::seconds maxBrokenBackoff_{std::chrono::hours(48)};
+};
+
+// In-memory cache of a bounded number of origins, safe to share by threads
+class SynchronizedLruAltSvcCache : public AltSvcCache {
+ public:
+  explicit SynchronizedLruAltSvcCache(uint64_t mapMax);
+
+ protected:
+  folly::Optional<AltSvcRecord> getRecord(const std::string& origin) override;
+  void putRecord(const std::string& origin, AltSvcRecord record) override;
+  void removeRecord(const std::string& origin) override;
+
+ private:
+  using EvictingRecordMap = folly::EvictingCacheMap<std::string, AltSvcRecord>;
+  folly::Synchronized<EvictingRecordMap> cache_;
+};
+
+} // namespace proxygen
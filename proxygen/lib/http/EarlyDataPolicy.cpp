@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/EarlyDataPolicy.h>
+
+#include <folly/hash/Hash.h>
+
+namespace proxygen {
+
+namespace {
+
+const std::string kEarlyDataHeader{"Early-Data"};
+
+bool isSafeMethod(const HTTPMessage& request) {
+  auto method = request.getMethod();
+  return method && (*method == HTTPMethod::GET ||
+                    *method == HTTPMethod::HEAD ||
+                    *method == HTTPMethod::OPTIONS);
+}
+
+} // namespace
+
+EarlyDataPolicy::EarlyDataPolicy(Options options)
+    : options_(std::move(options)),
+      seen_(folly::EvictingCacheMap<uint64_t, TimePoint>(
+          std::max<uint64_t>(options_.antiReplayCapacity, 1))) {
+}
+
+bool EarlyDataPolicy::isEarlyData(const HTTPMessage& request) {
+  // RFC 8470: intermediaries forward early data with "Early-Data: 1"
+  return request.isEarlyData() ||
+         request.getHeaders().getSingleOrEmpty(kEarlyDataHeader) == "1";
+}
+
+bool EarlyDataPolicy::canSendInEarlyData(const HTTPMessage& request) {
+  return isSafeMethod(request);
+}
+
+bool EarlyDataPolicy::shouldProcess(const HTTPMessage& request,
+                                    folly::StringPiece replayContext) {
+  if (!isEarlyData(request)) {
+    return true;
+  }
+  if (!isAllowed(request)) {
+    VLOG(4) << "Early data not allowed for " << request.getMethodString()
+            << " " << request.getPath();
+    return false;
+  }
+  if (isSafeMethod(request) || options_.antiReplayWindow.count() == 0) {
+    return true;
+  }
+  return checkReplay(request, replayContext);
+}
+
+bool EarlyDataPolicy::isAllowed(const HTTPMessage& request) const {
+  auto method = request.getMethod();
+  if (!method || std::find(options_.methods.begin(),
+                           options_.methods.end(),
+                           *method) == options_.methods.end()) {
+    return false;
+  }
+  if (options_.pathPrefixes.empty()) {
+    return true;
+  }
+  folly::StringPiece path(request.getPath());
+  for (const auto& prefix : options_.pathPrefixes) {
+    if (path.startsWith(prefix)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool EarlyDataPolicy::checkReplay(const HTTPMessage& request,
+                                  folly::StringPiece replayContext) {
+  // A replay repeats the request exactly, so hash all of it. Two different
+  // clients sending an identical request also collide; the second one gets
+  // a 425 and retries, which costs a round trip but is otherwise harmless.
+  auto key = folly::hash::hash_combine(
+      replayContext, request.getMethodString(), request.getURL());
+  request.getHeaders().forEach(
+      [&key](const std::string& name, const std::string& value) {
+        key = folly::hash::hash_combine(key, name, value);
+      });
+
+  auto currentTime = now();
+  auto seen = seen_.wlock();
+  auto it = seen->find(key);
+  if (it != seen->end() &&
+      currentTime - it->second < options_.antiReplayWindow) {
+    VLOG(3) << "Refusing possible early data replay of "
+            << request.getMethodString() << " " << request.getPath();
+    return false;
+  }
+  seen->set(key, currentTime);
+  return true;
+}
+
+} // namespace proxygen
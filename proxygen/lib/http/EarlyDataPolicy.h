@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/utils/Time.h>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Decides which requests received in TLS 1.3 or QUIC early data (0-RTT) a
+ * server processes before the handshake completes (RFC 8470). Early data
+ * can be replayed by an attacker, so a request the policy refuses should be
+ * answered with 425 (Too Early); the client then sends it again once the
+ * handshake is done.
+ *
+ * A request is accepted if its method is allowed and its path matches an
+ * allowed prefix. Accepted requests with unsafe methods (anything but GET,
+ * HEAD and OPTIONS) are also remembered for antiReplayWindow, and an
+ * identical one in that window is refused. Safe methods are not tracked,
+ * since replaying them has no effect.
+ *
+ * Thread safe, so one policy may be shared by every server thread.
+ */
+class EarlyDataPolicy {
+ public:
+  struct Options {
+    std::vector<HTTPMethod> methods{
+        HTTPMethod::GET, HTTPMethod::HEAD, HTTPMethod::OPTIONS};
+    // If not empty, only paths starting with one of these are accepted
+    std::vector<std::string> pathPrefixes;
+    // 0 disables the anti-replay cache
+    std::chrono::milliseconds antiReplayWindow{std::chrono::seconds(10)};
+    uint64_t antiReplayCapacity{100000};
+  };
+
+  explicit EarlyDataPolicy(Options options);
+  virtual ~EarlyDataPolicy() = default;
+
+  /**
+   * Whether request arrived in early data, either on this connection or,
+   * per its Early-Data header, at an intermediary.
+   */
+  static bool isEarlyData(const HTTPMessage& request);
+
+  /**
+   * Whether a client may send request in early data: only safe methods,
+   * which the server can process even if the request is replayed.
+   */
+  static bool canSendInEarlyData(const HTTPMessage& request);
+
+  /**
+   * Whether request can be processed now. Requests that are not early data
+   * always can. replayContext is mixed into the anti-replay key; it should
+   * be something a replay shares with the original, like the QUIC original
+   * destination connection ID and stream ID.
+   */
+  bool shouldProcess(const HTTPMessage& request,
+                     folly::StringPiece replayContext = folly::StringPiece());
+
+ protected:
+  virtual TimePoint now() const {
+    return getCurrentTime();
+  }
+
+ private:
+  bool isAllowed(const HTTPMessage& request) const;
+  // Returns false if an identical request was seen within the window
+  bool checkReplay(const HTTPMessage& request,
+                   folly::StringPiece replayContext);
+
+  const Options options_;
+  folly::Synchronized<folly::EvictingCacheMap<uint64_t, TimePoint>> seen_;
+};
+
+} // namespace proxygen
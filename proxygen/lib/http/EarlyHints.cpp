@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/EarlyHints.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+
+namespace proxygen {
+
+EarlyHints::EarlyHints(const std::vector<Link>& links) {
+  std::vector<std::string> values;
+  values.reserve(links.size());
+  for (const auto& link : links) {
+    values.emplace_back(formatLink(link));
+  }
+  init(folly::join(", ", values));
+}
+
+EarlyHints::EarlyHints(const std::vector<std::string>& linkValues) {
+  init(folly::join(", ", linkValues));
+}
+
+void EarlyHints::init(std::string linkValue) {
+  msg_.setHTTPVersion(1, 1);
+  msg_.setStatusCode(103);
+  msg_.setStatusMessage(HTTPMessage::getDefaultReason(103));
+  if (!linkValue.empty()) {
+    msg_.getHeaders().add(HTTP_HEADER_LINK, std::move(linkValue));
+  }
+}
+
+std::string EarlyHints::formatLink(const Link& link) {
+  auto value = folly::to<std::string>('<', link.uri, ">; rel=", link.rel);
+  if (!link.as.empty()) {
+    folly::toAppend("; as=", link.as, &value);
+  }
+  if (link.crossOrigin) {
+    value.append("; crossorigin");
+  }
+  return value;
+}
+
+} // namespace proxygen
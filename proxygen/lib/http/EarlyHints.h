@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/lib/http/HTTPMessage.h>
+
+namespace proxygen {
+
+/**
+ * A precomputed 103 (Early Hints) response carrying Link headers, meant to
+ * be built once per route and shared by every request to that route (see
+ * HTTPTransaction::sendEarlyHints and ResponseHandler::sendEarlyHints).
+ *
+ * All links are joined into a single Link field. On HTTP/2 and HTTP/3 the
+ * field is then inserted into the connection's dynamic table the first time
+ * it is sent, and later hints on the same connection encode to a single
+ * index.
+ */
+class EarlyHints {
+ public:
+  struct Link {
+    std::string uri;
+    std::string rel{"preload"};
+    // Destination type for preloads, eg: "style", "script" or "font"
+    std::string as;
+    bool crossOrigin{false};
+  };
+
+  explicit EarlyHints(const std::vector<Link>& links);
+
+  /**
+   * Build from preformatted Link field values.
+   */
+  explicit EarlyHints(const std::vector<std::string>& linkValues);
+
+  const HTTPMessage& getMessage() const {
+    return msg_;
+  }
+
+  const std::string& getLinkValue() const {
+    return msg_.getHeaders().getSingleOrEmpty(HTTP_HEADER_LINK);
+  }
+
+  bool empty() const {
+    return getLinkValue().empty();
+  }
+
+  // Formats a link as `<uri>; rel=preload; as=style; crossorigin`
+  static std::string formatLink(const Link& link);
+
+ private:
+  void init(std::string linkValue);
+
+  HTTPMessage msg_;
+};
+
+} // namespace proxygen
@@ -30,9 +30,12 @@ std::chrono::milliseconds HQConnector::timeElapsed() {
 
 void HQConnector::reset() {
   if (session_) {
-    // This destroys the session
-    session_->dropConnection();
+    // This destroys the session. It reports connectError, which is not
+    // passed on: the connect was cancelled, not failed.
+    auto session = session_;
     session_ = nullptr;
+    session->setConnectCallback(nullptr);
+    session->dropConnection();
   }
 }
 
@@ -98,6 +101,21 @@ void HQConnector::connect(
   quicClient->start(session_, session_);
 }
 
+void HQConnector::connectSuccess() noexcept {
+  CHECK(session_);
+  if (!earlyDataEnabled_ || session_->isReplaySafe()) {
+    // onReplaySafe follows
+    return;
+  }
+  // 0-RTT: hand the session over now rather than after the handshake
+  auto session = session_;
+  session_ = nullptr;
+  session->setConnectCallback(nullptr);
+  if (cb_) {
+    cb_->connectSuccess(session);
+  }
+}
+
 void HQConnector::onReplaySafe() noexcept {
   CHECK(session_);
   if (cb_) {
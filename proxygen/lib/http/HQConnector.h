@@ -52,6 +52,17 @@ class HQConnector : public HQSession::ConnectCallback {
 
   void setQuicPskCache(std::shared_ptr<quic::QuicPskCache> quicPskCache);
 
+  /**
+   * Report connectSuccess as soon as 0-RTT data can be sent, instead of
+   * when the handshake completes. This needs a PSK cache holding a ticket
+   * for the server. Until the session isReplaySafe(), requests that are not
+   * safe to replay should wait with addWaitingForReplaySafety. If the
+   * handshake then fails, the session errors its transactions.
+   */
+  void setEarlyDataEnabled(bool enabled) {
+    earlyDataEnabled_ = enabled;
+  }
+
   void reset();
 
   void connect(
@@ -76,6 +87,7 @@ class HQConnector : public HQSession::ConnectCallback {
   }
 
   // HQSession::ConnectCallback
+  void connectSuccess() noexcept override;
   void onReplaySafe() noexcept override;
   void connectError(quic::QuicError error) noexcept override;
 
@@ -87,6 +99,7 @@ class HQConnector : public HQSession::ConnectCallback {
   quic::TransportSettings transportSettings_;
   std::shared_ptr<quic::QuicPskCache> quicPskCache_;
   bool useConnectionEndWithErrorCallback_{false};
+  bool earlyDataEnabled_{false};
 };
 
 } // namespace proxygen
@@ -80,7 +80,8 @@ HTTPMessage::HTTPMessage()
       chunked_(false),
       upgraded_(false),
       wantsKeepalive_(true),
-      trailersAllowed_(false) {
+      trailersAllowed_(false),
+      earlyData_(false) {
 }
 
 HTTPMessage::~HTTPMessage() {
@@ -111,6 +112,7 @@ HTTPMessage::HTTPMessage(const HTTPMessage& message)
       upgraded_(message.upgraded_),
       wantsKeepalive_(message.wantsKeepalive_),
       trailersAllowed_(message.trailersAllowed_),
+      earlyData_(message.earlyData_),
       scheme_(message.scheme_) {
   if (isRequest()) {
     setURL(request().url_);
@@ -151,6 +153,7 @@ HTTPMessage::HTTPMessage(HTTPMessage&& message) noexcept
       upgraded_(message.upgraded_),
       wantsKeepalive_(message.wantsKeepalive_),
       trailersAllowed_(message.trailersAllowed_),
+      earlyData_(message.earlyData_),
       scheme_(message.scheme_) {
   if (isRequest()) {
     setURL(request().url_);
@@ -193,6 +196,7 @@ HTTPMessage& HTTPMessage::operator=(const HTTPMessage& message) {
   upgraded_ = message.upgraded_;
   wantsKeepalive_ = message.wantsKeepalive_;
   trailersAllowed_ = message.trailersAllowed_;
+  earlyData_ = message.earlyData_;
   scheme_ = message.scheme_;
   upgradeWebsocket_ = message.upgradeWebsocket_;
 
@@ -235,6 +239,7 @@ HTTPMessage& HTTPMessage::operator=(HTTPMessage&& message) {
   upgraded_ = message.upgraded_;
   wantsKeepalive_ = message.wantsKeepalive_;
   trailersAllowed_ = message.trailersAllowed_;
+  earlyData_ = message.earlyData_;
   scheme_ = message.scheme_;
   upgradeWebsocket_ = message.upgradeWebsocket_;
   trailers_ = std::move(message.trailers_);
@@ -873,6 +878,8 @@ const char* HTTPMessage::getDefaultReason(uint16_t status) {
       return "Continue";
     case 101:
       return "Switching Protocols";
+    case 103:
+      return "Early Hints";
     case 200:
       return "OK";
     case 201:
@@ -939,6 +946,8 @@ const char* HTTPMessage::getDefaultReason(uint16_t status) {
       return "Expectation Failed";
     case 418:
       return "I'm a teapot";
+    case 425:
+      return "Too Early";
     case 426:
       return "Upgrade Required";
     case 428:
@@ -466,6 +466,18 @@ class HTTPMessage {
     trailersAllowed_ = trailersAllowedVal;
   }
 
+  /**
+   * Set by downstream sessions on a request received in TLS 1.3 or QUIC
+   * early data, before the handshake completed. Such a request may be a
+   * replay; see EarlyDataPolicy.
+   */
+  bool isEarlyData() const {
+    return earlyData_;
+  }
+  void setEarlyData(bool earlyData) {
+    earlyData_ = earlyData;
+  }
+
   /**
    * Returns true if this message has trailers that need to be serialized
    */
@@ -1119,6 +1131,7 @@ class HTTPMessage {
   bool upgraded_ : 1;
   bool wantsKeepalive_ : 1;
   bool trailersAllowed_ : 1;
+  bool earlyData_ : 1;
 
   Scheme scheme_{Scheme::HTTP};
 
@@ -11,6 +11,7 @@
 #include <folly/ThreadLocal.h>
 #include <proxygen/lib/http/HeaderConstants.h>
 #include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/utils/ByteScan.h>
 
 namespace proxygen {
 
@@ -59,6 +60,47 @@ const char CodecUtil::http_tokens[256] = {
 };
 // clang-format on
 
+size_t CodecUtil::skipCommonTokenChars(folly::ByteRange name) {
+  using namespace bytescan;
+  return findFirst(
+      name,
+      [](auto v) {
+        return none(either(either(inRange(v, 'a', 'z'), inRange(v, '0', '9')),
+                           eq(v, '-')));
+      },
+      [](uint8_t c) {
+        return !((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                 c == '-');
+      });
+}
+
+size_t CodecUtil::findHeaderValueSpecial(folly::ByteRange value,
+                                         bool allowHighAscii) {
+  using namespace bytescan;
+  return findFirst(
+      value,
+      [allowHighAscii](auto v) {
+        auto special =
+            either(either(butNot(inRange(v, 0, 0x1f), eq(v, '\t')),
+                          eq(v, 0x7f)),
+                   either(eq(v, '"'), eq(v, '\\')));
+        return allowHighAscii ? special
+                              : either(special, inRange(v, 0x80, 0xff));
+      },
+      [allowHighAscii](uint8_t c) {
+        return (c < 0x20 && c != '\t') || c == 0x7f || c == '"' ||
+               c == '\\' || (c > 0x7f && !allowHighAscii);
+      });
+}
+
+size_t CodecUtil::findCRLF(folly::ByteRange value) {
+  using namespace bytescan;
+  return findFirst(
+      value,
+      [](auto v) { return either(eq(v, '\r'), eq(v, '\n')); },
+      [](uint8_t c) { return c == '\r' || c == '\n'; });
+}
+
 bool CodecUtil::hasGzipAndDeflate(const std::string& value,
                                   bool& hasGzip,
                                   bool& hasDeflate) {
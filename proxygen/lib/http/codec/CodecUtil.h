@@ -81,6 +81,9 @@ class CodecUtil {
     if (name.size() == 0) {
       return false;
     }
+    // Most names are only lowercase letters, digits and '-', which are
+    // valid in every mode and cleared a vector at a time
+    name.advance(skipCommonTokenChars(name));
     for (uint8_t p : name) {
       if (mode == HEADER_NAME_STRICT_COMPAT) {
         // Allows ' ', '"', '/', '}' and high ASCII
@@ -118,6 +121,9 @@ class CodecUtil {
       lws_expect_ws2
     } state = lws_none;
 
+    // Bytes the state machine below ignores leave its state as it is, so
+    // skip ahead to the first one it cares about
+    value.advance(findHeaderValueSpecial(value, mode != STRICT));
     for (auto p = std::begin(value); p != std::end(value); ++p) {
       if (escape) {
         escape = false;
@@ -184,6 +190,25 @@ class CodecUtil {
     return !escape && (state == lws_none || state == lws_expect_ws2);
   }
 
+  /**
+   * Vectorized scans behind the validators above, 16 bytes at a time where
+   * SSE2 or NEON is available and a byte at a time elsewhere.
+   */
+
+  // Length of the prefix of name made of lowercase letters, digits and '-'
+  static size_t skipCommonTokenChars(folly::ByteRange name);
+
+  /**
+   * Offset of the first byte validateHeaderValue has to look at: a CTL other
+   * than HT, DEL, '"', '\\', or high ASCII unless allowHighAscii.  Returns
+   * value.size() if there is none.
+   */
+  static size_t findHeaderValueSpecial(folly::ByteRange value,
+                                       bool allowHighAscii);
+
+  // Offset of the first CR or LF, or value.size() if there is none
+  static size_t findCRLF(folly::ByteRange value);
+
   static bool hasGzipAndDeflate(const std::string& value,
                                 bool& hasGzip,
                                 bool& hasDeflate);
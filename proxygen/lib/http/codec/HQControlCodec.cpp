@@ -102,7 +102,9 @@ ParseResult HQControlCodec::parseSettings(Cursor& cursor,
       case hq::SettingId::HEADER_TABLE_SIZE:
       case hq::SettingId::MAX_HEADER_LIST_SIZE:
       case hq::SettingId::QPACK_BLOCKED_STREAMS:
+      case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
       case hq::SettingId::H3_DATAGRAM:
+      case hq::SettingId::ENABLE_WEBTRANSPORT:
         break;
       default:
         continue; // ignore unknown settings
@@ -222,7 +224,9 @@ size_t HQControlCodec::generateSettings(folly::IOBufQueue& writeBuf) {
         case hq::SettingId::HEADER_TABLE_SIZE:
         case hq::SettingId::MAX_HEADER_LIST_SIZE:
         case hq::SettingId::QPACK_BLOCKED_STREAMS:
+        case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
         case hq::SettingId::H3_DATAGRAM:
+        case hq::SettingId::ENABLE_WEBTRANSPORT:
           break;
       }
       settings.emplace_back(*id, (SettingValue)setting.value);
@@ -94,7 +94,9 @@ decodeSettingValue(folly::io::Cursor& cursor,
     case SettingId::HEADER_TABLE_SIZE:
     case SettingId::MAX_HEADER_LIST_SIZE:
     case SettingId::QPACK_BLOCKED_STREAMS:
+    case SettingId::ENABLE_CONNECT_PROTOCOL:
     case SettingId::H3_DATAGRAM:
+    case SettingId::ENABLE_WEBTRANSPORT:
       return value;
   }
   return folly::none;
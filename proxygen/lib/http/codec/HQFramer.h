@@ -69,7 +69,9 @@ enum class SettingId : uint64_t {
   HEADER_TABLE_SIZE = 0x01,
   MAX_HEADER_LIST_SIZE = 0x06,
   QPACK_BLOCKED_STREAMS = 0x07,
+  ENABLE_CONNECT_PROTOCOL = 0x08,
   H3_DATAGRAM = 0x276,
+  ENABLE_WEBTRANSPORT = 0x2b603742,
 };
 
 using SettingValue = uint64_t;
@@ -28,6 +28,9 @@ std::ostream& operator<<(std::ostream& os, UnidirectionalStreamType type) {
     case UnidirectionalStreamType::PUSH:
       os << "push";
       break;
+    case UnidirectionalStreamType::WEBTRANSPORT:
+      os << "WebTransport";
+      break;
     default:
       os << "unknown";
       break;
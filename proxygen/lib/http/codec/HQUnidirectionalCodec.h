@@ -25,6 +25,8 @@ enum class UnidirectionalStreamType : uint64_t {
   // with any character that is allowed as the first character in HTTP/1.1
   // 0x20 (' '), 0x4020 ('@'), 0x80000020, 0xC000000000000020
   H1Q_CONTROL = 0x20,
+  // draft-ietf-webtrans-http3, followed by the session ID
+  WEBTRANSPORT = 0x54,
 };
 using StreamTypeType = std::underlying_type<UnidirectionalStreamType>::type;
 std::ostream& operator<<(std::ostream& os, UnidirectionalStreamType type);
@@ -47,6 +49,7 @@ folly::Optional<Ret> withType(uint64_t typeval,
     case UnidirectionalStreamType::QPACK_ENCODER:
     case UnidirectionalStreamType::QPACK_DECODER:
     case UnidirectionalStreamType::H1Q_CONTROL:
+    case UnidirectionalStreamType::WEBTRANSPORT:
       return functor(casted);
     default:
       return folly::none;
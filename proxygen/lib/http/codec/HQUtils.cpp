@@ -87,8 +87,12 @@ folly::Optional<hq::SettingId> httpToHqSettingsId(proxygen::SettingsId id) {
       return hq::SettingId::MAX_HEADER_LIST_SIZE;
     case proxygen::SettingsId::_HQ_QPACK_BLOCKED_STREAMS:
       return hq::SettingId::QPACK_BLOCKED_STREAMS;
+    case proxygen::SettingsId::ENABLE_CONNECT_PROTOCOL:
+      return hq::SettingId::ENABLE_CONNECT_PROTOCOL;
     case proxygen::SettingsId::_HQ_DATAGRAM:
       return hq::SettingId::H3_DATAGRAM;
+    case proxygen::SettingsId::_HQ_WEBTRANSPORT:
+      return hq::SettingId::ENABLE_WEBTRANSPORT;
     default:
       return folly::none; // this setting has no meaning in HQ
   }
@@ -103,8 +107,12 @@ folly::Optional<proxygen::SettingsId> hqToHttpSettingsId(hq::SettingId id) {
       return proxygen::SettingsId::MAX_HEADER_LIST_SIZE;
     case hq::SettingId::QPACK_BLOCKED_STREAMS:
       return proxygen::SettingsId::_HQ_QPACK_BLOCKED_STREAMS;
+    case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
+      return proxygen::SettingsId::ENABLE_CONNECT_PROTOCOL;
     case hq::SettingId::H3_DATAGRAM:
       return proxygen::SettingsId::_HQ_DATAGRAM;
+    case hq::SettingId::ENABLE_WEBTRANSPORT:
+      return proxygen::SettingsId::_HQ_WEBTRANSPORT;
   }
   return folly::none;
 }
@@ -563,7 +563,7 @@ void HTTP1xCodec::generateHeader(
       // will generate our own accept per hop, not client's.
       return;
     }
-    if (value.find_first_of("\r\n") != std::string::npos) {
+    if (CodecUtil::findCRLF(value) != value.size()) {
       return;
     }
     size_t lineLen = header.size() + value.size() + 4; // 4 for ": " + CRLF
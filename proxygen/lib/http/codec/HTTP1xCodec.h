@@ -80,6 +80,11 @@ class HTTP1xCodec : public HTTPCodec {
   bool supportsPushTransactions() const override {
     return false;
   }
+  bool supportsEarlyHints() const override {
+    // 1xx responses must not be sent to HTTP/1.0 clients
+    return transportDirection_ == TransportDirection::UPSTREAM ||
+           mayChunkEgress_;
+  }
   void generateHeader(
       folly::IOBufQueue& writeBuf,
       StreamID txn,
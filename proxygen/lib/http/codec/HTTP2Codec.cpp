@@ -30,10 +30,6 @@ std::string base64url_encode(ByteRange range) {
   return proxygen::Base64::urlEncode(range);
 }
 
-std::string base64url_decode(const std::string& str) {
-  return proxygen::Base64::urlDecode(str);
-}
-
 const size_t kDefaultGrowth = 4000;
 constexpr auto kOkhttp2 = "okhttp/2";
 constexpr int kOkhttp2GoawayLogFreq = 1000;
@@ -186,12 +182,13 @@ ErrorCode HTTP2Codec::parseFrame(folly::io::Cursor& cursor) {
     return ErrorCode::PROTOCOL_ERROR;
   }
   if (frameAffectsCompression(curHeader_.type) &&
-      curHeaderBlock_.chainLength() + curHeader_.length >
+      curHeaderBlockLength_ + curHeader_.length >
           egressSettings_.getSetting(SettingsId::MAX_HEADER_LIST_SIZE, 0)) {
     // this may be off by up to the padding length (max 255), but
     // these numbers are already so generous, and we're comparing the
     // max-uncompressed to the actual compressed size.  Let's fail
-    // before buffering.
+    // before decoding.  The decoder separately enforces the uncompressed
+    // limit as each fragment is decoded.
 
     // TODO(t6513634): it would be nicer to stream-process this header
     // block to keep the connection state consistent without consuming
@@ -443,6 +440,9 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
     const folly::Optional<http2::PriorityUpdate>& priority,
     const folly::Optional<uint32_t>& promisedStream,
     const folly::Optional<ExAttributes>& exAttributes) {
+  if (headerBuf) {
+    curHeaderBlockLength_ += headerBuf->computeChainDataLength();
+  }
   curHeaderBlock_.append(std::move(headerBuf));
   std::unique_ptr<HTTPMessage> msg;
   uint32_t headersCompleteStream = curHeader_.stream;
@@ -457,6 +457,7 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
     } else {
       parsingReq_ = transportDirection_ == TransportDirection::DOWNSTREAM;
     }
+    parseHeadersStartBlock(priority, exAttributes);
   } else if (headerBlockFrameType_ == http2::FrameType::PUSH_PROMISE) {
     CHECK(promisedStream_.hasValue());
     headersCompleteStream = *promisedStream_;
@@ -464,7 +465,7 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
 
   DeferredParseError parseError;
   if (curHeader_.flags & http2::END_HEADERS) {
-    auto parseRes = parseHeadersDecodeFrames(priority, exAttributes);
+    auto parseRes = parseHeadersDecodeFrames(priority);
     if (parseRes.hasError()) {
       parseError = std::move(parseRes.error());
       if (parseError.connectionError) {
@@ -473,6 +474,9 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
     } else {
       msg = std::move(*parseRes);
     }
+  } else {
+    // Decode what we have now rather than buffering the whole block
+    RETURN_IF_ERROR(parseHeadersDecodeFragment());
   }
 
   // Report back what we've parsed
@@ -541,21 +545,9 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
   return handleEndStream();
 }
 
-folly::Expected<std::unique_ptr<HTTPMessage>, HTTP2Codec::DeferredParseError>
-HTTP2Codec::parseHeadersDecodeFrames(
+void HTTP2Codec::parseHeadersStartBlock(
     const folly::Optional<http2::PriorityUpdate>& priority,
     const folly::Optional<ExAttributes>& exAttributes) {
-  // decompress headers
-  Cursor headerCursor(curHeaderBlock_.front());
-
-  // Validate circular dependencies.
-  if (priority && (curHeader_.stream == priority->streamDependency)) {
-    return folly::makeUnexpected(DeferredParseError(
-        ErrorCode::PROTOCOL_ERROR,
-        false,
-        folly::to<string>("Circular dependency for txn=", curHeader_.stream)));
-  }
-
   decodeInfo_.init(parsingReq_,
                    parsingDownstreamTrailers_,
                    validateHeaders_,
@@ -565,29 +557,70 @@ HTTP2Codec::parseHeadersDecodeFrames(
     decodeInfo_.msg->setHTTP2Priority(std::make_tuple(
         priority->streamDependency, priority->exclusive, priority->weight));
   }
+}
 
-  headerCodec_.decodeStreaming(
-      headerCursor, curHeaderBlock_.chainLength(), this);
-  auto msg = std::move(decodeInfo_.msg);
+ErrorCode HTTP2Codec::parseHeadersDecodeFragment() {
+  if (curHeaderBlock_.empty()) {
+    return ErrorCode::NO_ERROR;
+  }
+  Cursor headerCursor(curHeaderBlock_.front());
+  auto consumed = headerCodec_.decodeStreamingFragment(
+      headerCursor, curHeaderBlock_.chainLength(), this, false);
+  if (decodeInfo_.decodeError != HPACK::DecodeError::NONE) {
+    // Fails the connection without waiting for the rest of the block
+    logHeaderDecodeError(decodeInfo_.msg.get());
+    curHeaderBlock_.move();
+    curHeaderBlockLength_ = 0;
+    return ErrorCode::COMPRESSION_ERROR;
+  }
+  // Keep only a representation that continues in the next fragment
+  curHeaderBlock_.trimStart(consumed);
+  return ErrorCode::NO_ERROR;
+}
+
+void HTTP2Codec::logHeaderDecodeError(const HTTPMessage* msg) {
+  static const std::string decodeErrorMessage =
+      "Failed decoding header block for stream=";
+  // Avoid logging header blocks that have failed decoding due to being
+  // excessively large.
+  if (decodeInfo_.decodeError != HPACK::DecodeError::HEADERS_TOO_LARGE) {
+    LOG(ERROR) << decodeErrorMessage << curHeader_.stream << " header block=";
+    VLOG(3) << IOBufPrinter::printHexFolly(curHeaderBlock_.front(), true);
+  } else {
+    LOG(ERROR) << decodeErrorMessage << curHeader_.stream;
+  }
+
+  if (msg) {
+    // print the partial message
+    msg->dumpMessage(3);
+  }
+}
+
+folly::Expected<std::unique_ptr<HTTPMessage>, HTTP2Codec::DeferredParseError>
+HTTP2Codec::parseHeadersDecodeFrames(
+    const folly::Optional<http2::PriorityUpdate>& priority) {
   // Saving this in case we need to log it on error
-  auto g = folly::makeGuard([this] { curHeaderBlock_.move(); });
+  auto g = folly::makeGuard([this] {
+    curHeaderBlock_.move();
+    curHeaderBlockLength_ = 0;
+  });
+
+  // Validate circular dependencies.
+  if (priority && (curHeader_.stream == priority->streamDependency)) {
+    return folly::makeUnexpected(DeferredParseError(
+        ErrorCode::PROTOCOL_ERROR,
+        false,
+        folly::to<string>("Circular dependency for txn=", curHeader_.stream)));
+  }
+
+  // decompress the rest of the headers
+  Cursor headerCursor(curHeaderBlock_.front());
+  headerCodec_.decodeStreamingFragment(
+      headerCursor, curHeaderBlock_.chainLength(), this, true);
+  auto msg = std::move(decodeInfo_.msg);
   // Check decoding error
   if (decodeInfo_.decodeError != HPACK::DecodeError::NONE) {
-    static const std::string decodeErrorMessage =
-        "Failed decoding header block for stream=";
-    // Avoid logging header blocks that have failed decoding due to being
-    // excessively large.
-    if (decodeInfo_.decodeError != HPACK::DecodeError::HEADERS_TOO_LARGE) {
-      LOG(ERROR) << decodeErrorMessage << curHeader_.stream << " header block=";
-      VLOG(3) << IOBufPrinter::printHexFolly(curHeaderBlock_.front(), true);
-    } else {
-      LOG(ERROR) << decodeErrorMessage << curHeader_.stream;
-    }
-
-    if (msg) {
-      // print the partial message
-      msg->dumpMessage(3);
-    }
+    logHeaderDecodeError(msg.get());
     return folly::makeUnexpected(
         DeferredParseError(ErrorCode::COMPRESSION_ERROR, true, empty_string));
   }
@@ -1132,17 +1165,14 @@ bool HTTP2Codec::onIngressUpgradeMessage(const HTTPMessage& msg) {
     return true;
   }
 
-  auto decoded = base64url_decode(settingsHeader);
-
   // Must be well formed Base64Url and not too large
-  if (decoded.empty() || decoded.length() > http2::kMaxFramePayloadLength) {
+  IOBufQueue settingsQueue{IOBufQueue::cacheChainLength()};
+  if (Base64::decodedSize(settingsHeader) > http2::kMaxFramePayloadLength ||
+      !Base64::urlDecode(settingsHeader, settingsQueue) ||
+      settingsQueue.empty()) {
     VLOG(4) << __func__ << " failed to decode HTTP2-Settings";
     return false;
   }
-  std::unique_ptr<IOBuf> decodedBuf =
-      IOBuf::wrapBuffer(decoded.data(), decoded.length());
-  IOBufQueue settingsQueue{IOBufQueue::cacheChainLength()};
-  settingsQueue.append(std::move(decodedBuf));
   Cursor c(settingsQueue.front());
   std::deque<SettingPair> settings;
   // downcast is ok because of above length check
@@ -1419,6 +1449,9 @@ size_t HTTP2Codec::generateBody(folly::IOBufQueue& writeBuf,
   IOBufQueue queue(IOBufQueue::cacheChainLength());
   queue.append(std::move(chain));
   size_t maxFrameSize = maxSendFrameSize();
+  if (egressDataFrameSizeLimit_ > 0) {
+    maxFrameSize = std::min<size_t>(maxFrameSize, egressDataFrameSizeLimit_);
+  }
   while (queue.chainLength() > maxFrameSize) {
     auto chunk = queue.split(maxFrameSize);
     written += generateHeaderCallbackWrapper(
@@ -142,6 +142,9 @@ class HTTP2Codec
   void setHeaderCodecStats(HeaderCodec::Stats* hcStats) override {
     headerCodec_.setStats(hcStats);
   }
+  void setEgressDataFrameSizeLimit(uint32_t limit) override {
+    egressDataFrameSizeLimit_ = limit;
+  }
 
   bool isRequest(StreamID id) const {
     return ((transportDirection_ == TransportDirection::DOWNSTREAM &&
@@ -253,10 +256,14 @@ class HTTP2Codec
     DeferredParseError() = default;
   };
 
-  folly::Expected<std::unique_ptr<HTTPMessage>, DeferredParseError>
-  parseHeadersDecodeFrames(
+  void parseHeadersStartBlock(
       const folly::Optional<http2::PriorityUpdate>& priority,
       const folly::Optional<ExAttributes>& exAttributes);
+  ErrorCode parseHeadersDecodeFragment();
+  void logHeaderDecodeError(const HTTPMessage* msg);
+  folly::Expected<std::unique_ptr<HTTPMessage>, DeferredParseError>
+  parseHeadersDecodeFrames(
+      const folly::Optional<http2::PriorityUpdate>& priority);
   void deliverDeferredParseError(const DeferredParseError& parseError);
 
   folly::Optional<ErrorCode> parseHeadersCheckConcurrentStreams(
@@ -299,7 +306,11 @@ class HTTP2Codec
   folly::IOBufQueue curAuthenticatorBlock_{
       folly::IOBufQueue::cacheChainLength()};
 
+  // Header block fragments are decoded as they arrive; this only holds a
+  // header representation split across frames.
   folly::IOBufQueue curHeaderBlock_{folly::IOBufQueue::cacheChainLength()};
+  // Compressed length of the current header block so far
+  uint64_t curHeaderBlockLength_{0};
   HTTPSettings ingressSettings_{
       {SettingsId::HEADER_TABLE_SIZE, 4096},
       {SettingsId::ENABLE_PUSH, 1},
@@ -331,6 +342,8 @@ class HTTP2Codec
   std::vector<StreamID> virtualPriorityNodes_;
   folly::Optional<uint32_t> pendingTableMaxSize_;
   bool reuseIOBufHeadroomForData_{true};
+  // 0 means DATA frames are only limited by the peer's MAX_FRAME_SIZE
+  uint32_t egressDataFrameSizeLimit_{0};
 
   // True if last parsed HEADERS frame was trailers.
   // Reset only when HEADERS frame is parsed, thus
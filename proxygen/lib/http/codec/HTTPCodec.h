@@ -534,6 +534,14 @@ class HTTPCodec {
     return false;
   }
 
+  /**
+   * Check whether the peer can receive 103 (Early Hints) informational
+   * responses ahead of the final response.
+   */
+  virtual bool supportsEarlyHints() const {
+    return true;
+  }
+
   /**
    * Generate a connection preface, if there is any for this protocol.
    *
@@ -778,6 +786,14 @@ class HTTPCodec {
   virtual void setHeaderCodecStats(HeaderCodec::Stats* /* stats */) {
   }
 
+  /**
+   * Caps the payload of each generated DATA frame below the negotiated
+   * maximum, so callers can line frames up with transport records. 0 removes
+   * the cap. Only meaningful for protocols that frame body data.
+   */
+  virtual void setEgressDataFrameSizeLimit(uint32_t /* limit */) {
+  }
+
   /**
    * Get the identifier of the last stream started by the remote.
    */
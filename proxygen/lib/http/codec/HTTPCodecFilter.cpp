@@ -231,6 +231,10 @@ bool PassThroughHTTPCodecFilter::supportsPushTransactions() const {
   return call_->supportsPushTransactions();
 }
 
+bool PassThroughHTTPCodecFilter::supportsEarlyHints() const {
+  return call_->supportsEarlyHints();
+}
+
 size_t PassThroughHTTPCodecFilter::generateConnectionPreface(
     folly::IOBufQueue& writeBuf) {
   return call_->generateConnectionPreface(writeBuf);
@@ -383,6 +387,10 @@ void PassThroughHTTPCodecFilter::setHeaderCodecStats(
   call_->setHeaderCodecStats(stats);
 }
 
+void PassThroughHTTPCodecFilter::setEgressDataFrameSizeLimit(uint32_t limit) {
+  call_->setEgressDataFrameSizeLimit(limit);
+}
+
 HTTPCodec::StreamID PassThroughHTTPCodecFilter::getLastIncomingStreamID()
     const {
   return call_->getLastIncomingStreamID();
@@ -153,6 +153,8 @@ class PassThroughHTTPCodecFilter : public HTTPCodecFilter {
 
   bool supportsPushTransactions() const override;
 
+  bool supportsEarlyHints() const override;
+
   size_t generateConnectionPreface(folly::IOBufQueue& writeBuf) override;
 
   void generateHeader(
@@ -247,6 +249,8 @@ class PassThroughHTTPCodecFilter : public HTTPCodecFilter {
 
   void setHeaderCodecStats(HeaderCodec::Stats* stats) override;
 
+  void setEgressDataFrameSizeLimit(uint32_t limit) override;
+
   void enableDoubleGoawayDrain() override;
 
   HTTPCodec::StreamID getLastIncomingStreamID() const override;
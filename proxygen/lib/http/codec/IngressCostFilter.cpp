@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/IngressCostFilter.h>
+
+#include <folly/Conv.h>
+#include <limits>
+#include <proxygen/lib/http/codec/HTTP2Framer.h>
+
+namespace proxygen {
+
+IngressCostFilter::IngressCostFilter(Callback& callback)
+    : costCallback_(callback),
+      balance_(params_.burst),
+      lastRefill_(getCurrentTime()) {
+}
+
+void IngressCostFilter::setParams(const IngressCostParams& params) {
+  params_ = params;
+  balance_ = std::min<int64_t>(balance_, params_.burst);
+}
+
+void IngressCostFilter::refill() {
+  auto now = getCurrentTime();
+  auto elapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(now - lastRefill_);
+  auto credit = elapsed.count() * params_.refillPerSecond / 1000000;
+  if (credit <= 0) {
+    // Keep the remainder for the next charge
+    return;
+  }
+  lastRefill_ = now;
+  balance_ = std::min<int64_t>(balance_ + credit, params_.burst);
+}
+
+bool IngressCostFilter::charge(uint32_t cost, const char* reason) {
+  if (!params_.enabled) {
+    return false;
+  }
+  if (level_ == IngressCostLevel::CLOSE) {
+    return true;
+  }
+  refill();
+  balance_ -= cost;
+  if (balance_ >= 0) {
+    // A GOAWAY is not taken back
+    if (level_ == IngressCostLevel::DEPRIORITIZE) {
+      level_ = IngressCostLevel::NORMAL;
+    }
+    return false;
+  }
+
+  auto debt = static_cast<uint64_t>(-balance_);
+  auto level = IngressCostLevel::DEPRIORITIZE;
+  if (debt >= params_.closeDebt) {
+    level = IngressCostLevel::CLOSE;
+  } else if (debt >= params_.goawayDebt) {
+    level = IngressCostLevel::GOAWAY;
+  }
+  if (level <= level_) {
+    return false;
+  }
+  level_ = level;
+  if (level == IngressCostLevel::CLOSE) {
+    HTTPException ex(
+        HTTPException::Direction::INGRESS_AND_EGRESS,
+        folly::to<std::string>(
+            "dropping connection due to excessive ingress cost, debt = ",
+            debt,
+            ", most recent event = ",
+            reason));
+    ex.setProxygenError(kErrorDropped);
+    callback_->onError(0, ex, true);
+    return true;
+  }
+  VLOG(3) << "ingress cost budget exceeded, debt=" << debt
+          << " level=" << static_cast<uint32_t>(level) << " reason=" << reason;
+  std::chrono::milliseconds recoveryTime(
+      params_.refillPerSecond > 0 ? debt * 1000 / params_.refillPerSecond + 1
+                                  : 0);
+  costCallback_.onIngressCostExceeded(level, recoveryTime);
+  return false;
+}
+
+void IngressCostFilter::onFrameHeader(StreamID stream,
+                                      uint8_t flags,
+                                      uint64_t length,
+                                      uint64_t type,
+                                      uint16_t version) {
+  uint64_t cost = kIngressFrameCost;
+  if (type == static_cast<uint64_t>(http2::FrameType::HEADERS) ||
+      type == static_cast<uint64_t>(http2::FrameType::CONTINUATION)) {
+    // Charged before the block is buffered, so a CONTINUATION flood that
+    // never ends the header block still pays for every byte
+    cost += length / kIngressHeaderBytesPerCost;
+  }
+  cost = std::min<uint64_t>(cost, std::numeric_limits<uint32_t>::max());
+  if (!charge(static_cast<uint32_t>(cost), "frame")) {
+    callback_->onFrameHeader(stream, flags, length, type, version);
+  }
+}
+
+void IngressCostFilter::onMessageBegin(StreamID stream, HTTPMessage* msg) {
+  if (charge(kIngressStreamCost, "new stream")) {
+    return;
+  }
+  if (call_->getTransportDirection() == TransportDirection::DOWNSTREAM) {
+    openStreams_.insert(stream);
+  }
+  callback_->onMessageBegin(stream, msg);
+}
+
+void IngressCostFilter::onHeadersComplete(StreamID stream,
+                                          std::unique_ptr<HTTPMessage> msg) {
+  // Decompressed size, which is what an HPACK bomb inflates
+  if (charge(msg->getIngressHeaderSize().uncompressed /
+                 kIngressHeaderBytesPerCost,
+             "header decode")) {
+    return;
+  }
+  callback_->onHeadersComplete(stream, std::move(msg));
+}
+
+void IngressCostFilter::onAbort(StreamID stream, ErrorCode code) {
+  uint32_t cost = 0;
+  if (openStreams_.erase(stream) > 0) {
+    // The stream's transaction and handler were built for nothing
+    cost = kIngressResetOpenStreamCost;
+  }
+  if (!charge(cost, "reset")) {
+    callback_->onAbort(stream, code);
+  }
+}
+
+void IngressCostFilter::onError(StreamID stream,
+                                const HTTPException& error,
+                                bool newTxn) {
+  openStreams_.erase(stream);
+  callback_->onError(stream, error, newTxn);
+}
+
+void IngressCostFilter::onWindowUpdate(StreamID stream, uint32_t amount) {
+  if (!charge(amount < kIngressSmallWindowUpdate ? kIngressSmallWindowUpdateCost
+                                                 : 0,
+              "window update")) {
+    callback_->onWindowUpdate(stream, amount);
+  }
+}
+
+void IngressCostFilter::onSettings(const SettingsList& settings) {
+  auto cost = kIngressControlFrameCost + kIngressSettingCost * settings.size();
+  if (!charge(static_cast<uint32_t>(cost), "settings")) {
+    callback_->onSettings(settings);
+  }
+}
+
+void IngressCostFilter::onPingRequest(uint64_t data) {
+  if (!charge(kIngressControlFrameCost, "ping")) {
+    callback_->onPingRequest(data);
+  }
+}
+
+void IngressCostFilter::onPriority(StreamID stream,
+                                   const HTTPMessage::HTTP2Priority& pri) {
+  if (!charge(kIngressControlFrameCost, "priority")) {
+    callback_->onPriority(stream, pri);
+  }
+}
+
+void IngressCostFilter::generateHeader(
+    folly::IOBufQueue& writeBuf,
+    StreamID stream,
+    const HTTPMessage& msg,
+    bool eom,
+    HTTPHeaderSize* size,
+    const folly::Optional<HTTPHeaders>& extraHeaders) {
+  if (eom) {
+    openStreams_.erase(stream);
+  }
+  call_->generateHeader(writeBuf, stream, msg, eom, size, extraHeaders);
+}
+
+size_t IngressCostFilter::generateBody(folly::IOBufQueue& writeBuf,
+                                       StreamID stream,
+                                       std::unique_ptr<folly::IOBuf> chain,
+                                       folly::Optional<uint8_t> padding,
+                                       bool eom) {
+  if (eom) {
+    openStreams_.erase(stream);
+  }
+  return call_->generateBody(
+      writeBuf, stream, std::move(chain), padding, eom);
+}
+
+size_t IngressCostFilter::generateEOM(folly::IOBufQueue& writeBuf,
+                                      StreamID stream) {
+  openStreams_.erase(stream);
+  return call_->generateEOM(writeBuf, stream);
+}
+
+size_t IngressCostFilter::generateRstStream(folly::IOBufQueue& writeBuf,
+                                            StreamID stream,
+                                            ErrorCode statusCode) {
+  openStreams_.erase(stream);
+  return call_->generateRstStream(writeBuf, stream, statusCode);
+}
+
+} // namespace proxygen
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <folly/container/F14Set.h>
+#include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+// Estimated cost, in abstract units of roughly a microsecond of CPU or a few
+// hundred bytes of memory, charged for each kind of ingress event.
+constexpr uint32_t kIngressFrameCost = 1;
+constexpr uint32_t kIngressStreamCost = 20;
+constexpr uint32_t kIngressHeaderBytesPerCost = 32;
+constexpr uint32_t kIngressResetOpenStreamCost = 60;
+constexpr uint32_t kIngressSmallWindowUpdate = 1024;
+constexpr uint32_t kIngressSmallWindowUpdateCost = 10;
+constexpr uint32_t kIngressSettingCost = 5;
+constexpr uint32_t kIngressControlFrameCost = 5;
+constexpr uint32_t kIngressWindowStallCost = 20;
+
+// A busy, well behaved client stays far below the refill rate
+constexpr uint32_t kDefaultIngressCostRefillPerSecond = 100000;
+constexpr uint32_t kDefaultIngressCostBurst = 200000;
+constexpr uint32_t kDefaultIngressCostGoawayDebt = 50000;
+constexpr uint32_t kDefaultIngressCostCloseDebt = 200000;
+
+struct IngressCostParams {
+  bool enabled{true};
+  // Budget regained per second, and the most that can be saved up
+  uint32_t refillPerSecond{kDefaultIngressCostRefillPerSecond};
+  uint32_t burst{kDefaultIngressCostBurst};
+  // Once the budget is spent the connection is deprioritised; at these
+  // debts it is sent a GOAWAY or closed.
+  uint32_t goawayDebt{kDefaultIngressCostGoawayDebt};
+  uint32_t closeDebt{kDefaultIngressCostCloseDebt};
+};
+
+enum class IngressCostLevel : uint8_t {
+  NORMAL,
+  DEPRIORITIZE,
+  GOAWAY,
+  CLOSE,
+};
+
+/**
+ * This class charges each ingress event an estimated processing cost
+ * against a per-connection token bucket, so patterns that are cheap to send
+ * but expensive to handle (rapid reset, CONTINUATION floods, tiny
+ * WINDOW_UPDATEs, SETTINGS churn) run out of budget long before a normal
+ * client would.
+ *
+ * Responses are graduated.  An empty budget asks the session to deprioritise
+ * the connection until it refills, a larger debt asks for a GOAWAY, and
+ * reaching closeDebt converts the callback into a session level error with
+ * ProxygenError = kErrorDropped, like ControlMessageRateLimitFilter.
+ */
+class IngressCostFilter : public PassThroughHTTPCodecFilter {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {
+    }
+    /**
+     * Called when the connection moves to DEPRIORITIZE or GOAWAY.
+     * recoveryTime is how long until the budget is back in credit.
+     */
+    virtual void onIngressCostExceeded(
+        IngressCostLevel level, std::chrono::milliseconds recoveryTime) = 0;
+  };
+
+  explicit IngressCostFilter(Callback& callback);
+
+  void setParams(const IngressCostParams& params);
+
+  /**
+   * Charge cost for an event the codec does not see, such as a send stall
+   * caused by the peer's flow control window.  Returns true if the
+   * connection is being dropped.
+   */
+  bool charge(uint32_t cost, const char* reason);
+
+  IngressCostLevel getLevel() const {
+    return level_;
+  }
+
+  int64_t getBalance() const {
+    return balance_;
+  }
+
+  // Filter functions
+  void onFrameHeader(StreamID stream,
+                     uint8_t flags,
+                     uint64_t length,
+                     uint64_t type,
+                     uint16_t version = 0) override;
+  void onMessageBegin(StreamID stream, HTTPMessage* msg) override;
+  void onHeadersComplete(StreamID stream,
+                         std::unique_ptr<HTTPMessage> msg) override;
+  void onAbort(StreamID stream, ErrorCode code) override;
+  void onError(StreamID stream,
+               const HTTPException& error,
+               bool newTxn) override;
+  void onWindowUpdate(StreamID stream, uint32_t amount) override;
+  void onSettings(const SettingsList& settings) override;
+  void onPingRequest(uint64_t data) override;
+  void onPriority(StreamID stream,
+                  const HTTPMessage::HTTP2Priority& pri) override;
+
+  void generateHeader(
+      folly::IOBufQueue& writeBuf,
+      StreamID stream,
+      const HTTPMessage& msg,
+      bool eom,
+      HTTPHeaderSize* size,
+      const folly::Optional<HTTPHeaders>& extraHeaders) override;
+  size_t generateBody(folly::IOBufQueue& writeBuf,
+                      StreamID stream,
+                      std::unique_ptr<folly::IOBuf> chain,
+                      folly::Optional<uint8_t> padding,
+                      bool eom) override;
+  size_t generateEOM(folly::IOBufQueue& writeBuf, StreamID stream) override;
+  size_t generateRstStream(folly::IOBufQueue& writeBuf,
+                           StreamID stream,
+                           ErrorCode statusCode) override;
+
+ private:
+  void refill();
+
+  Callback& costCallback_;
+  IngressCostParams params_;
+  int64_t balance_;
+  TimePoint lastRefill_;
+  IngressCostLevel level_{IngressCostLevel::NORMAL};
+  // Peer initiated streams we have not finished responding to.  Resetting
+  // one of these is the expensive half of a rapid reset.
+  folly::F14FastSet<StreamID> openStreams_;
+};
+
+} // namespace proxygen
@@ -178,6 +178,16 @@ void HPACKCodec::decodeStreaming(
   decoder_.decodeStreaming(cursor, length, streamingCb);
 }
 
+uint32_t HPACKCodec::decodeStreamingFragment(
+    Cursor& cursor,
+    uint32_t length,
+    HPACK::StreamingCallback* streamingCb,
+    bool endOfBlock) noexcept {
+  streamingCb->stats = stats_;
+  return decoder_.decodeStreamingFragment(
+      cursor, length, streamingCb, endOfBlock);
+}
+
 void HPACKCodec::describe(std::ostream& stream) const {
   stream << "DecoderTable:\n" << decoder_;
   stream << "EncoderTable:\n" << encoder_;
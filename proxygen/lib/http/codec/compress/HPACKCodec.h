@@ -60,6 +60,15 @@ class HPACKCodec : public HeaderCodec {
                        uint32_t length,
                        HPACK::StreamingCallback* streamingCb) noexcept;
 
+  /**
+   * Decode one fragment of a header block, returning the bytes consumed.
+   * See HPACKDecoder::decodeStreamingFragment.
+   */
+  uint32_t decodeStreamingFragment(folly::io::Cursor& cursor,
+                                   uint32_t length,
+                                   HPACK::StreamingCallback* streamingCb,
+                                   bool endOfBlock) noexcept;
+
   void setEncoderHeaderTableSize(uint32_t size) {
     encoder_.setHeaderTableSize(size);
   }
@@ -19,29 +19,12 @@ uint32_t HPACKContext::getIndex(const HPACKHeader& header) const {
 
 uint32_t HPACKContext::getIndex(const HPACKHeaderName& name,
                                 folly::StringPiece value) const {
-  // First consult the static header table if applicable
-  // Applicability is determined by the following guided optimizations:
-  // 1) The set of CommonHeaders includes all StaticTable headers and so we can
-  // quickly conclude that we need not check the StaticTable
-  // for non-CommonHeaders
-  // 2) The StaticTable only contains non empty values for a very small subset
-  // of header names.  As getIndex is only meaingful if both name and value
-  // match, we know that if our header has a value and is not part of the very
-  // small subset of header names, there is no point consulting the StaticTable
-  bool consultStaticTable = false;
-  if (value.empty()) {
-    consultStaticTable = name.isCommonHeader();
-  } else {
-    consultStaticTable =
-        StaticHeaderTable::isHeaderCodeInTableWithNonEmptyValue(
-            name.getHeaderCode());
-  }
-  if (consultStaticTable) {
-    uint32_t staticIndex = getStaticTable().getIndex(name, value);
-    if (staticIndex) {
-      staticRefs_++;
-      return staticToGlobalIndex(staticIndex);
-    }
+  // First consult the static header table.  Its index is a perfect hash
+  // built at compile time, so this is cheap even for headers it lacks.
+  uint32_t staticIndex = getStaticTable().getIndex(name, value);
+  if (staticIndex) {
+    staticRefs_++;
+    return staticToGlobalIndex(staticIndex);
   }
 
   // Else check the dynamic table
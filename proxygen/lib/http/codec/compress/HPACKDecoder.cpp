@@ -12,6 +12,14 @@
 
 using folly::io::Cursor;
 
+namespace {
+// While more fragments of the block follow, running out of input only means
+// the representation is decoded again once they arrive
+bool isRetried(proxygen::HPACK::DecodeError err, bool moreFragments) {
+  return moreFragments && err == proxygen::HPACK::DecodeError::BUFFER_UNDERFLOW;
+}
+} // namespace
+
 namespace proxygen {
 
 void HPACKDecoder::decodeStreaming(Cursor& cursor,
@@ -21,7 +29,7 @@ void HPACKDecoder::decodeStreaming(Cursor& cursor,
   uint32_t emittedSize = 0;
 
   while (!hasError() && !dbuf.empty()) {
-    emittedSize += decodeHeader(dbuf, streamingCb, nullptr);
+    emittedSize += decodeHeader(dbuf, streamingCb, nullptr, false);
 
     if (emittedSize > maxUncompressed_) {
       LOG(ERROR) << "exceeded uncompressed size limit of " << maxUncompressed_
@@ -39,10 +47,63 @@ void HPACKDecoder::decodeStreaming(Cursor& cursor,
                  emittedSize);
 }
 
+uint32_t HPACKDecoder::decodeStreamingFragment(
+    Cursor& cursor,
+    uint32_t totalBytes,
+    HPACK::StreamingCallback* streamingCb,
+    bool endOfBlock) {
+  HPACKDecodeBuffer dbuf(cursor, totalBytes, maxUncompressed_, endOfBlock);
+  uint32_t consumed = 0;
+  bool moreFragments = !endOfBlock;
+
+  while (!hasError() && !dbuf.empty()) {
+    auto headerSize =
+        partial_ ? resumeLiteralHeader(dbuf, streamingCb, moreFragments)
+                 : decodeHeader(dbuf, streamingCb, nullptr, moreFragments);
+    if (moreFragments && err_ == HPACK::DecodeError::BUFFER_UNDERFLOW) {
+      // The rest of this representation is in a later fragment.  Nothing
+      // was emitted or added to the table for it, so it is decoded again
+      // next time: from the start, or from the value if the name was read.
+      err_ = HPACK::DecodeError::NONE;
+      if (partial_) {
+        consumed = partial_->valueOffset;
+      }
+      break;
+    }
+    consumed = dbuf.consumedBytes();
+    blockEmittedSize_ += headerSize;
+
+    if (blockEmittedSize_ > maxUncompressed_) {
+      LOG(ERROR) << "exceeded uncompressed size limit of " << maxUncompressed_
+                 << " bytes";
+      err_ = HPACK::DecodeError::HEADERS_TOO_LARGE;
+      break;
+    }
+    blockEmittedSize_ += 2;
+  }
+  if (endOfBlock && partial_ && !hasError()) {
+    LOG(ERROR) << "Header block ended in the value of name=" << partial_->name;
+    err_ = HPACK::DecodeError::BUFFER_UNDERFLOW;
+  }
+  blockCompressedSize_ += consumed;
+  if (endOfBlock || hasError()) {
+    partial_.reset();
+    completeDecode(HeaderCodec::Type::HPACK,
+                   streamingCb,
+                   blockCompressedSize_,
+                   blockCompressedSize_,
+                   blockEmittedSize_);
+    blockCompressedSize_ = 0;
+    blockEmittedSize_ = 0;
+  }
+  return consumed;
+}
+
 uint32_t HPACKDecoder::decodeLiteralHeader(
     HPACKDecodeBuffer& dbuf,
     HPACK::StreamingCallback* streamingCb,
-    headers_t* emitted) {
+    headers_t* emitted,
+    bool moreFragments) {
   uint8_t byte = dbuf.peek();
   bool indexing = byte & HPACK::LITERAL_INC_INDEX.code;
   HPACKHeader header;
@@ -58,7 +119,11 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
     uint64_t index;
     err_ = dbuf.decodeInteger(length, index);
     if (err_ != HPACK::DecodeError::NONE) {
-      LOG(ERROR) << "Decode error decoding index err_=" << err_;
+      if (isRetried(err_, moreFragments)) {
+        VLOG(4) << "Name index continues in the next fragment";
+      } else {
+        LOG(ERROR) << "Decode error decoding index err_=" << err_;
+      }
       return 0;
     }
     // validate the index
@@ -75,15 +140,38 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
     err_ = dbuf.decodeLiteral(headerName);
     header.name = headerName;
     if (err_ != HPACK::DecodeError::NONE) {
-      LOG(ERROR) << "Error decoding header name err_=" << err_;
+      if (isRetried(err_, moreFragments)) {
+        VLOG(4) << "Header name continues in the next fragment";
+      } else {
+        LOG(ERROR) << "Error decoding header name err_=" << err_;
+      }
       return 0;
     }
   }
-  // value
+  return decodeLiteralValue(
+      dbuf, header, indexing, streamingCb, emitted, moreFragments);
+}
+
+uint32_t HPACKDecoder::decodeLiteralValue(
+    HPACKDecodeBuffer& dbuf,
+    HPACKHeader& header,
+    bool indexing,
+    HPACK::StreamingCallback* streamingCb,
+    headers_t* emitted,
+    bool moreFragments) {
+  auto valueOffset = dbuf.consumedBytes();
   err_ = dbuf.decodeLiteral(header.value);
   if (err_ != HPACK::DecodeError::NONE) {
-    LOG(ERROR) << "Error decoding header value name=" << header.name
-               << " err_=" << err_;
+    if (isRetried(err_, moreFragments)) {
+      VLOG(4) << "Value of header name=" << header.name
+              << " continues in the next fragment";
+      // Keep the name, which may be a long Huffman string, so it is not
+      // decoded again with every fragment
+      partial_ = PartialLiteral{std::move(header.name), indexing, valueOffset};
+    } else {
+      LOG(ERROR) << "Error decoding header value name=" << header.name
+                 << " err_=" << err_;
+    }
     return 0;
   }
 
@@ -102,14 +190,31 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
   return emittedSize;
 }
 
+uint32_t HPACKDecoder::resumeLiteralHeader(
+    HPACKDecodeBuffer& dbuf,
+    HPACK::StreamingCallback* streamingCb,
+    bool moreFragments) {
+  HPACKHeader header;
+  header.name = std::move(partial_->name);
+  bool indexing = partial_->indexing;
+  partial_.reset();
+  return decodeLiteralValue(
+      dbuf, header, indexing, streamingCb, nullptr, moreFragments);
+}
+
 uint32_t HPACKDecoder::decodeIndexedHeader(
     HPACKDecodeBuffer& dbuf,
     HPACK::StreamingCallback* streamingCb,
-    headers_t* emitted) {
+    headers_t* emitted,
+    bool moreFragments) {
   uint64_t index;
   err_ = dbuf.decodeInteger(HPACK::INDEX_REF.prefixLength, index);
   if (err_ != HPACK::DecodeError::NONE) {
-    LOG(ERROR) << "Decode error decoding index err_=" << err_;
+    if (isRetried(err_, moreFragments)) {
+      VLOG(4) << "Index continues in the next fragment";
+    } else {
+      LOG(ERROR) << "Decode error decoding index err_=" << err_;
+    }
     return 0;
   }
   // validate the index
@@ -133,18 +238,19 @@ bool HPACKDecoder::isValid(uint32_t index) {
 
 uint32_t HPACKDecoder::decodeHeader(HPACKDecodeBuffer& dbuf,
                                     HPACK::StreamingCallback* streamingCb,
-                                    headers_t* emitted) {
+                                    headers_t* emitted,
+                                    bool moreFragments) {
   uint8_t byte = dbuf.peek();
   if (byte & HPACK::INDEX_REF.code) {
-    return decodeIndexedHeader(dbuf, streamingCb, emitted);
+    return decodeIndexedHeader(dbuf, streamingCb, emitted, moreFragments);
   } else if (byte & HPACK::LITERAL_INC_INDEX.code) {
     // else it's fine, fall through to decodeLiteralHeader
   } else if (byte & HPACK::TABLE_SIZE_UPDATE.code) {
-    handleTableSizeUpdate(dbuf, table_);
+    handleTableSizeUpdate(dbuf, table_, moreFragments);
     return 0;
   } // else LITERAL
   // LITERAL_NO_INDEXING or LITERAL_INCR_INDEXING
-  return decodeLiteralHeader(dbuf, streamingCb, emitted);
+  return decodeLiteralHeader(dbuf, streamingCb, emitted, moreFragments);
 }
 
 } // namespace proxygen
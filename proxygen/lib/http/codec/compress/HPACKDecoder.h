@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <folly/Optional.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <proxygen/lib/http/codec/compress/HPACKContext.h>
@@ -36,6 +37,26 @@ class HPACKDecoder
                        uint32_t totalBytes,
                        HPACK::StreamingCallback* streamingCb);
 
+  /**
+   * Incremental variant of decodeStreaming for a header block that arrives
+   * in several fragments (HEADERS + CONTINUATION).  Decodes every complete
+   * header representation in the first totalBytes of cursor and returns the
+   * number of bytes consumed.  The caller keeps the remainder and passes it
+   * again, followed by the next fragment.
+   *
+   * A literal whose value is cut off keeps its decoded name, so the name
+   * bytes are consumed and only the value is decoded again.
+   *
+   * The uncompressed size limit applies across the whole block, so an
+   * oversized block fails on the fragment that crosses it.
+   * onHeadersComplete is called for the fragment with endOfBlock set, and
+   * onDecodeError as soon as an error is found.
+   */
+  uint32_t decodeStreamingFragment(folly::io::Cursor& cursor,
+                                   uint32_t totalBytes,
+                                   HPACK::StreamingCallback* streamingCb,
+                                   bool endOfBlock);
+
   void setHeaderTableMaxSize(uint32_t maxSize) {
     HPACKDecoderBase::setHeaderTableMaxSize(table_, maxSize);
   }
@@ -43,17 +64,47 @@ class HPACKDecoder
  private:
   bool isValid(uint32_t index);
 
+  // moreFragments: the block continues in a later fragment, so running out
+  // of input is not an error
   uint32_t decodeIndexedHeader(HPACKDecodeBuffer& dbuf,
                                HPACK::StreamingCallback* streamingCb,
-                               headers_t* emitted);
+                               headers_t* emitted,
+                               bool moreFragments);
 
   uint32_t decodeLiteralHeader(HPACKDecodeBuffer& dbuf,
                                HPACK::StreamingCallback* streamingCb,
-                               headers_t* emitted);
+                               headers_t* emitted,
+                               bool moreFragments);
+
+  uint32_t decodeLiteralValue(HPACKDecodeBuffer& dbuf,
+                              HPACKHeader& header,
+                              bool indexing,
+                              HPACK::StreamingCallback* streamingCb,
+                              headers_t* emitted,
+                              bool moreFragments);
+
+  // Finishes the literal left in partial_ by the previous fragment
+  uint32_t resumeLiteralHeader(HPACKDecodeBuffer& dbuf,
+                               HPACK::StreamingCallback* streamingCb,
+                               bool moreFragments);
 
   uint32_t decodeHeader(HPACKDecodeBuffer& dbuf,
                         HPACK::StreamingCallback* streamingCb,
-                        headers_t* emitted);
+                        headers_t* emitted,
+                        bool moreFragments);
+
+  // A literal whose value continues in the next fragment
+  struct PartialLiteral {
+    HPACKHeaderName name;
+    bool indexing{false};
+    // Where the value starts in the fragment that was cut off
+    uint32_t valueOffset{0};
+  };
+
+  // State of a block being decoded with decodeStreamingFragment
+  uint32_t blockCompressedSize_{0};
+  uint32_t blockEmittedSize_{0};
+  folly::Optional<PartialLiteral> partial_;
 };
 
 } // namespace proxygen
@@ -64,11 +64,13 @@ void HPACKDecoderBase::setHeaderTableMaxSize(HeaderTable& table,
 
 void HPACKDecoderBase::handleTableSizeUpdate(HPACKDecodeBuffer& dbuf,
                                              HeaderTable& table,
-                                             bool isQpack) {
+                                             bool partialInput) {
   uint64_t arg = 0;
   err_ = dbuf.decodeInteger(HPACK::TABLE_SIZE_UPDATE.prefixLength, arg);
   if (err_ != HPACK::DecodeError::NONE) {
-    if (!isQpack || err_ != HPACK::DecodeError::BUFFER_UNDERFLOW) {
+    if (partialInput && err_ == HPACK::DecodeError::BUFFER_UNDERFLOW) {
+      VLOG(4) << "Table size update continues in later input";
+    } else {
       LOG(ERROR) << "Decode error decoding maxSize err_=" << err_;
     }
     return;
@@ -56,9 +56,9 @@ class HPACKDecoderBase {
 
   void handleTableSizeUpdate(HPACKDecodeBuffer& dbuf,
                              HeaderTable& table,
-                             /* used to determine whether or not we log
-                                certain events */
-                             bool isQpack = false);
+                             /* more input follows, so an underflow is
+                                retried rather than logged as an error */
+                             bool partialInput = false);
 
   HPACK::DecodeError err_{HPACK::DecodeError::NONE};
   uint32_t maxTableSize_;
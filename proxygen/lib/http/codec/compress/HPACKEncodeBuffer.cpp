@@ -10,6 +10,7 @@
 
 #include <memory>
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
+#include <proxygen/lib/http/codec/compress/HuffmanEncodeCache.h>
 #include <proxygen/lib/http/codec/compress/Logging.h>
 #include <proxygen/lib/utils/Logging.h>
 
@@ -105,12 +106,20 @@ uint32_t HPACKEncodeBuffer::encodeHuffman(folly::StringPiece literal) {
 uint32_t HPACKEncodeBuffer::encodeHuffman(uint8_t instruction,
                                           uint8_t nbit,
                                           folly::StringPiece literal) {
-  static const auto& huffmanTree = huffman::huffTree();
-  uint32_t size = huffmanTree.getEncodeSize(literal);
   // add the length
   DCHECK_LE(nbit, 7);
   uint8_t huffmanOn = uint8_t(1 << nbit);
   DCHECK_EQ(instruction & huffmanOn, 0);
+  if (literal.size() <= HuffmanEncodeCache::kMaxLiteralSize) {
+    // another encoder on this thread has likely encoded it already
+    auto encoded = HuffmanEncodeCache::get().encode(literal);
+    uint32_t count =
+        encodeInteger(encoded.size(), instruction | huffmanOn, nbit);
+    buf_.push(encoded.data(), encoded.size());
+    return count + encoded.size();
+  }
+  static const auto& huffmanTree = huffman::huffTree();
+  uint32_t size = huffmanTree.getEncodeSize(literal);
   uint32_t count = encodeInteger(size, instruction | huffmanOn, nbit);
   // ensure we have enough bytes before performing the encoding
   count += huffmanTree.encode(literal, buf_);
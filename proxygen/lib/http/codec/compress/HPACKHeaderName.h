@@ -82,7 +82,7 @@ class HPACKHeaderName {
     return !(*this == headerName);
   }
   bool operator>(const HPACKHeaderName& headerName) const {
-    if (!isAllocated() && !headerName.isAllocated()) {
+    if (isOrderedByAddress() && headerName.isOrderedByAddress()) {
       // Common header tables are aligned alphabetically (unit tested as well
       // to ensure it isn't accidentally changed)
       return address_ > headerName.address_;
@@ -91,7 +91,7 @@ class HPACKHeaderName {
     }
   }
   bool operator<(const HPACKHeaderName& headerName) const {
-    if (!isAllocated() && !headerName.isAllocated()) {
+    if (isOrderedByAddress() && headerName.isOrderedByAddress()) {
       // Common header tables are aligned alphabetically (unit tested as well
       // to ensure it isn't accidentally changed)
       return address_ < headerName.address_;
@@ -201,6 +201,16 @@ class HPACKHeaderName {
     }
   }
 
+  /*
+   * Whether address_ points into the generated part of the common header
+   * table.  Names added with registerCustomName follow the generated ones in
+   * registration order, so they must be compared by value.
+   */
+  bool isOrderedByAddress() const {
+    return !isAllocated() &&
+           !HTTPCommonHeaders::isCustomCode(getHeaderCode());
+  }
+
   /*
    * Address either stores a pointer to a header name in HTTPCommonHeaders,
    * or stores a pointer to a dynamically allocated std::string
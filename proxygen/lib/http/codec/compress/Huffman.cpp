@@ -10,6 +10,7 @@
 
 #include <folly/Indestructible.h>
 #include <folly/portability/Sockets.h>
+#include <cstring>
 
 using std::pair;
 
@@ -130,8 +131,19 @@ void HuffTree::buildTree() {
   }
 }
 
-uint32_t HuffTree::encode(folly::StringPiece literal,
-                          folly::io::QueueAppender& buf) const {
+namespace {
+
+/**
+ * Packs the huffman codes of literal into 4-byte words.  Full words go to
+ * writeWord in host order, the padded leftover of 1 to 4 bytes goes to
+ * writeTail already in network order.
+ */
+template <typename WriteWord, typename WriteTail>
+uint32_t encodeWords(const uint32_t* codes,
+                     const uint8_t* codeBits,
+                     folly::StringPiece literal,
+                     WriteWord&& writeWord,
+                     WriteTail&& writeTail) {
   uint32_t code;     // the huffman code of a given character
   uint8_t bits;      // on how many bits code is represented
   uint32_t w = 0;    // 4-byte word used for packing bits and write it to memory
@@ -139,8 +151,8 @@ uint32_t HuffTree::encode(folly::StringPiece literal,
   uint32_t totalBytes = 0;
   for (size_t i = 0; i < literal.size(); i++) {
     uint8_t ch = literal[i];
-    code = codes_[ch];
-    bits = bits_[ch];
+    code = codes[ch];
+    bits = codeBits[ch];
 
     if (wbits + bits < 32) {
       w = (w << bits) | code;
@@ -148,9 +160,7 @@ uint32_t HuffTree::encode(folly::StringPiece literal,
     } else {
       uint8_t xbits = wbits + bits - 32;
       w = (w << (bits - xbits)) | (code >> xbits);
-      // write the word into the buffer by converting to network order, which
-      // takes care of the endianness problems
-      buf.writeBE<uint32_t>(w);
+      writeWord(w);
       totalBytes += 4;
       // carry for next batch
       wbits = xbits;
@@ -172,13 +182,44 @@ uint32_t HuffTree::encode(folly::StringPiece literal,
     w = w << (32 - wbits);
     // set the bytes in the network order and copy w[0], w[1]...
     w = htonl(w);
-    // we need to use memcpy because we might write less than 4 bytes
-    buf.push((uint8_t*)&w, bytes);
+    writeTail(w, bytes);
     totalBytes += bytes;
   }
   return totalBytes;
 }
 
+} // namespace
+
+uint32_t HuffTree::encode(folly::StringPiece literal,
+                          folly::io::QueueAppender& buf) const {
+  return encodeWords(
+      codes_,
+      bits_,
+      literal,
+      [&](uint32_t w) {
+        // write the word into the buffer by converting to network order,
+        // which takes care of the endianness problems
+        buf.writeBE<uint32_t>(w);
+      },
+      [&](uint32_t w, uint8_t bytes) {
+        // we need to use memcpy because we might write less than 4 bytes
+        buf.push((uint8_t*)&w, bytes);
+      });
+}
+
+uint32_t HuffTree::encode(folly::StringPiece literal, uint8_t* out) const {
+  return encodeWords(
+      codes_,
+      bits_,
+      literal,
+      [&](uint32_t w) {
+        w = htonl(w);
+        memcpy(out, &w, sizeof(w));
+        out += sizeof(w);
+      },
+      [&](uint32_t w, uint8_t bytes) { memcpy(out, &w, bytes); });
+}
+
 uint32_t HuffTree::getEncodeSize(folly::StringPiece literal) const {
   uint32_t totalBits = 0;
   for (size_t i = 0; i < literal.size(); i++) {
@@ -114,6 +114,14 @@ class HuffTree {
   uint32_t encode(folly::StringPiece literal,
                   folly::io::QueueAppender& buf) const;
 
+  /**
+   * encode string literal into flat memory
+   *
+   * @param literal string to encode
+   * @param out where to write the encoded data, getEncodeSize(literal) bytes
+   */
+  uint32_t encode(folly::StringPiece literal, uint8_t* out) const;
+
   /**
    * get the encode size for a string literal, works as a dry-run for the encode
    * useful to allocate enough buffer space before doing the actual encode
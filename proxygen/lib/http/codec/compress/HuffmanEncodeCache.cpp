@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/compress/HuffmanEncodeCache.h>
+
+#include <folly/SingletonThreadLocal.h>
+#include <folly/hash/Hash.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/codec/compress/Huffman.h>
+
+namespace proxygen {
+
+namespace {
+struct HuffmanEncodeCacheTag {};
+} // namespace
+
+HuffmanEncodeCache& HuffmanEncodeCache::get() {
+  return folly::SingletonThreadLocal<HuffmanEncodeCache,
+                                     HuffmanEncodeCacheTag>::get();
+}
+
+HuffmanEncodeCache::HuffmanEncodeCache() : slots_(kNumSlots) {
+}
+
+folly::ByteRange HuffmanEncodeCache::encode(folly::StringPiece literal) {
+  DCHECK_LE(literal.size(), kMaxLiteralSize);
+  auto& slot =
+      slots_[folly::hasher<folly::StringPiece>()(literal) % kNumSlots];
+  if (slot.valid && folly::StringPiece(slot.literal) == literal) {
+    stats_.hits++;
+  } else {
+    stats_.misses++;
+    static const auto& huffmanTree = huffman::huffTree();
+    // assign and resize reuse the slot's capacity, so a warm cache rarely
+    // allocates on a miss
+    slot.literal.assign(literal.data(), literal.size());
+    slot.encoded.resize(huffmanTree.getEncodeSize(literal));
+    huffmanTree.encode(literal, reinterpret_cast<uint8_t*>(&slot.encoded[0]));
+    slot.valid = true;
+  }
+  return folly::ByteRange(
+      reinterpret_cast<const uint8_t*>(slot.encoded.data()),
+      slot.encoded.size());
+}
+
+void HuffmanEncodeCache::clear() {
+  for (auto& slot : slots_) {
+    slot.valid = false;
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Huffman encoded forms of recently encoded literals, shared by every HPACK
+ * and QPACK encoder on a thread.  Connections to the same origin send mostly
+ * the same header names and values, such as user-agent, accept or cookie,
+ * so their encoders can reuse each other's work instead of redoing it.
+ *
+ * Each thread has its own cache, so lookups take no locks.  It is direct
+ * mapped: a literal can only live in the slot its hash picks, and a miss
+ * replaces whatever was there.  Literals longer than kMaxLiteralSize are
+ * not cached, which bounds the memory a thread holds.
+ */
+class HuffmanEncodeCache {
+ public:
+  static constexpr size_t kNumSlots = 512;
+  static constexpr size_t kMaxLiteralSize = 256;
+
+  struct Stats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+  };
+
+  // The calling thread's cache
+  static HuffmanEncodeCache& get();
+
+  HuffmanEncodeCache();
+
+  /**
+   * The huffman encoded form of literal, encoding it on a miss.  The result
+   * stays valid until the next call on this cache.  literal must be at most
+   * kMaxLiteralSize long.
+   */
+  folly::ByteRange encode(folly::StringPiece literal);
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+  void clear();
+
+ private:
+  struct Slot {
+    std::string literal;
+    std::string encoded;
+    bool valid{false};
+  };
+
+  std::vector<Slot> slots_;
+  Stats stats_;
+};
+
+} // namespace proxygen
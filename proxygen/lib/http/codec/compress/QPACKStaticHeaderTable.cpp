@@ -12,6 +12,8 @@
 
 #include <glog/logging.h>
 
+namespace proxygen {
+
 namespace {
 
 // Array of static header table entires pair
@@ -19,124 +21,120 @@ namespace {
 // isHeaderNameInTableWithNonEmptyValue as well
 //
 // From https://github.com/quicwg/base-drafts/wiki/QPACK-Static-Table
-const char* s_tableEntries[][2] = {
-    {":authority", ""},
-    {":path", "/"},
-    {"age", "0"},
-    {"content-disposition", ""},
-    {"content-length", "0"},
-    {"cookie", ""},
-    {"date", ""},
-    {"etag", ""},
-    {"if-modified-since", ""},
-    {"if-none-match", ""},
-    {"last-modified", ""},
-    {"link", ""},
-    {"location", ""},
-    {"referer", ""},
-    {"set-cookie", ""},
-    {":method", "CONNECT"},
-    {":method", "DELETE"},
-    {":method", "GET"},
-    {":method", "HEAD"},
-    {":method", "OPTIONS"},
-    {":method", "POST"},
-    {":method", "PUT"},
-    {":scheme", "http"},
-    {":scheme", "https"},
-    {":status", "103"},
-    {":status", "200"},
-    {":status", "304"},
-    {":status", "404"},
-    {":status", "503"},
-    {"accept", "*/*"},
-    {"accept", "application/dns-message"},
-    {"accept-encoding", "gzip, deflate, br"},
-    {"accept-ranges", "bytes"},
-    {"access-control-allow-headers", "cache-control"},
-    {"access-control-allow-headers", "content-type"},
-    {"access-control-allow-origin", "*"},
-    {"cache-control", "max-age=0"},
-    {"cache-control", "max-age=2592000"},
-    {"cache-control", "max-age=604800"},
-    {"cache-control", "no-cache"},
-    {"cache-control", "no-store"},
-    {"cache-control", "public, max-age=31536000"},
-    {"content-encoding", "br"},
-    {"content-encoding", "gzip"},
-    {"content-type", "application/dns-message"},
-    {"content-type", "application/javascript"},
-    {"content-type", "application/json"},
-    {"content-type", "application/x-www-form-urlencoded"},
-    {"content-type", "image/gif"},
-    {"content-type", "image/jpeg"},
-    {"content-type", "image/png"},
-    {"content-type", "text/css"},
-    {"content-type", "text/html; charset=utf-8"},
-    {"content-type", "text/plain"},
-    {"content-type", "text/plain;charset=utf-8"},
-    {"range", "bytes=0-"},
-    {"strict-transport-security", "max-age=31536000"},
-    {"strict-transport-security", "max-age=31536000; includesubdomains"},
-    {"strict-transport-security",
+constexpr StaticHeaderTableEntry kTableEntries[] = {
+    {HTTP_HEADER_COLON_AUTHORITY, ""},
+    {HTTP_HEADER_COLON_PATH, "/"},
+    {HTTP_HEADER_AGE, "0"},
+    {HTTP_HEADER_CONTENT_DISPOSITION, ""},
+    {HTTP_HEADER_CONTENT_LENGTH, "0"},
+    {HTTP_HEADER_COOKIE, ""},
+    {HTTP_HEADER_DATE, ""},
+    {HTTP_HEADER_ETAG, ""},
+    {HTTP_HEADER_IF_MODIFIED_SINCE, ""},
+    {HTTP_HEADER_IF_NONE_MATCH, ""},
+    {HTTP_HEADER_LAST_MODIFIED, ""},
+    {HTTP_HEADER_LINK, ""},
+    {HTTP_HEADER_LOCATION, ""},
+    {HTTP_HEADER_REFERER, ""},
+    {HTTP_HEADER_SET_COOKIE, ""},
+    {HTTP_HEADER_COLON_METHOD, "CONNECT"},
+    {HTTP_HEADER_COLON_METHOD, "DELETE"},
+    {HTTP_HEADER_COLON_METHOD, "GET"},
+    {HTTP_HEADER_COLON_METHOD, "HEAD"},
+    {HTTP_HEADER_COLON_METHOD, "OPTIONS"},
+    {HTTP_HEADER_COLON_METHOD, "POST"},
+    {HTTP_HEADER_COLON_METHOD, "PUT"},
+    {HTTP_HEADER_COLON_SCHEME, "http"},
+    {HTTP_HEADER_COLON_SCHEME, "https"},
+    {HTTP_HEADER_COLON_STATUS, "103"},
+    {HTTP_HEADER_COLON_STATUS, "200"},
+    {HTTP_HEADER_COLON_STATUS, "304"},
+    {HTTP_HEADER_COLON_STATUS, "404"},
+    {HTTP_HEADER_COLON_STATUS, "503"},
+    {HTTP_HEADER_ACCEPT, "*/*"},
+    {HTTP_HEADER_ACCEPT, "application/dns-message"},
+    {HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate, br"},
+    {HTTP_HEADER_ACCEPT_RANGES, "bytes"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_HEADERS, "cache-control"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_HEADERS, "content-type"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_ORIGIN, "*"},
+    {HTTP_HEADER_CACHE_CONTROL, "max-age=0"},
+    {HTTP_HEADER_CACHE_CONTROL, "max-age=2592000"},
+    {HTTP_HEADER_CACHE_CONTROL, "max-age=604800"},
+    {HTTP_HEADER_CACHE_CONTROL, "no-cache"},
+    {HTTP_HEADER_CACHE_CONTROL, "no-store"},
+    {HTTP_HEADER_CACHE_CONTROL, "public, max-age=31536000"},
+    {HTTP_HEADER_CONTENT_ENCODING, "br"},
+    {HTTP_HEADER_CONTENT_ENCODING, "gzip"},
+    {HTTP_HEADER_CONTENT_TYPE, "application/dns-message"},
+    {HTTP_HEADER_CONTENT_TYPE, "application/javascript"},
+    {HTTP_HEADER_CONTENT_TYPE, "application/json"},
+    {HTTP_HEADER_CONTENT_TYPE, "application/x-www-form-urlencoded"},
+    {HTTP_HEADER_CONTENT_TYPE, "image/gif"},
+    {HTTP_HEADER_CONTENT_TYPE, "image/jpeg"},
+    {HTTP_HEADER_CONTENT_TYPE, "image/png"},
+    {HTTP_HEADER_CONTENT_TYPE, "text/css"},
+    {HTTP_HEADER_CONTENT_TYPE, "text/html; charset=utf-8"},
+    {HTTP_HEADER_CONTENT_TYPE, "text/plain"},
+    {HTTP_HEADER_CONTENT_TYPE, "text/plain;charset=utf-8"},
+    {HTTP_HEADER_RANGE, "bytes=0-"},
+    {HTTP_HEADER_STRICT_TRANSPORT_SECURITY, "max-age=31536000"},
+    {HTTP_HEADER_STRICT_TRANSPORT_SECURITY,
+     "max-age=31536000; includesubdomains"},
+    {HTTP_HEADER_STRICT_TRANSPORT_SECURITY,
      "max-age=31536000; includesubdomains; preload"},
-    {"vary", "accept-encoding"},
-    {"vary", "origin"},
-    {"x-content-type-options", "nosniff"},
-    {"x-xss-protection", "1; mode=block"},
-    {":status", "100"},
-    {":status", "204"},
-    {":status", "206"},
-    {":status", "302"},
-    {":status", "400"},
-    {":status", "403"},
-    {":status", "421"},
-    {":status", "425"},
-    {":status", "500"},
-    {"accept-language", ""},
-    {"access-control-allow-credentials", "FALSE"},
-    {"access-control-allow-credentials", "TRUE"},
-    {"access-control-allow-headers", "*"},
-    {"access-control-allow-methods", "get"},
-    {"access-control-allow-methods", "get, post, options"},
-    {"access-control-allow-methods", "options"},
-    {"access-control-expose-headers", "content-length"},
-    {"access-control-request-headers", "content-type"},
-    {"access-control-request-method", "get"},
-    {"access-control-request-method", "post"},
-    {"alt-svc", "clear"},
-    {"authorization", ""},
-    {"content-security-policy",
+    {HTTP_HEADER_VARY, "accept-encoding"},
+    {HTTP_HEADER_VARY, "origin"},
+    {HTTP_HEADER_X_CONTENT_TYPE_OPTIONS, "nosniff"},
+    {HTTP_HEADER_X_XSS_PROTECTION, "1; mode=block"},
+    {HTTP_HEADER_COLON_STATUS, "100"},
+    {HTTP_HEADER_COLON_STATUS, "204"},
+    {HTTP_HEADER_COLON_STATUS, "206"},
+    {HTTP_HEADER_COLON_STATUS, "302"},
+    {HTTP_HEADER_COLON_STATUS, "400"},
+    {HTTP_HEADER_COLON_STATUS, "403"},
+    {HTTP_HEADER_COLON_STATUS, "421"},
+    {HTTP_HEADER_COLON_STATUS, "425"},
+    {HTTP_HEADER_COLON_STATUS, "500"},
+    {HTTP_HEADER_ACCEPT_LANGUAGE, ""},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_CREDENTIALS, "FALSE"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_CREDENTIALS, "TRUE"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_HEADERS, "*"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_METHODS, "get"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_METHODS, "get, post, options"},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_METHODS, "options"},
+    {HTTP_HEADER_ACCESS_CONTROL_EXPOSE_HEADERS, "content-length"},
+    {HTTP_HEADER_ACCESS_CONTROL_REQUEST_HEADERS, "content-type"},
+    {HTTP_HEADER_ACCESS_CONTROL_REQUEST_METHOD, "get"},
+    {HTTP_HEADER_ACCESS_CONTROL_REQUEST_METHOD, "post"},
+    {HTTP_HEADER_ALT_SVC, "clear"},
+    {HTTP_HEADER_AUTHORIZATION, ""},
+    {HTTP_HEADER_CONTENT_SECURITY_POLICY,
      "script-src 'none'; object-src 'none'; base-uri 'none'"},
-    {"early-data", "1"},
-    {"expect-ct", ""},
-    {"forwarded", ""},
-    {"if-range", ""},
-    {"origin", ""},
-    {"purpose", "prefetch"},
-    {"server", ""},
-    {"timing-allow-origin", "*"},
-    {"upgrade-insecure-requests", "1"},
-    {"user-agent", ""},
-    {"x-forwarded-for", ""},
-    {"x-frame-options", "deny"},
-    {"x-frame-options", "sameorigin"}};
+    {HTTP_HEADER_EARLY_DATA, "1"},
+    {HTTP_HEADER_EXPECT_CT, ""},
+    {HTTP_HEADER_FORWARDED, ""},
+    {HTTP_HEADER_IF_RANGE, ""},
+    {HTTP_HEADER_ORIGIN, ""},
+    {HTTP_HEADER_PURPOSE, "prefetch"},
+    {HTTP_HEADER_SERVER, ""},
+    {HTTP_HEADER_TIMING_ALLOW_ORIGIN, "*"},
+    {HTTP_HEADER_UPGRADE_INSECURE_REQUESTS, "1"},
+    {HTTP_HEADER_USER_AGENT, ""},
+    {HTTP_HEADER_X_FORWARDED_FOR, ""},
+    {HTTP_HEADER_X_FRAME_OPTIONS, "deny"},
+    {HTTP_HEADER_X_FRAME_OPTIONS, "sameorigin"}};
 
-const int kEntriesSize = sizeof(s_tableEntries) / (2 * sizeof(const char*));
+constexpr StaticHeaderTableIndex kTableIndex(kTableEntries);
+static_assert(kTableIndex.isPerfect(), "No perfect hash for the table");
 } // namespace
 
-namespace proxygen {
-
 /**
  * Not currently used for QPACK, because the table contains 28 common headers
  * with non-empty value.  To get the list run:
  *
- * cat HTTPCommonHeaders.txt  | tr '[:upper:]' '[:lower:]' | \
- * xargs -n 1 --replace=STR \
- *    grep -w STR codec/compress/QPACKStaticHeaderTable.cpp | \
- *  grep -v "\"\"" | cut -d\" -f 2 | sort | uniq | \
- *  tr '[:lower:]' '[:upper:]' | \
- * sed -e's/^/HTTP_HEADER_/g' -e's/-/_/g' -e's/:/COLON_/g'
+ * grep -v '""' codec/compress/QPACKStaticHeaderTable.cpp | \
+ *   grep -o 'HTTP_HEADER_[A-Z_]*' | sort -u
  */
 bool QPACKStaticHeaderTable::isHeaderCodeInTableWithNonEmptyValue(
     HTTPHeaderCode /*headerCode*/) {
@@ -145,8 +143,8 @@ bool QPACKStaticHeaderTable::isHeaderCodeInTableWithNonEmptyValue(
 }
 
 const StaticHeaderTable& QPACKStaticHeaderTable::get() {
-  static const folly::Indestructible<StaticHeaderTable> table(s_tableEntries,
-                                                              kEntriesSize);
+  static const folly::Indestructible<StaticHeaderTable> table(kTableEntries,
+                                                              kTableIndex);
   return *table;
 }
 
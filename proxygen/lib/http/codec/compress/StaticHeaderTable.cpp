@@ -15,78 +15,80 @@
 
 using std::list;
 
+namespace proxygen {
+
 namespace {
 
 // Array of static header table entires pair
 // Note: if updating this table (should never have to but whatever), update
 // isHeaderNameInTableWithNonEmptyValue as well
-const char* s_tableEntries[][2] = {{":authority", ""},
-                                   {":method", "GET"},
-                                   {":method", "POST"},
-                                   {":path", "/"},
-                                   {":path", "/index.html"},
-                                   {":scheme", "http"},
-                                   {":scheme", "https"},
-                                   {":status", "200"},
-                                   {":status", "204"},
-                                   {":status", "206"},
-                                   {":status", "304"},
-                                   {":status", "400"},
-                                   {":status", "404"},
-                                   {":status", "500"},
-                                   {"accept-charset", ""},
-                                   {"accept-encoding", "gzip, deflate"},
-                                   {"accept-language", ""},
-                                   {"accept-ranges", ""},
-                                   {"accept", ""},
-                                   {"access-control-allow-origin", ""},
-                                   {"age", ""},
-                                   {"allow", ""},
-                                   {"authorization", ""},
-                                   {"cache-control", ""},
-                                   {"content-disposition", ""},
-                                   {"content-encoding", ""},
-                                   {"content-language", ""},
-                                   {"content-length", ""},
-                                   {"content-location", ""},
-                                   {"content-range", ""},
-                                   {"content-type", ""},
-                                   {"cookie", ""},
-                                   {"date", ""},
-                                   {"etag", ""},
-                                   {"expect", ""},
-                                   {"expires", ""},
-                                   {"from", ""},
-                                   {"host", ""},
-                                   {"if-match", ""},
-                                   {"if-modified-since", ""},
-                                   {"if-none-match", ""},
-                                   {"if-range", ""},
-                                   {"if-unmodified-since", ""},
-                                   {"last-modified", ""},
-                                   {"link", ""},
-                                   {"location", ""},
-                                   {"max-forwards", ""},
-                                   {"proxy-authenticate", ""},
-                                   {"proxy-authorization", ""},
-                                   {"range", ""},
-                                   {"referer", ""},
-                                   {"refresh", ""},
-                                   {"retry-after", ""},
-                                   {"server", ""},
-                                   {"set-cookie", ""},
-                                   {"strict-transport-security", ""},
-                                   {"transfer-encoding", ""},
-                                   {"user-agent", ""},
-                                   {"vary", ""},
-                                   {"via", ""},
-                                   {"www-authenticate", ""}};
+constexpr StaticHeaderTableEntry kTableEntries[] = {
+    {HTTP_HEADER_COLON_AUTHORITY, ""},
+    {HTTP_HEADER_COLON_METHOD, "GET"},
+    {HTTP_HEADER_COLON_METHOD, "POST"},
+    {HTTP_HEADER_COLON_PATH, "/"},
+    {HTTP_HEADER_COLON_PATH, "/index.html"},
+    {HTTP_HEADER_COLON_SCHEME, "http"},
+    {HTTP_HEADER_COLON_SCHEME, "https"},
+    {HTTP_HEADER_COLON_STATUS, "200"},
+    {HTTP_HEADER_COLON_STATUS, "204"},
+    {HTTP_HEADER_COLON_STATUS, "206"},
+    {HTTP_HEADER_COLON_STATUS, "304"},
+    {HTTP_HEADER_COLON_STATUS, "400"},
+    {HTTP_HEADER_COLON_STATUS, "404"},
+    {HTTP_HEADER_COLON_STATUS, "500"},
+    {HTTP_HEADER_ACCEPT_CHARSET, ""},
+    {HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate"},
+    {HTTP_HEADER_ACCEPT_LANGUAGE, ""},
+    {HTTP_HEADER_ACCEPT_RANGES, ""},
+    {HTTP_HEADER_ACCEPT, ""},
+    {HTTP_HEADER_ACCESS_CONTROL_ALLOW_ORIGIN, ""},
+    {HTTP_HEADER_AGE, ""},
+    {HTTP_HEADER_ALLOW, ""},
+    {HTTP_HEADER_AUTHORIZATION, ""},
+    {HTTP_HEADER_CACHE_CONTROL, ""},
+    {HTTP_HEADER_CONTENT_DISPOSITION, ""},
+    {HTTP_HEADER_CONTENT_ENCODING, ""},
+    {HTTP_HEADER_CONTENT_LANGUAGE, ""},
+    {HTTP_HEADER_CONTENT_LENGTH, ""},
+    {HTTP_HEADER_CONTENT_LOCATION, ""},
+    {HTTP_HEADER_CONTENT_RANGE, ""},
+    {HTTP_HEADER_CONTENT_TYPE, ""},
+    {HTTP_HEADER_COOKIE, ""},
+    {HTTP_HEADER_DATE, ""},
+    {HTTP_HEADER_ETAG, ""},
+    {HTTP_HEADER_EXPECT, ""},
+    {HTTP_HEADER_EXPIRES, ""},
+    {HTTP_HEADER_FROM, ""},
+    {HTTP_HEADER_HOST, ""},
+    {HTTP_HEADER_IF_MATCH, ""},
+    {HTTP_HEADER_IF_MODIFIED_SINCE, ""},
+    {HTTP_HEADER_IF_NONE_MATCH, ""},
+    {HTTP_HEADER_IF_RANGE, ""},
+    {HTTP_HEADER_IF_UNMODIFIED_SINCE, ""},
+    {HTTP_HEADER_LAST_MODIFIED, ""},
+    {HTTP_HEADER_LINK, ""},
+    {HTTP_HEADER_LOCATION, ""},
+    {HTTP_HEADER_MAX_FORWARDS, ""},
+    {HTTP_HEADER_PROXY_AUTHENTICATE, ""},
+    {HTTP_HEADER_PROXY_AUTHORIZATION, ""},
+    {HTTP_HEADER_RANGE, ""},
+    {HTTP_HEADER_REFERER, ""},
+    {HTTP_HEADER_REFRESH, ""},
+    {HTTP_HEADER_RETRY_AFTER, ""},
+    {HTTP_HEADER_SERVER, ""},
+    {HTTP_HEADER_SET_COOKIE, ""},
+    {HTTP_HEADER_STRICT_TRANSPORT_SECURITY, ""},
+    {HTTP_HEADER_TRANSFER_ENCODING, ""},
+    {HTTP_HEADER_USER_AGENT, ""},
+    {HTTP_HEADER_VARY, ""},
+    {HTTP_HEADER_VIA, ""},
+    {HTTP_HEADER_WWW_AUTHENTICATE, ""}};
 
-const int kEntriesSize = sizeof(s_tableEntries) / (2 * sizeof(const char*));
+constexpr StaticHeaderTableIndex kTableIndex(kTableEntries);
+static_assert(kTableIndex.isPerfect(), "No perfect hash for the table");
 } // namespace
 
-namespace proxygen {
-
 bool StaticHeaderTable::isHeaderCodeInTableWithNonEmptyValue(
     HTTPHeaderCode headerCode) {
   switch (headerCode) {
@@ -102,13 +104,18 @@ bool StaticHeaderTable::isHeaderCodeInTableWithNonEmptyValue(
   }
 }
 
-StaticHeaderTable::StaticHeaderTable(const char* entries[][2], int size)
-    : HeaderTable(0) {
+StaticHeaderTable::StaticHeaderTable(const StaticHeaderTableEntry* entries,
+                                     size_t size,
+                                     const StaticHeaderTableIndex& index)
+    : HeaderTable(0), index_(index) {
+  // Decoding still goes through the HeaderTable entries.
   // calculate the size
   list<HPACKHeader> hlist;
   uint32_t byteCount = 0;
-  for (int i = 0; i < size; ++i) {
-    hlist.push_back(HPACKHeader(entries[i][0], entries[i][1]));
+  for (size_t i = 0; i < size; ++i) {
+    hlist.push_back(HPACKHeader(
+        HPACKHeaderName(entries[i].code),
+        folly::StringPiece(entries[i].value.data(), entries[i].value.size())));
     byteCount += hlist.back().bytes();
   }
   // initialize with a capacity that will exactly fit the static headers
@@ -120,8 +127,8 @@ StaticHeaderTable::StaticHeaderTable(const char* entries[][2], int size)
 }
 
 const StaticHeaderTable& StaticHeaderTable::get() {
-  static const folly::Indestructible<StaticHeaderTable> table(s_tableEntries,
-                                                              kEntriesSize);
+  static const folly::Indestructible<StaticHeaderTable> table(kTableEntries,
+                                                              kTableIndex);
   return *table;
 }
 
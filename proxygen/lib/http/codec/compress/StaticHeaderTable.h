@@ -8,19 +8,150 @@
 
 #pragma once
 
+#include <array>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
+#include <string_view>
 
 namespace proxygen {
 
+/**
+ * A static table entry.  Every name in the HPACK and QPACK static tables is
+ * a common header, so it is stored as its HTTPHeaderCode, which the gperf
+ * generated HTTPCommonHeaders already hashes perfectly.
+ */
+struct StaticHeaderTableEntry {
+  HTTPHeaderCode code;
+  std::string_view value;
+};
+
+/**
+ * Encoder lookups into a static table, built at compile time from its
+ * entries.  Names map to their first index through an array indexed by
+ * header code.  Name and value pairs go through a perfect hash of the code
+ * and a few bytes of the value: the constructor searches for a seed under
+ * which no two entries share a slot, so a lookup is one hash and one
+ * comparison against the only candidate.
+ */
+class StaticHeaderTableIndex {
+ public:
+  static constexpr size_t kMaxEntries = 128;
+
+  template <size_t N>
+  constexpr explicit StaticHeaderTableIndex(
+      const StaticHeaderTableEntry (&entries)[N]) {
+    static_assert(N < kMaxEntries, "Static table too large");
+    for (size_t i = 0; i < N; ++i) {
+      // Index 0 stays a sentinel that matches nothing
+      codes_[i + 1] = entries[i].code;
+      values_[i + 1] = entries[i].value;
+      if (names_[entries[i].code] == 0) {
+        names_[entries[i].code] = static_cast<uint8_t>(i + 1);
+      }
+    }
+    for (seed_ = 0; seed_ < kMaxSeeds; ++seed_) {
+      if (buildSlots(N)) {
+        return;
+      }
+    }
+  }
+
+  // False if no seed gave a perfect hash; checked with static_assert
+  constexpr bool isPerfect() const {
+    return seed_ < kMaxSeeds;
+  }
+
+  // The first 1-based index with this name, or 0
+  uint32_t nameIndex(HTTPHeaderCode code) const {
+    return names_[code];
+  }
+
+  // The first 1-based index with this name and value, or 0
+  uint32_t getIndex(HTTPHeaderCode code, std::string_view value) const {
+    uint8_t index = slots_[hash(code, value, seed_)];
+    return (codes_[index] == code && values_[index] == value) ? index : 0;
+  }
+
+ private:
+  // Sparse enough that a seed turns up after a few tries, which keeps the
+  // compile time search short
+  static constexpr size_t kSlots = 2048;
+  static constexpr uint32_t kMaxSeeds = 1024;
+
+  static constexpr size_t hash(HTTPHeaderCode code,
+                               std::string_view value,
+                               uint32_t seed) {
+    uint32_t h = seed * 0x9E3779B1 ^ code;
+    h = h * 31 + static_cast<uint32_t>(value.size());
+    if (!value.empty()) {
+      h = h * 31 + uint8_t(value.front());
+      h = h * 31 + uint8_t(value[value.size() / 4]);
+      h = h * 31 + uint8_t(value[value.size() / 2]);
+      h = h * 31 + uint8_t(value.back());
+    }
+    h ^= h >> 15;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    return h & (kSlots - 1);
+  }
+
+  constexpr bool buildSlots(size_t size) {
+    for (auto& slot : slots_) {
+      slot = 0;
+    }
+    for (size_t i = 1; i <= size; ++i) {
+      auto& slot = slots_[hash(codes_[i], values_[i], seed_)];
+      if (slot == 0) {
+        slot = static_cast<uint8_t>(i);
+      } else if (codes_[slot] != codes_[i] || values_[slot] != values_[i]) {
+        return false;
+      }
+      // else a repeat of an earlier entry, which keeps the lower index
+    }
+    return true;
+  }
+
+  std::array<uint8_t, HTTPHeaderCodeMaxCodes> names_{};
+  std::array<uint8_t, kSlots> slots_{};
+  std::array<HTTPHeaderCode, kMaxEntries> codes_{};
+  std::array<std::string_view, kMaxEntries> values_{};
+  uint32_t seed_{0};
+};
+
 class StaticHeaderTable : public HeaderTable {
 
  public:
-  explicit StaticHeaderTable(const char* entries[][2], int size);
+  template <size_t N>
+  StaticHeaderTable(const StaticHeaderTableEntry (&entries)[N],
+                    const StaticHeaderTableIndex& index)
+      : StaticHeaderTable(entries, N, index) {
+  }
 
   static const StaticHeaderTable& get();
 
   static bool isHeaderCodeInTableWithNonEmptyValue(HTTPHeaderCode headerCode);
+
+  // Encoder lookups go to the compile time index instead of the name map
+  uint32_t getIndex(const HPACKHeader& header) const {
+    return getIndex(header.name, header.value);
+  }
+
+  uint32_t getIndex(const HPACKHeaderName& name,
+                    folly::StringPiece value) const {
+    return index_.getIndex(name.getHeaderCode(),
+                           std::string_view(value.data(), value.size()));
+  }
+
+  uint32_t nameIndex(const HPACKHeaderName& headerName) const {
+    return index_.nameIndex(headerName.getHeaderCode());
+  }
+
+ private:
+  StaticHeaderTable(const StaticHeaderTableEntry* entries,
+                    size_t size,
+                    const StaticHeaderTableIndex& index);
+
+  const StaticHeaderTableIndex& index_;
 };
 
 } // namespace proxygen
@@ -220,6 +220,116 @@ TEST_F(HPACKCodecTests, UncompressedSizeLimit) {
   EXPECT_EQ(result.error(), HPACK::DecodeError::HEADERS_TOO_LARGE);
 }
 
+/**
+ * Decode a block split at every possible size, feeding each fragment to the
+ * decoder as it arrives and keeping only the bytes it did not consume
+ */
+TEST_F(HPACKCodecTests, FragmentedDecode) {
+  vector<vector<string>> headers = {
+      {":method", "GET"},
+      {":path", "/index.php"},
+      {"cookie", string(300, 'c')},
+      {"x-custom", "value"},
+  };
+  for (uint32_t fragmentSize = 1; fragmentSize < 64; fragmentSize++) {
+    HPACKCodec encoder{TransportDirection::UPSTREAM};
+    HPACKCodec decoder{TransportDirection::DOWNSTREAM};
+    // The second block refers to entries the first one indexed
+    for (auto i = 0; i < 2; i++) {
+      auto encHeaders = headersFromArray(headers);
+      unique_ptr<IOBuf> encoded = encoder.encode(encHeaders);
+      Cursor input(encoded.get());
+      folly::IOBufQueue pending{folly::IOBufQueue::cacheChainLength()};
+      TestStreamingCallback cb;
+      while (!input.isAtEnd()) {
+        unique_ptr<IOBuf> fragment;
+        input.clone(fragment,
+                    std::min<size_t>(fragmentSize, input.totalLength()));
+        pending.append(std::move(fragment));
+        bool endOfBlock = input.isAtEnd();
+        Cursor cursor(pending.front());
+        auto consumed = decoder.decodeStreamingFragment(
+            cursor, pending.chainLength(), &cb, endOfBlock);
+        pending.trimStart(consumed);
+        ASSERT_FALSE(cb.hasError());
+        EXPECT_TRUE(!endOfBlock || pending.empty());
+      }
+      auto result = cb.getResult();
+      ASSERT_FALSE(result.hasError());
+      EXPECT_EQ(result->headers.size(), headers.size() * 2);
+      EXPECT_EQ(result->headers[5].str, headers[2][1]);
+      EXPECT_EQ(cb.decodedSize_.compressed,
+                encoded->computeChainDataLength());
+    }
+  }
+}
+
+/**
+ * The uncompressed limit is enforced across fragments, on the fragment that
+ * crosses it
+ */
+TEST_F(HPACKCodecTests, FragmentedSizeLimit) {
+  vector<vector<string>> headers = {{"x-bomb", string(1000, 'b')}};
+  auto encHeaders = headersFromArray(headers);
+  unique_ptr<IOBuf> encoded = client.encode(encHeaders);
+  TestStreamingCallback cb;
+  server.setMaxUncompressed(10000);
+  Cursor cursor(encoded.get());
+  EXPECT_EQ(server.decodeStreamingFragment(
+                cursor, encoded->computeChainDataLength(), &cb, false),
+            encoded->computeChainDataLength());
+  EXPECT_FALSE(cb.hasError());
+  // Each byte references the indexed entry: a cheap way to emit ~1KB
+  auto refs = IOBuf::create(20);
+  memset(refs->writableData(), 0x80 | 62, 20);
+  refs->append(20);
+  Cursor refCursor(refs.get());
+  server.decodeStreamingFragment(refCursor, 20, &cb, false);
+  EXPECT_TRUE(cb.hasError());
+  EXPECT_EQ(cb.error, HPACK::DecodeError::HEADERS_TOO_LARGE);
+}
+
+/**
+ * A literal whose value is cut off keeps its name: the name bytes are
+ * consumed, and a block that ends before the value fails
+ */
+TEST_F(HPACKCodecTests, FragmentedValueKeepsName) {
+  vector<vector<string>> headers = {{"x-" + string(300, 'n'), "value"}};
+  auto encHeaders = headersFromArray(headers);
+  unique_ptr<IOBuf> encoded = client.encode(encHeaders);
+  auto length = encoded->computeChainDataLength();
+  TestStreamingCallback cb;
+  Cursor cursor(encoded.get());
+  auto consumed =
+      server.decodeStreamingFragment(cursor, length - 1, &cb, false);
+  EXPECT_GT(consumed, 0);
+  EXPECT_LT(consumed, length - 1);
+  EXPECT_FALSE(cb.hasError());
+  Cursor rest(encoded.get());
+  rest.skip(consumed);
+  EXPECT_EQ(server.decodeStreamingFragment(rest, length - consumed, &cb, true),
+            length - consumed);
+  auto result = cb.getResult();
+  ASSERT_FALSE(result.hasError());
+  ASSERT_EQ(result->headers.size(), 2);
+  EXPECT_EQ(result->headers[0].str, headers[0][0]);
+  EXPECT_EQ(result->headers[1].str, headers[0][1]);
+  EXPECT_EQ(cb.decodedSize_.compressed, length);
+
+  // The name ends the fragment, and the block ends with an empty one
+  HPACKCodec decoder{TransportDirection::DOWNSTREAM};
+  TestStreamingCallback cb2;
+  Cursor nameOnly(encoded.get());
+  EXPECT_EQ(decoder.decodeStreamingFragment(nameOnly, consumed, &cb2, false),
+            consumed);
+  EXPECT_FALSE(cb2.hasError());
+  auto empty = IOBuf::create(0);
+  Cursor emptyCursor(empty.get());
+  decoder.decodeStreamingFragment(emptyCursor, 0, &cb2, true);
+  EXPECT_TRUE(cb2.hasError());
+  EXPECT_EQ(cb2.error, HPACK::DecodeError::BUFFER_UNDERFLOW);
+}
+
 /**
  * Size limit stats
  */
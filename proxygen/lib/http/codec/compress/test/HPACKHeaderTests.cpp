@@ -184,3 +184,25 @@ TEST_F(HPACKHeaderNameTest, TestIsCommonHeader) {
   HPACKHeader testHPACKHeader(externalHeader, "");
   EXPECT_FALSE(testHPACKHeader.name.isCommonHeader());
 }
+
+TEST_F(HPACKHeaderNameTest, TestCustomCommonHeader) {
+  auto code = HTTPCommonHeaders::registerCustomName("X-HPACK-Custom");
+  ASSERT_TRUE(HTTPCommonHeaders::isCustomCode(code));
+
+  HPACKHeaderName fromCode(code);
+  HPACKHeaderName fromName("X-Hpack-Custom");
+  EXPECT_EQ(fromCode.get(), "x-hpack-custom");
+  EXPECT_EQ(fromName.c_str(), fromCode.c_str());
+  EXPECT_TRUE(fromName.isCommonHeader());
+  EXPECT_EQ(fromName.getHeaderCode(), code);
+
+  // Custom names sit after the generated ones in the table, ordering must
+  // still be alphabetical
+  HPACKHeaderName accept(HTTP_HEADER_ACCEPT);
+  HPACKHeaderName realIP(HTTP_HEADER_X_REAL_IP);
+  HPACKHeaderName other("zzz");
+  EXPECT_TRUE(accept < fromCode);
+  EXPECT_TRUE(fromCode < realIP);
+  EXPECT_TRUE(realIP > fromCode);
+  EXPECT_TRUE(fromCode < other);
+}
@@ -11,6 +11,7 @@
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
 #include <proxygen/lib/http/codec/compress/Logging.h>
 #include <proxygen/lib/http/codec/compress/QPACKHeaderTable.h>
+#include <proxygen/lib/http/codec/compress/QPACKStaticHeaderTable.h>
 #include <sstream>
 
 using namespace std;
@@ -338,4 +339,32 @@ TEST_F(HeaderTableTests, TinyTable) {
   EXPECT_EQ(table.length(), 1);
 }
 
+TEST_F(HeaderTableTests, StaticTableIndex) {
+  for (auto table :
+       {&StaticHeaderTable::get(), &QPACKStaticHeaderTable::get()}) {
+    // The compile time index agrees with the name map of the base class
+    const HeaderTable& base = *table;
+    for (uint32_t i = 1; i <= table->size(); ++i) {
+      const auto& header = table->getHeader(i);
+      EXPECT_EQ(table->getIndex(header), base.getIndex(header));
+      EXPECT_EQ(table->nameIndex(header.name), base.nameIndex(header.name));
+      EXPECT_LE(table->getIndex(header), i);
+      EXPECT_EQ(table->getIndex(header.name, header.value.toStdString() + "x"),
+                0);
+    }
+    EXPECT_EQ(table->getIndex(HPACKHeaderName("x-custom"), ""), 0);
+    EXPECT_EQ(table->nameIndex(HPACKHeaderName("x-custom")), 0);
+  }
+  EXPECT_EQ(StaticHeaderTable::get().getIndex(
+                HPACKHeaderName(HTTP_HEADER_COLON_STATUS), "404"),
+            13);
+  EXPECT_EQ(QPACKStaticHeaderTable::get().getIndex(
+                HPACKHeaderName(HTTP_HEADER_CONTENT_TYPE),
+                "text/plain;charset=utf-8"),
+            55);
+  EXPECT_EQ(QPACKStaticHeaderTable::get().nameIndex(
+                HPACKHeaderName(HTTP_HEADER_EARLY_DATA)),
+            96);
+}
+
 } // namespace proxygen
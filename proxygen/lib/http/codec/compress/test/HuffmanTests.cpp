@@ -9,10 +9,12 @@
 #include <tuple>
 #include <unordered_set>
 
+#include <folly/Conv.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/codec/compress/Huffman.h>
+#include <proxygen/lib/http/codec/compress/HuffmanEncodeCache.h>
 #include <proxygen/lib/http/codec/compress/Logging.h>
 
 using namespace folly::io;
@@ -162,6 +164,46 @@ TEST_F(HuffmanTests, UserAgent) {
   CHECK_EQ(user_agent, decoded);
 }
 
+TEST_F(HuffmanTests, EncodeFlat) {
+  for (folly::StringPiece literal :
+       {"gzip", "accept-encoding", "Mozilla/5.0 (iPhone; CPU iPhone OS)"}) {
+    IOBufQueue bufQueue;
+    QueueAppender appender(&bufQueue, 512);
+    uint32_t size = tree_.encode(literal, appender);
+    std::string flat(tree_.getEncodeSize(literal), '\0');
+    EXPECT_EQ(tree_.encode(literal, (uint8_t*)&flat[0]), size);
+    EXPECT_EQ(bufQueue.move()->moveToFbString().toStdString(), flat);
+  }
+}
+
+TEST_F(HuffmanTests, EncodeCache) {
+  proxygen::HuffmanEncodeCache cache;
+  auto expected = [this](folly::StringPiece literal) {
+    std::string flat(tree_.getEncodeSize(literal), '\0');
+    tree_.encode(literal, (uint8_t*)&flat[0]);
+    return flat;
+  };
+  auto encode = [&](folly::StringPiece literal) {
+    return cache.encode(literal).castToConst<char>().str();
+  };
+  EXPECT_EQ(encode("gzip, deflate"), expected("gzip, deflate"));
+  EXPECT_EQ(cache.getStats().misses, 1);
+  EXPECT_EQ(encode("gzip, deflate"), expected("gzip, deflate"));
+  EXPECT_EQ(cache.getStats().hits, 1);
+  EXPECT_EQ(encode("text/html"), expected("text/html"));
+  EXPECT_EQ(cache.getStats().misses, 2);
+
+  cache.clear();
+  EXPECT_EQ(encode("gzip, deflate"), expected("gzip, deflate"));
+  EXPECT_EQ(cache.getStats().misses, 3);
+
+  // Colliding literals replace each other but are never confused
+  for (size_t i = 0; i < 4 * proxygen::HuffmanEncodeCache::kNumSlots; ++i) {
+    auto literal = folly::to<std::string>("value-", i);
+    EXPECT_EQ(encode(literal), expected(literal));
+  }
+}
+
 /*
  * this test is verifying the CHECK for length at the end of huffman::encode()
  */
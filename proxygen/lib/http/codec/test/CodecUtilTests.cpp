@@ -154,6 +154,47 @@ TEST(CodecUtil, validateHeaderValue) {
       CodecUtil::validateHeaderValue(input("foo\r\n"), CodecUtil::COMPLIANT));
 }
 
+TEST(CodecUtil, vectorScans) {
+  // Every offset across a few vector widths, so both the vector loop and
+  // the tail find the byte
+  for (size_t len = 0; len < 70; len++) {
+    for (size_t pos = 0; pos < len; pos++) {
+      string name(len, 'a');
+      EXPECT_EQ(CodecUtil::skipCommonTokenChars(input(name.c_str())), len);
+      name[pos] = '_';
+      EXPECT_EQ(CodecUtil::skipCommonTokenChars(input(name.c_str())), pos);
+
+      string value(len, 'v');
+      value[pos] = '\t';
+      EXPECT_EQ(CodecUtil::findHeaderValueSpecial(input(value.c_str()), false),
+                len);
+      EXPECT_EQ(CodecUtil::findCRLF(input(value.c_str())), len);
+      value[pos] = '\xc3';
+      EXPECT_EQ(CodecUtil::findHeaderValueSpecial(input(value.c_str()), true),
+                len);
+      EXPECT_EQ(CodecUtil::findHeaderValueSpecial(input(value.c_str()), false),
+                pos);
+      value[pos] = '\n';
+      EXPECT_EQ(CodecUtil::findCRLF(input(value.c_str())), pos);
+      EXPECT_EQ(CodecUtil::findHeaderValueSpecial(input(value.c_str()), true),
+                pos);
+    }
+  }
+  string value(40, 'v');
+  value += "\r\n ";
+  value += string(20, 'w');
+  EXPECT_TRUE(CodecUtil::validateHeaderValue(input(value.c_str()),
+                                             CodecUtil::STRICT));
+  value += "\x7f";
+  EXPECT_FALSE(CodecUtil::validateHeaderValue(input(value.c_str()),
+                                              CodecUtil::STRICT));
+  string name = string(40, 'x') + "_Y";
+  EXPECT_TRUE(CodecUtil::validateHeaderName(
+      input(name.c_str()), CodecUtil::HEADER_NAME_STRICT_COMPAT));
+  EXPECT_FALSE(CodecUtil::validateHeaderName(input(name.c_str()),
+                                             CodecUtil::HEADER_NAME_STRICT));
+}
+
 TEST(CodecUtil, hasGzipAndDeflate) {
   bool gzip = false;
   bool deflate = false;
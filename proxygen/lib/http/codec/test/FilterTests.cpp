@@ -11,7 +11,9 @@
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/HTTPMessage.h>
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
+#include <proxygen/lib/http/codec/HTTP2Framer.h>
 #include <proxygen/lib/http/codec/HTTPChecks.h>
+#include <proxygen/lib/http/codec/IngressCostFilter.h>
 #include <proxygen/lib/http/codec/test/MockHTTPCodec.h>
 #include <proxygen/lib/http/codec/test/TestUtils.h>
 #include <random>
@@ -93,6 +95,35 @@ class FlowControlFilterTest : public FilterTest {
   int recvWindow_{initSize};
 };
 
+class MockIngressCostCallback : public IngressCostFilter::Callback {
+ public:
+  MOCK_METHOD(void,
+              onIngressCostExceeded,
+              (IngressCostLevel, std::chrono::milliseconds));
+};
+
+class IngressCostFilterTest : public FilterTest {
+ public:
+  void SetUp() override {
+    EXPECT_CALL(*codec_, getTransportDirection())
+        .WillRepeatedly(Return(TransportDirection::DOWNSTREAM));
+    filter_ = new IngressCostFilter(costCallback_);
+    // No refill, so the test controls the balance exactly
+    IngressCostParams params;
+    params.refillPerSecond = 0;
+    params.burst = 100;
+    params.goawayDebt = 100;
+    params.closeDebt = 200;
+    filter_->setParams(params);
+    chain_.addFilters(std::unique_ptr<IngressCostFilter>(filter_));
+  }
+
+ protected:
+  StrictMock<MockIngressCostCallback> costCallback_;
+  IngressCostFilter* filter_;
+  HTTPMessage req_{getGetRequest()};
+};
+
 using DefaultFlowControl = FlowControlFilterTest<0>;
 using BigWindow = FlowControlFilterTest<1000000>;
 
@@ -246,3 +277,89 @@ TEST_F(HTTPChecksTest, RecvTraceBody) {
 
   callbackStart_->onHeadersComplete(0, std::move(msg));
 }
+
+MATCHER(IsDroppedException, "") {
+  return arg->hasProxygenError() && arg->getProxygenError() == kErrorDropped;
+}
+
+TEST_F(IngressCostFilterTest, RapidReset) {
+  EXPECT_CALL(callback_, onMessageBegin(_, _)).Times(4);
+  EXPECT_CALL(callback_, onAbort(_, _)).Times(3);
+
+  // Each stream opened then reset costs kIngressStreamCost +
+  // kIngressResetOpenStreamCost = 80
+  callbackStart_->onMessageBegin(1, &req_);
+  callbackStart_->onAbort(1, ErrorCode::CANCEL);
+  EXPECT_EQ(filter_->getBalance(), 20);
+  EXPECT_EQ(filter_->getLevel(), IngressCostLevel::NORMAL);
+
+  EXPECT_CALL(costCallback_,
+              onIngressCostExceeded(IngressCostLevel::DEPRIORITIZE, _));
+  callbackStart_->onMessageBegin(3, &req_);
+  callbackStart_->onAbort(3, ErrorCode::CANCEL);
+
+  EXPECT_CALL(costCallback_,
+              onIngressCostExceeded(IngressCostLevel::GOAWAY, _));
+  callbackStart_->onMessageBegin(5, &req_);
+  callbackStart_->onAbort(5, ErrorCode::CANCEL);
+
+  // The abort that crosses closeDebt is replaced by a session error
+  EXPECT_CALL(callback_, onError(0, IsDroppedException(), true));
+  callbackStart_->onMessageBegin(7, &req_);
+  callbackStart_->onAbort(7, ErrorCode::CANCEL);
+  EXPECT_EQ(filter_->getLevel(), IngressCostLevel::CLOSE);
+}
+
+TEST_F(IngressCostFilterTest, ResetAfterResponseIsCheap) {
+  EXPECT_CALL(callback_, onMessageBegin(_, _));
+  EXPECT_CALL(callback_, onAbort(1, ErrorCode::CANCEL));
+  EXPECT_CALL(*codec_, generateEOM(_, 1)).WillOnce(Return(0));
+
+  callbackStart_->onMessageBegin(1, &req_);
+  chain_->generateEOM(writeBuf_, 1);
+  callbackStart_->onAbort(1, ErrorCode::CANCEL);
+  EXPECT_EQ(filter_->getBalance(), 100 - kIngressStreamCost);
+}
+
+TEST_F(IngressCostFilterTest, ContinuationFlood) {
+  EXPECT_CALL(callback_, onFrameHeader(_, _, _, _, _)).Times(AnyNumber());
+  EXPECT_CALL(costCallback_,
+              onIngressCostExceeded(IngressCostLevel::DEPRIORITIZE, _));
+  EXPECT_CALL(costCallback_,
+              onIngressCostExceeded(IngressCostLevel::GOAWAY, _));
+  EXPECT_CALL(callback_, onError(0, IsDroppedException(), true));
+  // Header block bytes are charged as the frames arrive, before the block
+  // is complete.  Each frame costs 1 + 1600 / 32 = 51.
+  for (int i = 0; i < 10; i++) {
+    callbackStart_->onFrameHeader(
+        1,
+        0,
+        1600,
+        static_cast<uint64_t>(http2::FrameType::CONTINUATION));
+  }
+  EXPECT_EQ(filter_->getLevel(), IngressCostLevel::CLOSE);
+}
+
+TEST_F(IngressCostFilterTest, SmallWindowUpdates) {
+  EXPECT_CALL(callback_, onWindowUpdate(0, _)).Times(12);
+  callbackStart_->onWindowUpdate(0, 65535);
+  EXPECT_EQ(filter_->getBalance(), 100);
+  for (int i = 0; i < 10; i++) {
+    callbackStart_->onWindowUpdate(0, 1);
+  }
+  EXPECT_EQ(filter_->getBalance(), 0);
+  EXPECT_CALL(costCallback_,
+              onIngressCostExceeded(IngressCostLevel::DEPRIORITIZE, _));
+  callbackStart_->onWindowUpdate(0, 1);
+}
+
+TEST_F(IngressCostFilterTest, Disabled) {
+  IngressCostParams params;
+  params.enabled = false;
+  filter_->setParams(params);
+  EXPECT_CALL(callback_, onPingRequest(_)).Times(1000);
+  for (int i = 0; i < 1000; i++) {
+    callbackStart_->onPingRequest(i);
+  }
+  EXPECT_EQ(filter_->getLevel(), IngressCostLevel::NORMAL);
+}
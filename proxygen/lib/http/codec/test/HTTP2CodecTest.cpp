@@ -911,6 +911,74 @@ TEST_F(HTTP2CodecTest, BadContinuationStream) {
 #endif
 }
 
+TEST_F(HTTP2CodecTest, ContinuationSplitsHeader) {
+  // CONTINUATION boundaries in the middle of header representations
+  HTTPMessage req = getGetRequest();
+  req.getHeaders().add(HTTP_HEADER_COOKIE, string(2000, 'c'));
+  req.getHeaders().add(HTTP_HEADER_USER_AGENT, "coolio");
+  HPACKCodec headerCodec(TransportDirection::UPSTREAM);
+  for (auto stream = 1; stream <= 3; stream += 2) {
+    IOBufQueue block(IOBufQueue::cacheChainLength());
+    headerCodec.encodeHTTP(req, block, false);
+    writeHeaders(output_,
+                 block.split(7),
+                 stream,
+                 folly::none,
+                 http2::kNoPadding,
+                 true,
+                 false);
+    while (block.chainLength() > 100) {
+      http2::writeContinuation(output_, stream, false, block.split(100));
+    }
+    http2::writeContinuation(output_, stream, true, block.move());
+  }
+
+  parse();
+  EXPECT_EQ(callbacks_.messageBegin, 2);
+  EXPECT_EQ(callbacks_.headersComplete, 2);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+  // The second block is mostly references to the first one's entries
+  const auto& headers = callbacks_.msg->getHeaders();
+  EXPECT_EQ(string(2000, 'c'), headers.getSingleOrEmpty(HTTP_HEADER_COOKIE));
+  EXPECT_EQ("coolio", headers.getSingleOrEmpty(HTTP_HEADER_USER_AGENT));
+}
+
+TEST_F(HTTP2CodecTest, ContinuationHeadersTooLarge) {
+  // A small header block that decodes past MAX_HEADER_LIST_SIZE fails as
+  // soon as it crosses the limit, without waiting for END_HEADERS
+  HTTPMessage req = getGetRequest();
+  req.getHeaders().add("x-bomb", string(4000, 'b'));
+  HPACKCodec headerCodec(TransportDirection::UPSTREAM);
+  IOBufQueue block(IOBufQueue::cacheChainLength());
+  headerCodec.encodeHTTP(req, block, false);
+  writeHeaders(output_,
+               block.move(),
+               1,
+               folly::none,
+               http2::kNoPadding,
+               true,
+               false);
+  const uint32_t kContinuations = 100;
+  for (uint32_t i = 0; i < kContinuations; i++) {
+    // Each is one byte, an indexed reference to x-bomb
+    auto ref = makeBuf(1);
+    *ref->writableData() = 0x80 | 62;
+    http2::writeContinuation(output_, 1, false, std::move(ref));
+  }
+
+  parse();
+  EXPECT_EQ(callbacks_.messageBegin, 0);
+  EXPECT_EQ(callbacks_.headersComplete, 0);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 1);
+  EXPECT_EQ(callbacks_.lastParseError->getCodecStatusCode(),
+            ErrorCode::COMPRESSION_ERROR);
+#ifndef NDEBUG
+  EXPECT_LT(downstreamCodec_.getReceivedFrameCount(), kContinuations);
+#endif
+}
+
 TEST_F(HTTP2CodecTest, FrameTooLarge) {
   writeFrameHeaderManual(output_, 1 << 15, 0, 0, 1);
 
@@ -1012,6 +1080,26 @@ TEST_F(HTTP2CodecTest, LongData) {
   EXPECT_EQ(callbacks_.data_.move()->moveToFbString(), buf->moveToFbString());
 }
 
+TEST_F(HTTP2CodecTest, EgressDataFrameSizeLimit) {
+  // The limit only lowers the frame size, never raises it past the setting
+  HTTPSettings* settings = (HTTPSettings*)upstreamCodec_.getIngressSettings();
+  settings->setSetting(SettingsId::MAX_FRAME_SIZE, 32);
+  upstreamCodec_.setEgressDataFrameSizeLimit(64);
+  auto buf = makeBuf(100);
+  upstreamCodec_.generateBody(
+      output_, 1, buf->clone(), HTTPCodec::NoPadding, false);
+  upstreamCodec_.setEgressDataFrameSizeLimit(10);
+  upstreamCodec_.generateBody(
+      output_, 1, buf->clone(), HTTPCodec::NoPadding, true);
+
+  parse();
+  EXPECT_EQ(callbacks_.messageComplete, 1);
+  EXPECT_EQ(callbacks_.bodyCalls, 4 + 10);
+  EXPECT_EQ(callbacks_.bodyLength, 200);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
 TEST_F(HTTP2CodecTest, PushPromiseContinuation) {
   auto settings = upstreamCodec_.getEgressSettings();
   settings->setSetting(SettingsId::ENABLE_PUSH, 1);
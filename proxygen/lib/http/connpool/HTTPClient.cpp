@@ -0,0 +1,789 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/HTTPClient.h>
+
+#include <folly/Conv.h>
+#include <folly/io/SocketOptionMap.h>
+#include <folly/io/async/ssl/OpenSSLTransportCertificate.h>
+#include <folly/portability/OpenSSL.h>
+#include <proxygen/lib/http/EarlyDataPolicy.h>
+#include <proxygen/lib/http/HQConnector.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/codec/CodecProtocol.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <quic/QuicException.h>
+
+using folly::IOBuf;
+using std::unique_ptr;
+
+namespace proxygen {
+
+namespace {
+
+bool isIdempotent(const HTTPMessage& request) {
+  auto method = request.getMethod();
+  if (!method) {
+    return false;
+  }
+  switch (*method) {
+    case HTTPMethod::GET:
+    case HTTPMethod::HEAD:
+    case HTTPMethod::PUT:
+    case HTTPMethod::DELETE:
+    case HTTPMethod::OPTIONS:
+    case HTTPMethod::TRACE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * Whether a request that failed before any response arrived can be sent
+ * again on another session.
+ */
+bool isRetryable(const HTTPMessage& request, const HTTPException& error) {
+  switch (error.getProxygenError()) {
+    case kErrorStreamUnacknowledged:
+    case kErrorEarlyDataRejected:
+    case kErrorEarlyDataFailed:
+      // GOAWAY or REFUSED_STREAM, or 0-RTT the server did not accept: the
+      // server did not process it
+      return true;
+    case kErrorEOF:
+    case kErrorConnectionReset:
+    case kErrorConnection:
+    case kErrorRead:
+    case kErrorWrite:
+      // Typically a pooled session the server had already closed
+      return isIdempotent(request);
+    default:
+      return false;
+  }
+}
+
+constexpr folly::StringPiece kHTTP3ProtocolId{"h3"};
+
+std::string altSvcKey(const Endpoint& origin) {
+  return AltSvcCache::originKey(origin.getHostname(), origin.getPort());
+}
+
+/**
+ * OpenSSL only verifies the chain against the trust store; whether the
+ * certificate is for the host we meant to reach is checked here.
+ */
+bool certificateMatchesHost(const folly::AsyncTransport* transport,
+                            folly::StringPiece host) {
+  auto cert = transport ? transport->getPeerCertificate() : nullptr;
+  auto x509 = folly::OpenSSLTransportCertificate::tryExtractX509(cert);
+  if (!x509) {
+    return false;
+  }
+  if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+    host = host.subpiece(1, host.size() - 2);
+  }
+  auto hostStr = host.str();
+  if (X509_check_ip_asc(x509.get(), hostStr.c_str(), 0) == 1) {
+    return true;
+  }
+  return X509_check_host(
+             x509.get(), hostStr.data(), hostStr.size(), 0, nullptr) == 1;
+}
+
+HTTPException makeException(const std::string& message, ProxygenError err) {
+  HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS, message);
+  ex.setProxygenError(err);
+  return ex;
+}
+
+} // namespace
+
+/**
+ * One connection attempt to an origin, over TCP (with TLS for secure
+ * origins) or QUIC.
+ */
+class HTTPClient::ConnectAttempt
+    : public HTTPConnector::Callback
+    , public HQConnector::Callback {
+ public:
+  ConnectAttempt(HTTPClient& client, const Endpoint& origin, bool http3)
+      : client_(client), origin_(origin), http3_(http3) {
+  }
+
+  void start(const folly::SocketAddress& addr) {
+    const auto& options = client_.getOptions();
+    auto evb = client_.getEventBase();
+    if (http3_) {
+      hqConnector_ =
+          std::make_unique<HQConnector>(this, options.transactionTimeout);
+      hqConnector_->setTransportSettings(options.quicTransportSettings);
+      hqConnector_->setQuicPskCache(options.quicPskCache);
+      hqConnector_->setEarlyDataEnabled(options.enableEarlyData);
+      hqConnector_->connect(evb,
+                            folly::none,
+                            addr,
+                            options.fizzContext,
+                            options.certVerifier,
+                            options.connectTimeout,
+                            folly::emptySocketOptionMap,
+                            origin_.getHostname());
+      return;
+    }
+    connector_ = std::make_unique<HTTPConnector>(
+        this, WheelTimerInstance(options.transactionTimeout, evb));
+    if (!options.plaintextProtocol.empty()) {
+      connector_->setPlaintextProtocol(options.plaintextProtocol);
+    }
+    if (origin_.isSecure()) {
+      connector_->connectSSL(evb,
+                             addr,
+                             options.sslContext,
+                             nullptr,
+                             options.connectTimeout,
+                             folly::emptySocketOptionMap,
+                             folly::AsyncSocket::anyAddress(),
+                             origin_.getHostname());
+    } else {
+      connector_->connect(evb, addr, options.connectTimeout);
+    }
+  }
+
+  // HTTPConnector::Callback
+  void connectSuccess(HTTPUpstreamSession* session) noexcept override {
+    auto self = release();
+    const auto& sslContext = client_.getOptions().sslContext;
+    if (origin_.isSecure() && sslContext->needsPeerVerification() &&
+        !certificateMatchesHost(session->getTransport(),
+                                origin_.getHostname())) {
+      session->dropConnection();
+      client_.onConnectError(
+          origin_,
+          makeException(folly::to<std::string>("Certificate does not match ",
+                                               origin_.getHostname()),
+                        kErrorConnect),
+          http3_);
+      return;
+    }
+    client_.onConnectSuccess(origin_, session, http3_);
+  }
+
+  void connectError(const folly::AsyncSocketException& ex) noexcept override {
+    auto self = release();
+    client_.onConnectError(
+        origin_,
+        makeException(folly::to<std::string>("Connect failed: ", ex.what()),
+                      ex.getType() == folly::AsyncSocketException::TIMED_OUT
+                          ? kErrorConnectTimeout
+                          : kErrorConnect),
+        http3_);
+  }
+
+  // HQConnector::Callback
+  void connectSuccess(HQUpstreamSession* session) noexcept override {
+    auto self = release();
+    client_.onConnectSuccess(origin_, session, http3_);
+  }
+
+  void connectError(const quic::QuicErrorCode& code) noexcept override {
+    auto self = release();
+    client_.onConnectError(
+        origin_,
+        makeException(
+            folly::to<std::string>("QUIC connect failed: ",
+                                   quic::toString(code)),
+            kErrorConnect),
+        http3_);
+  }
+
+ private:
+  /**
+   * Take ownership back from the client. The connector is still on the
+   * stack, so destruction is deferred to the end of the loop.
+   */
+  struct DeferredDelete {
+    ~DeferredDelete() {
+      if (attempt) {
+        evb->runInLoop([attempt = std::move(attempt)]() {});
+      }
+    }
+    folly::EventBase* evb{nullptr};
+    unique_ptr<ConnectAttempt> attempt;
+  };
+
+  DeferredDelete release() {
+    DeferredDelete self;
+    self.evb = client_.getEventBase();
+    auto it = client_.connectAttempts_.find(this);
+    CHECK(it != client_.connectAttempts_.end());
+    self.attempt = std::move(it->second);
+    client_.connectAttempts_.erase(it);
+    return self;
+  }
+
+  HTTPClient& client_;
+  const Endpoint origin_;
+  const bool http3_;
+  unique_ptr<HTTPConnector> connector_;
+  unique_ptr<HQConnector> hqConnector_;
+};
+
+/**
+ * Follows an HTTP/3 session handed over for 0-RTT until its handshake
+ * completes, since only then is h3 known to work for the origin. Installed
+ * as the session's InfoCallback, which the session pool passes calls on
+ * to. Deletes itself when the session is destroyed.
+ */
+class HTTPClient::HandshakeWatcher : public HTTPSessionBase::InfoCallback {
+ public:
+  HandshakeWatcher(HTTPClient* client,
+                   const Endpoint& origin,
+                   HTTPSessionBase* session)
+      : client_(client), origin_(origin) {
+    // The connectors create sessions without one
+    DCHECK(!session->getInfoCallback());
+    client_->handshakeWatchers_.insert(this);
+    session->setInfoCallback(this);
+  }
+
+  // The client is going away; report nothing
+  void detachClient() {
+    client_ = nullptr;
+  }
+
+  void onFullHandshakeCompletion(const HTTPSessionBase&) override {
+    report(true);
+  }
+
+  void onDestroy(const HTTPSessionBase&) override {
+    // Still in 0-RTT: the handshake failed or timed out
+    report(false);
+    delete this;
+  }
+
+ private:
+  void report(bool success) {
+    if (client_) {
+      auto client = client_;
+      client_ = nullptr;
+      client->handshakeWatchers_.erase(this);
+      client->onHTTP3Handshake(origin_, success);
+    }
+  }
+
+  HTTPClient* client_;
+  const Endpoint origin_;
+};
+
+/**
+ * Handler for a fetch(). Sends the request, buffers the response and
+ * fulfills the promise. Deletes itself when done.
+ *
+ * On a session still in its 0-RTT handshake, only requests that are safe to
+ * replay are sent at once; others wait for the handshake. A 425 (Too Early)
+ * response to early data is retried after the handshake.
+ */
+class HTTPClient::FetchRequest
+    : public HTTPTransactionHandler
+    , public HTTPClient::TransactionCallback
+    , private folly::AsyncTransport::ReplaySafetyCallback {
+ public:
+  FetchRequest(HTTPClient* client,
+               const Endpoint& origin,
+               HTTPMessage request,
+               unique_ptr<IOBuf> body)
+      : client_(client),
+        origin_(origin),
+        request_(std::move(request)),
+        body_(std::move(body)) {
+  }
+
+  folly::SemiFuture<Response> getFuture() {
+    return promise_.getSemiFuture();
+  }
+
+  void start() {
+    CHECK(client_);
+    client_->getTransaction(origin_, this, this);
+  }
+
+  // The client is going away; no more retries
+  void detachClient() {
+    client_ = nullptr;
+  }
+
+  // TransactionCallback
+  void transactionReady(HTTPTransaction* txn) noexcept override {
+    attempts_++;
+    if (!txn->getTransport().isReplaySafe() &&
+        (tooEarly_ || !EarlyDataPolicy::canSendInEarlyData(request_))) {
+      VLOG(4) << "Holding request to " << origin_.getHostname()
+              << " until the handshake completes";
+      waitingForReplaySafety_ = true;
+      txn->addWaitingForReplaySafety(this);
+      return;
+    }
+    sendRequest(txn);
+  }
+
+  void transactionError(const HTTPException& error) noexcept override {
+    error_ = error;
+    finish();
+  }
+
+  // HTTPTransactionHandler
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    stopWaitingForReplaySafety();
+    txn_ = nullptr;
+    if (retry_ && client_) {
+      retry_ = false;
+      error_.reset();
+      client_->stats_.retries++;
+      start();
+      return;
+    }
+    if (!error_ && !eom_) {
+      error_ = makeException("Transaction ended without a response",
+                             kErrorStreamAbort);
+    }
+    finish();
+  }
+
+  void onHeadersComplete(unique_ptr<HTTPMessage> msg) noexcept override {
+    if (client_) {
+      client_->processAltSvc(origin_, *msg);
+    }
+    if (msg->getStatusCode() == 425 && sentInEarlyData_ && !tooEarly_ &&
+        client_) {
+      // The server wants this after the handshake (RFC 8470)
+      VLOG(4) << "Retrying request to " << origin_.getHostname()
+              << " after 425 Too Early";
+      tooEarly_ = true;
+      retry_ = true;
+      return;
+    }
+    response_.message = std::move(msg);
+  }
+
+  void onBody(unique_ptr<IOBuf> chain) noexcept override {
+    if (response_.message) {
+      responseBody_.append(std::move(chain));
+    }
+  }
+
+  void onTrailers(unique_ptr<HTTPHeaders> trailers) noexcept override {
+    if (response_.message) {
+      response_.trailers = std::move(trailers);
+    }
+  }
+
+  void onEOM() noexcept override {
+    eom_ = response_.message != nullptr;
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const HTTPException& error) noexcept override {
+    // A request held for the handshake never reached the server
+    bool sent = !waitingForReplaySafety_;
+    stopWaitingForReplaySafety();
+    error_ = error;
+    if (!response_.message && client_ &&
+        attempts_ <= client_->options_.maxRetries &&
+        (!sent || isRetryable(request_, error))) {
+      VLOG(4) << "Retrying request to " << origin_.getHostname()
+              << " after error: " << error.what();
+      retry_ = true;
+    }
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  // ReplaySafetyCallback
+  void onReplaySafe() noexcept override {
+    waitingForReplaySafety_ = false;
+    CHECK(txn_);
+    sendRequest(txn_);
+  }
+
+  void sendRequest(HTTPTransaction* txn) {
+    sentInEarlyData_ = !txn->getTransport().isReplaySafe();
+    if (body_) {
+      txn->sendHeaders(request_);
+      txn->sendBody(body_->clone());
+      txn->sendEOM();
+    } else {
+      txn->sendHeadersWithEOM(request_);
+    }
+  }
+
+  void stopWaitingForReplaySafety() {
+    if (waitingForReplaySafety_ && txn_) {
+      txn_->removeWaitingForReplaySafety(this);
+    }
+    waitingForReplaySafety_ = false;
+  }
+
+  void finish() {
+    if (error_) {
+      promise_.setException(*error_);
+    } else {
+      response_.body = responseBody_.move();
+      promise_.setValue(std::move(response_));
+    }
+    if (client_) {
+      client_->fetches_.erase(this);
+    }
+    delete this;
+  }
+
+  HTTPClient* client_;
+  const Endpoint origin_;
+  const HTTPMessage request_;
+  // Kept whole so the request can be sent again
+  const unique_ptr<IOBuf> body_;
+  folly::Promise<Response> promise_;
+  Response response_;
+  folly::IOBufQueue responseBody_{folly::IOBufQueue::cacheChainLength()};
+  folly::Optional<HTTPException> error_;
+  HTTPTransaction* txn_{nullptr};
+  uint32_t attempts_{0};
+  bool retry_{false};
+  bool eom_{false};
+  bool waitingForReplaySafety_{false};
+  bool sentInEarlyData_{false};
+  // Got 425 for early data, so wait for the handshake from now on
+  bool tooEarly_{false};
+};
+
+HTTPClient::Origin::Origin(const Endpoint& endpoint, const Options& options)
+    : endpoint(endpoint),
+      pool(nullptr,
+           options.maxIdleSessionsPerOrigin,
+           options.idleTimeout,
+           options.maxSessionAge) {
+}
+
+HTTPClient::HTTPClient(folly::EventBase* evb, Options options)
+    : evb_(CHECK_NOTNULL(evb)), options_(std::move(options)) {
+  // SessionPool binds to the EventBaseManager's EventBase for this thread
+  evb_->dcheckIsInEventBaseThread();
+  if (!options_.sslContext) {
+    options_.sslContext = std::make_shared<folly::SSLContext>();
+    options_.sslContext->setOptions(SSL_OP_NO_COMPRESSION);
+    options_.sslContext->setAdvertisedNextProtocols({"h2", "http/1.1"});
+    options_.sslContext->setVerificationOption(
+        folly::SSLContext::SSLVerifyPeerEnum::VERIFY);
+    if (SSL_CTX_set_default_verify_paths(
+            options_.sslContext->getSSLCtx()) != 1) {
+      LOG(ERROR) << "Failed to load the system CA certificates";
+    }
+  }
+  if (!options_.resolver) {
+    options_.resolver = [](const Endpoint& origin) {
+      return folly::SocketAddress(
+          origin.getHostname(), origin.getPort(), true /* allowNameLookup */);
+    };
+  }
+  if (options_.enableHTTP3 &&
+      (!options_.fizzContext || !options_.certVerifier)) {
+    LOG(ERROR) << "HTTP/3 needs a fizz context and certificate verifier";
+    options_.enableHTTP3 = false;
+  }
+}
+
+HTTPClient::~HTTPClient() {
+  for (auto fetch : fetches_) {
+    fetch->detachClient();
+  }
+  fetches_.clear();
+  for (auto watcher : handshakeWatchers_) {
+    watcher->detachClient();
+  }
+  handshakeWatchers_.clear();
+  // Cancels the connects without callbacks
+  connectAttempts_.clear();
+  auto error = makeException("HTTPClient destroyed", kErrorShutdown);
+  for (auto& entry : origins_) {
+    failWaiters(*entry.second, error);
+  }
+  origins_.clear();
+}
+
+HTTPClient::Origin& HTTPClient::getOrigin(const Endpoint& endpoint) {
+  auto it = origins_.find(endpoint);
+  if (it == origins_.end()) {
+    it = origins_
+             .emplace(endpoint, std::make_unique<Origin>(endpoint, options_))
+             .first;
+  }
+  return *it->second;
+}
+
+void HTTPClient::getTransaction(const Endpoint& endpoint,
+                                HTTPTransactionHandler* handler,
+                                TransactionCallback* callback) {
+  evb_->dcheckIsInEventBaseThread();
+  auto& origin = getOrigin(endpoint);
+  // Don't jump ahead of requests already waiting
+  if (origin.waiters.empty()) {
+    auto txn = origin.pool.getTransaction(handler);
+    if (txn) {
+      stats_.sessionsReused++;
+      callback->transactionReady(txn);
+      return;
+    }
+  }
+  origin.waiters.push_back({handler, callback});
+  maybeConnect(origin);
+}
+
+void HTTPClient::cancelGetTransaction(TransactionCallback* callback) {
+  for (auto& entry : origins_) {
+    auto& waiters = entry.second->waiters;
+    waiters.erase(std::remove_if(waiters.begin(),
+                                 waiters.end(),
+                                 [callback](const Waiter& waiter) {
+                                   return waiter.callback == callback;
+                                 }),
+                  waiters.end());
+  }
+}
+
+folly::SemiFuture<HTTPClient::Response> HTTPClient::fetch(
+    const URL& url, HTTPMessage request, unique_ptr<IOBuf> body) {
+  if (!url.isValid() || !url.hasHost()) {
+    return folly::makeSemiFuture<Response>(
+        makeException(folly::to<std::string>("Invalid URL ", url.getUrl()),
+                      kErrorMalformedInput));
+  }
+  request.setURL(url.makeRelativeURL());
+  request.getHeaders().set(HTTP_HEADER_HOST, url.getHostAndPortOmitDefault());
+  request.setSecure(url.isSecure());
+  auto fetch =
+      new FetchRequest(this,
+                       Endpoint(url.getHost(), url.getPort(), url.isSecure()),
+                       std::move(request),
+                       std::move(body));
+  fetches_.insert(fetch);
+  auto future = fetch->getFuture();
+  fetch->start();
+  return future;
+}
+
+folly::SemiFuture<HTTPClient::Response> HTTPClient::get(
+    const std::string& url) {
+  HTTPMessage request;
+  request.setMethod(HTTPMethod::GET);
+  return fetch(URL(url), std::move(request));
+}
+
+void HTTPClient::processAltSvc(const Endpoint& origin,
+                               const HTTPMessage& response) {
+  // Only secure origins can be upgraded to HTTP/3
+  if (!options_.altSvcCache || !origin.isSecure()) {
+    return;
+  }
+  const auto& headers = response.getHeaders();
+  if (headers.exists(HTTP_HEADER_ALT_SVC)) {
+    options_.altSvcCache->processAltSvc(
+        altSvcKey(origin), headers.combine(HTTP_HEADER_ALT_SVC, ","));
+  }
+}
+
+void HTTPClient::drain() {
+  for (auto& entry : origins_) {
+    entry.second->pool.drainAllSessions();
+  }
+}
+
+size_t HTTPClient::getNumSessions(const Endpoint& endpoint) const {
+  auto it = origins_.find(endpoint);
+  return it == origins_.end() ? 0 : it->second->pool.getNumSessions();
+}
+
+bool HTTPClient::useHTTP3(const Origin& origin) const {
+  if (!options_.enableHTTP3 || !origin.endpoint.isSecure()) {
+    return false;
+  }
+  if (options_.altSvcCache) {
+    return options_.altSvcCache
+        ->getAlternative(altSvcKey(origin.endpoint), kHTTP3ProtocolId)
+        .hasValue();
+  }
+  return !origin.http3Broken;
+}
+
+void HTTPClient::maybeConnect(Origin& origin) {
+  // One connection serves every waiter on a multiplexed protocol
+  size_t wanted = origin.multiplexed ? 1 : origin.waiters.size();
+  wanted = std::min<size_t>(wanted, options_.maxConnectsPerOrigin);
+  while (!origin.waiters.empty() && origin.connecting < wanted) {
+    startConnect(origin, useHTTP3(origin));
+  }
+}
+
+void HTTPClient::startConnect(Origin& origin, bool http3) {
+  origin.connecting++;
+  stats_.connectsStarted++;
+  if (http3) {
+    origin.http3Connecting++;
+    if (options_.http3RaceDelay.count() > 0) {
+      if (!origin.raceTimeout) {
+        origin.raceTimeout = folly::AsyncTimeout::make(
+            *evb_, [this, &origin]() noexcept { onRaceTimeout(origin); });
+      }
+      if (!origin.raceTimeout->isScheduled()) {
+        origin.raceTimeout->scheduleTimeout(options_.http3RaceDelay);
+      }
+    }
+  }
+  connect(origin.endpoint, http3);
+}
+
+void HTTPClient::onRaceTimeout(Origin& origin) {
+  // Nothing to race if QUIC finished or TCP is already connecting
+  if (origin.waiters.empty() || origin.http3Connecting == 0 ||
+      origin.connecting > origin.http3Connecting) {
+    return;
+  }
+  VLOG(4) << "QUIC to " << origin.endpoint.getHostname()
+          << " is slow, racing TCP";
+  startConnect(origin, false);
+}
+
+void HTTPClient::connect(const Endpoint& origin, bool http3) {
+  // The advertised alternative may be on another host or port; TLS is
+  // still for the origin
+  auto target = origin;
+  if (http3 && options_.altSvcCache) {
+    auto alternative = options_.altSvcCache->getAlternative(altSvcKey(origin),
+                                                            kHTTP3ProtocolId);
+    if (alternative) {
+      target = Endpoint(alternative->host.empty() ? origin.getHostname()
+                                                  : alternative->host,
+                        alternative->port,
+                        true);
+    }
+  }
+  folly::SocketAddress addr;
+  try {
+    addr = options_.resolver(target);
+  } catch (const std::exception& ex) {
+    onConnectError(origin,
+                   makeException(folly::to<std::string>("Failed to resolve ",
+                                                        origin.getHostname(),
+                                                        ": ",
+                                                        ex.what()),
+                                 kErrorDNSResolutionErr),
+                   http3);
+    return;
+  }
+  auto attempt = std::make_unique<ConnectAttempt>(*this, origin, http3);
+  auto rawAttempt = attempt.get();
+  connectAttempts_.emplace(rawAttempt, std::move(attempt));
+  rawAttempt->start(addr);
+}
+
+void HTTPClient::onConnectSuccess(const Endpoint& endpoint,
+                                  HTTPSessionBase* session,
+                                  bool http3) {
+  auto& origin = getOrigin(endpoint);
+  DCHECK_GT(origin.connecting, 0);
+  origin.connecting--;
+  if (http3) {
+    DCHECK_GT(origin.http3Connecting, 0);
+    origin.http3Connecting--;
+    if (origin.http3Connecting == 0 && origin.raceTimeout) {
+      origin.raceTimeout->cancelTimeout();
+    }
+    if (session->isReplaySafe()) {
+      onHTTP3Handshake(endpoint, true);
+    } else {
+      // 0-RTT; the handshake may yet fail
+      new HandshakeWatcher(this, endpoint, session);
+    }
+  }
+  origin.multiplexed = isParallelCodecProtocol(session->getCodecProtocol());
+  VLOG(4) << "Connected to " << endpoint.getHostname() << " protocol="
+          << getCodecProtocolString(session->getCodecProtocol());
+  origin.pool.putSession(session);
+  serviceWaiters(origin);
+}
+
+void HTTPClient::onConnectError(const Endpoint& endpoint,
+                                const HTTPException& error,
+                                bool http3) {
+  auto& origin = getOrigin(endpoint);
+  DCHECK_GT(origin.connecting, 0);
+  origin.connecting--;
+  stats_.connectErrors++;
+  VLOG(3) << "Connect to " << endpoint.getHostname()
+          << " failed: " << error.what();
+  if (http3) {
+    DCHECK_GT(origin.http3Connecting, 0);
+    origin.http3Connecting--;
+    if (options_.altSvcCache) {
+      options_.altSvcCache->markBroken(altSvcKey(endpoint), kHTTP3ProtocolId);
+    } else {
+      origin.http3Broken = true;
+    }
+    // Fall back to TCP, which may get through where UDP does not
+    maybeConnect(origin);
+  }
+  if (origin.connecting == 0) {
+    failWaiters(origin, error);
+  }
+}
+
+void HTTPClient::onHTTP3Handshake(const Endpoint& endpoint, bool success) {
+  VLOG(4) << "QUIC handshake with " << endpoint.getHostname()
+          << (success ? " completed" : " failed");
+  if (options_.altSvcCache) {
+    if (success) {
+      options_.altSvcCache->markWorking(altSvcKey(endpoint), kHTTP3ProtocolId);
+    } else {
+      options_.altSvcCache->markBroken(altSvcKey(endpoint), kHTTP3ProtocolId);
+    }
+  } else if (!success) {
+    getOrigin(endpoint).http3Broken = true;
+  }
+}
+
+void HTTPClient::serviceWaiters(Origin& origin) {
+  while (!origin.waiters.empty()) {
+    auto waiter = origin.waiters.front();
+    auto txn = origin.pool.getTransaction(waiter.handler);
+    if (!txn) {
+      break;
+    }
+    origin.waiters.pop_front();
+    waiter.callback->transactionReady(txn);
+  }
+  maybeConnect(origin);
+}
+
+void HTTPClient::failWaiters(Origin& origin, const HTTPException& error) {
+  auto waiters = std::move(origin.waiters);
+  origin.waiters.clear();
+  for (auto& waiter : waiters) {
+    waiter.callback->transactionError(error);
+  }
+}
+
+} // namespace proxygen
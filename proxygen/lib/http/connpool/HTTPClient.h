@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <fizz/client/FizzClientContext.h>
+#include <fizz/protocol/CertificateVerifier.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/SSLContext.h>
+#include <proxygen/lib/http/AltSvcCache.h>
+#include <proxygen/lib/http/HTTPException.h>
+#include <proxygen/lib/http/connpool/Endpoint.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+#include <proxygen/lib/utils/URL.h>
+#include <quic/fizz/client/handshake/QuicPskCache.h>
+#include <quic/state/TransportSettings.h>
+
+namespace proxygen {
+
+/**
+ * An asynchronous HTTP client that pools sessions per origin.
+ *
+ * Each origin (scheme, host, port) has its own SessionPool. A request is
+ * served from a pooled session when one can open another transaction;
+ * otherwise it waits for a new connection. HTTP/2 and HTTP/3 sessions are
+ * shared by every concurrent request to the origin, so the connection and
+ * TLS handshake are paid once. Secure origins negotiate h2 or http/1.1 with
+ * ALPN. With enableHTTP3, an origin that advertised h3 with Alt-Svc is
+ * connected to over QUIC, optionally racing TCP, and falls back to TCP if
+ * QUIC fails. With enableEarlyData, resumed QUIC connections carry requests
+ * that are safe to replay in 0-RTT.
+ *
+ * Like SessionPool, an HTTPClient belongs to one EventBase and must be
+ * created, used and destroyed in that thread. Run one per IO thread for a
+ * per-thread set of pools.
+ *
+ * Two APIs are provided:
+ *  - fetch() sends a whole request and returns a SemiFuture of the buffered
+ *    response. Requests that fail before any response arrives are retried
+ *    on another session when that is safe. Coroutines can co_await the
+ *    SemiFuture.
+ *  - getTransaction() hands a transaction on a pooled session to the
+ *    caller's HTTPTransactionHandler, for streaming request and response
+ *    bodies.
+ */
+class HTTPClient {
+ public:
+  struct Options {
+    // Idle sessions kept per origin; see SessionPool
+    uint32_t maxIdleSessionsPerOrigin{4};
+    std::chrono::milliseconds idleTimeout{std::chrono::seconds(60)};
+    std::chrono::milliseconds maxSessionAge{0};
+    // Connections being established at once to one origin
+    uint32_t maxConnectsPerOrigin{4};
+    std::chrono::milliseconds connectTimeout{std::chrono::seconds(5)};
+    std::chrono::milliseconds transactionTimeout{std::chrono::seconds(30)};
+    // Extra attempts fetch() makes for a request that failed before any
+    // response was received
+    uint32_t maxRetries{1};
+    // For plaintext origins, e.g. "h2c" for HTTP/2 with prior knowledge
+    std::string plaintextProtocol;
+    /**
+     * For secure TCP origins. If unset, one advertising h2 and http/1.1
+     * that verifies peers against the system CA certificates is used. When
+     * the context verifies peers, the certificate must also match the
+     * origin's hostname.
+     */
+    std::shared_ptr<folly::SSLContext> sslContext;
+    // HTTP/3 needs a fizz context (with h3 in its ALPN list) and verifier
+    bool enableHTTP3{false};
+    std::shared_ptr<const fizz::client::FizzClientContext> fizzContext;
+    std::shared_ptr<const fizz::CertificateVerifier> certVerifier;
+    quic::TransportSettings quicTransportSettings;
+    // Resumption tickets for QUIC, which 0-RTT needs
+    std::shared_ptr<quic::QuicPskCache> quicPskCache;
+    /**
+     * Use a resumed QUIC session as soon as 0-RTT data can be sent. fetch()
+     * sends requests EarlyDataPolicy::canSendInEarlyData allows at once and
+     * holds the rest until the handshake completes; getTransaction()
+     * callers must check HTTPTransaction::getTransport().isReplaySafe()
+     * and do the same with addWaitingForReplaySafety.
+     */
+    bool enableEarlyData{false};
+    /**
+     * Records Alt-Svc from responses and QUIC failures. With enableHTTP3,
+     * only origins it has h3 for are tried over QUIC; without a cache every
+     * secure origin is. h3 is marked working once a QUIC handshake
+     * completes, so a 0-RTT session that then fails marks it broken. May be
+     * shared by the clients of several threads.
+     */
+    std::shared_ptr<AltSvcCache> altSvcCache;
+    // Start a TCP connection as well if QUIC has not connected after this
+    // long; 0 waits for QUIC to fail
+    std::chrono::milliseconds http3RaceDelay{0};
+    /**
+     * Maps an origin to the address to connect to; may throw. The default
+     * does a blocking getaddrinfo in the EventBase thread, so callers that
+     * care about latency should provide one backed by a cache.
+     */
+    std::function<folly::SocketAddress(const Endpoint&)> resolver;
+  };
+
+  struct Stats {
+    uint64_t connectsStarted{0};
+    uint64_t connectErrors{0};
+    // Transactions opened on a session that already existed
+    uint64_t sessionsReused{0};
+    uint64_t retries{0};
+  };
+
+  struct Response {
+    std::unique_ptr<HTTPMessage> message;
+    std::unique_ptr<folly::IOBuf> body;
+    std::unique_ptr<HTTPHeaders> trailers;
+  };
+
+  /**
+   * Result of getTransaction(). Exactly one method is called, unless the
+   * request is cancelled first.
+   */
+  class TransactionCallback {
+   public:
+    virtual ~TransactionCallback() {
+    }
+    /**
+     * The handler's setTransaction has been called with txn, which is ready
+     * for the request to be sent.
+     */
+    virtual void transactionReady(HTTPTransaction* txn) noexcept = 0;
+    virtual void transactionError(const HTTPException& error) noexcept = 0;
+  };
+
+  HTTPClient(folly::EventBase* evb, Options options);
+
+  /**
+   * Sessions with open transactions are drained, and closed once their
+   * transactions finish. Requests still waiting for a connection get
+   * transactionError, and pending fetch() futures fail.
+   */
+  virtual ~HTTPClient();
+
+  HTTPClient(const HTTPClient&) = delete;
+  HTTPClient& operator=(const HTTPClient&) = delete;
+
+  /**
+   * Open a transaction to origin for handler, on a pooled session if one
+   * can take it. The callback may be invoked before this returns.
+   */
+  void getTransaction(const Endpoint& origin,
+                      HTTPTransactionHandler* handler,
+                      TransactionCallback* callback);
+
+  // Stop waiting for a transaction; no callback is invoked
+  void cancelGetTransaction(TransactionCallback* callback);
+
+  /**
+   * Send request to url (which must be absolute) and buffer the response.
+   * The request's URL, Host header and security are set from url.
+   */
+  folly::SemiFuture<Response> fetch(
+      const URL& url,
+      HTTPMessage request,
+      std::unique_ptr<folly::IOBuf> body = nullptr);
+
+  folly::SemiFuture<Response> get(const std::string& url);
+
+  /**
+   * Record the Alt-Svc header of a response from origin. fetch() does this
+   * itself; getTransaction() callers should call it from their handler.
+   */
+  void processAltSvc(const Endpoint& origin, const HTTPMessage& response);
+
+  // Gracefully close every pooled session
+  void drain();
+
+  size_t getNumSessions(const Endpoint& origin) const;
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+  folly::EventBase* getEventBase() const {
+    return evb_;
+  }
+
+ protected:
+  /**
+   * Start a connection to origin, over QUIC if http3 is set. Completion is
+   * reported with onConnectSuccess or onConnectError, possibly before this
+   * returns.
+   */
+  virtual void connect(const Endpoint& origin, bool http3);
+
+  void onConnectSuccess(const Endpoint& origin,
+                        HTTPSessionBase* session,
+                        bool http3);
+  void onConnectError(const Endpoint& origin,
+                      const HTTPException& error,
+                      bool http3);
+  /**
+   * Whether the handshake of an HTTP/3 session handed over for 0-RTT
+   * completed. A session that goes away first counts as a failure.
+   */
+  void onHTTP3Handshake(const Endpoint& origin, bool success);
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+ private:
+  class ConnectAttempt;
+  class FetchRequest;
+  class HandshakeWatcher;
+
+  struct Waiter {
+    HTTPTransactionHandler* handler;
+    TransactionCallback* callback;
+  };
+
+  struct Origin {
+    Origin(const Endpoint& endpoint, const Options& options);
+
+    Endpoint endpoint;
+    SessionPool pool;
+    std::deque<Waiter> waiters;
+    uint32_t connecting{0};
+    uint32_t http3Connecting{0};
+    // Until a session says otherwise, assume one connection serves all
+    bool multiplexed{true};
+    // QUIC failed to connect and there is no AltSvcCache to back off in,
+    // so use TCP from now on
+    bool http3Broken{false};
+    // Starts a TCP connection if QUIC is slow
+    folly::AsyncTimeout::UniquePtr raceTimeout;
+  };
+
+  Origin& getOrigin(const Endpoint& endpoint);
+  void serviceWaiters(Origin& origin);
+  void maybeConnect(Origin& origin);
+  void failWaiters(Origin& origin, const HTTPException& error);
+  bool useHTTP3(const Origin& origin) const;
+  void startConnect(Origin& origin, bool http3);
+  void onRaceTimeout(Origin& origin);
+
+  folly::EventBase* evb_;
+  Options options_;
+  Stats stats_;
+  folly::F14NodeMap<Endpoint,
+                    std::unique_ptr<Origin>,
+                    EndpointHash,
+                    EndpointEqual>
+      origins_;
+  folly::F14FastMap<ConnectAttempt*, std::unique_ptr<ConnectAttempt>>
+      connectAttempts_;
+  folly::F14FastSet<FetchRequest*> fetches_;
+  folly::F14FastSet<HandshakeWatcher*> handshakeWatchers_;
+};
+
+} // namespace proxygen
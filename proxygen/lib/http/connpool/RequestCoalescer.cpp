@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/RequestCoalescer.h>
+
+#include <algorithm>
+#include <folly/Conv.h>
+
+using folly::IOBuf;
+using std::unique_ptr;
+
+namespace proxygen {
+
+CoalescedFetch::FanoutGuard::FanoutGuard(CoalescedFetch& fetch)
+    : fetch_(fetch) {
+  fetch_.guardDepth_++;
+}
+
+CoalescedFetch::FanoutGuard::~FanoutGuard() {
+  DCHECK_GT(fetch_.guardDepth_, 0);
+  if (--fetch_.guardDepth_ > 0) {
+    return;
+  }
+  auto& subs = fetch_.subscribers_;
+  subs.erase(std::remove(subs.begin(), subs.end(), nullptr), subs.end());
+  if (fetch_.detached_ && fetch_.numSubscribers_ == 0) {
+    delete &fetch_;
+  }
+}
+
+CoalescedFetch::CoalescedFetch(RequestCoalescer* coalescer,
+                               std::string key,
+                               BufferLimits limits)
+    : coalescer_(coalescer),
+      key_(std::move(key)),
+      limits_(limits),
+      joinable_(true),
+      eomReceived_(false),
+      errored_(false),
+      ingressPaused_(false),
+      detached_(false) {
+}
+
+CoalescedFetch::~CoalescedFetch() {
+  DCHECK_EQ(numSubscribers_, 0);
+  setUnjoinable();
+}
+
+bool CoalescedFetch::addSubscriber(Subscriber* subscriber) {
+  if (!joinable_) {
+    return false;
+  }
+  FanoutGuard g(*this);
+  subscribers_.emplace_back(std::make_unique<SubscriberState>(subscriber));
+  numSubscribers_++;
+  if (response_) {
+    subscriber->onCoalescedHeaders(*response_);
+  }
+  updateIngressState();
+  return true;
+}
+
+void CoalescedFetch::removeSubscriber(Subscriber* subscriber) {
+  FanoutGuard g(*this);
+  auto state = findState(subscriber);
+  if (!state) {
+    return;
+  }
+  eraseState(state);
+  if (numSubscribers_ == 0 && !eomReceived_ && !errored_) {
+    VLOG(4) << "Last subscriber left, aborting upstream fetch key=" << key_;
+    errored_ = true;
+    setUnjoinable();
+    if (txn_) {
+      txn_->sendAbort();
+    } else {
+      detached_ = true;
+    }
+  } else {
+    updateIngressState();
+  }
+}
+
+void CoalescedFetch::pauseSubscriber(Subscriber* subscriber) {
+  auto state = findState(subscriber);
+  if (state) {
+    state->paused = true;
+  }
+}
+
+void CoalescedFetch::resumeSubscriber(Subscriber* subscriber) {
+  FanoutGuard g(*this);
+  auto state = findState(subscriber);
+  if (!state) {
+    return;
+  }
+  state->paused = false;
+  flush(*state);
+  updateIngressState();
+}
+
+void CoalescedFetch::abort(const HTTPException& error) {
+  FanoutGuard g(*this);
+  if (errored_) {
+    return;
+  }
+  errored_ = true;
+  setUnjoinable();
+  failAll(error);
+  if (txn_) {
+    txn_->sendAbort();
+  } else {
+    detached_ = true;
+  }
+}
+
+void CoalescedFetch::setTransaction(HTTPTransaction* txn) noexcept {
+  txn_ = txn;
+}
+
+void CoalescedFetch::detachTransaction() noexcept {
+  FanoutGuard g(*this);
+  txn_ = nullptr;
+  detached_ = true;
+  setUnjoinable();
+  if (!eomReceived_ && !errored_) {
+    errored_ = true;
+    HTTPException ex(HTTPException::Direction::INGRESS,
+                     "Upstream transaction detached before EOM");
+    ex.setProxygenError(kErrorStreamAbort);
+    failAll(ex);
+  }
+}
+
+void CoalescedFetch::onHeadersComplete(unique_ptr<HTTPMessage> msg) noexcept {
+  if (msg->isResponse() && msg->getStatusCode() < 200) {
+    VLOG(4) << "Not forwarding non-final response key=" << key_;
+    return;
+  }
+  FanoutGuard g(*this);
+  response_ = std::move(msg);
+  // Subscribers joining from within a callback get the headers replayed
+  // in addSubscriber
+  auto n = subscribers_.size();
+  for (size_t i = 0; i < n; i++) {
+    if (subscribers_[i]) {
+      subscribers_[i]->subscriber->onCoalescedHeaders(*response_);
+    }
+  }
+}
+
+void CoalescedFetch::onBody(unique_ptr<IOBuf> chain) noexcept {
+  FanoutGuard g(*this);
+  setUnjoinable();
+  auto n = subscribers_.size();
+  for (size_t i = 0; i < n; i++) {
+    auto state = subscribers_[i].get();
+    if (!state) {
+      continue;
+    }
+    if (!state->paused && state->pendingBody.empty()) {
+      state->subscriber->onCoalescedBody(chain->clone());
+      continue;
+    }
+    state->pendingBody.append(chain->clone());
+    if (state->pendingBody.chainLength() > limits_.hardLimit) {
+      VLOG(3) << "Dropping slow subscriber buffered="
+              << state->pendingBody.chainLength() << " key=" << key_;
+      auto subscriber = state->subscriber;
+      eraseState(state);
+      HTTPException ex(HTTPException::Direction::EGRESS,
+                       "Coalesced subscriber exceeded buffer limit");
+      ex.setProxygenError(kErrorWriteTimeout);
+      subscriber->onCoalescedError(ex);
+    }
+  }
+  if (numSubscribers_ == 0 && !eomReceived_ && txn_) {
+    errored_ = true;
+    txn_->sendAbort();
+    return;
+  }
+  updateIngressState();
+}
+
+void CoalescedFetch::onTrailers(unique_ptr<HTTPHeaders> trailers) noexcept {
+  FanoutGuard g(*this);
+  auto n = subscribers_.size();
+  for (size_t i = 0; i < n; i++) {
+    auto state = subscribers_[i].get();
+    if (!state) {
+      continue;
+    }
+    auto copy = std::make_unique<HTTPHeaders>(*trailers);
+    if (!state->paused && state->pendingBody.empty()) {
+      state->subscriber->onCoalescedTrailers(std::move(copy));
+    } else {
+      state->pendingTrailers = std::move(copy);
+    }
+  }
+}
+
+void CoalescedFetch::onEOM() noexcept {
+  FanoutGuard g(*this);
+  eomReceived_ = true;
+  setUnjoinable();
+  auto n = subscribers_.size();
+  for (size_t i = 0; i < n; i++) {
+    auto state = subscribers_[i].get();
+    if (!state) {
+      continue;
+    }
+    state->pendingEOM = true;
+    flush(*state);
+  }
+}
+
+void CoalescedFetch::onUpgrade(UpgradeProtocol /*protocol*/) noexcept {
+  // isCoalescable() rejects upgrade requests
+  LOG(ERROR) << "Unexpected upgrade on coalesced fetch key=" << key_;
+}
+
+void CoalescedFetch::onError(const HTTPException& error) noexcept {
+  FanoutGuard g(*this);
+  if (errored_ || eomReceived_) {
+    return;
+  }
+  VLOG(4) << "Upstream error on coalesced fetch key=" << key_ << " err="
+          << error.what();
+  errored_ = true;
+  setUnjoinable();
+  failAll(error);
+}
+
+CoalescedFetch::SubscriberState* CoalescedFetch::findState(
+    Subscriber* subscriber) {
+  for (auto& state : subscribers_) {
+    if (state && state->subscriber == subscriber) {
+      return state.get();
+    }
+  }
+  return nullptr;
+}
+
+void CoalescedFetch::eraseState(SubscriberState* state) {
+  DCHECK_GT(guardDepth_, 0);
+  for (auto& s : subscribers_) {
+    if (s.get() == state) {
+      s.reset();
+      DCHECK_GT(numSubscribers_, 0);
+      numSubscribers_--;
+      return;
+    }
+  }
+}
+
+void CoalescedFetch::flush(SubscriberState& state) {
+  DCHECK_GT(guardDepth_, 0);
+  if (state.paused) {
+    return;
+  }
+  auto subscriber = state.subscriber;
+  if (!state.pendingBody.empty()) {
+    subscriber->onCoalescedBody(state.pendingBody.move());
+    // The callback may have removed or paused the subscriber
+    if (findState(subscriber) != &state || state.paused) {
+      return;
+    }
+  }
+  if (state.pendingTrailers) {
+    subscriber->onCoalescedTrailers(std::move(state.pendingTrailers));
+    if (findState(subscriber) != &state) {
+      return;
+    }
+  }
+  if (state.pendingEOM) {
+    eraseState(&state);
+    subscriber->onCoalescedEOM();
+  }
+}
+
+void CoalescedFetch::failAll(const HTTPException& error) {
+  DCHECK_GT(guardDepth_, 0);
+  auto n = subscribers_.size();
+  for (size_t i = 0; i < n; i++) {
+    auto state = subscribers_[i].get();
+    if (!state) {
+      continue;
+    }
+    auto subscriber = state->subscriber;
+    eraseState(state);
+    subscriber->onCoalescedError(error);
+  }
+}
+
+void CoalescedFetch::setUnjoinable() {
+  if (!joinable_) {
+    return;
+  }
+  joinable_ = false;
+  if (coalescer_) {
+    coalescer_->remove(key_, this);
+    coalescer_ = nullptr;
+  }
+}
+
+void CoalescedFetch::updateIngressState() {
+  if (!txn_ || eomReceived_ || errored_) {
+    return;
+  }
+  bool allBlocked = numSubscribers_ > 0;
+  for (const auto& state : subscribers_) {
+    if (state && !isBlocked(*state)) {
+      allBlocked = false;
+      break;
+    }
+  }
+  if (allBlocked && !ingressPaused_) {
+    VLOG(4) << "All subscribers blocked, pausing upstream key=" << key_;
+    ingressPaused_ = true;
+    txn_->pauseIngress();
+  } else if (!allBlocked && ingressPaused_) {
+    VLOG(4) << "Resuming upstream key=" << key_;
+    ingressPaused_ = false;
+    txn_->resumeIngress();
+  }
+}
+
+RequestCoalescer::RequestCoalescer(std::vector<std::string> keyHeaders,
+                                   CoalescedFetch::BufferLimits limits)
+    : keyHeaders_(std::move(keyHeaders)), limits_(limits) {
+}
+
+RequestCoalescer::~RequestCoalescer() {
+  for (auto& it : inflight_) {
+    it.second->coalescer_ = nullptr;
+    it.second->joinable_ = false;
+  }
+}
+
+bool RequestCoalescer::isCoalescable(const HTTPMessage& request) {
+  auto method = request.getMethod();
+  if (!method || (*method != HTTPMethod::GET && *method != HTTPMethod::HEAD)) {
+    return false;
+  }
+  const auto& headers = request.getHeaders();
+  if (headers.exists(HTTP_HEADER_TRANSFER_ENCODING) ||
+      headers.exists(HTTP_HEADER_UPGRADE)) {
+    return false;
+  }
+  // The response to a request with credentials may be personalized, so it
+  // must not be shared with other clients
+  if (headers.exists(HTTP_HEADER_AUTHORIZATION) ||
+      headers.exists(HTTP_HEADER_PROXY_AUTHORIZATION) ||
+      headers.exists(HTTP_HEADER_COOKIE)) {
+    return false;
+  }
+  if (request.checkForHeaderToken(
+          HTTP_HEADER_CACHE_CONTROL, "no-cache", false) ||
+      request.checkForHeaderToken(
+          HTTP_HEADER_CACHE_CONTROL, "no-store", false)) {
+    return false;
+  }
+  const auto& contentLength =
+      headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH);
+  return contentLength.empty() || contentLength == "0";
+}
+
+std::string RequestCoalescer::makeKey(const HTTPMessage& request) const {
+  const auto& headers = request.getHeaders();
+  auto key = folly::to<std::string>(request.getMethodString(),
+                                    ' ',
+                                    request.getScheme(),
+                                    "://",
+                                    headers.getSingleOrEmpty(HTTP_HEADER_HOST),
+                                    ' ',
+                                    request.getURL());
+  for (const auto& name : keyHeaders_) {
+    folly::toAppend('\n', name, ':', headers.combine(name), &key);
+  }
+  return key;
+}
+
+RequestCoalescer::SubscribeResult RequestCoalescer::subscribe(
+    const HTTPMessage& request, CoalescedFetch::Subscriber* subscriber) {
+  SubscribeResult result;
+  if (!isCoalescable(request)) {
+    return result;
+  }
+  auto key = makeKey(request);
+  auto it = inflight_.find(key);
+  if (it != inflight_.end() && it->second->addSubscriber(subscriber)) {
+    numCoalesced_++;
+    result.fetch = it->second;
+    return result;
+  }
+  auto fetch = new CoalescedFetch(this, key, limits_);
+  inflight_[std::move(key)] = fetch;
+  fetch->addSubscriber(subscriber);
+  result.fetch = fetch;
+  result.isNew = true;
+  return result;
+}
+
+void RequestCoalescer::remove(const std::string& key, CoalescedFetch* fetch) {
+  auto it = inflight_.find(key);
+  if (it != inflight_.end() && it->second == fetch) {
+    inflight_.erase(it);
+  }
+}
+
+} // namespace proxygen
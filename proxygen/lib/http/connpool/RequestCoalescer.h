@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/HTTPException.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+namespace proxygen {
+
+class RequestCoalescer;
+
+/**
+ * A CoalescedFetch is the HTTPTransaction::Handler for a single upstream
+ * request whose response is shared by any number of downstream
+ * subscribers. Headers are copied, body chunks are IOBuf clones of the
+ * upstream data (no byte copies) and trailers are copied once per
+ * subscriber.
+ *
+ * Each subscriber has its own egress buffer. A subscriber that calls
+ * pauseSubscriber() has body buffered for it until resumeSubscriber().
+ * Upstream ingress is paused only when every subscriber is over the soft
+ * buffer limit, so one slow reader does not stall the others. A subscriber
+ * that exceeds the hard limit is dropped with an error.
+ *
+ * A fetch accepts new subscribers until the first body byte is delivered
+ * (response headers are kept so they can be replayed). After that the
+ * fetch is removed from its RequestCoalescer and identical requests start a
+ * new upstream fetch.
+ *
+ * Instances manage their own lifetime: the fetch is destroyed after the
+ * upstream transaction detaches (or after abort() if no transaction was
+ * ever attached).
+ */
+class CoalescedFetch : public HTTPTransaction::Handler {
+ public:
+  class Subscriber {
+   public:
+    virtual ~Subscriber() = default;
+
+    virtual void onCoalescedHeaders(const HTTPMessage& msg) noexcept = 0;
+    virtual void onCoalescedBody(
+        std::unique_ptr<folly::IOBuf> chain) noexcept = 0;
+    virtual void onCoalescedTrailers(
+        std::unique_ptr<HTTPHeaders> trailers) noexcept = 0;
+    virtual void onCoalescedEOM() noexcept = 0;
+    /**
+     * Terminal callback. The subscriber is removed from the fetch before
+     * this is invoked.
+     */
+    virtual void onCoalescedError(const HTTPException& error) noexcept = 0;
+  };
+
+  struct BufferLimits {
+    // Past this many buffered bytes a subscriber counts as blocked
+    uint64_t softLimit{64 * 1024};
+    // Past this many buffered bytes a subscriber is dropped
+    uint64_t hardLimit{1024 * 1024};
+  };
+
+  /**
+   * Attach a subscriber. Returns false if the fetch no longer accepts
+   * subscribers. Headers already received are replayed synchronously.
+   */
+  bool addSubscriber(Subscriber* subscriber);
+
+  /**
+   * Detach a subscriber without delivering any further callbacks. If the
+   * last subscriber leaves before the response completes, the upstream
+   * transaction is aborted.
+   */
+  void removeSubscriber(Subscriber* subscriber);
+
+  /**
+   * Flow control signals from the downstream side of a subscriber,
+   * typically forwarded from onEgressPaused/onEgressResumed.
+   */
+  void pauseSubscriber(Subscriber* subscriber);
+  void resumeSubscriber(Subscriber* subscriber);
+
+  /**
+   * Fail the fetch, eg: if the upstream transaction could not be created.
+   * All subscribers receive onCoalescedError.
+   */
+  void abort(const HTTPException& error);
+
+  bool isJoinable() const {
+    return joinable_;
+  }
+
+  size_t getNumSubscribers() const {
+    return numSubscribers_;
+  }
+
+  HTTPTransaction* getTransaction() const {
+    return txn_;
+  }
+
+  // HTTPTransaction::Handler methods
+  void setTransaction(HTTPTransaction* txn) noexcept override;
+  void detachTransaction() noexcept override;
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override;
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+  void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override;
+  void onEOM() noexcept override;
+  void onUpgrade(UpgradeProtocol protocol) noexcept override;
+  void onError(const HTTPException& error) noexcept override;
+  // The upstream request has no body, egress flow control is irrelevant
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  friend class RequestCoalescer;
+
+  struct SubscriberState {
+    explicit SubscriberState(Subscriber* s) : subscriber(s) {
+    }
+
+    Subscriber* subscriber;
+    folly::IOBufQueue pendingBody{folly::IOBufQueue::cacheChainLength()};
+    std::unique_ptr<HTTPHeaders> pendingTrailers;
+    bool paused{false};
+    bool pendingEOM{false};
+  };
+
+  // Keeps the fetch alive while fanning out callbacks and performs
+  // deferred cleanup once the outermost callback returns.
+  class FanoutGuard {
+   public:
+    explicit FanoutGuard(CoalescedFetch& fetch);
+    ~FanoutGuard();
+
+   private:
+    CoalescedFetch& fetch_;
+  };
+
+  CoalescedFetch(RequestCoalescer* coalescer,
+                 std::string key,
+                 BufferLimits limits);
+  ~CoalescedFetch() override;
+
+  SubscriberState* findState(Subscriber* subscriber);
+  void eraseState(SubscriberState* state);
+  void flush(SubscriberState& state);
+  void failAll(const HTTPException& error);
+  void setUnjoinable();
+  void updateIngressState();
+  bool isBlocked(const SubscriberState& state) const {
+    return state.pendingBody.chainLength() >= limits_.softLimit;
+  }
+
+  RequestCoalescer* coalescer_;
+  std::string key_;
+  BufferLimits limits_;
+  HTTPTransaction* txn_{nullptr};
+  std::unique_ptr<HTTPMessage> response_;
+  // Entries are nulled out while callbacks are in progress and compacted
+  // once the outermost FanoutGuard is released.
+  std::vector<std::unique_ptr<SubscriberState>> subscribers_;
+  size_t numSubscribers_{0};
+  uint32_t guardDepth_{0};
+  bool joinable_ : 1;
+  bool eomReceived_ : 1;
+  bool errored_ : 1;
+  bool ingressPaused_ : 1;
+  bool detached_ : 1;
+};
+
+/**
+ * RequestCoalescer implements collapsed forwarding: identical in-flight
+ * upstream requests share a single upstream HTTPTransaction. Requests are
+ * identified by method, scheme, host, URL and a configurable set of request
+ * headers the upstream response may vary on (eg: Accept-Encoding).
+ *
+ * Typical usage from a proxy handler:
+ *
+ *   auto res = coalescer.subscribe(request, this);
+ *   if (res.fetch && res.isNew) {
+ *     auto txn = session->newTransaction(res.fetch);
+ *     if (!txn) {
+ *       res.fetch->abort(...);
+ *     } else {
+ *       txn->sendHeadersWithEOM(request);
+ *     }
+ *   }
+ *
+ * Like SessionPool it may only be used from a single thread. Fetches that
+ * are still in flight when the coalescer is destroyed keep running but can
+ * no longer be joined.
+ */
+class RequestCoalescer {
+ public:
+  struct SubscribeResult {
+    // nullptr if the request is not eligible for coalescing
+    CoalescedFetch* fetch{nullptr};
+    // true if the caller must start the upstream transaction
+    bool isNew{false};
+  };
+
+  explicit RequestCoalescer(std::vector<std::string> keyHeaders = {},
+                            CoalescedFetch::BufferLimits limits = {});
+  ~RequestCoalescer();
+
+  RequestCoalescer(const RequestCoalescer&) = delete;
+  RequestCoalescer& operator=(const RequestCoalescer&) = delete;
+
+  /**
+   * Only GET and HEAD requests without a body are coalesced.  Requests with
+   * credentials (Authorization, Proxy-Authorization or Cookie) or with
+   * Cache-Control no-cache or no-store always get their own fetch.
+   */
+  static bool isCoalescable(const HTTPMessage& request);
+
+  std::string makeKey(const HTTPMessage& request) const;
+
+  /**
+   * Subscribe to the in-flight fetch for this request, creating one if
+   * needed. When a new fetch is created the caller owns starting the
+   * upstream transaction with the fetch as its handler.
+   */
+  SubscribeResult subscribe(const HTTPMessage& request,
+                            CoalescedFetch::Subscriber* subscriber);
+
+  size_t getNumInflight() const {
+    return inflight_.size();
+  }
+
+  // Number of subscribe() calls that joined an existing fetch
+  uint64_t getNumCoalesced() const {
+    return numCoalesced_;
+  }
+
+ private:
+  friend class CoalescedFetch;
+
+  void remove(const std::string& key, CoalescedFetch* fetch);
+
+  std::vector<std::string> keyHeaders_;
+  CoalescedFetch::BufferLimits limits_;
+  folly::F14FastMap<std::string, CoalescedFetch*> inflight_;
+  uint64_t numCoalesced_{0};
+};
+
+} // namespace proxygen
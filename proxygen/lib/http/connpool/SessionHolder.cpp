@@ -156,6 +156,12 @@ void SessionHolder::onCreate(const HTTPSessionBase&) {
   LOG(FATAL) << "onCreate() should not be reachable.";
 }
 
+void SessionHolder::onFullHandshakeCompletion(const HTTPSessionBase& session) {
+  if (originalSessionInfoCb_) {
+    originalSessionInfoCb_->onFullHandshakeCompletion(session);
+  }
+}
+
 void SessionHolder::onIngressError(const HTTPSessionBase& session,
                                    ProxygenError error) {
   if (originalSessionInfoCb_) {
@@ -114,6 +114,7 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
 
   // HTTPSession::InfoCallback
   void onCreate(const HTTPSessionBase&) override;
+  void onFullHandshakeCompletion(const HTTPSessionBase&) override;
   void onIngressError(const HTTPSessionBase&, ProxygenError) override;
   void onIngressEOF() override {
   }
@@ -0,0 +1,777 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/HTTPClient.h>
+
+#include <fizz/protocol/DefaultCertificateVerifier.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/codec/test/MockHTTPCodec.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+/**
+ * The session's codec callback is saved in callback, and the ID of each
+ * stream it creates in lastStream. requestsSent counts the headers it
+ * generates.
+ */
+std::unique_ptr<NiceMock<MockHTTPCodec>> makeCodec(
+    bool parallel,
+    HTTPCodec::Callback** callback,
+    HTTPCodec::StreamID* lastStream,
+    uint32_t* requestsSent) {
+  // Odd, like any upstream HTTP/2 stream
+  static HTTPCodec::StreamID nextStream = 1;
+  auto codec = std::make_unique<NiceMock<MockHTTPCodec>>();
+  EXPECT_CALL(*codec, getTransportDirection())
+      .WillRepeatedly(Return(TransportDirection::UPSTREAM));
+  EXPECT_CALL(*codec, setCallback(_)).WillRepeatedly(SaveArg<0>(callback));
+  EXPECT_CALL(*codec, createStream())
+      .WillRepeatedly(InvokeWithoutArgs([lastStream] {
+        *lastStream = nextStream;
+        nextStream += 2;
+        return *lastStream;
+      }));
+  EXPECT_CALL(*codec, generateHeader(_, _, _, _, _, _))
+      .WillRepeatedly(InvokeWithoutArgs([requestsSent] { (*requestsSent)++; }));
+  EXPECT_CALL(*codec, isReusable()).WillRepeatedly(Return(true));
+  EXPECT_CALL(*codec, supportsParallelRequests())
+      .WillRepeatedly(Return(parallel));
+  EXPECT_CALL(*codec, getProtocol())
+      .WillRepeatedly(
+          Return(parallel ? CodecProtocol::HTTP_2 : CodecProtocol::HTTP_1_1));
+  EXPECT_CALL(*codec, generateRstStream(_, _, _)).WillRepeatedly(Return(1));
+  return codec;
+}
+
+/**
+ * A transport whose handshake completes when the test says so, as with
+ * TLS or QUIC early data.
+ */
+class EarlyDataTransport : public TestAsyncTransport {
+ public:
+  EarlyDataTransport(folly::EventBase* evb, bool replaySafe)
+      : TestAsyncTransport(evb), replaySafe_(replaySafe) {
+  }
+
+  bool isReplaySafe() const override {
+    return replaySafe_;
+  }
+
+  void setReplaySafetyCallback(ReplaySafetyCallback* callback) override {
+    replaySafetyCallback_ = callback;
+  }
+
+  void completeHandshake() {
+    replaySafe_ = true;
+    if (replaySafetyCallback_) {
+      replaySafetyCallback_->onReplaySafe();
+    }
+  }
+
+ private:
+  bool replaySafe_;
+  ReplaySafetyCallback* replaySafetyCallback_{nullptr};
+};
+
+// An Alt-Svc cache on a clock the test moves
+class TestAltSvcCache : public SynchronizedLruAltSvcCache {
+ public:
+  TestAltSvcCache() : SynchronizedLruAltSvcCache(10) {
+  }
+
+  void advance(std::chrono::seconds delta) {
+    now_ += delta;
+  }
+
+  // Consecutive failures recorded for the protocol, even past the backoff
+  uint32_t getFailures(const std::string& origin,
+                       folly::StringPiece protocolId) {
+    auto record = getRecord(origin);
+    if (record) {
+      for (const auto& broken : record->broken) {
+        if (broken.protocolId == protocolId) {
+          return broken.failures;
+        }
+      }
+    }
+    return 0;
+  }
+
+ protected:
+  std::chrono::system_clock::time_point now() const override {
+    return now_;
+  }
+
+ private:
+  std::chrono::system_clock::time_point now_{std::chrono::seconds(1000000)};
+};
+
+class TestHandler : public HTTPTransactionHandler {
+ public:
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void detachTransaction() noexcept override {
+    txn_ = nullptr;
+  }
+  void onHeadersComplete(std::unique_ptr<HTTPMessage>) noexcept override {
+  }
+  void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {
+  }
+  void onEOM() noexcept override {
+  }
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+  void onError(const HTTPException&) noexcept override {
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+  HTTPTransaction* txn_{nullptr};
+};
+
+class MockTransactionCallback : public HTTPClient::TransactionCallback {
+ public:
+  MOCK_METHOD(void, transactionReady, (HTTPTransaction*), (noexcept));
+  MOCK_METHOD(void, transactionError, (const HTTPException&), (noexcept));
+};
+
+/**
+ * Connects complete when the test says so, with sessions over test
+ * transports.
+ */
+class TestHTTPClient : public HTTPClient {
+ public:
+  TestHTTPClient(folly::EventBase* evb,
+                 folly::HHWheelTimer* timeouts,
+                 Options options)
+      : HTTPClient(evb, std::move(options)), timeouts_(timeouts) {
+  }
+
+  void completeConnect(bool parallel) {
+    ASSERT_FALSE(connects.empty());
+    auto connect = connects.front();
+    connects.pop_front();
+    onConnectSuccess(connect.first, makeSession(parallel), connect.second);
+  }
+
+  void failConnect() {
+    ASSERT_FALSE(connects.empty());
+    auto connect = connects.front();
+    connects.pop_front();
+    HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS, "test");
+    ex.setProxygenError(kErrorConnect);
+    onConnectError(connect.first, ex, connect.second);
+  }
+
+  // Answer the last request sent on the newest session
+  void respond(uint16_t statusCode) {
+    respond(lastStream, statusCode);
+  }
+
+  void respond(HTTPCodec::StreamID stream, uint16_t statusCode) {
+    codecCallback->onHeadersComplete(stream, makeResponse(statusCode));
+    codecCallback->onMessageComplete(stream, false);
+  }
+
+  const Options& options() const {
+    return getOptions();
+  }
+
+  std::deque<std::pair<Endpoint, bool>> connects;
+  // The newest session's codec callback, and the last stream it opened
+  HTTPCodec::Callback* codecCallback{nullptr};
+  HTTPCodec::StreamID lastStream{0};
+  // Requests sent on any session
+  uint32_t requestsSent{0};
+  // The newest session and its transport
+  HTTPUpstreamSession* session{nullptr};
+  EarlyDataTransport* transport{nullptr};
+  // New sessions start in 0-RTT, before their handshake completes
+  bool earlyData{false};
+  // Start real QUIC connects rather than recording them
+  bool quicConnects{false};
+
+ protected:
+  void connect(const Endpoint& origin, bool http3) override {
+    if (http3 && quicConnects) {
+      HTTPClient::connect(origin, http3);
+      return;
+    }
+    connects.emplace_back(origin, http3);
+  }
+
+ private:
+  HTTPUpstreamSession* makeSession(bool parallel) {
+    wangle::TransportInfo tinfo;
+    tinfo.acceptTime = getCurrentTime();
+    transport = new EarlyDataTransport(getEventBase(), !earlyData);
+    session = new HTTPUpstreamSession(
+        timeouts_,
+        folly::AsyncTransport::UniquePtr(transport),
+        folly::SocketAddress("127.0.0.1", 80),
+        folly::SocketAddress("127.0.0.1", 12345),
+        makeCodec(parallel, &codecCallback, &lastStream, &requestsSent),
+        tinfo,
+        nullptr);
+    return session;
+  }
+
+  // Outlives the client, whose pools drain sessions when it is destroyed
+  folly::HHWheelTimer* timeouts_;
+};
+
+} // namespace
+
+class HTTPClientTest : public testing::Test {
+ public:
+  void SetUp() override {
+    folly::EventBaseManager::get()->setEventBase(&evb_, false);
+    client_ = std::make_unique<TestHTTPClient>(
+        &evb_, timeouts_.get(), HTTPClient::Options());
+  }
+
+  void TearDown() override {
+    client_.reset();
+    evb_.loop();
+    folly::EventBaseManager::get()->clearEventBase();
+  }
+
+ protected:
+  folly::EventBase evb_;
+  folly::HHWheelTimer::UniquePtr timeouts_{
+      folly::HHWheelTimer::newTimer(&evb_)};
+  std::unique_ptr<TestHTTPClient> client_;
+  const Endpoint origin_{"example.com", 443, true};
+};
+
+TEST_F(HTTPClientTest, ParallelSessionReused) {
+  TestHandler handlers[3];
+  StrictMock<MockTransactionCallback> callbacks[3];
+  client_->getTransaction(origin_, &handlers[0], &callbacks[0]);
+  client_->getTransaction(origin_, &handlers[1], &callbacks[1]);
+  // One connection serves both
+  EXPECT_EQ(client_->connects.size(), 1);
+
+  EXPECT_CALL(callbacks[0], transactionReady(_));
+  EXPECT_CALL(callbacks[1], transactionReady(_));
+  client_->completeConnect(true);
+  EXPECT_NE(handlers[0].txn_, nullptr);
+  EXPECT_NE(handlers[1].txn_, nullptr);
+  EXPECT_EQ(client_->getNumSessions(origin_), 1);
+
+  EXPECT_CALL(callbacks[2], transactionReady(_));
+  client_->getTransaction(origin_, &handlers[2], &callbacks[2]);
+  EXPECT_TRUE(client_->connects.empty());
+  EXPECT_EQ(client_->getStats().sessionsReused, 1);
+  EXPECT_EQ(client_->getStats().connectsStarted, 1);
+
+  for (auto& handler : handlers) {
+    handler.txn_->sendAbort();
+  }
+  evb_.loop();
+}
+
+TEST_F(HTTPClientTest, SerialSessionsScaleOut) {
+  TestHandler handlers[3];
+  NiceMock<MockTransactionCallback> callbacks[3];
+  for (int i = 0; i < 3; i++) {
+    client_->getTransaction(origin_, &handlers[i], &callbacks[i]);
+  }
+  // The protocol is unknown, so only one connect to start
+  EXPECT_EQ(client_->connects.size(), 1);
+
+  // HTTP/1.1 takes one request; the others need their own connections
+  client_->completeConnect(false);
+  EXPECT_NE(handlers[0].txn_, nullptr);
+  EXPECT_EQ(handlers[1].txn_, nullptr);
+  EXPECT_EQ(client_->connects.size(), 2);
+
+  client_->completeConnect(false);
+  client_->completeConnect(false);
+  for (auto& handler : handlers) {
+    ASSERT_NE(handler.txn_, nullptr);
+    handler.txn_->sendAbort();
+  }
+  EXPECT_EQ(client_->getStats().connectsStarted, 3);
+  evb_.loop();
+}
+
+TEST_F(HTTPClientTest, ConnectErrorFailsWaiters) {
+  TestHandler handlers[2];
+  StrictMock<MockTransactionCallback> callbacks[2];
+  client_->getTransaction(origin_, &handlers[0], &callbacks[0]);
+  client_->getTransaction(origin_, &handlers[1], &callbacks[1]);
+
+  EXPECT_CALL(callbacks[0], transactionError(_))
+      .WillOnce(Invoke([](const HTTPException& ex) {
+        EXPECT_EQ(ex.getProxygenError(), kErrorConnect);
+      }));
+  EXPECT_CALL(callbacks[1], transactionError(_));
+  client_->failConnect();
+  EXPECT_EQ(client_->getStats().connectErrors, 1);
+  EXPECT_TRUE(client_->connects.empty());
+}
+
+TEST_F(HTTPClientTest, CancelGetTransaction) {
+  TestHandler handler;
+  StrictMock<MockTransactionCallback> callback;
+  client_->getTransaction(origin_, &handler, &callback);
+  client_->cancelGetTransaction(&callback);
+
+  // The session is pooled for later
+  client_->completeConnect(true);
+  EXPECT_EQ(handler.txn_, nullptr);
+  EXPECT_EQ(client_->getNumSessions(origin_), 1);
+}
+
+TEST_F(HTTPClientTest, DefaultSSLContextVerifiesPeer) {
+  EXPECT_TRUE(client_->options().sslContext->needsPeerVerification());
+
+  // A caller's context is used as given
+  HTTPClient::Options options;
+  options.sslContext = std::make_shared<folly::SSLContext>();
+  options.sslContext->setVerificationOption(
+      folly::SSLContext::SSLVerifyPeerEnum::NO_VERIFY);
+  client_ = std::make_unique<TestHTTPClient>(
+      &evb_, timeouts_.get(), std::move(options));
+  EXPECT_FALSE(client_->options().sslContext->needsPeerVerification());
+}
+
+TEST_F(HTTPClientTest, DestroyFailsWaiters) {
+  TestHandler handler;
+  StrictMock<MockTransactionCallback> callback;
+  client_->getTransaction(origin_, &handler, &callback);
+  EXPECT_CALL(callback, transactionError(_))
+      .WillOnce(Invoke([](const HTTPException& ex) {
+        EXPECT_EQ(ex.getProxygenError(), kErrorShutdown);
+      }));
+  client_.reset();
+}
+
+TEST_F(HTTPClientTest, HTTP3FallsBackToTCP) {
+  HTTPClient::Options options;
+  options.enableHTTP3 = true;
+  options.fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+  options.certVerifier = std::make_shared<fizz::DefaultCertificateVerifier>(
+      fizz::VerificationContext::Client);
+  client_ = std::make_unique<TestHTTPClient>(
+      &evb_, timeouts_.get(), std::move(options));
+
+  TestHandler handler;
+  StrictMock<MockTransactionCallback> callback;
+  client_->getTransaction(origin_, &handler, &callback);
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_TRUE(client_->connects.front().second);
+
+  // No error for the request, just a TCP connect
+  client_->failConnect();
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_FALSE(client_->connects.front().second);
+
+  EXPECT_CALL(callback, transactionReady(_));
+  client_->completeConnect(true);
+  handler.txn_->sendAbort();
+  evb_.loop();
+}
+
+TEST_F(HTTPClientTest, DestroyDuringHTTP3Connect) {
+  HTTPClient::Options options;
+  options.enableHTTP3 = true;
+  options.fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+  options.certVerifier = std::make_shared<fizz::DefaultCertificateVerifier>(
+      fizz::VerificationContext::Client);
+  // Nothing answers there, so the handshake is still going
+  options.resolver = [](const Endpoint&) {
+    return folly::SocketAddress("127.0.0.1", 1);
+  };
+  client_ = std::make_unique<TestHTTPClient>(
+      &evb_, timeouts_.get(), std::move(options));
+  client_->quicConnects = true;
+
+  TestHandler handler;
+  StrictMock<MockTransactionCallback> callback;
+  client_->getTransaction(origin_, &handler, &callback);
+  EXPECT_TRUE(client_->connects.empty());
+  EXPECT_EQ(client_->getStats().connectsStarted, 1);
+  EXPECT_EQ(client_->getStats().connectErrors, 0);
+
+  // Cancelling the QUIC connect reports no connect error, so nothing falls
+  // back to TCP; the request only learns the client is gone
+  EXPECT_CALL(callback, transactionError(_))
+      .WillOnce(Invoke([](const HTTPException& ex) {
+        EXPECT_EQ(ex.getProxygenError(), kErrorShutdown);
+      }));
+  client_.reset();
+}
+
+TEST_F(HTTPClientTest, AltSvcSelectsHTTP3) {
+  auto cache = std::make_shared<SynchronizedLruAltSvcCache>(10);
+  HTTPClient::Options options;
+  options.enableHTTP3 = true;
+  options.fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+  options.certVerifier = std::make_shared<fizz::DefaultCertificateVerifier>(
+      fizz::VerificationContext::Client);
+  options.altSvcCache = cache;
+  options.http3RaceDelay = std::chrono::milliseconds(10);
+  client_ = std::make_unique<TestHTTPClient>(
+      &evb_, timeouts_.get(), std::move(options));
+
+  // Nothing advertised yet, so TCP
+  TestHandler handler;
+  StrictMock<MockTransactionCallback> callback;
+  client_->getTransaction(origin_, &handler, &callback);
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_FALSE(client_->connects.front().second);
+  EXPECT_CALL(callback, transactionReady(_));
+  client_->completeConnect(false);
+
+  HTTPMessage response;
+  response.setStatusCode(200);
+  response.getHeaders().add(HTTP_HEADER_ALT_SVC, R"(h3=":443")");
+  client_->processAltSvc(origin_, response);
+  EXPECT_TRUE(cache->getAlternative("https://example.com:443", "h3"));
+
+  // The serial session is busy, so the next request connects over QUIC,
+  // and races TCP when that is slow
+  TestHandler handler2;
+  StrictMock<MockTransactionCallback> callback2;
+  client_->getTransaction(origin_, &handler2, &callback2);
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_TRUE(client_->connects.front().second);
+  while (client_->connects.size() < 2) {
+    evb_.loopOnce();
+  }
+  EXPECT_FALSE(client_->connects.back().second);
+
+  // QUIC failing marks h3 broken; the TCP connect serves the request
+  client_->failConnect();
+  EXPECT_TRUE(cache->isBroken("https://example.com:443", "h3"));
+  EXPECT_CALL(callback2, transactionReady(_));
+  client_->completeConnect(false);
+  EXPECT_TRUE(client_->connects.empty());
+
+  handler.txn_->sendAbort();
+  handler2.txn_->sendAbort();
+  evb_.loop();
+}
+
+TEST_F(HTTPClientTest, AltSvcWorkingAfterHandshake) {
+  auto cache = std::make_shared<TestAltSvcCache>();
+  auto key = AltSvcCache::originKey("example.com", 443);
+  cache->processAltSvc(key, R"(h3=":443")");
+  // An old failure whose backoff has run out
+  cache->markBroken(key, "h3");
+  cache->advance(std::chrono::hours(1));
+  HTTPClient::Options options;
+  options.enableHTTP3 = true;
+  options.fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+  options.certVerifier = std::make_shared<fizz::DefaultCertificateVerifier>(
+      fizz::VerificationContext::Client);
+  options.altSvcCache = cache;
+  client_ = std::make_unique<TestHTTPClient>(
+      &evb_, timeouts_.get(), std::move(options));
+  client_->earlyData = true;
+
+  TestHandler handler;
+  StrictMock<MockTransactionCallback> callback;
+  client_->getTransaction(origin_, &handler, &callback);
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_TRUE(client_->connects.front().second);
+
+  // Usable in 0-RTT, but h3 has not been shown to work yet
+  EXPECT_CALL(callback, transactionReady(_));
+  client_->completeConnect(true);
+  EXPECT_EQ(cache->getFailures(key, "h3"), 1);
+
+  client_->transport->completeHandshake();
+  EXPECT_EQ(cache->getFailures(key, "h3"), 0);
+
+  handler.txn_->sendAbort();
+  evb_.loop();
+}
+
+TEST_F(HTTPClientTest, AltSvcBrokenWhenHandshakeFails) {
+  auto cache = std::make_shared<TestAltSvcCache>();
+  auto key = AltSvcCache::originKey("example.com", 443);
+  cache->processAltSvc(key, R"(h3=":443")");
+  HTTPClient::Options options;
+  options.enableHTTP3 = true;
+  options.fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+  options.certVerifier = std::make_shared<fizz::DefaultCertificateVerifier>(
+      fizz::VerificationContext::Client);
+  options.altSvcCache = cache;
+  client_ = std::make_unique<TestHTTPClient>(
+      &evb_, timeouts_.get(), std::move(options));
+  client_->earlyData = true;
+
+  TestHandler handler;
+  StrictMock<MockTransactionCallback> callback;
+  client_->getTransaction(origin_, &handler, &callback);
+  EXPECT_CALL(callback, transactionReady(_));
+  client_->completeConnect(true);
+  EXPECT_FALSE(cache->isBroken(key, "h3"));
+
+  // The handshake fails after 0-RTT was accepted locally
+  client_->session->dropConnection();
+  evb_.loop();
+  EXPECT_EQ(handler.txn_, nullptr);
+  EXPECT_TRUE(cache->isBroken(key, "h3"));
+
+  // So the next connection is over TCP
+  TestHandler handler2;
+  StrictMock<MockTransactionCallback> callback2;
+  client_->getTransaction(origin_, &handler2, &callback2);
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_FALSE(client_->connects.front().second);
+  EXPECT_CALL(callback2, transactionReady(_));
+  client_->completeConnect(true);
+  handler2.txn_->sendAbort();
+  evb_.loop();
+}
+
+TEST_F(HTTPClientTest, FetchInvalidURL) {
+  auto future = client_->get("not a url");
+  ASSERT_TRUE(future.isReady());
+  EXPECT_TRUE(future.hasException());
+}
+
+namespace {
+
+HTTPException makeError(ProxygenError error) {
+  HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS, "test");
+  ex.setProxygenError(error);
+  return ex;
+}
+
+HTTPMessage makeRequest(HTTPMethod method) {
+  HTTPMessage request;
+  request.setMethod(method);
+  return request;
+}
+
+} // namespace
+
+TEST_F(HTTPClientTest, FetchRetriesRefusedRequestOnNewConnection) {
+  auto future = client_->fetch(URL("https://example.com/upload"),
+                               makeRequest(HTTPMethod::POST),
+                               folly::IOBuf::copyBuffer("body"));
+  client_->completeConnect(true);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  auto refused = client_->lastStream;
+
+  // The server did not process it, so even a POST is sent again, on a new
+  // connection since this one is going away
+  client_->codecCallback->onGoaway(0, ErrorCode::NO_ERROR);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_FALSE(future.isReady());
+  ASSERT_EQ(client_->connects.size(), 1);
+  client_->completeConnect(true);
+  EXPECT_NE(client_->lastStream, refused);
+
+  client_->respond(200);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.isReady());
+  ASSERT_TRUE(future.hasValue());
+  EXPECT_EQ(future.value().message->getStatusCode(), 200);
+  EXPECT_EQ(client_->getStats().retries, 1);
+  EXPECT_EQ(client_->getStats().connectsStarted, 2);
+}
+
+TEST_F(HTTPClientTest, FetchRetriesIdempotentRequest) {
+  auto future = client_->get("https://example.com/");
+  client_->completeConnect(true);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+
+  // The pooled session is still usable, so the retry goes out on it
+  client_->codecCallback->onError(
+      client_->lastStream, makeError(kErrorConnectionReset), false);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_FALSE(future.isReady());
+  EXPECT_TRUE(client_->connects.empty());
+
+  client_->respond(200);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.hasValue());
+  EXPECT_EQ(future.value().message->getStatusCode(), 200);
+  EXPECT_EQ(client_->getStats().retries, 1);
+  EXPECT_EQ(client_->getStats().sessionsReused, 1);
+}
+
+TEST_F(HTTPClientTest, FetchRetriesAreBounded) {
+  // maxRetries is 1 by default
+  auto future = client_->get("https://example.com/");
+  client_->completeConnect(true);
+  for (int i = 0; i < 2; i++) {
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+    ASSERT_FALSE(future.isReady());
+    client_->codecCallback->onError(
+        client_->lastStream, makeError(kErrorConnectionReset), false);
+  }
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.hasException());
+  auto ex = future.result().exception().get_exception<HTTPException>();
+  ASSERT_NE(ex, nullptr);
+  EXPECT_EQ(ex->getProxygenError(), kErrorConnectionReset);
+  EXPECT_EQ(client_->getStats().retries, 1);
+}
+
+TEST_F(HTTPClientTest, FetchDoesNotRetryUnsafeRequest) {
+  // The server may have processed the POST before the connection broke
+  auto future = client_->fetch(URL("https://example.com/upload"),
+                               makeRequest(HTTPMethod::POST),
+                               folly::IOBuf::copyBuffer("body"));
+  client_->completeConnect(true);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  client_->codecCallback->onError(
+      client_->lastStream, makeError(kErrorConnectionReset), false);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.hasException());
+  EXPECT_EQ(client_->getStats().retries, 0);
+
+  // Nor is an error that says nothing about whether it was processed
+  auto future2 = client_->get("https://example.com/");
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  client_->codecCallback->onError(
+      client_->lastStream, makeError(kErrorTimeout), false);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future2.hasException());
+  EXPECT_EQ(client_->getStats().retries, 0);
+}
+
+TEST_F(HTTPClientTest, FetchFallsBackToTCP) {
+  HTTPClient::Options options;
+  options.enableHTTP3 = true;
+  options.fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+  options.certVerifier = std::make_shared<fizz::DefaultCertificateVerifier>(
+      fizz::VerificationContext::Client);
+  client_ = std::make_unique<TestHTTPClient>(
+      &evb_, timeouts_.get(), std::move(options));
+
+  auto future = client_->get("https://example.com/");
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_TRUE(client_->connects.front().second);
+  client_->failConnect();
+  ASSERT_EQ(client_->connects.size(), 1);
+  EXPECT_FALSE(client_->connects.front().second);
+  EXPECT_FALSE(future.isReady());
+
+  client_->completeConnect(true);
+  client_->respond(200);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.hasValue());
+  EXPECT_EQ(future.value().message->getStatusCode(), 200);
+  EXPECT_EQ(client_->getStats().connectErrors, 1);
+  // Falling back is not a retry of the request
+  EXPECT_EQ(client_->getStats().retries, 0);
+
+  // The next request is served by the TCP session
+  auto future2 = client_->get("https://example.com/");
+  EXPECT_TRUE(client_->connects.empty());
+  client_->respond(204);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future2.hasValue());
+  EXPECT_EQ(future2.value().message->getStatusCode(), 204);
+}
+
+TEST_F(HTTPClientTest, FetchHoldsUnsafeRequestUntilHandshake) {
+  client_->earlyData = true;
+  auto post = client_->fetch(URL("https://example.com/upload"),
+                             makeRequest(HTTPMethod::POST),
+                             folly::IOBuf::copyBuffer("body"));
+  client_->completeConnect(true);
+  auto postStream = client_->lastStream;
+  // A replayed POST could be processed twice
+  EXPECT_EQ(client_->requestsSent, 0);
+
+  // A GET goes out in 0-RTT
+  auto get = client_->get("https://example.com/");
+  EXPECT_EQ(client_->requestsSent, 1);
+  client_->respond(200);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(get.hasValue());
+  EXPECT_FALSE(post.isReady());
+
+  client_->transport->completeHandshake();
+  EXPECT_EQ(client_->requestsSent, 2);
+  client_->respond(postStream, 201);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(post.hasValue());
+  EXPECT_EQ(post.value().message->getStatusCode(), 201);
+  EXPECT_EQ(client_->getStats().retries, 0);
+}
+
+TEST_F(HTTPClientTest, FetchRetriesTooEarlyAfterHandshake) {
+  client_->earlyData = true;
+  auto future = client_->get("https://example.com/");
+  client_->completeConnect(true);
+  EXPECT_EQ(client_->requestsSent, 1);
+
+  // The server would not process it in 0-RTT, so it waits for the handshake
+  client_->respond(425);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_FALSE(future.isReady());
+  EXPECT_EQ(client_->requestsSent, 1);
+  EXPECT_TRUE(client_->connects.empty());
+
+  client_->transport->completeHandshake();
+  EXPECT_EQ(client_->requestsSent, 2);
+  client_->respond(200);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.hasValue());
+  EXPECT_EQ(future.value().message->getStatusCode(), 200);
+  EXPECT_EQ(client_->getStats().retries, 1);
+}
+
+TEST_F(HTTPClientTest, FetchPassesOnTooEarlyAfterHandshake) {
+  // Sent after the handshake, so a 425 is the server's final answer
+  auto future = client_->get("https://example.com/");
+  client_->completeConnect(true);
+  client_->respond(425);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.hasValue());
+  EXPECT_EQ(future.value().message->getStatusCode(), 425);
+  EXPECT_EQ(client_->getStats().retries, 0);
+}
+
+TEST_F(HTTPClientTest, FetchRetriesHeldRequestWhenHandshakeFails) {
+  client_->earlyData = true;
+  auto future = client_->fetch(URL("https://example.com/upload"),
+                               makeRequest(HTTPMethod::POST),
+                               folly::IOBuf::copyBuffer("body"));
+  client_->completeConnect(true);
+  EXPECT_EQ(client_->requestsSent, 0);
+
+  // Connected for 0-RTT, but the handshake then fails. The POST was never
+  // sent, so it is safe to send on a new connection.
+  client_->session->dropConnection();
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_FALSE(future.isReady());
+  ASSERT_EQ(client_->connects.size(), 1);
+
+  client_->earlyData = false;
+  client_->completeConnect(true);
+  EXPECT_EQ(client_->requestsSent, 1);
+  client_->respond(200);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(future.hasValue());
+  EXPECT_EQ(future.value().message->getStatusCode(), 200);
+  EXPECT_EQ(client_->getStats().retries, 1);
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/RequestCoalescer.h>
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class MockSubscriber : public CoalescedFetch::Subscriber {
+ public:
+  MOCK_METHOD(void, onCoalescedHeaders, (const HTTPMessage&), (noexcept));
+  MOCK_METHOD(void, onCoalescedBodyLen, (size_t));
+  MOCK_METHOD(void, onTrailersReceived, ());
+  MOCK_METHOD(void, onCoalescedEOM, (), (noexcept));
+  MOCK_METHOD(void, onCoalescedError, (const HTTPException&), (noexcept));
+
+  void onCoalescedBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    onCoalescedBodyLen(chain->computeChainDataLength());
+  }
+
+  void onCoalescedTrailers(
+      std::unique_ptr<HTTPHeaders> trailers) noexcept override {
+    EXPECT_NE(trailers, nullptr);
+    onTrailersReceived();
+  }
+};
+
+std::unique_ptr<folly::IOBuf> makeBody(size_t len) {
+  auto buf = folly::IOBuf::create(len);
+  memset(buf->writableData(), 'a', len);
+  buf->append(len);
+  return buf;
+}
+
+} // namespace
+
+TEST(RequestCoalescerTest, Eligibility) {
+  auto get = getGetRequest();
+  EXPECT_TRUE(RequestCoalescer::isCoalescable(get));
+
+  auto post = getPostRequest(10);
+  EXPECT_FALSE(RequestCoalescer::isCoalescable(post));
+
+  auto upgrade = getGetRequest();
+  upgrade.getHeaders().add(HTTP_HEADER_UPGRADE, "websocket");
+  EXPECT_FALSE(RequestCoalescer::isCoalescable(upgrade));
+
+  for (auto code : {HTTP_HEADER_AUTHORIZATION,
+                    HTTP_HEADER_PROXY_AUTHORIZATION,
+                    HTTP_HEADER_COOKIE}) {
+    auto credentials = getGetRequest();
+    credentials.getHeaders().add(code, "secret");
+    EXPECT_FALSE(RequestCoalescer::isCoalescable(credentials));
+  }
+
+  auto noCache = getGetRequest();
+  noCache.getHeaders().add(HTTP_HEADER_CACHE_CONTROL, "max-age=0, no-cache");
+  EXPECT_FALSE(RequestCoalescer::isCoalescable(noCache));
+  auto noStore = getGetRequest();
+  noStore.getHeaders().add(HTTP_HEADER_CACHE_CONTROL, "No-Store");
+  EXPECT_FALSE(RequestCoalescer::isCoalescable(noStore));
+  auto maxAge = getGetRequest();
+  maxAge.getHeaders().add(HTTP_HEADER_CACHE_CONTROL, "max-age=60");
+  EXPECT_TRUE(RequestCoalescer::isCoalescable(maxAge));
+}
+
+TEST(RequestCoalescerTest, CredentialsNotShared) {
+  RequestCoalescer coalescer;
+  StrictMock<MockSubscriber> sub1;
+  StrictMock<MockSubscriber> sub2;
+  auto req1 = getGetRequest("/profile");
+  req1.getHeaders().set(HTTP_HEADER_AUTHORIZATION, "Bearer user-a");
+  auto req2 = getGetRequest("/profile");
+  req2.getHeaders().set(HTTP_HEADER_AUTHORIZATION, "Bearer user-b");
+
+  // Neither joins a shared fetch, so each caller fetches on its own
+  auto res1 = coalescer.subscribe(req1, &sub1);
+  auto res2 = coalescer.subscribe(req2, &sub2);
+  EXPECT_EQ(res1.fetch, nullptr);
+  EXPECT_EQ(res2.fetch, nullptr);
+  EXPECT_EQ(coalescer.getNumInflight(), 0);
+  EXPECT_EQ(coalescer.getNumCoalesced(), 0);
+}
+
+TEST(RequestCoalescerTest, KeyHeaders) {
+  RequestCoalescer coalescer({"Accept-Encoding"});
+  auto req1 = getGetRequest("/foo");
+  req1.getHeaders().set(HTTP_HEADER_HOST, "www.foo.com");
+  auto req2 = req1;
+  EXPECT_EQ(coalescer.makeKey(req1), coalescer.makeKey(req2));
+
+  req2.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "gzip");
+  EXPECT_NE(coalescer.makeKey(req1), coalescer.makeKey(req2));
+
+  auto req3 = req1;
+  req3.getHeaders().set(HTTP_HEADER_HOST, "www.bar.com");
+  EXPECT_NE(coalescer.makeKey(req1), coalescer.makeKey(req3));
+
+  auto secure = req1;
+  secure.setSecure(true);
+  EXPECT_NE(coalescer.makeKey(req1), coalescer.makeKey(secure));
+
+  // Headers outside the key set do not matter
+  auto req4 = req1;
+  req4.getHeaders().set(HTTP_HEADER_USER_AGENT, "test");
+  EXPECT_EQ(coalescer.makeKey(req1), coalescer.makeKey(req4));
+}
+
+TEST(RequestCoalescerTest, FanoutResponse) {
+  RequestCoalescer coalescer;
+  StrictMock<MockSubscriber> sub1;
+  StrictMock<MockSubscriber> sub2;
+  auto req = getGetRequest();
+
+  auto res1 = coalescer.subscribe(req, &sub1);
+  ASSERT_NE(res1.fetch, nullptr);
+  EXPECT_TRUE(res1.isNew);
+  auto res2 = coalescer.subscribe(req, &sub2);
+  EXPECT_EQ(res1.fetch, res2.fetch);
+  EXPECT_FALSE(res2.isNew);
+  EXPECT_EQ(coalescer.getNumCoalesced(), 1);
+
+  auto fetch = res1.fetch;
+  EXPECT_CALL(sub1, onCoalescedHeaders(_));
+  EXPECT_CALL(sub2, onCoalescedHeaders(_));
+  fetch->onHeadersComplete(makeResponse(200));
+
+  EXPECT_CALL(sub1, onCoalescedBodyLen(100));
+  EXPECT_CALL(sub2, onCoalescedBodyLen(100));
+  fetch->onBody(makeBody(100));
+  // Once body has started the fetch can no longer be joined
+  EXPECT_EQ(coalescer.getNumInflight(), 0);
+
+  EXPECT_CALL(sub1, onTrailersReceived());
+  EXPECT_CALL(sub2, onTrailersReceived());
+  fetch->onTrailers(std::make_unique<HTTPHeaders>());
+  EXPECT_CALL(sub1, onCoalescedEOM());
+  EXPECT_CALL(sub2, onCoalescedEOM());
+  fetch->onEOM();
+  EXPECT_EQ(fetch->getNumSubscribers(), 0);
+  fetch->detachTransaction();
+}
+
+TEST(RequestCoalescerTest, LateJoinerGetsHeaders) {
+  RequestCoalescer coalescer;
+  StrictMock<MockSubscriber> sub1;
+  StrictMock<MockSubscriber> sub2;
+  auto req = getGetRequest();
+
+  auto fetch = coalescer.subscribe(req, &sub1).fetch;
+  EXPECT_CALL(sub1, onCoalescedHeaders(_));
+  fetch->onHeadersComplete(makeResponse(200));
+
+  EXPECT_CALL(sub2, onCoalescedHeaders(_));
+  EXPECT_EQ(coalescer.subscribe(req, &sub2).fetch, fetch);
+
+  EXPECT_CALL(sub1, onCoalescedEOM());
+  EXPECT_CALL(sub2, onCoalescedEOM());
+  fetch->onEOM();
+  fetch->detachTransaction();
+}
+
+TEST(RequestCoalescerTest, SlowSubscriberBuffered) {
+  RequestCoalescer coalescer;
+  StrictMock<MockSubscriber> fast;
+  StrictMock<MockSubscriber> slow;
+  auto req = getGetRequest();
+
+  auto fetch = coalescer.subscribe(req, &fast).fetch;
+  coalescer.subscribe(req, &slow);
+  EXPECT_CALL(fast, onCoalescedHeaders(_));
+  EXPECT_CALL(slow, onCoalescedHeaders(_));
+  fetch->onHeadersComplete(makeResponse(200));
+
+  fetch->pauseSubscriber(&slow);
+  EXPECT_CALL(fast, onCoalescedBodyLen(100)).Times(2);
+  fetch->onBody(makeBody(100));
+  fetch->onBody(makeBody(100));
+  EXPECT_CALL(fast, onCoalescedEOM());
+  fetch->onEOM();
+  fetch->detachTransaction();
+
+  // The slow subscriber keeps the fetch alive and drains on resume
+  EXPECT_EQ(fetch->getNumSubscribers(), 1);
+  InSequence seq;
+  EXPECT_CALL(slow, onCoalescedBodyLen(200));
+  EXPECT_CALL(slow, onCoalescedEOM());
+  fetch->resumeSubscriber(&slow);
+}
+
+TEST(RequestCoalescerTest, SlowSubscriberDropped) {
+  CoalescedFetch::BufferLimits limits;
+  limits.softLimit = 100;
+  limits.hardLimit = 150;
+  RequestCoalescer coalescer({}, limits);
+  StrictMock<MockSubscriber> fast;
+  StrictMock<MockSubscriber> slow;
+  auto req = getGetRequest();
+
+  auto fetch = coalescer.subscribe(req, &fast).fetch;
+  coalescer.subscribe(req, &slow);
+  EXPECT_CALL(fast, onCoalescedHeaders(_));
+  EXPECT_CALL(slow, onCoalescedHeaders(_));
+  fetch->onHeadersComplete(makeResponse(200));
+
+  fetch->pauseSubscriber(&slow);
+  EXPECT_CALL(fast, onCoalescedBodyLen(100)).Times(2);
+  EXPECT_CALL(slow, onCoalescedError(_))
+      .WillOnce(Invoke([](const HTTPException& ex) {
+        EXPECT_EQ(ex.getProxygenError(), kErrorWriteTimeout);
+      }));
+  fetch->onBody(makeBody(100));
+  fetch->onBody(makeBody(100));
+  EXPECT_EQ(fetch->getNumSubscribers(), 1);
+
+  EXPECT_CALL(fast, onCoalescedEOM());
+  fetch->onEOM();
+  fetch->detachTransaction();
+}
+
+TEST(RequestCoalescerTest, UpstreamError) {
+  RequestCoalescer coalescer;
+  StrictMock<MockSubscriber> sub1;
+  StrictMock<MockSubscriber> sub2;
+  auto req = getGetRequest();
+
+  auto fetch = coalescer.subscribe(req, &sub1).fetch;
+  coalescer.subscribe(req, &sub2);
+  EXPECT_CALL(sub1, onCoalescedError(_));
+  EXPECT_CALL(sub2, onCoalescedError(_));
+  fetch->onError(HTTPException(HTTPException::Direction::INGRESS, "test"));
+  EXPECT_EQ(coalescer.getNumInflight(), 0);
+
+  // A new request starts a new fetch
+  StrictMock<MockSubscriber> sub3;
+  auto res = coalescer.subscribe(req, &sub3);
+  EXPECT_TRUE(res.isNew);
+  EXPECT_NE(res.fetch, fetch);
+  fetch->detachTransaction();
+
+  EXPECT_CALL(sub3, onCoalescedError(_));
+  res.fetch->abort(HTTPException(HTTPException::Direction::EGRESS, "no txn"));
+}
+
+TEST(RequestCoalescerTest, AllSubscribersLeave) {
+  RequestCoalescer coalescer;
+  StrictMock<MockSubscriber> sub1;
+  StrictMock<MockSubscriber> sub2;
+  auto req = getGetRequest();
+
+  auto fetch = coalescer.subscribe(req, &sub1).fetch;
+  coalescer.subscribe(req, &sub2);
+  fetch->removeSubscriber(&sub1);
+  EXPECT_EQ(coalescer.getNumInflight(), 1);
+  // No upstream transaction was attached, so the fetch is destroyed
+  fetch->removeSubscriber(&sub2);
+  EXPECT_EQ(coalescer.getNumInflight(), 0);
+}
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/experimental/GrpcMessageCodec.h>
+
+#include <folly/Conv.h>
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
+#include <folly/ThreadLocal.h>
+#include <folly/io/Cursor.h>
+#include <limits>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+
+using folly::IOBuf;
+using folly::StringPiece;
+using std::unique_ptr;
+
+namespace proxygen {
+
+const std::string kGrpcContentType("application/grpc");
+const std::string kGrpcStatus("grpc-status");
+const std::string kGrpcMessage("grpc-message");
+const std::string kGrpcEncoding("grpc-encoding");
+const std::string kGrpcAcceptEncoding("grpc-accept-encoding");
+
+namespace {
+
+/**
+ * Compression is synchronous and a message is always a complete zlib
+ * stream, so one stream per type (and level) per thread is enough; each is
+ * reset between messages.
+ */
+class ZlibStreamPool {
+ public:
+  unique_ptr<ZlibStreamCompressor>& getCompressor(CompressionType type,
+                                                  int level) {
+    for (auto& entry : compressors_) {
+      if (entry.type == type && entry.level == level) {
+        return entry.compressor;
+      }
+    }
+    compressors_.push_back(
+        {type, level, std::make_unique<ZlibStreamCompressor>(type, level)});
+    return compressors_.back().compressor;
+  }
+
+  unique_ptr<ZlibStreamDecompressor>& getDecompressor(CompressionType type) {
+    auto& decompressor = type == CompressionType::GZIP ? gzipDecompressor_
+                                                       : deflateDecompressor_;
+    if (!decompressor) {
+      decompressor = std::make_unique<ZlibStreamDecompressor>(type);
+    }
+    return decompressor;
+  }
+
+ private:
+  struct CompressorEntry {
+    CompressionType type;
+    int level;
+    unique_ptr<ZlibStreamCompressor> compressor;
+  };
+  std::vector<CompressorEntry> compressors_;
+  unique_ptr<ZlibStreamDecompressor> gzipDecompressor_;
+  unique_ptr<ZlibStreamDecompressor> deflateDecompressor_;
+};
+
+folly::ThreadLocal<ZlibStreamPool> zlibStreamPool;
+
+bool isZlibType(CompressionType type) {
+  return type == CompressionType::GZIP || type == CompressionType::DEFLATE;
+}
+
+} // namespace
+
+const char* getGrpcStatusString(GrpcStatus status) {
+  switch (status) {
+    case GrpcStatus::OK:
+      return "OK";
+    case GrpcStatus::CANCELLED:
+      return "CANCELLED";
+    case GrpcStatus::UNKNOWN:
+      return "UNKNOWN";
+    case GrpcStatus::INVALID_ARGUMENT:
+      return "INVALID_ARGUMENT";
+    case GrpcStatus::DEADLINE_EXCEEDED:
+      return "DEADLINE_EXCEEDED";
+    case GrpcStatus::NOT_FOUND:
+      return "NOT_FOUND";
+    case GrpcStatus::ALREADY_EXISTS:
+      return "ALREADY_EXISTS";
+    case GrpcStatus::PERMISSION_DENIED:
+      return "PERMISSION_DENIED";
+    case GrpcStatus::RESOURCE_EXHAUSTED:
+      return "RESOURCE_EXHAUSTED";
+    case GrpcStatus::FAILED_PRECONDITION:
+      return "FAILED_PRECONDITION";
+    case GrpcStatus::ABORTED:
+      return "ABORTED";
+    case GrpcStatus::OUT_OF_RANGE:
+      return "OUT_OF_RANGE";
+    case GrpcStatus::UNIMPLEMENTED:
+      return "UNIMPLEMENTED";
+    case GrpcStatus::INTERNAL:
+      return "INTERNAL";
+    case GrpcStatus::UNAVAILABLE:
+      return "UNAVAILABLE";
+    case GrpcStatus::DATA_LOSS:
+      return "DATA_LOSS";
+    case GrpcStatus::UNAUTHENTICATED:
+      return "UNAUTHENTICATED";
+  }
+  return "Unknown";
+}
+
+folly::Optional<CompressionType> grpcEncodingToCompressionType(
+    StringPiece encoding) {
+  if (encoding.empty() || encoding == "identity") {
+    return CompressionType::NONE;
+  } else if (encoding == "gzip") {
+    return CompressionType::GZIP;
+  } else if (encoding == "deflate") {
+    return CompressionType::DEFLATE;
+  }
+  return folly::none;
+}
+
+StringPiece compressionTypeToGrpcEncoding(CompressionType type) {
+  switch (type) {
+    case CompressionType::GZIP:
+      return "gzip";
+    case CompressionType::DEFLATE:
+      return "deflate";
+    case CompressionType::NONE:
+    case CompressionType::ZSTD:
+      break;
+  }
+  DCHECK(type == CompressionType::NONE) << "Unsupported grpc-encoding";
+  return "identity";
+}
+
+std::string grpcPercentEncode(StringPiece message) {
+  std::string out;
+  out.reserve(message.size());
+  for (auto ch : message) {
+    auto byte = static_cast<uint8_t>(ch);
+    if (byte < 0x20 || byte > 0x7e || byte == '%') {
+      static const char kHex[] = "0123456789ABCDEF";
+      out.push_back('%');
+      out.push_back(kHex[byte >> 4]);
+      out.push_back(kHex[byte & 0xf]);
+    } else {
+      out.push_back(ch);
+    }
+  }
+  return out;
+}
+
+std::string grpcPercentDecode(StringPiece message) {
+  std::string out;
+  out.reserve(message.size());
+  for (size_t i = 0; i < message.size(); i++) {
+    std::string byte;
+    if (message[i] == '%' && i + 2 < message.size() &&
+        folly::unhexlify(message.subpiece(i + 1, 2), byte)) {
+      out.append(byte);
+      i += 2;
+    } else {
+      // Malformed escapes are passed through, as the spec asks
+      out.push_back(message[i]);
+    }
+  }
+  return out;
+}
+
+unique_ptr<IOBuf> grpcCompress(CompressionType type,
+                               int level,
+                               const IOBuf* message) {
+  if (!isZlibType(type)) {
+    LOG(ERROR) << "Unsupported gRPC compression type";
+    return nullptr;
+  }
+  auto& compressor = zlibStreamPool->getCompressor(type, level);
+  auto out = compressor->compress(message, true /* trailer */);
+  if (!out || compressor->hasError()) {
+    // Don't reuse a stream in an unknown state
+    compressor = std::make_unique<ZlibStreamCompressor>(type, level);
+    return nullptr;
+  }
+  compressor->reset();
+  return out;
+}
+
+folly::Expected<unique_ptr<IOBuf>, GrpcStatus> grpcDecompress(
+    CompressionType type, const IOBuf* message, uint32_t maxSize) {
+  if (!isZlibType(type)) {
+    LOG(ERROR) << "Unsupported gRPC compression type";
+    return folly::makeUnexpected(GrpcStatus::INTERNAL);
+  }
+  auto& decompressor = zlibStreamPool->getDecompressor(type);
+  auto out = decompressor->decompress(message, maxSize);
+  // A compressed message is one complete stream
+  if (!out || decompressor->hasError() || !decompressor->finished()) {
+    auto status = decompressor->outputLimitExceeded()
+                      ? GrpcStatus::RESOURCE_EXHAUSTED
+                      : GrpcStatus::INTERNAL;
+    decompressor = std::make_unique<ZlibStreamDecompressor>(type);
+    return folly::makeUnexpected(status);
+  }
+  decompressor->reset();
+  return out;
+}
+
+void GrpcMessageCodec::onIngress(unique_ptr<IOBuf> data) {
+  if (error_) {
+    return;
+  }
+  input_.append(std::move(data));
+  parse();
+}
+
+void GrpcMessageCodec::onIngressEOM() {
+  ingressEOM_ = true;
+  parse();
+}
+
+void GrpcMessageCodec::resume() {
+  paused_ = false;
+  parse();
+}
+
+void GrpcMessageCodec::parse() {
+  // A callback that pauses and resumes continues this loop
+  if (parsing_) {
+    return;
+  }
+  parsing_ = true;
+  SCOPE_EXIT {
+    parsing_ = false;
+  };
+  CHECK(callback_);
+
+  while (!paused_ && !error_) {
+    if (!messageLength_) {
+      if (input_.chainLength() < kGrpcMessagePrefixSize) {
+        break;
+      }
+      folly::io::Cursor cursor(input_.front());
+      auto flags = cursor.read<uint8_t>();
+      auto length = cursor.readBE<uint32_t>();
+      if (flags > 1) {
+        parseError(GrpcStatus::INTERNAL,
+                   folly::to<std::string>("Invalid message flags=", flags));
+        return;
+      }
+      if (length > maxMessageSize_) {
+        parseError(GrpcStatus::RESOURCE_EXHAUSTED,
+                   folly::to<std::string>("Message of ",
+                                          length,
+                                          " bytes exceeds maximum of ",
+                                          maxMessageSize_));
+        return;
+      }
+      if (flags && ingressCompression_ == CompressionType::NONE) {
+        parseError(GrpcStatus::INTERNAL,
+                   "Compressed message without grpc-encoding");
+        return;
+      }
+      input_.trimStart(kGrpcMessagePrefixSize);
+      messageLength_ = length;
+      messageCompressed_ = flags;
+    }
+    if (input_.chainLength() < *messageLength_) {
+      break;
+    }
+    // Shares the ingress buffers
+    auto message =
+        *messageLength_ > 0 ? input_.split(*messageLength_) : IOBuf::create(0);
+    messageLength_.reset();
+    if (messageCompressed_) {
+      auto decompressed =
+          grpcDecompress(ingressCompression_, message.get(), maxMessageSize_);
+      if (decompressed.hasError()) {
+        if (decompressed.error() == GrpcStatus::RESOURCE_EXHAUSTED) {
+          parseError(GrpcStatus::RESOURCE_EXHAUSTED,
+                     folly::to<std::string>("Decompressed message exceeds "
+                                            "maximum of ",
+                                            maxMessageSize_));
+        } else {
+          parseError(GrpcStatus::INTERNAL, "Failed to decompress message");
+        }
+        return;
+      }
+      message = std::move(*decompressed);
+    }
+    messagesParsed_++;
+    callback_->onMessage(std::move(message));
+  }
+
+  if (ingressEOM_ && !paused_ && !error_ && !complete_) {
+    if (messageLength_ || !input_.empty()) {
+      parseError(GrpcStatus::INTERNAL,
+                 "Stream ended in the middle of a message");
+      return;
+    }
+    complete_ = true;
+    callback_->onMessagesComplete();
+  }
+}
+
+void GrpcMessageCodec::parseError(GrpcStatus status, std::string error) {
+  VLOG(4) << "gRPC message parse error status=" << getGrpcStatusString(status)
+          << " error=" << error;
+  error_ = true;
+  input_.move();
+  callback_->onError(status, error);
+}
+
+size_t GrpcMessageCodec::serialize(folly::IOBufQueue& writeBuf,
+                                   unique_ptr<IOBuf> message,
+                                   CompressionType compression,
+                                   int compressionLevel) {
+  bool compressed = compression != CompressionType::NONE;
+  if (compressed) {
+    auto empty = IOBuf::create(0);
+    message = grpcCompress(
+        compression, compressionLevel, message ? message.get() : empty.get());
+    if (!message) {
+      return 0;
+    }
+  }
+  size_t length = message ? message->computeChainDataLength() : 0;
+  if (length > std::numeric_limits<uint32_t>::max()) {
+    LOG(ERROR) << "gRPC message too large to frame, length=" << length;
+    return 0;
+  }
+  folly::io::QueueAppender appender(&writeBuf, kGrpcMessagePrefixSize);
+  appender.write<uint8_t>(compressed ? 1 : 0);
+  appender.writeBE<uint32_t>(static_cast<uint32_t>(length));
+  if (length > 0) {
+    writeBuf.append(std::move(message));
+  }
+  return kGrpcMessagePrefixSize + length;
+}
+
+} // namespace proxygen
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/utils/StreamDecompressor.h>
+#include <string>
+
+namespace proxygen {
+
+// https://github.com/grpc/grpc/blob/master/doc/statuscodes.md
+enum class GrpcStatus : uint8_t {
+  OK = 0,
+  CANCELLED = 1,
+  UNKNOWN = 2,
+  INVALID_ARGUMENT = 3,
+  DEADLINE_EXCEEDED = 4,
+  NOT_FOUND = 5,
+  ALREADY_EXISTS = 6,
+  PERMISSION_DENIED = 7,
+  RESOURCE_EXHAUSTED = 8,
+  FAILED_PRECONDITION = 9,
+  ABORTED = 10,
+  OUT_OF_RANGE = 11,
+  UNIMPLEMENTED = 12,
+  INTERNAL = 13,
+  UNAVAILABLE = 14,
+  DATA_LOSS = 15,
+  UNAUTHENTICATED = 16,
+};
+
+const char* getGrpcStatusString(GrpcStatus status);
+
+// Compressed flag and big endian length
+constexpr size_t kGrpcMessagePrefixSize = 5;
+// The limit most gRPC implementations apply to received messages
+constexpr uint32_t kDefaultGrpcMaxMessageSize = 4 * 1024 * 1024;
+
+extern const std::string kGrpcContentType;
+extern const std::string kGrpcStatus;
+extern const std::string kGrpcMessage;
+extern const std::string kGrpcEncoding;
+extern const std::string kGrpcAcceptEncoding;
+
+/**
+ * Map a grpc-encoding value to a CompressionType and back.  identity maps to
+ * NONE; encodings we do not implement return folly::none.
+ */
+folly::Optional<CompressionType> grpcEncodingToCompressionType(
+    folly::StringPiece encoding);
+folly::StringPiece compressionTypeToGrpcEncoding(CompressionType type);
+
+/**
+ * grpc-message is percent-encoded: bytes outside printable ASCII, and '%'
+ * itself, are sent as %XX.
+ */
+std::string grpcPercentEncode(folly::StringPiece message);
+std::string grpcPercentDecode(folly::StringPiece message);
+
+/**
+ * Per-message compression through per-thread pools of zlib streams, so a
+ * message does not pay for deflateInit/inflateInit and their allocations.
+ * compress returns nullptr on error.  decompress stops inflating as soon
+ * as the output passes maxSize and fails with RESOURCE_EXHAUSTED, so a
+ * small message cannot expand without bound; other failures are INTERNAL.
+ */
+std::unique_ptr<folly::IOBuf> grpcCompress(CompressionType type,
+                                           int level,
+                                           const folly::IOBuf* message);
+folly::Expected<std::unique_ptr<folly::IOBuf>, GrpcStatus> grpcDecompress(
+    CompressionType type, const folly::IOBuf* message, uint32_t maxSize);
+
+/**
+ * Class for stream-parsing and serializing gRPC length-prefixed messages.
+ *
+ * Ingress is a sequence of body chunks in any split.  Each complete message
+ * is handed to the callback as an IOBuf chain that shares the ingress
+ * buffers, so a message straddling chunks is never copied (unless it is
+ * compressed, in which case it is inflated into a new buffer).
+ *
+ * While paused no messages are delivered and ingress is only buffered;
+ * resuming delivers anything complete.  After onError the codec is no longer
+ * usable.
+ */
+class GrpcMessageCodec {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {
+    }
+    virtual void onMessage(std::unique_ptr<folly::IOBuf> message) = 0;
+    // Ingress ended cleanly and every message has been delivered
+    virtual void onMessagesComplete() = 0;
+    virtual void onError(GrpcStatus status, const std::string& error) = 0;
+  };
+
+  void setCallback(Callback* callback) {
+    callback_ = callback;
+  }
+
+  void setMaxMessageSize(uint32_t maxMessageSize) {
+    maxMessageSize_ = maxMessageSize;
+  }
+
+  // From the peer's grpc-encoding, used for messages with the compressed flag
+  void setIngressCompression(CompressionType type) {
+    ingressCompression_ = type;
+  }
+
+  // Pass the next piece of input data
+  void onIngress(std::unique_ptr<folly::IOBuf> data);
+
+  // The end of input has been seen.  It is an error to end mid-message.
+  void onIngressEOM();
+
+  void pause() {
+    paused_ = true;
+  }
+
+  void resume();
+
+  bool isPaused() const {
+    return paused_;
+  }
+
+  bool hasError() const {
+    return error_;
+  }
+
+  // Ingress bytes buffered, including complete messages held while paused
+  size_t getBufferedBytes() const {
+    return input_.chainLength();
+  }
+
+  uint64_t getMessagesParsed() const {
+    return messagesParsed_;
+  }
+
+  /**
+   * Append message to writeBuf with its length prefix, compressing it first
+   * if compression is not NONE.  The message buffers are chained, not
+   * copied.  Returns the bytes added to writeBuf, or 0 on error.
+   */
+  static size_t serialize(folly::IOBufQueue& writeBuf,
+                          std::unique_ptr<folly::IOBuf> message,
+                          CompressionType compression = CompressionType::NONE,
+                          int compressionLevel = -1);
+
+ private:
+  void parse();
+  void parseError(GrpcStatus status, std::string error);
+
+  Callback* callback_{nullptr};
+  folly::IOBufQueue input_{folly::IOBufQueue::cacheChainLength()};
+  uint32_t maxMessageSize_{kDefaultGrpcMaxMessageSize};
+  CompressionType ingressCompression_{CompressionType::NONE};
+  // Prefix of the message being parsed, once it has been read
+  folly::Optional<uint32_t> messageLength_;
+  bool messageCompressed_{false};
+  bool paused_{false};
+  bool parsing_{false};
+  bool ingressEOM_{false};
+  bool complete_{false};
+  bool error_{false};
+  uint64_t messagesParsed_{0};
+};
+
+} // namespace proxygen
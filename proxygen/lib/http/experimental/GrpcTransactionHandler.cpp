@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/experimental/GrpcTransactionHandler.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+
+using folly::IOBuf;
+using folly::StringPiece;
+using std::unique_ptr;
+
+namespace proxygen {
+
+namespace {
+
+const std::string kGrpcAcceptEncodingValue("identity,deflate,gzip");
+
+bool acceptsEncoding(const HTTPHeaders& headers, StringPiece encoding) {
+  // Stops, returning true, at the first value that lists encoding
+  return headers.forEachValueOfHeader(
+      kGrpcAcceptEncoding, [&](const std::string& value) {
+        std::vector<StringPiece> encodings;
+        folly::split(',', value, encodings);
+        for (auto enc : encodings) {
+          if (folly::trimWhitespace(enc) == encoding) {
+            return true;
+          }
+        }
+        return false;
+      });
+}
+
+} // namespace
+
+GrpcStatus httpStatusToGrpcStatus(uint16_t httpStatus) {
+  switch (httpStatus) {
+    case 400:
+      return GrpcStatus::INTERNAL;
+    case 401:
+      return GrpcStatus::UNAUTHENTICATED;
+    case 403:
+      return GrpcStatus::PERMISSION_DENIED;
+    case 404:
+      return GrpcStatus::UNIMPLEMENTED;
+    case 429:
+    case 502:
+    case 503:
+    case 504:
+      return GrpcStatus::UNAVAILABLE;
+    default:
+      return GrpcStatus::UNKNOWN;
+  }
+}
+
+GrpcTransactionHandler::GrpcTransactionHandler()
+    : GrpcTransactionHandler(Options()) {
+}
+
+GrpcTransactionHandler::GrpcTransactionHandler(Options options)
+    : options_(options) {
+  codec_.setCallback(this);
+  codec_.setMaxMessageSize(options_.maxMessageSize);
+}
+
+void GrpcTransactionHandler::setTransaction(HTTPTransaction* txn) noexcept {
+  txn_ = txn;
+  if (options_.receiveWindow > 0) {
+    txn_->setReceiveWindow(options_.receiveWindow);
+  }
+  if (!isServer()) {
+    // The server must accept what the request's grpc-encoding names
+    egressCompression_ = options_.egressCompression;
+  }
+}
+
+void GrpcTransactionHandler::detachTransaction() noexcept {
+  txn_ = nullptr;
+}
+
+void GrpcTransactionHandler::addGrpcHeaders(HTTPMessage& msg) const {
+  auto& headers = msg.getHeaders();
+  headers.set(HTTP_HEADER_CONTENT_TYPE, kGrpcContentType);
+  if (egressCompression_ != CompressionType::NONE) {
+    headers.set(kGrpcEncoding,
+                compressionTypeToGrpcEncoding(egressCompression_).str());
+  }
+  headers.set(kGrpcAcceptEncoding, kGrpcAcceptEncodingValue);
+}
+
+void GrpcTransactionHandler::sendRequest(HTTPMessage request) {
+  CHECK(txn_);
+  request.setMethod(HTTPMethod::POST);
+  request.getHeaders().set(HTTP_HEADER_TE, "trailers");
+  addGrpcHeaders(request);
+  headersSent_ = true;
+  txn_->sendHeaders(request);
+}
+
+void GrpcTransactionHandler::sendResponseHeaders(HTTPMessage response) {
+  CHECK(txn_);
+  DCHECK(!headersSent_);
+  response.setStatusCode(200);
+  response.setStatusMessage("OK");
+  addGrpcHeaders(response);
+  headersSent_ = true;
+  txn_->sendHeaders(response);
+}
+
+bool GrpcTransactionHandler::sendMessage(unique_ptr<IOBuf> message) {
+  CHECK(txn_);
+  if (!headersSent_) {
+    DCHECK(isServer()) << "Request headers must be sent first";
+    sendResponseHeaders(HTTPMessage());
+  }
+  folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+  if (GrpcMessageCodec::serialize(writeBuf,
+                                  std::move(message),
+                                  egressCompression_,
+                                  options_.compressionLevel) == 0) {
+    return false;
+  }
+  txn_->sendBody(writeBuf.move());
+  return true;
+}
+
+void GrpcTransactionHandler::sendEndOfMessages() {
+  CHECK(txn_);
+  DCHECK(!isServer());
+  txn_->sendEOM();
+}
+
+void GrpcTransactionHandler::sendStatus(GrpcStatus status,
+                                        StringPiece message) {
+  CHECK(txn_);
+  DCHECK(isServer());
+  auto statusValue = folly::to<std::string>(static_cast<uint32_t>(status));
+  if (!headersSent_) {
+    // Trailers-Only: the status rides in the one and only HEADERS frame
+    HTTPMessage response;
+    response.setStatusCode(200);
+    response.setStatusMessage("OK");
+    addGrpcHeaders(response);
+    response.getHeaders().set(kGrpcStatus, statusValue);
+    if (!message.empty()) {
+      response.getHeaders().set(kGrpcMessage, grpcPercentEncode(message));
+    }
+    headersSent_ = true;
+    txn_->sendHeadersWithEOM(response);
+    return;
+  }
+  HTTPHeaders trailers;
+  trailers.set(kGrpcStatus, statusValue);
+  if (!message.empty()) {
+    trailers.set(kGrpcMessage, grpcPercentEncode(message));
+  }
+  // Sent with END_STREAM, in the same frame as the trailers
+  txn_->sendTrailers(trailers);
+  txn_->sendEOM();
+}
+
+void GrpcTransactionHandler::pauseMessages() {
+  codec_.pause();
+  if (txn_) {
+    txn_->pauseIngress();
+  }
+}
+
+void GrpcTransactionHandler::resumeMessages() {
+  // Messages already buffered go first, and may pause us again
+  codec_.resume();
+  if (txn_ && !codec_.isPaused()) {
+    txn_->resumeIngress();
+  }
+}
+
+void GrpcTransactionHandler::onHeadersComplete(
+    unique_ptr<HTTPMessage> msg) noexcept {
+  const auto& headers = msg->getHeaders();
+  if (msg->isResponse() && msg->getStatusCode() != 200) {
+    fail(httpStatusToGrpcStatus(msg->getStatusCode()),
+         folly::to<std::string>("HTTP status ", msg->getStatusCode()));
+    return;
+  }
+  if (!msg->isResponse() || !headers.exists(kGrpcStatus)) {
+    // A Trailers-Only response may omit content-type
+    const auto& contentType =
+        headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE);
+    if (!StringPiece(contentType).startsWith(kGrpcContentType)) {
+      fail(GrpcStatus::INTERNAL,
+           folly::to<std::string>("Unsupported content-type ", contentType));
+      return;
+    }
+  }
+
+  const auto& encoding = headers.getSingleOrEmpty(kGrpcEncoding);
+  auto compression = grpcEncodingToCompressionType(encoding);
+  if (!compression) {
+    fail(msg->isResponse() ? GrpcStatus::INTERNAL : GrpcStatus::UNIMPLEMENTED,
+         folly::to<std::string>("Unsupported grpc-encoding ", encoding));
+    return;
+  }
+  codec_.setIngressCompression(*compression);
+
+  if (isServer() && options_.egressCompression != CompressionType::NONE &&
+      acceptsEncoding(
+          headers, compressionTypeToGrpcEncoding(options_.egressCompression))) {
+    egressCompression_ = options_.egressCompression;
+  }
+  if (msg->isResponse()) {
+    setStatus(headers);
+  }
+  onGrpcHeaders(std::move(msg));
+}
+
+void GrpcTransactionHandler::onBody(unique_ptr<IOBuf> chain) noexcept {
+  if (failed_) {
+    return;
+  }
+  codec_.onIngress(std::move(chain));
+}
+
+void GrpcTransactionHandler::onTrailers(
+    unique_ptr<HTTPHeaders> trailers) noexcept {
+  if (!isServer()) {
+    setStatus(*trailers);
+  }
+}
+
+void GrpcTransactionHandler::onEOM() noexcept {
+  if (failed_) {
+    return;
+  }
+  codec_.onIngressEOM();
+}
+
+void GrpcTransactionHandler::onUpgrade(UpgradeProtocol /*protocol*/) noexcept {
+}
+
+void GrpcTransactionHandler::onError(const HTTPException& error) noexcept {
+  auto status = GrpcStatus::UNAVAILABLE;
+  if (error.getProxygenError() == kErrorTimeout) {
+    status = GrpcStatus::DEADLINE_EXCEEDED;
+  } else if (error.hasCodecStatusCode() &&
+             error.getCodecStatusCode() == ErrorCode::CANCEL) {
+    status = GrpcStatus::CANCELLED;
+  }
+  fail(status, error.what());
+}
+
+void GrpcTransactionHandler::setStatus(const HTTPHeaders& headers) {
+  const auto& value = headers.getSingleOrEmpty(kGrpcStatus);
+  if (value.empty()) {
+    return;
+  }
+  auto code = folly::tryTo<uint32_t>(value);
+  if (code.hasValue() &&
+      *code <= static_cast<uint32_t>(GrpcStatus::UNAUTHENTICATED)) {
+    status_ = static_cast<GrpcStatus>(*code);
+  } else {
+    status_ = GrpcStatus::UNKNOWN;
+  }
+  statusMessage_ = grpcPercentDecode(headers.getSingleOrEmpty(kGrpcMessage));
+}
+
+void GrpcTransactionHandler::onMessage(unique_ptr<IOBuf> message) {
+  onGrpcMessage(std::move(message));
+}
+
+void GrpcTransactionHandler::onMessagesComplete() {
+  if (isServer()) {
+    onGrpcComplete(GrpcStatus::OK, "");
+  } else if (status_) {
+    onGrpcComplete(*status_, statusMessage_);
+  } else {
+    onGrpcComplete(GrpcStatus::INTERNAL, "Response ended without grpc-status");
+  }
+}
+
+void GrpcTransactionHandler::onError(GrpcStatus status,
+                                     const std::string& error) {
+  fail(status, error);
+}
+
+void GrpcTransactionHandler::fail(GrpcStatus status,
+                                  const std::string& message) {
+  if (failed_) {
+    return;
+  }
+  failed_ = true;
+  onGrpcError(status, message);
+}
+
+} // namespace proxygen
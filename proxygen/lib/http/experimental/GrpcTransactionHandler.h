@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/lib/http/experimental/GrpcMessageCodec.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+namespace proxygen {
+
+/**
+ * Base HTTPTransaction handler for one gRPC call, on either side.
+ *
+ * Ingress body is parsed with GrpcMessageCodec and the subclass sees whole
+ * messages (onGrpcMessage) and the call's final status (onGrpcComplete).
+ * pauseMessages holds back delivery and pauses the transaction, so the
+ * stream's flow control window stops opening until the application is ready
+ * for another message.
+ *
+ * Egress frames messages (compressed when both ends allow it) and ends the
+ * call with trailers.  A server that fails before sending a message uses a
+ * Trailers-Only response, which is a single HEADERS frame.
+ *
+ * Subclasses that delete themselves should do so in detachTransaction after
+ * calling GrpcTransactionHandler::detachTransaction, and nowhere else.
+ */
+class GrpcTransactionHandler
+    : public HTTPTransactionHandler
+    , private GrpcMessageCodec::Callback {
+ public:
+  struct Options {
+    uint32_t maxMessageSize{kDefaultGrpcMaxMessageSize};
+    // Used for sent messages when the peer accepts it
+    CompressionType egressCompression{CompressionType::NONE};
+    int compressionLevel{-1};
+    // If non-zero, raise the stream receive window to this, so a large
+    // message does not wait a round trip per window update
+    uint32_t receiveWindow{0};
+  };
+
+  GrpcTransactionHandler();
+  explicit GrpcTransactionHandler(Options options);
+
+  // Request headers for a server, response headers for a client
+  virtual void onGrpcHeaders(std::unique_ptr<HTTPMessage> msg) noexcept = 0;
+
+  virtual void onGrpcMessage(
+      std::unique_ptr<folly::IOBuf> message) noexcept = 0;
+
+  /**
+   * Ingress is complete and every message was delivered.  A client gets the
+   * status from the trailers; a server gets OK, meaning the client
+   * half-closed.
+   */
+  virtual void onGrpcComplete(GrpcStatus status,
+                              const std::string& message) noexcept = 0;
+
+  /**
+   * The call failed: a malformed or oversized message, an unsupported
+   * encoding, a non-gRPC response, or a transport error.  No more messages
+   * are delivered.  Unless the transaction has already failed, a server
+   * should end the call with sendStatus and a client with sendAbort.
+   */
+  virtual void onGrpcError(GrpcStatus status,
+                           const std::string& message) noexcept = 0;
+
+  /**
+   * Client: send the request headers.  The method, content-type, te and
+   * encoding headers are filled in.
+   */
+  void sendRequest(HTTPMessage request);
+
+  // Server: send response headers, otherwise sent with the first message
+  void sendResponseHeaders(HTTPMessage response);
+
+  // Returns false if the message could not be framed
+  bool sendMessage(std::unique_ptr<folly::IOBuf> message);
+
+  // Client: half-close the call once all messages are sent
+  void sendEndOfMessages();
+
+  // Server: end the call with grpc-status and grpc-message trailers
+  void sendStatus(GrpcStatus status,
+                  folly::StringPiece message = folly::StringPiece());
+
+  void pauseMessages();
+  void resumeMessages();
+
+  HTTPTransaction* getTransaction() const {
+    return txn_;
+  }
+
+  const GrpcMessageCodec& getCodec() const {
+    return codec_;
+  }
+
+  // HTTPTransactionHandler methods
+  void setTransaction(HTTPTransaction* txn) noexcept override;
+  void detachTransaction() noexcept override;
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override;
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+  void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override;
+  void onEOM() noexcept override;
+  void onUpgrade(UpgradeProtocol protocol) noexcept override;
+  void onError(const HTTPException& error) noexcept override;
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+ protected:
+  HTTPTransaction* txn_{nullptr};
+
+ private:
+  // GrpcMessageCodec::Callback
+  void onMessage(std::unique_ptr<folly::IOBuf> message) override;
+  void onMessagesComplete() override;
+  void onError(GrpcStatus status, const std::string& error) override;
+
+  bool isServer() const {
+    return txn_ && txn_->isDownstream();
+  }
+  void addGrpcHeaders(HTTPMessage& msg) const;
+  void setStatus(const HTTPHeaders& headers);
+  void fail(GrpcStatus status, const std::string& message);
+
+  const Options options_;
+  GrpcMessageCodec codec_;
+  // Chosen once the peer's grpc-accept-encoding is known
+  CompressionType egressCompression_{CompressionType::NONE};
+  // From the response trailers (or Trailers-Only headers)
+  folly::Optional<GrpcStatus> status_;
+  std::string statusMessage_;
+  bool headersSent_{false};
+  bool failed_{false};
+};
+
+/**
+ * The gRPC status for a response that is not a gRPC response, following
+ * the HTTP to gRPC status code mapping.
+ */
+GrpcStatus httpStatusToGrpcStatus(uint16_t httpStatus);
+
+} // namespace proxygen
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <proxygen/lib/http/experimental/GrpcMessageCodec.h>
+
+using namespace proxygen;
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+namespace {
+
+class CountingCallback : public GrpcMessageCodec::Callback {
+ public:
+  void onMessage(std::unique_ptr<IOBuf> message) override {
+    bytes += message->computeChainDataLength();
+  }
+  void onMessagesComplete() override {
+  }
+  void onError(GrpcStatus, const std::string&) override {
+    CHECK(false);
+  }
+  uint64_t bytes{0};
+};
+
+std::unique_ptr<IOBuf> makeStream(size_t messageSize,
+                                  size_t numMessages,
+                                  CompressionType compression) {
+  IOBufQueue writeBuf{IOBufQueue::cacheChainLength()};
+  for (size_t i = 0; i < numMessages; i++) {
+    auto message = IOBuf::create(messageSize);
+    memset(message->writableData(), 'a' + i % 26, messageSize);
+    message->append(messageSize);
+    GrpcMessageCodec::serialize(writeBuf, std::move(message), compression);
+  }
+  return writeBuf.move();
+}
+
+// Feed the stream in HTTP/2 DATA frame sized chunks
+void parseStream(uint32_t iters,
+                 size_t messageSize,
+                 size_t numMessages,
+                 CompressionType compression = CompressionType::NONE) {
+  std::unique_ptr<IOBuf> input;
+  BENCHMARK_SUSPEND {
+    input = makeStream(messageSize, numMessages, compression);
+    input->coalesce();
+  }
+  for (uint32_t i = 0; i < iters; i++) {
+    GrpcMessageCodec codec;
+    CountingCallback callback;
+    codec.setCallback(&callback);
+    codec.setIngressCompression(compression);
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    queue.append(input->clone());
+    while (!queue.empty()) {
+      codec.onIngress(
+          queue.split(std::min<size_t>(16384, queue.chainLength())));
+    }
+    codec.onIngressEOM();
+    folly::doNotOptimizeAway(callback.bytes);
+  }
+}
+
+void serializeMessages(uint32_t iters,
+                       size_t messageSize,
+                       CompressionType compression = CompressionType::NONE) {
+  std::unique_ptr<IOBuf> message;
+  BENCHMARK_SUSPEND {
+    message = IOBuf::create(messageSize);
+    memset(message->writableData(), 'x', messageSize);
+    message->append(messageSize);
+  }
+  for (uint32_t i = 0; i < iters; i++) {
+    IOBufQueue writeBuf{IOBufQueue::cacheChainLength()};
+    folly::doNotOptimizeAway(GrpcMessageCodec::serialize(
+        writeBuf, message->clone(), compression));
+  }
+}
+
+} // namespace
+
+// Unary: a single small message per call
+BENCHMARK(UnaryParse100B, iters) {
+  parseStream(iters, 100, 1);
+}
+
+BENCHMARK(UnarySerialize100B, iters) {
+  serializeMessages(iters, 100);
+}
+
+BENCHMARK(UnarySerialize100BGzip, iters) {
+  serializeMessages(iters, 100, CompressionType::GZIP);
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Streaming: many messages, most straddling DATA frame boundaries
+BENCHMARK(StreamingParse1000x1KB, iters) {
+  parseStream(iters, 1000, 1000);
+}
+
+BENCHMARK(StreamingParse100x100KB, iters) {
+  parseStream(iters, 100000, 100);
+}
+
+BENCHMARK(StreamingParse1000x1KBGzip, iters) {
+  parseStream(iters, 1000, 1000, CompressionType::GZIP);
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/experimental/GrpcMessageCodec.h>
+
+#include <folly/io/Cursor.h>
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using folly::IOBuf;
+using folly::IOBufQueue;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+class TestCallback : public GrpcMessageCodec::Callback {
+ public:
+  void onMessage(unique_ptr<IOBuf> message) override {
+    messages.push_back(message->moveToFbString().toStdString());
+    if (pauseOnMessage) {
+      codec->pause();
+    }
+  }
+  void onMessagesComplete() override {
+    complete = true;
+  }
+  void onError(GrpcStatus status, const string& /*error*/) override {
+    error = status;
+  }
+
+  GrpcMessageCodec* codec{nullptr};
+  std::vector<string> messages;
+  bool pauseOnMessage{false};
+  bool complete{false};
+  folly::Optional<GrpcStatus> error;
+};
+
+} // namespace
+
+class GrpcMessageCodecTest : public testing::Test {
+ public:
+  void SetUp() override {
+    callback_.codec = &codec_;
+    codec_.setCallback(&callback_);
+  }
+
+  unique_ptr<IOBuf> serialize(const std::vector<string>& messages,
+                              CompressionType compression =
+                                  CompressionType::NONE) {
+    IOBufQueue writeBuf{IOBufQueue::cacheChainLength()};
+    for (const auto& message : messages) {
+      auto len = GrpcMessageCodec::serialize(
+          writeBuf, IOBuf::copyBuffer(message), compression);
+      EXPECT_GT(len, 0);
+    }
+    return writeBuf.move();
+  }
+
+  // Feed input one chunkSize piece at a time
+  void parse(unique_ptr<IOBuf> input, size_t chunkSize) {
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    queue.append(std::move(input));
+    while (!queue.empty()) {
+      codec_.onIngress(
+          queue.split(std::min<size_t>(chunkSize, queue.chainLength())));
+    }
+  }
+
+ protected:
+  GrpcMessageCodec codec_;
+  TestCallback callback_;
+};
+
+TEST_F(GrpcMessageCodecTest, Serialize) {
+  IOBufQueue writeBuf{IOBufQueue::cacheChainLength()};
+  EXPECT_EQ(GrpcMessageCodec::serialize(writeBuf, IOBuf::copyBuffer("abc")),
+            8);
+  folly::io::Cursor cursor(writeBuf.front());
+  EXPECT_EQ(cursor.read<uint8_t>(), 0);
+  EXPECT_EQ(cursor.readBE<uint32_t>(), 3);
+  EXPECT_EQ(cursor.readFixedString(3), "abc");
+}
+
+TEST_F(GrpcMessageCodecTest, SplitAnywhere) {
+  std::vector<string> messages{"hello", "", string(1000, 'a'), "world"};
+  auto input = serialize(messages);
+  auto total = input->computeChainDataLength();
+  for (size_t chunkSize = 1; chunkSize <= total; chunkSize++) {
+    GrpcMessageCodec codec;
+    TestCallback callback;
+    callback.codec = &codec;
+    codec.setCallback(&callback);
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    queue.append(input->clone());
+    while (!queue.empty()) {
+      codec.onIngress(
+          queue.split(std::min<size_t>(chunkSize, queue.chainLength())));
+    }
+    codec.onIngressEOM();
+    EXPECT_EQ(callback.messages, messages) << "chunkSize=" << chunkSize;
+    EXPECT_TRUE(callback.complete);
+    EXPECT_FALSE(callback.error);
+    EXPECT_EQ(codec.getMessagesParsed(), messages.size());
+  }
+}
+
+TEST_F(GrpcMessageCodecTest, TooLarge) {
+  codec_.setMaxMessageSize(100);
+  parse(serialize({string(100, 'a'), string(101, 'b')}), 7);
+  EXPECT_EQ(callback_.messages.size(), 1);
+  EXPECT_EQ(callback_.error, GrpcStatus::RESOURCE_EXHAUSTED);
+  EXPECT_TRUE(codec_.hasError());
+  EXPECT_EQ(codec_.getBufferedBytes(), 0);
+}
+
+TEST_F(GrpcMessageCodecTest, InvalidFlags) {
+  auto input = serialize({"abc"});
+  input->writableData()[0] = 2;
+  parse(std::move(input), 100);
+  EXPECT_EQ(callback_.error, GrpcStatus::INTERNAL);
+}
+
+TEST_F(GrpcMessageCodecTest, EOMMidMessage) {
+  auto input = serialize({"hello"});
+  input->trimEnd(1);
+  parse(std::move(input), 100);
+  codec_.onIngressEOM();
+  EXPECT_TRUE(callback_.messages.empty());
+  EXPECT_FALSE(callback_.complete);
+  EXPECT_EQ(callback_.error, GrpcStatus::INTERNAL);
+}
+
+TEST_F(GrpcMessageCodecTest, Compressed) {
+  std::vector<string> messages{string(5000, 'x'), "", "short"};
+  for (auto type : {CompressionType::GZIP, CompressionType::DEFLATE}) {
+    GrpcMessageCodec codec;
+    TestCallback callback;
+    codec.setCallback(&callback);
+    codec.setIngressCompression(type);
+    auto input = serialize(messages, type);
+    EXPECT_LT(input->computeChainDataLength(), 5000);
+    codec.onIngress(std::move(input));
+    codec.onIngressEOM();
+    EXPECT_EQ(callback.messages, messages);
+    EXPECT_TRUE(callback.complete);
+  }
+}
+
+TEST_F(GrpcMessageCodecTest, CompressedWithoutEncoding) {
+  parse(serialize({"abc"}, CompressionType::GZIP), 100);
+  EXPECT_EQ(callback_.error, GrpcStatus::INTERNAL);
+}
+
+TEST_F(GrpcMessageCodecTest, DecompressedTooLarge) {
+  codec_.setMaxMessageSize(1000);
+  codec_.setIngressCompression(CompressionType::GZIP);
+  parse(serialize({string(2000, 'x')}, CompressionType::GZIP), 100);
+  EXPECT_TRUE(callback_.messages.empty());
+  EXPECT_EQ(callback_.error, GrpcStatus::RESOURCE_EXHAUSTED);
+}
+
+TEST_F(GrpcMessageCodecTest, DecompressionBomb) {
+  // 64MB of zeros compresses to a few tens of KB, well under the limit
+  // checked against the prefix, but must not be inflated past it
+  auto input = serialize({string(64 * 1024 * 1024, '\0')},
+                         CompressionType::GZIP);
+  EXPECT_LT(input->computeChainDataLength(), kDefaultGrpcMaxMessageSize);
+  codec_.setIngressCompression(CompressionType::GZIP);
+  codec_.onIngress(std::move(input));
+  EXPECT_TRUE(callback_.messages.empty());
+  EXPECT_EQ(callback_.error, GrpcStatus::RESOURCE_EXHAUSTED);
+
+  // The pooled stream is usable afterwards
+  GrpcMessageCodec codec;
+  TestCallback callback;
+  codec.setCallback(&callback);
+  codec.setIngressCompression(CompressionType::GZIP);
+  codec.onIngress(serialize({"after"}, CompressionType::GZIP));
+  EXPECT_EQ(callback.messages, std::vector<string>{"after"});
+  EXPECT_FALSE(callback.error);
+}
+
+TEST_F(GrpcMessageCodecTest, PauseResume) {
+  callback_.pauseOnMessage = true;
+  parse(serialize({"one", "two", "three"}), 100);
+  codec_.onIngressEOM();
+  EXPECT_EQ(callback_.messages.size(), 1);
+  EXPECT_TRUE(codec_.isPaused());
+  EXPECT_GT(codec_.getBufferedBytes(), 0);
+
+  codec_.resume();
+  EXPECT_EQ(callback_.messages.size(), 2);
+  EXPECT_FALSE(callback_.complete);
+
+  callback_.pauseOnMessage = false;
+  codec_.resume();
+  EXPECT_EQ(callback_.messages,
+            std::vector<string>({"one", "two", "three"}));
+  EXPECT_TRUE(callback_.complete);
+  EXPECT_EQ(codec_.getBufferedBytes(), 0);
+}
+
+TEST(GrpcPercentEncodingTest, RoundTrip) {
+  string message("50% done\r\n\xe2\x9c\x93");
+  auto encoded = grpcPercentEncode(message);
+  EXPECT_EQ(encoded, "50%25 done%0D%0A%E2%9C%93");
+  EXPECT_EQ(grpcPercentDecode(encoded), message);
+  // Malformed escapes are kept as is
+  EXPECT_EQ(grpcPercentDecode("100%"), "100%");
+  EXPECT_EQ(grpcPercentDecode("%zz"), "%zz");
+}
+
+TEST(GrpcEncodingTest, Names) {
+  EXPECT_EQ(grpcEncodingToCompressionType("identity"), CompressionType::NONE);
+  EXPECT_EQ(grpcEncodingToCompressionType("gzip"), CompressionType::GZIP);
+  EXPECT_EQ(grpcEncodingToCompressionType("deflate"),
+            CompressionType::DEFLATE);
+  EXPECT_FALSE(grpcEncodingToCompressionType("snappy"));
+  EXPECT_EQ(compressionTypeToGrpcEncoding(CompressionType::GZIP), "gzip");
+}
@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/experimental/GrpcTransactionHandler.h>
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+
+using namespace proxygen;
+using namespace testing;
+using folly::IOBuf;
+using folly::IOBufQueue;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+class TestGrpcHandler : public GrpcTransactionHandler {
+ public:
+  using GrpcTransactionHandler::GrpcTransactionHandler;
+
+  void onGrpcHeaders(unique_ptr<HTTPMessage> msg) noexcept override {
+    headers = std::move(msg);
+  }
+  void onGrpcMessage(unique_ptr<IOBuf> message) noexcept override {
+    messages.push_back(message->moveToFbString().toStdString());
+    if (pauseOnMessage) {
+      pauseMessages();
+    }
+  }
+  void onGrpcComplete(GrpcStatus status,
+                      const string& message) noexcept override {
+    complete = status;
+    statusMessage = message;
+  }
+  void onGrpcError(GrpcStatus status, const string& message) noexcept override {
+    error = status;
+    statusMessage = message;
+  }
+
+  unique_ptr<HTTPMessage> headers;
+  std::vector<string> messages;
+  bool pauseOnMessage{false};
+  folly::Optional<GrpcStatus> complete;
+  folly::Optional<GrpcStatus> error;
+  string statusMessage;
+};
+
+HTTPMessage makeGrpcRequest() {
+  HTTPMessage request;
+  request.setMethod(HTTPMethod::POST);
+  request.setURL("/test.Echo/Echo");
+  request.getHeaders().set(HTTP_HEADER_CONTENT_TYPE, kGrpcContentType);
+  return request;
+}
+
+unique_ptr<HTTPMessage> makeGrpcResponse(uint16_t statusCode = 200) {
+  auto response = std::make_unique<HTTPMessage>();
+  response->setStatusCode(statusCode);
+  response->getHeaders().set(HTTP_HEADER_CONTENT_TYPE, kGrpcContentType);
+  return response;
+}
+
+unique_ptr<IOBuf> serialize(const std::vector<string>& messages,
+                            CompressionType compression =
+                                CompressionType::NONE) {
+  IOBufQueue writeBuf{IOBufQueue::cacheChainLength()};
+  for (const auto& message : messages) {
+    GrpcMessageCodec::serialize(
+        writeBuf, IOBuf::copyBuffer(message), compression);
+  }
+  return writeBuf.move();
+}
+
+} // namespace
+
+class GrpcTransactionHandlerTest : public testing::Test {
+ protected:
+  // A client for UPSTREAM, a server for DOWNSTREAM
+  void start(TransportDirection direction,
+             GrpcTransactionHandler::Options options =
+                 GrpcTransactionHandler::Options()) {
+    txn_ = std::make_unique<NiceMock<MockHTTPTransaction>>(
+        direction, HTTPCodec::StreamID(1), 0, egressQueue_);
+    handler_ = std::make_unique<TestGrpcHandler>(options);
+    handler_->setTransaction(txn_.get());
+  }
+
+  // Server: receive a request, then capture the response
+  void startServer(GrpcTransactionHandler::Options options =
+                       GrpcTransactionHandler::Options(),
+                   folly::StringPiece acceptEncoding = "") {
+    start(TransportDirection::DOWNSTREAM, options);
+    auto request = std::make_unique<HTTPMessage>(makeGrpcRequest());
+    if (!acceptEncoding.empty()) {
+      request->getHeaders().set(kGrpcAcceptEncoding, acceptEncoding.str());
+    }
+    handler_->onHeadersComplete(std::move(request));
+    ASSERT_TRUE(handler_->headers);
+    ON_CALL(*txn_, sendHeaders(_))
+        .WillByDefault(SaveArg<0>(&sentHeaders_));
+    ON_CALL(*txn_, sendHeadersWithEOM(_))
+        .WillByDefault(SaveArg<0>(&sentHeaders_));
+    ON_CALL(*txn_, sendBody(_))
+        .WillByDefault(Invoke([this](std::shared_ptr<IOBuf> body) {
+          sentBody_.append(body->cloneCoalesced());
+        }));
+  }
+
+  HTTP2PriorityQueue egressQueue_;
+  unique_ptr<NiceMock<MockHTTPTransaction>> txn_;
+  unique_ptr<TestGrpcHandler> handler_;
+  HTTPMessage sentHeaders_;
+  IOBufQueue sentBody_{IOBufQueue::cacheChainLength()};
+};
+
+TEST_F(GrpcTransactionHandlerTest, ClientRequestHeaders) {
+  GrpcTransactionHandler::Options options;
+  options.egressCompression = CompressionType::GZIP;
+  start(TransportDirection::UPSTREAM, options);
+
+  HTTPMessage sent;
+  EXPECT_CALL(*txn_, sendHeaders(_)).WillOnce(SaveArg<0>(&sent));
+  HTTPMessage request;
+  request.setURL("/test.Echo/Echo");
+  handler_->sendRequest(request);
+
+  EXPECT_EQ(sent.getMethod(), HTTPMethod::POST);
+  const auto& headers = sent.getHeaders();
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_TE), "trailers");
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE),
+            kGrpcContentType);
+  EXPECT_EQ(headers.getSingleOrEmpty(kGrpcEncoding), "gzip");
+  EXPECT_EQ(headers.getSingleOrEmpty(kGrpcAcceptEncoding),
+            "identity,deflate,gzip");
+}
+
+TEST_F(GrpcTransactionHandlerTest, ClientStatusFromTrailers) {
+  start(TransportDirection::UPSTREAM);
+  handler_->onHeadersComplete(makeGrpcResponse());
+  ASSERT_TRUE(handler_->headers);
+  handler_->onBody(serialize({"hello", "world"}));
+  EXPECT_EQ(handler_->messages, (std::vector<string>{"hello", "world"}));
+
+  auto trailers = std::make_unique<HTTPHeaders>();
+  trailers->set(kGrpcStatus, "5");
+  trailers->set(kGrpcMessage, "caf%C3%A9 100%25");
+  handler_->onTrailers(std::move(trailers));
+  EXPECT_FALSE(handler_->complete);
+  handler_->onEOM();
+  EXPECT_EQ(handler_->complete, GrpcStatus::NOT_FOUND);
+  EXPECT_EQ(handler_->statusMessage, "caf\xC3\xA9 100%");
+  EXPECT_FALSE(handler_->error);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ClientMissingStatus) {
+  start(TransportDirection::UPSTREAM);
+  handler_->onHeadersComplete(makeGrpcResponse());
+  handler_->onBody(serialize({"hello"}));
+  handler_->onEOM();
+  EXPECT_EQ(handler_->complete, GrpcStatus::INTERNAL);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ClientInvalidStatus) {
+  start(TransportDirection::UPSTREAM);
+  handler_->onHeadersComplete(makeGrpcResponse());
+  auto trailers = std::make_unique<HTTPHeaders>();
+  trailers->set(kGrpcStatus, "99");
+  handler_->onTrailers(std::move(trailers));
+  handler_->onEOM();
+  EXPECT_EQ(handler_->complete, GrpcStatus::UNKNOWN);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ClientTrailersOnly) {
+  start(TransportDirection::UPSTREAM);
+  // The status is in the only HEADERS frame, which may omit content-type
+  auto response = std::make_unique<HTTPMessage>();
+  response->setStatusCode(200);
+  response->getHeaders().set(kGrpcStatus, "7");
+  response->getHeaders().set(kGrpcMessage, "denied");
+  handler_->onHeadersComplete(std::move(response));
+  ASSERT_TRUE(handler_->headers);
+  handler_->onEOM();
+  EXPECT_TRUE(handler_->messages.empty());
+  EXPECT_EQ(handler_->complete, GrpcStatus::PERMISSION_DENIED);
+  EXPECT_EQ(handler_->statusMessage, "denied");
+  EXPECT_FALSE(handler_->error);
+}
+
+TEST_F(GrpcTransactionHandlerTest, HTTPStatusToGrpcStatus) {
+  EXPECT_EQ(httpStatusToGrpcStatus(400), GrpcStatus::INTERNAL);
+  EXPECT_EQ(httpStatusToGrpcStatus(401), GrpcStatus::UNAUTHENTICATED);
+  EXPECT_EQ(httpStatusToGrpcStatus(403), GrpcStatus::PERMISSION_DENIED);
+  EXPECT_EQ(httpStatusToGrpcStatus(404), GrpcStatus::UNIMPLEMENTED);
+  EXPECT_EQ(httpStatusToGrpcStatus(429), GrpcStatus::UNAVAILABLE);
+  EXPECT_EQ(httpStatusToGrpcStatus(502), GrpcStatus::UNAVAILABLE);
+  EXPECT_EQ(httpStatusToGrpcStatus(503), GrpcStatus::UNAVAILABLE);
+  EXPECT_EQ(httpStatusToGrpcStatus(504), GrpcStatus::UNAVAILABLE);
+  EXPECT_EQ(httpStatusToGrpcStatus(500), GrpcStatus::UNKNOWN);
+  EXPECT_EQ(httpStatusToGrpcStatus(302), GrpcStatus::UNKNOWN);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ClientNonGrpcResponse) {
+  start(TransportDirection::UPSTREAM);
+  handler_->onHeadersComplete(makeGrpcResponse(503));
+  EXPECT_FALSE(handler_->headers);
+  EXPECT_EQ(handler_->error, GrpcStatus::UNAVAILABLE);
+
+  // Nothing more is delivered
+  handler_->onBody(serialize({"hello"}));
+  handler_->onEOM();
+  EXPECT_TRUE(handler_->messages.empty());
+  EXPECT_FALSE(handler_->complete);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ClientWrongContentType) {
+  start(TransportDirection::UPSTREAM);
+  auto response = makeGrpcResponse();
+  response->getHeaders().set(HTTP_HEADER_CONTENT_TYPE, "text/html");
+  handler_->onHeadersComplete(std::move(response));
+  EXPECT_FALSE(handler_->headers);
+  EXPECT_EQ(handler_->error, GrpcStatus::INTERNAL);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ClientCompressedResponse) {
+  start(TransportDirection::UPSTREAM);
+  auto response = makeGrpcResponse();
+  response->getHeaders().set(kGrpcEncoding, "gzip");
+  handler_->onHeadersComplete(std::move(response));
+  handler_->onBody(serialize({"hello", "world"}, CompressionType::GZIP));
+  EXPECT_EQ(handler_->messages, (std::vector<string>{"hello", "world"}));
+  EXPECT_FALSE(handler_->error);
+}
+
+TEST_F(GrpcTransactionHandlerTest, UnsupportedEncoding) {
+  start(TransportDirection::UPSTREAM);
+  auto response = makeGrpcResponse();
+  response->getHeaders().set(kGrpcEncoding, "snappy");
+  handler_->onHeadersComplete(std::move(response));
+  EXPECT_FALSE(handler_->headers);
+  EXPECT_EQ(handler_->error, GrpcStatus::INTERNAL);
+
+  // A server tells the client it does not implement it
+  start(TransportDirection::DOWNSTREAM);
+  auto request = std::make_unique<HTTPMessage>(makeGrpcRequest());
+  request->getHeaders().set(kGrpcEncoding, "snappy");
+  handler_->onHeadersComplete(std::move(request));
+  EXPECT_FALSE(handler_->headers);
+  EXPECT_EQ(handler_->error, GrpcStatus::UNIMPLEMENTED);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ServerStatusTrailers) {
+  startServer();
+  handler_->onBody(serialize({"ping"}));
+  handler_->onEOM();
+  EXPECT_EQ(handler_->messages, (std::vector<string>{"ping"}));
+  EXPECT_EQ(handler_->complete, GrpcStatus::OK);
+
+  // The response headers go out with the first message
+  EXPECT_CALL(*txn_, sendHeaders(_));
+  EXPECT_CALL(*txn_, sendBody(_));
+  EXPECT_TRUE(handler_->sendMessage(IOBuf::copyBuffer("pong")));
+  EXPECT_EQ(sentHeaders_.getStatusCode(), 200);
+  EXPECT_EQ(sentHeaders_.getHeaders().getSingleOrEmpty(
+                HTTP_HEADER_CONTENT_TYPE),
+            kGrpcContentType);
+  EXPECT_FALSE(sentHeaders_.getHeaders().exists(kGrpcEncoding));
+  EXPECT_EQ(sentBody_.chainLength(), kGrpcMessagePrefixSize + 4);
+
+  HTTPHeaders trailers;
+  EXPECT_CALL(*txn_, sendTrailers(_)).WillOnce(SaveArg<0>(&trailers));
+  EXPECT_CALL(*txn_, sendEOM());
+  EXPECT_CALL(*txn_, sendHeadersWithEOM(_)).Times(0);
+  handler_->sendStatus(GrpcStatus::ABORTED, "100%");
+  EXPECT_EQ(trailers.getSingleOrEmpty(kGrpcStatus), "10");
+  EXPECT_EQ(trailers.getSingleOrEmpty(kGrpcMessage), "100%25");
+}
+
+TEST_F(GrpcTransactionHandlerTest, ServerTrailersOnly) {
+  startServer();
+  // Failing before any message sends a single HEADERS frame
+  EXPECT_CALL(*txn_, sendHeadersWithEOM(_));
+  EXPECT_CALL(*txn_, sendHeaders(_)).Times(0);
+  EXPECT_CALL(*txn_, sendTrailers(_)).Times(0);
+  EXPECT_CALL(*txn_, sendEOM()).Times(0);
+  handler_->sendStatus(GrpcStatus::NOT_FOUND, "no such method");
+
+  const auto& headers = sentHeaders_.getHeaders();
+  EXPECT_EQ(sentHeaders_.getStatusCode(), 200);
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE),
+            kGrpcContentType);
+  EXPECT_EQ(headers.getSingleOrEmpty(kGrpcStatus), "5");
+  EXPECT_EQ(headers.getSingleOrEmpty(kGrpcMessage), "no such method");
+}
+
+TEST_F(GrpcTransactionHandlerTest, ServerCompressesWhenAccepted) {
+  GrpcTransactionHandler::Options options;
+  options.egressCompression = CompressionType::GZIP;
+  startServer(options, "identity, gzip");
+
+  EXPECT_TRUE(handler_->sendMessage(IOBuf::copyBuffer("pong")));
+  EXPECT_EQ(sentHeaders_.getHeaders().getSingleOrEmpty(kGrpcEncoding), "gzip");
+  ASSERT_GT(sentBody_.chainLength(), kGrpcMessagePrefixSize);
+  // The compressed flag
+  EXPECT_EQ(sentBody_.front()->data()[0], 1);
+}
+
+TEST_F(GrpcTransactionHandlerTest, ServerDoesNotCompressUnlessAccepted) {
+  GrpcTransactionHandler::Options options;
+  options.egressCompression = CompressionType::GZIP;
+  startServer(options, "identity,deflate");
+
+  EXPECT_TRUE(handler_->sendMessage(IOBuf::copyBuffer("pong")));
+  EXPECT_FALSE(sentHeaders_.getHeaders().exists(kGrpcEncoding));
+  EXPECT_EQ(sentBody_.chainLength(), kGrpcMessagePrefixSize + 4);
+  EXPECT_EQ(sentBody_.front()->data()[0], 0);
+}
+
+TEST_F(GrpcTransactionHandlerTest, PauseResume) {
+  start(TransportDirection::UPSTREAM);
+  handler_->onHeadersComplete(makeGrpcResponse());
+
+  // Paused, messages are buffered and the stream stops reading
+  EXPECT_CALL(*txn_, pauseIngress());
+  handler_->pauseMessages();
+  Mock::VerifyAndClearExpectations(txn_.get());
+  handler_->onBody(serialize({"one", "two"}));
+  auto trailers = std::make_unique<HTTPHeaders>();
+  trailers->set(kGrpcStatus, "0");
+  handler_->onTrailers(std::move(trailers));
+  handler_->onEOM();
+  EXPECT_TRUE(handler_->messages.empty());
+  EXPECT_FALSE(handler_->complete);
+
+  // A handler that pauses again from onGrpcMessage gets one message, and
+  // the stream stays paused
+  handler_->pauseOnMessage = true;
+  EXPECT_CALL(*txn_, pauseIngress());
+  EXPECT_CALL(*txn_, resumeIngress()).Times(0);
+  handler_->resumeMessages();
+  Mock::VerifyAndClearExpectations(txn_.get());
+  EXPECT_EQ(handler_->messages, (std::vector<string>{"one"}));
+  EXPECT_FALSE(handler_->complete);
+
+  handler_->pauseOnMessage = false;
+  EXPECT_CALL(*txn_, resumeIngress());
+  handler_->resumeMessages();
+  EXPECT_EQ(handler_->messages, (std::vector<string>{"one", "two"}));
+  EXPECT_EQ(handler_->complete, GrpcStatus::OK);
+}
+
+TEST_F(GrpcTransactionHandlerTest, TransportErrors) {
+  start(TransportDirection::UPSTREAM);
+  HTTPException timeout(HTTPException::Direction::INGRESS_AND_EGRESS,
+                        "timeout");
+  timeout.setProxygenError(kErrorTimeout);
+  handler_->onError(timeout);
+  EXPECT_EQ(handler_->error, GrpcStatus::DEADLINE_EXCEEDED);
+
+  start(TransportDirection::UPSTREAM);
+  HTTPException cancel(HTTPException::Direction::INGRESS_AND_EGRESS,
+                       "cancel");
+  cancel.setCodecStatusCode(ErrorCode::CANCEL);
+  handler_->onError(cancel);
+  EXPECT_EQ(handler_->error, GrpcStatus::CANCELLED);
+}
@@ -11,14 +11,102 @@
 #include <folly/io/async/DelayedDestruction.h>
 #include <string>
 
+namespace {
+
+// Initial ring capacity, must be a power of 2
+constexpr size_t kInitialRingSize = 16;
+
+/**
+ * The ByteEvent handed to callbacks for a ByteEventRecord.  Unlike
+ * TransactionByteEvent it does not hold its own pending byte event on the
+ * transaction, the record's reference is released after dispatch.
+ */
+class RecordByteEvent : public proxygen::ByteEvent {
+ public:
+  RecordByteEvent(uint64_t byteOffset,
+                  EventType eventType,
+                  proxygen::HTTPTransaction* txn,
+                  proxygen::TimePoint pingRequestReceivedTime,
+                  Callback callback)
+      : ByteEvent(byteOffset, eventType, std::move(callback)),
+        txn_(txn),
+        pingRequestReceivedTime_(pingRequestReceivedTime) {
+  }
+
+  proxygen::HTTPTransaction* getTransaction() const override {
+    return txn_;
+  }
+
+  int64_t getLatency() override {
+    if (eventType_ != PING_REPLY_SENT) {
+      return -1;
+    }
+    return proxygen::millisecondsSince(pingRequestReceivedTime_).count();
+  }
+
+ private:
+  proxygen::HTTPTransaction* txn_;
+  proxygen::TimePoint pingRequestReceivedTime_;
+};
+
+} // namespace
+
 namespace proxygen {
 
+void ByteEventTracker::EventRing::insert(size_t pos,
+                                         const ByteEventRecord& record) {
+  DCHECK_LE(pos, size_);
+  if (size_ == records_.size()) {
+    std::vector<ByteEventRecord> grown(
+        std::max(kInitialRingSize, records_.size() * 2));
+    for (size_t i = 0; i < size_; i++) {
+      grown[i] = (*this)[i];
+    }
+    records_.swap(grown);
+    head_ = 0;
+  }
+  // Shift the tail up by one, pings are the only out of order inserts and
+  // usually land near the back
+  for (size_t i = size_; i > pos; i--) {
+    (*this)[i] = (*this)[i - 1];
+  }
+  size_++;
+  (*this)[pos] = record;
+}
+
 ByteEventTracker::~ByteEventTracker() {
   drainByteEvents();
 }
 
 void ByteEventTracker::absorb(ByteEventTracker&& other) {
-  byteEvents_ = std::move(other.byteEvents_);
+  drainByteEvents();
+  std::swap(byteEvents_, other.byteEvents_);
+  std::swap(callbackPool_, other.callbackPool_);
+  std::swap(freeCallbacks_, other.freeCallbacks_);
+}
+
+uint32_t ByteEventTracker::storeCallback(ByteEvent::Callback callback) {
+  if (!callback) {
+    return kNoCallback;
+  }
+  if (freeCallbacks_.empty()) {
+    callbackPool_.emplace_back(std::move(callback));
+    return static_cast<uint32_t>(callbackPool_.size() - 1);
+  }
+  auto index = freeCallbacks_.back();
+  freeCallbacks_.pop_back();
+  callbackPool_[index] = std::move(callback);
+  return index;
+}
+
+ByteEvent::Callback ByteEventTracker::takeCallback(uint32_t index) {
+  if (index == kNoCallback) {
+    return nullptr;
+  }
+  auto callback = std::move(callbackPool_[index]);
+  callbackPool_[index] = nullptr;
+  freeCallbacks_.push_back(index);
+  return callback;
 }
 
 // The purpose of self is to represent shared ownership during
@@ -30,13 +118,23 @@ bool ByteEventTracker::processByteEvents(std::shared_ptr<ByteEventTracker> self,
   DCHECK(bytesWritten >= bytesWritten_);
   bytesWritten_ = bytesWritten;
 
+  // Every event covered by this write is handled in this pass.  Each record
+  // is removed before its callbacks run, in case a callback absorbs this
+  // ByteEventTracker or adds more events.
   while (!byteEvents_.empty() &&
-         (byteEvents_.front().byteOffset_ <= bytesWritten)) {
-    ByteEvent& event = byteEvents_.front();
-    int64_t latency;
-    auto txn = event.getTransaction();
+         (byteEvents_.front().byteOffset <= bytesWritten)) {
+    auto record = byteEvents_.front();
+    byteEvents_.pop_front();
+    RecordByteEvent event(record.byteOffset,
+                          record.eventType,
+                          record.txn,
+                          record.pingRequestReceivedTime,
+                          takeCallback(record.callbackIndex));
+    event.timestampTx_ = record.timestampTx;
+    event.timestampAck_ = record.timestampAck;
+    auto txn = record.txn;
 
-    switch (event.eventType_) {
+    switch (record.eventType) {
       case ByteEvent::FIRST_HEADER_BYTE:
         txn->onEgressHeaderFirstByte();
         break;
@@ -50,9 +148,8 @@ bool ByteEventTracker::processByteEvents(std::shared_ptr<ByteEventTracker> self,
         txn->onEgressTrackedByte();
         break;
       case ByteEvent::PING_REPLY_SENT:
-        latency = event.getLatency();
         if (callback_) {
-          callback_->onPingReplyLatency(latency);
+          callback_->onPingReplyLatency(event.getLatency());
         }
         break;
       case ByteEvent::SECOND_TO_LAST_PACKET:
@@ -72,9 +169,9 @@ bool ByteEventTracker::processByteEvents(std::shared_ptr<ByteEventTracker> self,
       event.callback_(event);
     }
     VLOG(5) << " removing ByteEvent " << event;
-    // explicitly remove from the list, in case delete event triggers a
-    // callback that would absorb this ByteEventTracker.
-    byteEvents_.pop_front_and_dispose([](ByteEvent* event) { delete event; });
+    if (txn) {
+      txn->decrementPendingByteEvents();
+    }
   }
 
   return self.use_count() == 1;
@@ -84,19 +181,37 @@ size_t ByteEventTracker::drainByteEvents() {
   size_t numEvents = 0;
   // everything is dead from here on, let's just drop all extra refs to txns
   while (!byteEvents_.empty()) {
-    byteEvents_.pop_front_and_dispose([](ByteEvent* event) { delete event; });
+    auto record = byteEvents_.front();
+    byteEvents_.pop_front();
+    takeCallback(record.callbackIndex);
+    if (record.txn) {
+      record.txn->decrementPendingByteEvents();
+    }
     ++numEvents;
   }
   return numEvents;
 }
 
+ByteEventTracker::ByteEventRecord& ByteEventTracker::addTransactionByteEvent(
+    uint64_t offset,
+    ByteEvent::EventType eventType,
+    HTTPTransaction* txn,
+    ByteEvent::Callback callback) {
+  txn->incrementPendingByteEvents();
+  byteEvents_.push_back(ByteEventRecord{offset,
+                                        txn,
+                                        TimePoint(),
+                                        storeCallback(std::move(callback)),
+                                        eventType});
+  return byteEvents_[byteEvents_.size() - 1];
+}
+
 void ByteEventTracker::addLastByteEvent(HTTPTransaction* txn,
                                         uint64_t byteNo,
                                         ByteEvent::Callback callback) noexcept {
   VLOG(5) << " adding last byte event for " << byteNo;
-  TransactionByteEvent* event =
-      new TransactionByteEvent(byteNo, ByteEvent::LAST_BYTE, txn, callback);
-  byteEvents_.push_back(*event);
+  addTransactionByteEvent(
+      byteNo, ByteEvent::LAST_BYTE, txn, std::move(callback));
 }
 
 void ByteEventTracker::addTrackedByteEvent(
@@ -104,46 +219,43 @@ void ByteEventTracker::addTrackedByteEvent(
     uint64_t byteNo,
     ByteEvent::Callback callback) noexcept {
   VLOG(5) << " adding tracked byte event for " << byteNo;
-  TransactionByteEvent* event =
-      new TransactionByteEvent(byteNo, ByteEvent::TRACKED_BYTE, txn, callback);
-  byteEvents_.push_back(*event);
+  addTransactionByteEvent(
+      byteNo, ByteEvent::TRACKED_BYTE, txn, std::move(callback));
 }
 
 void ByteEventTracker::addPingByteEvent(size_t pingSize,
                                         TimePoint timestamp,
                                         uint64_t bytesScheduled,
                                         ByteEvent::Callback callback) {
-  // register a byte event on ping reply sent, and adjust the byteOffset_
+  // register a byte event on ping reply sent, and adjust the byteOffset
   // for others by one ping size
   uint64_t offset = bytesScheduled + pingSize;
-  auto i = byteEvents_.rbegin();
-  for (; i != byteEvents_.rend(); ++i) {
-    if (i->byteOffset_ > bytesScheduled) {
-      VLOG(5) << "pushing back ByteEvent from " << *i << " to "
-              << ByteEvent(i->byteOffset_ + pingSize, i->eventType_);
-      i->byteOffset_ += pingSize;
+  size_t pos = byteEvents_.size();
+  for (; pos > 0; --pos) {
+    auto& record = byteEvents_[pos - 1];
+    if (record.byteOffset > bytesScheduled) {
+      VLOG(5) << "pushing back ByteEvent from "
+              << ByteEvent(record.byteOffset, record.eventType) << " to "
+              << ByteEvent(record.byteOffset + pingSize, record.eventType);
+      record.byteOffset += pingSize;
     } else {
       break; // the rest of the events are already scheduled
     }
   }
 
-  ByteEvent* be = new PingByteEvent(offset, timestamp, callback);
-  if (i == byteEvents_.rend()) {
-    byteEvents_.push_front(*be);
-  } else if (i == byteEvents_.rbegin()) {
-    byteEvents_.push_back(*be);
-  } else {
-    --i;
-    CHECK_GT(i->byteOffset_, bytesScheduled);
-    byteEvents_.insert(i.base(), *be);
-  }
+  byteEvents_.insert(pos,
+                     ByteEventRecord{offset,
+                                     nullptr,
+                                     timestamp,
+                                     storeCallback(std::move(callback)),
+                                     ByteEvent::PING_REPLY_SENT});
 }
 
 void ByteEventTracker::addFirstBodyByteEvent(uint64_t offset,
                                              HTTPTransaction* txn,
                                              ByteEvent::Callback callback) {
-  byteEvents_.push_back(
-      *new TransactionByteEvent(offset, ByteEvent::FIRST_BYTE, txn, callback));
+  addTransactionByteEvent(
+      offset, ByteEvent::FIRST_BYTE, txn, std::move(callback));
 }
 
 void ByteEventTracker::addFirstHeaderByteEvent(uint64_t offset,
@@ -151,8 +263,8 @@ void ByteEventTracker::addFirstHeaderByteEvent(uint64_t offset,
                                                ByteEvent::Callback callback) {
   // onWriteSuccess() is called after the entire header has been written.
   // It does not catch partial write case.
-  byteEvents_.push_back(*new TransactionByteEvent(
-      offset, ByteEvent::FIRST_HEADER_BYTE, txn, callback));
+  addTransactionByteEvent(
+      offset, ByteEvent::FIRST_HEADER_BYTE, txn, std::move(callback));
 }
 
 } // namespace proxygen
@@ -11,7 +11,9 @@
 #include <proxygen/lib/http/session/AckLatencyEvent.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <proxygen/lib/http/session/TransactionByteEvents.h>
+#include <limits>
 #include <proxygen/lib/utils/Time.h>
+#include <vector>
 
 namespace proxygen {
 
@@ -24,6 +26,12 @@ class TTLBAStats;
  * the byte has been written on the wire, or acknowledged.
  *
  * Subclasses may implement handling of acknowledgement timing.
+ *
+ * Pending events are kept as fixed-size records in a ring buffer ordered by
+ * offset, so tracking an event does not allocate once the ring has grown to
+ * the session's working set.  Callbacks attached to events are kept in a
+ * reusable pool.  processByteEvents hands each covered record to the
+ * callbacks as a ByteEvent that only lives for the duration of the call.
  */
 class ByteEventTracker {
  public:
@@ -141,13 +149,84 @@ class ByteEventTracker {
   virtual void setTTLBAStats(TTLBAStats* /* stats */) {
   }
 
+  size_t getNumPendingByteEvents() const {
+    return byteEvents_.size();
+  }
+
  protected:
+  static constexpr uint32_t kNoCallback = std::numeric_limits<uint32_t>::max();
+
+  struct ByteEventRecord {
+    uint64_t byteOffset;
+    // Holds a pending byte event reference, nullptr for PING_REPLY_SENT
+    HTTPTransaction* txn;
+    // PING_REPLY_SENT only
+    TimePoint pingRequestReceivedTime;
+    // Index into callbackPool_
+    uint32_t callbackIndex;
+    ByteEvent::EventType eventType;
+    // Set by TX and ACK-tracking subclasses, copied to ByteEvent::timestamp*_
+    bool timestampTx{false};
+    bool timestampAck{false};
+  };
+
+  /**
+   * Growable ring buffer of ByteEventRecords.  Records are appended in offset
+   * order; insert() is only needed for ping replies, which are scheduled
+   * ahead of buffered egress.
+   */
+  class EventRing {
+   public:
+    bool empty() const {
+      return size_ == 0;
+    }
+    size_t size() const {
+      return size_;
+    }
+    ByteEventRecord& operator[](size_t i) {
+      return records_[(head_ + i) & (records_.size() - 1)];
+    }
+    ByteEventRecord& front() {
+      return (*this)[0];
+    }
+    void push_back(const ByteEventRecord& record) {
+      insert(size_, record);
+    }
+    void pop_front() {
+      DCHECK(!empty());
+      head_ = (head_ + 1) & (records_.size() - 1);
+      size_--;
+    }
+    void insert(size_t pos, const ByteEventRecord& record);
+    void clear() {
+      head_ = 0;
+      size_ = 0;
+    }
+
+   private:
+    std::vector<ByteEventRecord> records_;
+    size_t head_{0};
+    size_t size_{0};
+  };
+
+  // Returns the new record, valid until byteEvents_ is next modified
+  ByteEventRecord& addTransactionByteEvent(uint64_t offset,
+                                           ByteEvent::EventType eventType,
+                                           HTTPTransaction* txn,
+                                           ByteEvent::Callback callback);
+  uint32_t storeCallback(ByteEvent::Callback callback);
+  ByteEvent::Callback takeCallback(uint32_t index);
+
   // the last value of byteWritten passed to processByteEvents
   // should always increase
   uint64_t bytesWritten_ = 0;
 
-  // byteEvents_ is in the ascending order of ByteEvent::byteOffset_
-  folly::CountedIntrusiveList<ByteEvent, &ByteEvent::listHook> byteEvents_;
+  // byteEvents_ is in the ascending order of ByteEventRecord::byteOffset
+  EventRing byteEvents_;
+
+  // Callbacks of pending events, slots are reused through freeCallbacks_
+  std::vector<ByteEvent::Callback> callbackPool_;
+  std::vector<uint32_t> freeCallbacks_;
 
   Callback* callback_;
 };
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/DatagramBuffer.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+#include <ostream>
+
+namespace proxygen {
+
+std::ostream& operator<<(std::ostream& os, DatagramDropPolicy policy) {
+  switch (policy) {
+    case DatagramDropPolicy::DROP_NEWEST:
+      return os << "drop_newest";
+    case DatagramDropPolicy::DROP_OLDEST:
+      return os << "drop_oldest";
+    case DatagramDropPolicy::PRIORITY:
+      return os << "priority";
+  }
+  return os << "unknown";
+}
+
+void DatagramBuffer::Ring::push(Entry entry) {
+  bytes += entry.length;
+  slots[(head + size) % slots.size()] = std::move(entry);
+  size++;
+}
+
+DatagramBuffer::Entry DatagramBuffer::Ring::pop() {
+  auto entry = std::move(slots[head]);
+  head = (head + 1) % slots.size();
+  size--;
+  bytes -= entry.length;
+  return entry;
+}
+
+DatagramBuffer::DatagramBuffer() : DatagramBuffer(Params()) {
+}
+
+DatagramBuffer::DatagramBuffer(Params params) : params_(params) {
+  streams_.reserve(params_.maxStreams);
+}
+
+DatagramBuffer::Dropped DatagramBuffer::setParams(Params params) {
+  params_ = params;
+  spareRings_.clear();
+  // Put everything back through add() in arrival order, so the new limits
+  // and policy decide what stays
+  std::vector<std::pair<uint64_t, Entry>> entries;
+  for (auto& stream : streams_) {
+    while (stream.second.size > 0) {
+      entries.emplace_back(stream.first, stream.second.pop());
+    }
+  }
+  streams_.clear();
+  totalBytes_ = 0;
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+    return a.second.seq < b.second.seq;
+  });
+  auto buffered = stats_.buffered;
+  Dropped dropped;
+  for (auto& entry : entries) {
+    auto res = add(entry.first, std::move(entry.second.buf));
+    dropped.datagrams += res.datagrams;
+    dropped.bytes += res.bytes;
+  }
+  stats_.buffered = buffered;
+  return dropped;
+}
+
+DatagramBuffer::Dropped DatagramBuffer::add(
+    uint64_t streamId, std::unique_ptr<folly::IOBuf> datagram) {
+  Dropped dropped;
+  uint64_t length = datagram ? datagram->computeChainDataLength() : 0;
+  auto dropArriving = [&] {
+    dropped.datagrams++;
+    dropped.bytes += length;
+    stats_.dropped++;
+    stats_.droppedBytes += length;
+    return dropped;
+  };
+  if (params_.maxStreams == 0 || params_.maxDatagramsPerStream == 0 ||
+      length > params_.maxBytesPerStream || length > params_.maxBytes) {
+    return dropArriving();
+  }
+  bool dropNewest = params_.dropPolicy == DatagramDropPolicy::DROP_NEWEST;
+
+  // Make room within the stream. Its datagrams are equally urgent, so the
+  // priority policy drops the oldest here too.
+  auto it = streams_.find(streamId);
+  while (it != streams_.end() &&
+         (it->second.full() ||
+          it->second.bytes + length > params_.maxBytesPerStream)) {
+    if (dropNewest) {
+      return dropArriving();
+    }
+    dropOldest(it, dropped);
+    it = streams_.find(streamId);
+  }
+
+  // Make room across streams
+  while ((it == streams_.end() && streams_.size() >= params_.maxStreams) ||
+         totalBytes_ + length > params_.maxBytes) {
+    if (dropNewest) {
+      return dropArriving();
+    }
+    auto victim = pickVictim(streamId);
+    if (victim == streams_.end()) {
+      return dropArriving();
+    }
+    if (it == streams_.end() && streams_.size() >= params_.maxStreams) {
+      // A whole stream has to go to make room for a new one
+      auto victimId = victim->first;
+      while (victim != streams_.end()) {
+        dropOldest(victim, dropped);
+        victim = streams_.find(victimId);
+      }
+    } else {
+      dropOldest(victim, dropped);
+    }
+    it = streams_.find(streamId);
+  }
+
+  if (it == streams_.end()) {
+    it = streams_.emplace(streamId, makeRing()).first;
+  }
+  it->second.push(Entry{std::move(datagram), length, nextSeq_++});
+  totalBytes_ += length;
+  stats_.buffered++;
+  return dropped;
+}
+
+DatagramBuffer::Dropped DatagramBuffer::erase(uint64_t streamId) {
+  Dropped dropped;
+  auto it = streams_.find(streamId);
+  while (it != streams_.end()) {
+    dropOldest(it, dropped);
+    it = streams_.find(streamId);
+  }
+  return dropped;
+}
+
+void DatagramBuffer::clear() {
+  streams_.clear();
+  spareRings_.clear();
+  totalBytes_ = 0;
+}
+
+size_t DatagramBuffer::getNumBuffered(uint64_t streamId) const {
+  auto it = streams_.find(streamId);
+  return it == streams_.end() ? 0 : it->second.size;
+}
+
+DatagramBuffer::Ring DatagramBuffer::makeRing() {
+  Ring ring;
+  if (!spareRings_.empty()) {
+    ring.slots = std::move(spareRings_.back());
+    spareRings_.pop_back();
+  } else {
+    ring.slots.resize(params_.maxDatagramsPerStream);
+  }
+  return ring;
+}
+
+void DatagramBuffer::recycle(Ring ring) {
+  DCHECK_EQ(ring.size, 0);
+  if (ring.slots.size() == params_.maxDatagramsPerStream &&
+      spareRings_.size() < params_.maxStreams) {
+    spareRings_.emplace_back(std::move(ring.slots));
+  }
+}
+
+void DatagramBuffer::dropOldest(
+    folly::F14FastMap<uint64_t, Ring>::iterator it, Dropped& dropped) {
+  auto entry = it->second.pop();
+  totalBytes_ -= entry.length;
+  dropped.datagrams++;
+  dropped.bytes += entry.length;
+  stats_.dropped++;
+  stats_.droppedBytes += entry.length;
+  if (it->second.size == 0) {
+    auto ring = std::move(it->second);
+    streams_.erase(it);
+    recycle(std::move(ring));
+  }
+}
+
+folly::F14FastMap<uint64_t, DatagramBuffer::Ring>::iterator
+DatagramBuffer::pickVictim(uint64_t streamId) {
+  auto victim = streams_.end();
+  if (params_.dropPolicy == DatagramDropPolicy::DROP_OLDEST) {
+    for (auto it = streams_.begin(); it != streams_.end(); ++it) {
+      if (victim == streams_.end() ||
+          it->second.front().seq < victim->second.front().seq) {
+        victim = it;
+      }
+    }
+    return victim;
+  }
+  // PRIORITY: the least urgent stream, the oldest among equals
+  uint8_t victimUrgency = 0;
+  for (auto it = streams_.begin(); it != streams_.end(); ++it) {
+    auto urgency = getUrgency(it->first);
+    if (victim == streams_.end() || urgency > victimUrgency ||
+        (urgency == victimUrgency &&
+         it->second.front().seq < victim->second.front().seq)) {
+      victim = it;
+      victimUrgency = urgency;
+    }
+  }
+  if (victim != streams_.end() && getUrgency(streamId) > victimUrgency) {
+    return streams_.end();
+  }
+  return victim;
+}
+
+} // namespace proxygen
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/container/F14Map.h>
+#include <folly/io/IOBuf.h>
+#include <iosfwd>
+#include <vector>
+
+namespace proxygen {
+
+// Which datagram goes when a DatagramBuffer limit is reached
+enum class DatagramDropPolicy : uint8_t {
+  // The arriving datagram
+  DROP_NEWEST,
+  // The datagram that has been buffered the longest
+  DROP_OLDEST,
+  // The oldest datagram of the least urgent stream. The arriving datagram
+  // is dropped if its stream is less urgent than every buffered one.
+  PRIORITY,
+};
+
+std::ostream& operator<<(std::ostream& os, DatagramDropPolicy policy);
+
+/**
+ * Holds datagrams that arrive for a stream before it can take them, such as
+ * HTTP/3 datagrams received ahead of the response headers, and hands them
+ * over in arrival order once it can.
+ *
+ * Both the number of datagrams and their bytes are bounded, per stream and
+ * in total, as is the number of streams. When a limit is hit the drop
+ * policy picks what is discarded. The default drops the oldest, so streams
+ * that never open cannot keep newer ones out for the life of the session.
+ * Each stream keeps its datagrams in a ring sized to the per stream limit;
+ * rings of streams that were drained are reused, so buffering does not
+ * allocate per datagram.
+ */
+class DatagramBuffer {
+ public:
+  struct Params {
+    size_t maxStreams{10};
+    size_t maxDatagramsPerStream{5};
+    uint64_t maxBytesPerStream{16 * 1024};
+    uint64_t maxBytes{64 * 1024};
+    DatagramDropPolicy dropPolicy{DatagramDropPolicy::DROP_OLDEST};
+  };
+
+  struct Stats {
+    uint64_t buffered{0};
+    uint64_t delivered{0};
+    uint64_t dropped{0};
+    uint64_t droppedBytes{0};
+  };
+
+  // What one call discarded, including the added datagram for add()
+  struct Dropped {
+    uint32_t datagrams{0};
+    uint64_t bytes{0};
+  };
+
+  // The urgency of a stream for the PRIORITY policy; lower is more urgent
+  using UrgencyFn = folly::Function<uint8_t(uint64_t)>;
+
+  DatagramBuffer();
+  explicit DatagramBuffer(Params params);
+
+  // Drops whatever no longer fits the new limits
+  Dropped setParams(Params params);
+  const Params& getParams() const {
+    return params_;
+  }
+
+  void setUrgencyFn(UrgencyFn fn) {
+    urgencyFn_ = std::move(fn);
+  }
+
+  Dropped add(uint64_t streamId, std::unique_ptr<folly::IOBuf> datagram);
+
+  // Removes the stream's datagrams, passing them to fn oldest first
+  template <typename F>
+  void deliver(uint64_t streamId, F&& fn) {
+    auto it = streams_.find(streamId);
+    if (it == streams_.end()) {
+      return;
+    }
+    auto ring = std::move(it->second);
+    streams_.erase(it);
+    totalBytes_ -= ring.bytes;
+    stats_.delivered += ring.size;
+    while (ring.size > 0) {
+      fn(ring.pop().buf);
+    }
+    recycle(std::move(ring));
+  }
+
+  // Drops the stream's datagrams
+  Dropped erase(uint64_t streamId);
+  void clear();
+
+  bool empty() const {
+    return streams_.empty();
+  }
+  size_t getNumStreams() const {
+    return streams_.size();
+  }
+  uint64_t getBufferedBytes() const {
+    return totalBytes_;
+  }
+  size_t getNumBuffered(uint64_t streamId) const;
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  struct Entry {
+    std::unique_ptr<folly::IOBuf> buf;
+    uint64_t length{0};
+    // Arrival order across all streams
+    uint64_t seq{0};
+  };
+
+  struct Ring {
+    std::vector<Entry> slots;
+    size_t head{0};
+    size_t size{0};
+    uint64_t bytes{0};
+
+    bool full() const {
+      return size == slots.size();
+    }
+    const Entry& front() const {
+      return slots[head];
+    }
+    void push(Entry entry);
+    Entry pop();
+  };
+
+  Ring makeRing();
+  void recycle(Ring ring);
+  // Drops the oldest datagram of the stream, and the stream once empty
+  void dropOldest(folly::F14FastMap<uint64_t, Ring>::iterator it,
+                  Dropped& dropped);
+  // The stream to drop from when the session wide limits are hit, or end()
+  // if the arriving datagram should go instead
+  folly::F14FastMap<uint64_t, Ring>::iterator pickVictim(uint64_t streamId);
+  uint8_t getUrgency(uint64_t streamId) {
+    return urgencyFn_ ? urgencyFn_(streamId) : 0;
+  }
+
+  Params params_;
+  UrgencyFn urgencyFn_;
+  folly::F14FastMap<uint64_t, Ring> streams_;
+  // Drained rings, kept to be reused by the next streams
+  std::vector<std::vector<Entry>> spareRings_;
+  uint64_t totalBytes_{0};
+  uint64_t nextSeq_{0};
+  Stats stats_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * Picks the TLS record size a session should aim its egress at.
+ *
+ * A record can only be decrypted once all of it has arrived, so while the
+ * congestion window is small (at the start of a connection, and after it
+ * has been idle long enough for TCP to restart slow start) records that fit
+ * in one segment let the peer process data as each packet lands. Once a
+ * transfer has sent enough to open the window, full size records cut the
+ * per-record framing and crypto overhead.
+ *
+ * The size starts at initialSize and doubles each time rampBytes more are
+ * written, up to maxSize. Writing nothing for idleTimeout starts over.
+ */
+class EgressRecordSizer {
+ public:
+  struct Params {
+    // Fits one TCP segment along with TLS and TCP/IP overhead
+    uint32_t initialSize{1400};
+    // The largest TLS record
+    uint32_t maxSize{16384};
+    uint64_t rampBytes{256 * 1024};
+    std::chrono::milliseconds idleTimeout{1000};
+  };
+
+  EgressRecordSizer() = default;
+  explicit EgressRecordSizer(Params params) : params_(params) {
+  }
+
+  uint32_t getRecordSize(TimePoint now) {
+    if (bytesSinceIdle_ > 0 && now - lastWrite_ >= params_.idleTimeout) {
+      bytesSinceIdle_ = 0;
+    }
+    auto doublings = bytesSinceIdle_ / params_.rampBytes;
+    if (doublings >= 32) {
+      return params_.maxSize;
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(
+        uint64_t(params_.initialSize) << doublings, params_.maxSize));
+  }
+
+  void onBytesWritten(uint64_t bytes, TimePoint now) {
+    if (bytesSinceIdle_ > 0 && now - lastWrite_ >= params_.idleTimeout) {
+      bytesSinceIdle_ = 0;
+    }
+    bytesSinceIdle_ += bytes;
+    lastWrite_ = now;
+  }
+
+ private:
+  Params params_;
+  uint64_t bytesSinceIdle_{0};
+  TimePoint lastWrite_;
+};
+
+} // namespace proxygen
@@ -23,6 +23,7 @@ void HQDownstreamSession::onTransportReady() noexcept {
 
 void HQDownstreamSession::onFullHandshakeDone() noexcept {
   HQDownstreamSession::DestructorGuard dg(this);
+  fullHandshakeDone_ = true;
   if (infoCallback_) {
     infoCallback_->onFullHandshakeCompletion(*this);
   }
@@ -47,6 +48,8 @@ void HQDownstreamSession::onConnectionSetupErrorHandler(
 
 void HQDownstreamSession::setupOnHeadersComplete(HTTPTransaction* txn,
                                                  HTTPMessage* msg) {
+  // Stream data before the client's Finished can only have come in 0-RTT
+  msg->setEarlyData(!fullHandshakeDone_);
   HTTPTransaction::Handler* handler =
       getController()->getRequestHandler(*txn, msg);
   CHECK(handler);
@@ -199,6 +199,9 @@ class HQDownstreamSession : public HQSession {
 
   // Whether or not we have already received an onTransportReady callback.
   bool transportReadyNotified_{false};
+
+  // Until the handshake completes, requests arrive in early data
+  bool fullHandshakeDone_{false};
 };
 
 } // namespace proxygen
@@ -21,6 +21,7 @@
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/http/webtransport/CapsuleWebTransport.h>
 
 #include <folly/CppAttributes.h>
 #include <folly/Format.h>
@@ -44,6 +45,14 @@ static const std::string kNoProtocolString("");
 static const std::string kH1QV1ProtocolString("h1q-fb");
 static const std::string kH1QV2ProtocolString("h1q-fb-v2");
 static const std::string kQUICProtocolName("QUIC");
+// draft-ietf-webtrans-http3: the signal starting a WebTransport bidirectional
+// stream, and the error for streams of sessions that never showed up
+constexpr uint64_t kWebTransportBidiSignal = 0x41;
+constexpr uint64_t kWebTransportBufferedStreamRejected = 0x3994bd84;
+// Marks a CONNECT whose WebTransport streams are native QUIC streams, as
+// the client sent in draft-ietf-webtrans-http3-02
+static const std::string kWebTransportNativeHeader(
+    "sec-webtransport-http3-draft02");
 
 using namespace proxygen::HTTP3;
 bool noError(quic::QuicErrorCode error) {
@@ -117,6 +126,17 @@ void HQSession::onNewBidirectionalStream(quic::StreamId id) noexcept {
   if (!versionUtils_->checkNewStream(id)) {
     return;
   }
+  if (supportsWebTransport_) {
+    // Wait for the first bytes to tell a request from a WebTransport stream
+    pendingBidiStreams_.insert(id);
+    sock_->setPeekCallback(id, &wtBidiPeeker_);
+    sock_->setReadCallback(id, &wtBidiPeeker_);
+    return;
+  }
+  startRequestStream(id);
+}
+
+void HQSession::startRequestStream(quic::StreamId id) {
   auto hqStream = findNonDetachedStream(id);
   DCHECK(!hqStream);
   hqStream = createStreamTransport(id);
@@ -170,6 +190,11 @@ void HQSession::onStopSending(quic::StreamId id,
   auto stream = findStream(id);
   if (stream) {
     handleWriteError(stream, error);
+    return;
+  }
+  auto wtStream = wtStreams_.find(id);
+  if (wtStream != wtStreams_.end()) {
+    wtStream->second->onStopSending(id, error);
   }
 }
 
@@ -197,10 +222,11 @@ bool HQSession::H1QFBV1VersionUtils::checkNewStream(quic::StreamId id) {
 
 bool HQSession::GoawayUtils::checkNewStream(HQSession& session,
                                             quic::StreamId id) {
-  // Reject all bidirectional, server-initiated streams
+  // Reject all bidirectional, server-initiated streams, unless they may be
+  // WebTransport streams
   if (id == kMaxClientBidiStreamId ||
       (session.sock_->isBidirectionalStream(id) &&
-       session.sock_->isServerStream(id))) {
+       session.sock_->isServerStream(id) && !session.supportsWebTransport_)) {
     session.abortStream(HTTPException::Direction::INGRESS_AND_EGRESS,
                         id,
                         HTTP3::ErrorCode::HTTP_STREAM_CREATION_ERROR);
@@ -792,6 +818,8 @@ size_t HQSession::HQVersionUtils::sendSettings() {
           // TODO: qpackCodec_.setMaxUncompressed(setting.value)
           break;
         case hq::SettingId::H3_DATAGRAM:
+        case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
+        case hq::SettingId::ENABLE_WEBTRANSPORT:
           break;
       }
     }
@@ -1054,6 +1082,11 @@ bool HQSession::eraseStream(quic::StreamId streamId) {
   bool erased = false;
   if (streams_.erase(streamId)) {
     erased = true;
+    rejectBufferedWebTransportStreams(streamId);
+    // Datagrams the stream never got to read
+    if (!datagramsBuffer_.empty()) {
+      onDatagramsDropped(datagramsBuffer_.erase(streamId));
+    }
   }
 
   // TODO: only do this when stream is server-uni
@@ -1109,8 +1142,8 @@ void HQSession::runLoopCallback() noexcept {
   // Maybe schedule the next loop callback
   VLOG(4) << "sess=" << *this << " maybe schedule the next loop callback. "
           << " pending writes: " << !txnEgressQueue_.empty()
-          << " pending processing reads: " << pendingProcessReadSet_.size();
-  if (!pendingProcessReadSet_.empty()) {
+          << " pending processing reads: " << pendingProcessReads_.size();
+  if (!pendingProcessReads_.empty()) {
     scheduleLoopCallback(false);
   }
   // checkForShutdown is now in ScopeGuard
@@ -1292,7 +1325,7 @@ HQSession::H1QFBV2VersionUtils::parseStreamPreface(uint64_t preface) {
 
 folly::Optional<UnidirectionalStreamType>
 HQSession::HQVersionUtils::parseStreamPreface(uint64_t preface) {
-  hq::UnidirectionalTypeF parse = [](hq::UnidirectionalStreamType type)
+  hq::UnidirectionalTypeF parse = [this](hq::UnidirectionalStreamType type)
       -> folly::Optional<UnidirectionalStreamType> {
     switch (type) {
       case UnidirectionalStreamType::CONTROL:
@@ -1300,6 +1333,11 @@ HQSession::HQVersionUtils::parseStreamPreface(uint64_t preface) {
       case UnidirectionalStreamType::QPACK_ENCODER:
       case UnidirectionalStreamType::QPACK_DECODER:
         return type;
+      case UnidirectionalStreamType::WEBTRANSPORT:
+        if (session_.supportsWebTransport_) {
+          return type;
+        }
+        return folly::none;
       default:
         return folly::none;
     }
@@ -1403,6 +1441,189 @@ folly::Optional<hq::UnidirectionalStreamType> HQSession::parseStreamPreface(
   return versionUtils_->parseStreamPreface(preface);
 }
 
+void HQSession::setDatagramBufferParams(DatagramBuffer::Params params) {
+  VLOG(4) << __func__ << " maxStreams=" << params.maxStreams
+          << " maxDatagramsPerStream=" << params.maxDatagramsPerStream
+          << " maxBytes=" << params.maxBytes
+          << " policy=" << params.dropPolicy << " sess=" << *this;
+  onDatagramsDropped(datagramsBuffer_.setParams(params));
+}
+
+bool HQSession::peerMayOpenRequestStream(quic::StreamId id) const {
+  return direction_ == TransportDirection::DOWNSTREAM &&
+         sock_->isBidirectionalStream(id) && !sock_->isServerStream(id) &&
+         id >= minUnseenIncomingStreamId_;
+}
+
+uint8_t HQSession::getDatagramUrgency(quic::StreamId id) {
+  // A PRIORITY_UPDATE may have arrived ahead of the stream too
+  auto update = priorityUpdatesBuffer_.findWithoutPromotion(id);
+  if (update != priorityUpdatesBuffer_.end()) {
+    return update->second.urgency;
+  }
+  if (sock_) {
+    auto pri = sock_->getStreamPriority(id);
+    if (pri) {
+      return pri->level;
+    }
+  }
+  return kDefaultHttpPriorityUrgency;
+}
+
+void HQSession::onDatagramsDropped(const DatagramBuffer::Dropped& dropped) {
+  if (dropped.datagrams == 0) {
+    return;
+  }
+  VLOG(4) << "Dropped " << dropped.datagrams << " buffered datagrams, "
+          << dropped.bytes << " bytes sess=" << *this;
+  if (sessionStats_) {
+    sessionStats_->recordDroppedDatagrams(dropped.datagrams, dropped.bytes);
+  }
+}
+
+void HQSession::onNewWebTransportUniStream(quic::StreamId id,
+                                           quic::StreamId sessionId,
+                                           size_t toConsume) {
+  VLOG(4) << __func__ << " streamID=" << id << " sessionID=" << sessionId
+          << " sess=" << *this;
+  sock_->setPeekCallback(id, nullptr);
+  auto consumeRes = sock_->consume(id, toConsume);
+  if (consumeRes.hasError()) {
+    rejectWebTransportStream(id, false);
+    return;
+  }
+  onNewWebTransportStream(id, sessionId, false);
+}
+
+void HQSession::onBidiStreamPreface(
+    quic::StreamId id,
+    const HQUnidirStreamDispatcher::Callback::PeekData& data) {
+  if (data.empty() || data.front().offset != 0) {
+    return;
+  }
+  bool eof = data.back().eof;
+  folly::Optional<std::pair<uint64_t, size_t>> signal;
+  folly::Optional<std::pair<uint64_t, size_t>> sessionId;
+  if (auto dataBuf = data.front().data.front()) {
+    folly::io::Cursor cursor(dataBuf);
+    signal = quic::decodeQuicInteger(cursor);
+    if (signal && signal->first == kWebTransportBidiSignal) {
+      sessionId = quic::decodeQuicInteger(cursor);
+    }
+  }
+  if (sessionId) {
+    pendingBidiStreams_.erase(id);
+    clearStreamCallbacks(id);
+    auto consumeRes = sock_->consume(id, signal->second + sessionId->second);
+    if (consumeRes.hasError()) {
+      rejectWebTransportStream(id, true);
+      return;
+    }
+    VLOG(4) << "New WebTransport bidi streamID=" << id
+            << " sessionID=" << sessionId->first << " sess=" << *this;
+    onNewWebTransportStream(id, sessionId->first, true);
+    return;
+  }
+  bool wtSignal = signal && signal->first == kWebTransportBidiSignal;
+  if (!eof && (!signal || wtSignal)) {
+    // Wait for the rest of the preface
+    return;
+  }
+  // A WebTransport preface cut short by FIN is as malformed as a server
+  // request stream
+  startPendingBidiStream(id, wtSignal);
+}
+
+void HQSession::onPendingBidiStreamReadable(quic::StreamId id) {
+  // Readable with nothing to peek means the stream ended without a byte
+  bool ended = false;
+  auto peekRes = sock_->peek(
+      id,
+      [&ended](quic::StreamId,
+               const folly::Range<quic::QuicSocket::PeekIterator>& peekData) {
+        ended = peekData.empty();
+      });
+  if (peekRes.hasError() || !ended) {
+    return;
+  }
+  VLOG(4) << "Pending bidi streamID=" << id << " ended before its preface"
+          << " sess=" << *this;
+  startPendingBidiStream(id, false);
+}
+
+void HQSession::startPendingBidiStream(quic::StreamId id, bool malformed) {
+  pendingBidiStreams_.erase(id);
+  clearStreamCallbacks(id);
+  if (malformed || sock_->isServerStream(id)) {
+    // Servers may only open bidirectional streams for WebTransport
+    abortStream(HTTPException::Direction::INGRESS_AND_EGRESS,
+                id,
+                HTTP3::ErrorCode::HTTP_STREAM_CREATION_ERROR);
+    return;
+  }
+  // The request codec rejects an empty or truncated request as it would
+  // without WebTransport
+  startRequestStream(id);
+}
+
+void HQSession::WebTransportBidiPeeker::peekError(
+    quic::StreamId id, quic::QuicError error) noexcept {
+  VLOG(4) << "peekError on pending bidi streamID=" << id
+          << " error: " << error;
+  session_.pendingBidiStreams_.erase(id);
+  session_.clearStreamCallbacks(id);
+}
+
+void HQSession::onNewWebTransportStream(quic::StreamId id,
+                                        quic::StreamId sessionId,
+                                        bool bidi) {
+  auto wtSession = wtSessions_.find(sessionId);
+  if (wtSession != wtSessions_.end()) {
+    wtSession->second->onNewStream(id, bidi);
+    return;
+  }
+  // The CONNECT stream may not have arrived yet, or its handler has not
+  // created the session; hold a few streams until one of those happens
+  bool sessionPending =
+      streams_.count(sessionId) > 0 || peerMayOpenRequestStream(sessionId);
+  size_t numBuffered = 0;
+  for (const auto& buffered : bufferedWtStreams_) {
+    numBuffered += buffered.second.size();
+  }
+  if (!sessionPending || numBuffered >= kMaxBufferedWebTransportStreams) {
+    VLOG(3) << "Rejecting WebTransport streamID=" << id
+            << " for sessionID=" << sessionId << " sess=" << *this;
+    rejectWebTransportStream(id, bidi);
+    return;
+  }
+  bufferedWtStreams_[sessionId].emplace_back(id, bidi);
+}
+
+void HQSession::rejectWebTransportStream(quic::StreamId id, bool bidi) {
+  auto error = static_cast<quic::ApplicationErrorCode>(
+      kWebTransportBufferedStreamRejected);
+  sock_->setPeekCallback(id, nullptr);
+  sock_->setReadCallback(id, nullptr, error);
+  if (bidi) {
+    sock_->resetStream(id, error);
+  }
+}
+
+void HQSession::rejectBufferedWebTransportStreams(quic::StreamId sessionId) {
+  auto buffered = bufferedWtStreams_.find(sessionId);
+  if (buffered == bufferedWtStreams_.end()) {
+    return;
+  }
+  auto streams = std::move(buffered->second);
+  bufferedWtStreams_.erase(buffered);
+  if (!sock_) {
+    return;
+  }
+  for (const auto& stream : streams) {
+    rejectWebTransportStream(stream.first, stream.second);
+  }
+}
+
 size_t HQSession::cleanupPendingStreams() {
   std::vector<quic::StreamId> streamsToCleanup;
 
@@ -1414,6 +1635,17 @@ size_t HQSession::cleanupPendingStreams() {
 
   cleanupUnboundPushStreams(streamsToCleanup);
 
+  streamsToCleanup.insert(streamsToCleanup.end(),
+                          pendingBidiStreams_.begin(),
+                          pendingBidiStreams_.end());
+  pendingBidiStreams_.clear();
+  for (const auto& buffered : bufferedWtStreams_) {
+    for (const auto& stream : buffered.second) {
+      streamsToCleanup.push_back(stream.first);
+    }
+  }
+  bufferedWtStreams_.clear();
+
   // Clean up the streams by detaching all callbacks
   for (auto pendingStreamId : streamsToCleanup) {
     clearStreamCallbacks(pendingStreamId);
@@ -1482,7 +1714,8 @@ void HQSession::readRequestStream(quic::StreamId id) noexcept {
     return;
   }
 
-  resetTimeout();
+  // The timeout is reset once for all the streams read in this loop
+  readActivity_ = true;
   quic::Buf data = std::move(readRes.value().first);
   auto readSize = data ? data->computeChainDataLength() : 0;
   hqStream->readEOF_ = readRes.value().second;
@@ -1506,21 +1739,30 @@ void HQSession::readRequestStream(quic::StreamId id) noexcept {
     infoCallback_->onRead(*this, readSize, hqStream->getStreamId());
   }
 
-  pendingProcessReadSet_.insert(id);
+  addPendingProcessRead(*hqStream);
 }
 
-void HQSession::processReadData() {
-  for (auto it = pendingProcessReadSet_.begin();
-       it != pendingProcessReadSet_.end();) {
-    auto g = folly::makeGuard([&]() {
-      // the codec may not have processed all the data, but we won't ask again
-      // until we get more
-      // TODO: set a timeout?
-      it = pendingProcessReadSet_.erase(it);
-    });
+void HQSession::addPendingProcessRead(HQStreamTransportBase& stream) {
+  if (!stream.pendingProcessRead_) {
+    stream.pendingProcessRead_ = true;
+    pendingProcessReads_.push_back(stream.getIngressStreamId());
+  }
+}
 
+void HQSession::processReadData() {
+  if (readActivity_) {
+    readActivity_ = false;
+    resetTimeout();
+  }
+  // Every stream read during this loop is parsed and dispatched in one pass,
+  // rather than as each readAvailable comes in. Streams queued while
+  // processing are handled in the next loop.
+  std::vector<quic::StreamId> processing;
+  processing.swap(pendingProcessReads_);
+  pendingProcessReads_.swap(spareProcessReads_);
+  for (auto id : processing) {
     HQStreamTransportBase* ingressStream =
-        findIngressStream(*it, true /* includeDetached */);
+        findIngressStream(id, true /* includeDetached */);
 
     if (!ingressStream) {
       // ingress on a transaction may cause other transactions to get deleted
@@ -1533,18 +1775,22 @@ void HQSession::processReadData() {
               << ingressStream->txn_;
       ingressStream->readBuf_.move();
       ingressStream->readEOF_ = false;
+      ingressStream->pendingProcessRead_ = false;
       continue;
     }
 
     // Feed it to the codec
     auto blocked = ingressStream->processReadData();
-    if (!blocked) {
-      if (ingressStream->readEOF_) {
-        ingressStream->onIngressEOF();
-      }
-      continue;
+    // the codec may not have processed all the data, but we won't ask again
+    // until we get more
+    // TODO: set a timeout?
+    ingressStream->pendingProcessRead_ = false;
+    if (!blocked && ingressStream->readEOF_) {
+      ingressStream->onIngressEOF();
     }
   }
+  processing.clear();
+  spareProcessReads_ = std::move(processing);
 }
 
 void HQSession::H1QFBV1VersionUtils::headersComplete(HTTPMessage* msg) {
@@ -1601,6 +1847,7 @@ void HQSession::HQVersionUtils::applySettings(const SettingsList& settings) {
   uint32_t tableSize = kDefaultIngressHeaderTableSize;
   uint32_t blocked = kDefaultIngressQpackBlockedStream;
   bool datagram = false;
+  folly::Optional<bool> webTransport;
   FOLLY_MAYBE_UNUSED uint32_t numPlaceholders = kDefaultIngressNumPlaceHolders;
   for (auto& setting : settings) {
     auto id = httpToHqSettingsId(setting.id);
@@ -1619,6 +1866,11 @@ void HQSession::HQVersionUtils::applySettings(const SettingsList& settings) {
         case hq::SettingId::H3_DATAGRAM:
           datagram = static_cast<bool>(setting.value);
           break;
+        case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
+          break;
+        case hq::SettingId::ENABLE_WEBTRANSPORT:
+          webTransport = static_cast<bool>(setting.value);
+          break;
       }
     }
   }
@@ -1636,6 +1888,12 @@ void HQSession::HQVersionUtils::applySettings(const SettingsList& settings) {
   // H3 Datagram flows are bi-directional, enable only of local and peer
   // support it
   session_.datagramEnabled_ &= datagram;
+  // A client only starts sessions with native streams once the server
+  // enabled them; until then it falls back to capsules on the CONNECT stream
+  if (webTransport) {
+    session_.webTransportEnabled_ =
+        session_.supportsWebTransport_ && *webTransport;
+  }
 
   VLOG(3) << "Applied SETTINGS sess=" << session_ << " size=" << tableSize
           << " blocked=" << blocked;
@@ -1946,23 +2204,85 @@ void HQSession::handleSessionError(HQStreamBase* stream,
 uint64_t HQSession::writeRequestStreams(uint64_t maxEgress) noexcept {
   // requestStreamWriteImpl may call txn->onWriteReady
   txnEgressQueue_.nextEgress(nextEgressResults_);
-  for (auto it = nextEgressResults_.begin(); it != nextEgressResults_.end();
-       ++it) {
-    auto& ratio = it->second;
-    auto hqStream =
-        static_cast<HQStreamTransportBase*>(&it->first->getTransport());
-    // TODO: scale maxToSend by ratio?
-    auto sent = requestStreamWriteImpl(hqStream, maxEgress, ratio);
-    DCHECK_LE(sent, maxEgress);
+  for (const auto& result : nextEgressResults_) {
+    nextEgressGuards_.emplace_back(result.first);
+  }
+
+  // Deficit round robin: each stream may send its ratio of this write
+  // event's budget plus the credit it carried over, so the first stream in
+  // the list cannot take the whole budget. Whatever is left after that
+  // (streams short of data or flow control) goes to the streams that still
+  // have egress, in priority order, so no capacity is wasted.
+  const uint64_t budget = maxEgress;
+  std::array<uint64_t, kMaxPriority + 1> urgencyBytes{};
+  auto writeStream = [&](HQStreamTransportBase* hqStream,
+                         uint64_t allowed,
+                         double ratio) {
+    auto sent = requestStreamWriteImpl(hqStream, allowed, ratio);
+    DCHECK_LE(sent, allowed);
     maxEgress -= sent;
+    if (sent > 0 && sessionStats_) {
+      auto priority = hqStream->getHTTPPriority();
+      auto urgency =
+          priority ? priority->urgency : kDefaultHttpPriorityUrgency;
+      urgencyBytes[urgency] += sent;
+    }
+    return sent;
+  };
 
-    if (maxEgress == 0 && std::next(it) != nextEgressResults_.end()) {
+  bool leftover = false;
+  for (auto& [txn, ratio] : nextEgressResults_) {
+    auto hqStream = static_cast<HQStreamTransportBase*>(&txn->getTransport());
+    if (maxEgress == 0) {
       VLOG(3) << __func__ << " sess=" << *this
               << " got more to send than the transport could take";
       break;
     }
+    if (!hqStream->queueHandle_.isStreamTransportEnqueued()) {
+      // Another stream's callbacks dequeued it
+      continue;
+    }
+    auto share = static_cast<uint64_t>(budget * ratio);
+    auto allowed = std::min(maxEgress, share + hqStream->egressCredit_);
+    auto sent = allowed > 0 ? writeStream(hqStream, allowed, ratio) : 0;
+    if (hqStream->queueHandle_.isStreamTransportEnqueued()) {
+      // Capped so a stream cannot save up for a burst
+      hqStream->egressCredit_ = std::min(allowed - sent, budget);
+      leftover = true;
+    } else {
+      hqStream->egressCredit_ = 0;
+    }
+  }
+
+  if (leftover && maxEgress > 0) {
+    for (auto& [txn, ratio] : nextEgressResults_) {
+      auto hqStream = static_cast<HQStreamTransportBase*>(&txn->getTransport());
+      if (maxEgress == 0) {
+        break;
+      }
+      if (!hqStream->queueHandle_.isStreamTransportEnqueued()) {
+        continue;
+      }
+      auto sent = writeStream(hqStream, maxEgress, ratio);
+      // Extra bytes are paid for out of the stream's credit
+      hqStream->egressCredit_ -= std::min(sent, hqStream->egressCredit_);
+      if (!hqStream->queueHandle_.isStreamTransportEnqueued()) {
+        hqStream->egressCredit_ = 0;
+      }
+    }
+  }
+
+  if (sessionStats_) {
+    for (uint8_t urgency = 0; urgency < urgencyBytes.size(); urgency++) {
+      if (urgencyBytes[urgency] > 0) {
+        sessionStats_->recordWriteEventUrgencyBytes(urgency,
+                                                    urgencyBytes[urgency]);
+      }
+    }
   }
   nextEgressResults_.clear();
+  // May destroy transactions that finished
+  nextEgressGuards_.clear();
   return maxEgress;
 }
 
@@ -2658,10 +2978,8 @@ void HQSession::HQStreamTransportBase::onHeadersComplete(
   // - specifically, the QPACK encoder stream.  If that's true, then there may
   // be unparsed data in HQStreamTransport.  Add this stream's id to the
   // read set and schedule a loop callback to restart it.
-  if (session_.pendingProcessReadSet_.find(getStreamId()) ==
-          session_.pendingProcessReadSet_.end() &&
-      !readBuf_.empty()) {
-    session_.pendingProcessReadSet_.insert(getStreamId());
+  if (!pendingProcessRead_ && !readBuf_.empty()) {
+    session_.addPendingProcessRead(*this);
     session_.scheduleLoopCallback();
   }
 
@@ -2690,6 +3008,14 @@ void HQSession::HQStreamTransportBase::onHeadersComplete(
     }
   }
 
+  // The client decided whether its WebTransport streams are native
+  if (session_.direction_ == TransportDirection::DOWNSTREAM &&
+      session_.supportsWebTransport_ &&
+      msg->getMethod() == HTTPMethod::CONNECT &&
+      msg->getHeaders().exists(kWebTransportNativeHeader)) {
+    webTransportNative_ = true;
+  }
+
   // Tell the HTTPTransaction to start processing the message now
   // that the full ingress headers have arrived.
   // Depending on the push promise latch, the message is delivered to
@@ -2710,14 +3036,10 @@ void HQSession::HQStreamTransportBase::onHeadersComplete(
   // The stream can now receive datagrams: check for any pending datagram and
   // deliver it to the handler
   if (session_.datagramEnabled_ && !session_.datagramsBuffer_.empty()) {
-    auto itr = session_.datagramsBuffer_.find(streamId);
-    if (itr != session_.datagramsBuffer_.end()) {
-      auto& vec = itr->second;
-      for (auto& datagram : vec) {
-        txn_.onDatagram(std::move(datagram));
-      }
-      session_.datagramsBuffer_.erase(itr);
-    }
+    session_.datagramsBuffer_.deliver(
+        streamId, [this](std::unique_ptr<folly::IOBuf> datagram) {
+          txn_.onDatagram(std::move(datagram));
+        });
   }
 }
 
@@ -2961,10 +3283,16 @@ void HQSession::HQStreamTransportBase::sendHeaders(HTTPTransaction* txn,
     sendPushPromise(txn, folly::none, headers, size, includeEOM);
     return;
   }
+  // Tell the server which WebTransport mapping this CONNECT uses
+  folly::Optional<HTTPMessage> wtRequest;
+  if (webTransportNative_ && headers.isRequest()) {
+    wtRequest.emplace(headers);
+    wtRequest->getHeaders().set(kWebTransportNativeHeader, "1");
+  }
   auto g = folly::makeGuard(setActiveCodec(__func__));
   auto streamId = getStreamId();
-  auto headerGenOffsets =
-      generateHeadersCommon(streamId, headers, includeEOM, size);
+  auto headerGenOffsets = generateHeadersCommon(
+      streamId, wtRequest ? *wtRequest : headers, includeEOM, size);
   auto oldOffset = headerGenOffsets.first;
   auto newOffset = headerGenOffsets.second;
 
@@ -3727,23 +4055,21 @@ void HQSession::onDatagramsAvailable() noexcept {
     auto streamId = quarterStreamId->first * 4;
     auto stream = findNonDetachedStream(streamId);
 
+    if (!stream && !peerMayOpenRequestStream(streamId)) {
+      // The stream is closed, or is one the peer cannot open, so nothing
+      // would ever take these
+      VLOG(4) << "Dropping datagram for closed streamId=" << streamId
+              << " ctx=" << ctxId->first << " len=" << datagramQ.chainLength()
+              << " sess=" << *this;
+      onDatagramsDropped(
+          DatagramBuffer::Dropped{1, datagramQ.chainLength()});
+      continue;
+    }
     if (!stream || !stream->hasHeaders_) {
       VLOG(4) << "Stream cannot receive datagrams yet. streamId=" << streamId
               << " ctx=" << ctxId->first << " len=" << datagramQ.chainLength()
               << " sess=" << *this;
-      // TODO: a possible optimization would be to discard datagrams destined
-      // to streams that were already closed
-      auto itr = datagramsBuffer_.find(streamId);
-      if (itr == datagramsBuffer_.end()) {
-        itr = datagramsBuffer_.insert(streamId, {}).first;
-      }
-      auto& vec = itr->second;
-      if (vec.size() < vec.max_size()) {
-        vec.emplace_back(datagramQ.move());
-      } else {
-        // buffer is full: discard the datagram
-        datagramQ.move();
-      }
+      onDatagramsDropped(datagramsBuffer_.add(streamId, datagramQ.move()));
       continue;
     }
 
@@ -3803,6 +4129,272 @@ bool HQSession::HQStreamTransport::sendDatagram(
   return true;
 }
 
+std::unique_ptr<WebTransportImpl>
+HQSession::HQStreamTransport::newWebTransport(HTTPTransaction& txn) {
+  // The two ends may not have each other's SETTINGS at the same time, so
+  // only the client looks at them. It uses native streams if the server
+  // enabled them and says so on the CONNECT, which must not have been sent
+  // yet; the server follows whatever the CONNECT said.
+  if (session_.direction_ == TransportDirection::UPSTREAM) {
+    webTransportNative_ =
+        session_.webTransportEnabled_ && !txn.isEgressStarted();
+  }
+  if (webTransportNative_) {
+    return std::make_unique<HQWebTransport>(session_, txn);
+  }
+  return std::make_unique<CapsuleWebTransport>(txn);
+}
+
+HQSession::HQWebTransport::HQWebTransport(HQSession& session,
+                                          HTTPTransaction& txn)
+    : WebTransportImpl(txn, Options()),
+      session_(session),
+      sessionId_(txn.getID()) {
+}
+
+HQSession::HQWebTransport::~HQWebTransport() {
+  if (session_.sock_) {
+    auto error =
+        static_cast<quic::ApplicationErrorCode>(toHTTP3ErrorCode(kSessionGone));
+    for (const auto& stream : streams_) {
+      if (stream.second.reading) {
+        session_.sock_->setReadCallback(stream.first, nullptr, error);
+      }
+      if (stream.second.writing) {
+        session_.sock_->resetStream(stream.first, error);
+      }
+    }
+  }
+  for (const auto& stream : streams_) {
+    session_.wtStreams_.erase(stream.first);
+  }
+  if (registered_) {
+    session_.wtSessions_.erase(sessionId_);
+  }
+}
+
+void HQSession::HQWebTransport::onAttached() {
+  registered_ = session_.wtSessions_.emplace(sessionId_, this).second;
+  DCHECK(registered_);
+  auto buffered = session_.bufferedWtStreams_.find(sessionId_);
+  if (buffered == session_.bufferedWtStreams_.end()) {
+    return;
+  }
+  auto streams = std::move(buffered->second);
+  session_.bufferedWtStreams_.erase(buffered);
+  // Announcing the streams calls into the handler
+  HTTPTransaction::DestructorGuard g(&txn_);
+  for (const auto& stream : streams) {
+    onNewStream(stream.first, stream.second);
+  }
+}
+
+uint16_t HQSession::HQWebTransport::getDatagramSizeLimit() const {
+  return txn_.getDatagramSizeLimit();
+}
+
+folly::Expected<folly::Unit, WebTransport::ErrorCode>
+HQSession::HQWebTransport::sendDatagram(
+    std::unique_ptr<folly::IOBuf> datagram) {
+  if (isClosed()) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  if (!txn_.sendDatagram(std::move(datagram))) {
+    return folly::makeUnexpected(ErrorCode::SEND_ERROR);
+  }
+  return folly::unit;
+}
+
+void HQSession::HQWebTransport::onNewStream(quic::StreamId id, bool bidi) {
+  if (isClosed() || !session_.sock_) {
+    session_.rejectWebTransportStream(id, bidi);
+    return;
+  }
+  VLOG(4) << "New WebTransport streamID=" << id << " bidi=" << bidi
+          << " sessionID=" << sessionId_ << " sess=" << session_;
+  addStream(id, true, bidi);
+  session_.sock_->setReadCallback(id, this);
+  onNewIngressStream(id, bidi);
+}
+
+void HQSession::HQWebTransport::onStopSending(
+    quic::StreamId id, quic::ApplicationErrorCode error) {
+  auto it = streams_.find(id);
+  if (it == streams_.end() || !it->second.writing) {
+    return;
+  }
+  onStreamDone(id, false);
+  onIngressStopSending(id, fromHTTP3ErrorCode(error).value_or(0));
+}
+
+void HQSession::HQWebTransport::readAvailable(quic::StreamId id) noexcept {
+  auto readRes = session_.sock_->read(id, 0);
+  if (readRes.hasError()) {
+    readError(id, quic::QuicError(readRes.error(), "sync read error"));
+    return;
+  }
+  auto data = std::move(readRes.value().first);
+  auto eof = readRes.value().second;
+  if (eof) {
+    onStreamDone(id, true);
+  }
+  onIngressStreamData(id, std::move(data), eof);
+}
+
+void HQSession::HQWebTransport::readError(quic::StreamId id,
+                                          quic::QuicError error) noexcept {
+  VLOG(4) << "WebTransport readError streamID=" << id << " error: " << error;
+  onStreamDone(id, true);
+  uint32_t streamError = kSessionGone;
+  if (auto appError = error.code.asApplicationErrorCode()) {
+    streamError = fromHTTP3ErrorCode(*appError).value_or(0);
+  }
+  onIngressStreamReset(id, streamError);
+}
+
+void HQSession::HQWebTransport::onStreamWriteReady(
+    quic::StreamId id, uint64_t /*maxToSend*/) noexcept {
+  onStreamWriteReady(id);
+}
+
+void HQSession::HQWebTransport::onStreamWriteError(
+    quic::StreamId id, quic::QuicError error) noexcept {
+  VLOG(4) << "WebTransport write error streamID=" << id << " error: " << error;
+  auto it = streams_.find(id);
+  if (it == streams_.end() || !it->second.writing) {
+    return;
+  }
+  onStreamDone(id, false);
+  onIngressStopSending(id, kSessionGone);
+}
+
+folly::Expected<WebTransport::StreamId, WebTransport::ErrorCode>
+HQSession::HQWebTransport::newStream(bool bidi) {
+  auto& sock = session_.sock_;
+  if (!sock) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  auto id = bidi ? sock->createBidirectionalStream()
+                 : sock->createUnidirectionalStream();
+  if (id.hasError()) {
+    VLOG(3) << "Failed to create WebTransport stream error=" << id.error()
+            << " sess=" << session_;
+    return folly::makeUnexpected(ErrorCode::STREAM_CREATION_ERROR);
+  }
+  // Stream preface: the stream type or bidi signal, then the session ID
+  folly::IOBufQueue preface{folly::IOBufQueue::cacheChainLength()};
+  encodeVarint(bidi ? kWebTransportBidiSignal
+                    : static_cast<uint64_t>(
+                          hq::UnidirectionalStreamType::WEBTRANSPORT),
+               preface);
+  encodeVarint(sessionId_, preface);
+  auto writeRes = sock->writeChain(*id, preface.move(), false);
+  if (writeRes.hasError()) {
+    sock->resetStream(
+        *id,
+        static_cast<quic::ApplicationErrorCode>(
+            HTTP3::ErrorCode::HTTP_INTERNAL_ERROR));
+    return folly::makeUnexpected(ErrorCode::STREAM_CREATION_ERROR);
+  }
+  addStream(*id, bidi, true);
+  if (bidi) {
+    sock->setReadCallback(*id, this);
+  }
+  return *id;
+}
+
+folly::Expected<WebTransport::FCState, WebTransport::ErrorCode>
+HQSession::HQWebTransport::sendStreamData(StreamId id,
+                                          std::unique_ptr<folly::IOBuf> data,
+                                          bool fin) {
+  auto& sock = session_.sock_;
+  if (!sock) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  auto writeRes = sock->writeChain(id, std::move(data), fin);
+  if (writeRes.hasError()) {
+    VLOG(3) << "WebTransport write failed streamID=" << id
+            << " error=" << writeRes.error();
+    return folly::makeUnexpected(ErrorCode::SEND_ERROR);
+  }
+  if (fin) {
+    onStreamDone(id, false);
+    return FCState::UNBLOCKED;
+  }
+  auto buffered = sock->getStreamWriteBufferedBytes(id);
+  if (buffered.hasError() || *buffered <= kMaxStreamWriteBuffer) {
+    return FCState::UNBLOCKED;
+  }
+  // Told once the transport drains the stream
+  sock->notifyPendingWriteOnStream(id, this);
+  return FCState::BLOCKED;
+}
+
+void HQSession::HQWebTransport::resetStreamEgress(StreamId id,
+                                                  uint32_t error) {
+  if (session_.sock_) {
+    session_.sock_->resetStream(
+        id, static_cast<quic::ApplicationErrorCode>(toHTTP3ErrorCode(error)));
+  }
+  onStreamDone(id, false);
+}
+
+void HQSession::HQWebTransport::stopStreamIngress(StreamId id,
+                                                  uint32_t error) {
+  if (session_.sock_) {
+    session_.sock_->setReadCallback(
+        id,
+        nullptr,
+        static_cast<quic::ApplicationErrorCode>(toHTTP3ErrorCode(error)));
+  }
+  onStreamDone(id, true);
+}
+
+void HQSession::HQWebTransport::pauseStreamIngress(StreamId id,
+                                                   bool paused) {
+  if (!session_.sock_) {
+    return;
+  }
+  if (paused) {
+    session_.sock_->pauseRead(id);
+  } else {
+    session_.sock_->resumeRead(id);
+  }
+}
+
+void HQSession::HQWebTransport::onSessionEnd() {
+  // The remaining streams were reset and stopped already. The session stays
+  // registered so that late peer streams are rejected rather than buffered.
+  for (const auto& stream : streams_) {
+    session_.wtStreams_.erase(stream.first);
+  }
+  streams_.clear();
+}
+
+void HQSession::HQWebTransport::addStream(quic::StreamId id,
+                                          bool reading,
+                                          bool writing) {
+  streams_[id] = StreamState{reading, writing};
+  session_.wtStreams_[id] = this;
+}
+
+void HQSession::HQWebTransport::onStreamDone(quic::StreamId id,
+                                             bool reading) {
+  auto it = streams_.find(id);
+  if (it == streams_.end()) {
+    return;
+  }
+  if (reading) {
+    it->second.reading = false;
+  } else {
+    it->second.writing = false;
+  }
+  if (!it->second.reading && !it->second.writing) {
+    streams_.erase(it);
+    session_.wtStreams_.erase(id);
+  }
+}
+
 std::ostream& operator<<(std::ostream& os, const HQSession& session) {
   session.describe(os);
   return os;
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <folly/container/EvictingCacheMap.h>
+#include <folly/container/F14Map.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/DelayedDestructionBase.h>
@@ -23,6 +24,7 @@
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
 #include <proxygen/lib/http/codec/HTTPSettings.h>
+#include <proxygen/lib/http/session/DatagramBuffer.h>
 #include <proxygen/lib/http/session/HQByteEventTracker.h>
 #include <proxygen/lib/http/session/HQStreamBase.h>
 #include <proxygen/lib/http/session/HQUnidirectionalCallbacks.h>
@@ -64,12 +66,11 @@ extern const proxygen::http2::PriorityUpdate hqDefaultPriority;
 using HQVersionType = std::underlying_type<HQVersion>::type;
 
 constexpr uint8_t kMaxDatagramHeaderSize = 16;
-// Maximum number of datagrams to buffer per stream
-constexpr uint8_t kDefaultMaxBufferedDatagrams = 5;
-// Maximum number of streams with datagrams buffered
-constexpr uint8_t kMaxStreamsWithBufferedDatagrams = 10;
 // Maximum number of priority updates received when stream is not available
 constexpr uint8_t kMaxBufferedPriorityUpdates = 10;
+// Maximum number of WebTransport streams held for a session that the
+// application has not picked up yet
+constexpr uint8_t kMaxBufferedWebTransportStreams = 16;
 
 /**
  * Session-level protocol info.
@@ -147,6 +148,7 @@ class HQSession
 
  private:
   class HQControlStream;
+  class HQWebTransport;
   class H1QFBV1VersionUtils;
   class H1QFBV2VersionUtils;
   class HQVersionUtils;
@@ -380,12 +382,28 @@ class HQSession
     if (datagramEnabled && datagramEnabled->value) {
       datagramEnabled_ = true;
     }
+    auto webTransport =
+        egressSettings_.getSetting(SettingsId::_HQ_WEBTRANSPORT);
+    if (webTransport && webTransport->value) {
+      supportsWebTransport_ = true;
+    }
   }
 
   void setMaxConcurrentIncomingStreams(uint32_t /*num*/) override {
     // need transport API
   }
 
+  /**
+   * Limits and drop policy for H3 datagrams that arrive before their stream
+   * can take them. Datagrams already buffered that no longer fit are
+   * dropped.
+   */
+  void setDatagramBufferParams(DatagramBuffer::Params params);
+
+  const DatagramBuffer::Stats& getDatagramBufferStats() const {
+    return datagramsBuffer_.getStats();
+  }
+
   /**
    * Send a settings frame
    */
@@ -629,7 +647,10 @@ class HQSession
   virtual bool erasePushStream(quic::StreamId streamId) = 0;
 
   void resumeReadsForPushStream(quic::StreamId streamId) {
-    pendingProcessReadSet_.insert(streamId);
+    auto stream = findIngressStream(streamId, true /* includeDetached */);
+    if (stream) {
+      addPendingProcessRead(*stream);
+    }
     resumeReads(streamId);
   }
 
@@ -677,6 +698,10 @@ class HQSession
 
   void rejectStream(quic::StreamId /* id */) override;
 
+  void onNewWebTransportUniStream(quic::StreamId id,
+                                  quic::StreamId sessionId,
+                                  size_t toConsume) override;
+
   folly::Optional<hq::UnidirectionalStreamType> parseStreamPreface(
       uint64_t preface) override;
 
@@ -716,12 +741,15 @@ class HQSession
         unidirectionalReadDispatcher_(*this, direction),
         createTime_(std::chrono::steady_clock::now()) {
     codec_.add<HTTPChecks>();
+    datagramsBuffer_.setUrgencyFn(
+        [this](uint64_t streamId) { return getDatagramUrgency(streamId); });
     // dummy, ingress, egress
     codecStack_.reserve(kMaxCodecStackDepth);
     codecStack_.emplace_back(nullptr, nullptr, nullptr);
 
     attachToSessionController();
     nextEgressResults_.reserve(maxConcurrentIncomingStreams_);
+    nextEgressGuards_.reserve(maxConcurrentIncomingStreams_);
     quicInfo_ = std::make_shared<QuicProtocolInfo>();
   }
 
@@ -796,6 +824,35 @@ class HQSession
   // or Push streams are request streams.
   HQStreamTransport* createStreamTransport(quic::StreamId streamId);
 
+  // Sets up an ingress bidirectional stream as a request stream
+  void startRequestStream(quic::StreamId id);
+
+  // Whether id is a request stream the peer has yet to open, so datagrams
+  // or WebTransport streams that arrive for it first are worth holding
+  bool peerMayOpenRequestStream(quic::StreamId id) const;
+
+  // Urgency of a stream whose datagrams are buffered, for the PRIORITY drop
+  // policy
+  uint8_t getDatagramUrgency(quic::StreamId id);
+  void onDatagramsDropped(const DatagramBuffer::Dropped& dropped);
+
+  // Bidirectional streams are peeked while WebTransport is enabled, since
+  // they may carry the WebTransport signal rather than a request
+  void onBidiStreamPreface(
+      quic::StreamId id, const HQUnidirStreamDispatcher::Callback::PeekData&);
+  // A stream that ends before any bytes is never peeked, only readable
+  void onPendingBidiStreamReadable(quic::StreamId id);
+  // Leaves the pending state as a request stream, unless it can't be one
+  void startPendingBidiStream(quic::StreamId id, bool malformed);
+
+  // Hands a peer's stream to its WebTransport session, or holds it until the
+  // application creates the session
+  void onNewWebTransportStream(quic::StreamId id,
+                               quic::StreamId sessionId,
+                               bool bidi);
+  void rejectWebTransportStream(quic::StreamId id, bool bidi);
+  void rejectBufferedWebTransportStreams(quic::StreamId sessionId);
+
   bool createEgressControlStreams();
   HQControlStream* tryCreateIngressControlStream(quic::StreamId id,
                                                  uint64_t preface);
@@ -826,6 +883,8 @@ class HQSession
 
   // helper functions for reads
   void readRequestStream(quic::StreamId id) noexcept;
+  // Queues the stream's buffered ingress for the next processReadData
+  void addPendingProcessRead(HQStreamTransportBase& stream);
   void readControlStream(HQControlStream* controlStream);
 
   // Runs the codecs on all request streams that have received data
@@ -1679,16 +1738,24 @@ class HQSession
     bool wantsOnWriteReady(size_t canSend) const;
 
     HQPriHandle queueHandle_;
+    // Deficit round robin credit: bytes of earlier write events' shares
+    // this stream could not use while it still had egress pending
+    uint64_t egressCredit_{0};
     HTTPTransaction txn_;
     // need to send EOM
     bool pendingEOM_{false};
     // have read EOF
     bool readEOF_{false};
+    // listed in the session's pendingProcessReads_
+    bool pendingProcessRead_{false};
     bool hasCodec_{false};
     bool hasIngress_{false};
     bool detached_{false};
     bool ingressError_{false};
     bool hasHeaders_{false};
+    // The CONNECT on this stream uses native WebTransport streams rather
+    // than capsules
+    bool webTransportNative_{false};
     enum class EOMType { CODEC, TRANSPORT };
     ConditionalGate<EOMType, 2> eomGate_;
 
@@ -1816,6 +1883,9 @@ class HQSession
 
     uint16_t getDatagramSizeLimit() const noexcept override;
     bool sendDatagram(std::unique_ptr<folly::IOBuf> datagram) override;
+
+    std::unique_ptr<WebTransportImpl> newWebTransport(
+        HTTPTransaction& txn) override;
   }; // HQStreamTransport
 
 #ifdef _MSC_VER
@@ -1823,6 +1893,91 @@ class HQSession
 #endif
 
  private:
+  /**
+   * A WebTransport session whose streams are QUIC streams, prefixed with
+   * the stream type or signal and the CONNECT stream's ID. Registered with
+   * the session so that peer streams and STOP_SENDING reach it.
+   */
+  class HQWebTransport
+      : public WebTransportImpl
+      , public quic::QuicSocket::ReadCallback
+      , public quic::QuicSocket::WriteCallback {
+   public:
+    HQWebTransport(HQSession& session, HTTPTransaction& txn);
+    ~HQWebTransport() override;
+
+    uint16_t getDatagramSizeLimit() const override;
+    folly::Expected<folly::Unit, ErrorCode> sendDatagram(
+        std::unique_ptr<folly::IOBuf> datagram) override;
+
+    void onAttached() override;
+
+    // A peer stream whose preface has been consumed
+    void onNewStream(quic::StreamId id, bool bidi);
+    void onStopSending(quic::StreamId id, quic::ApplicationErrorCode error);
+
+    // quic::QuicSocket::ReadCallback
+    void readAvailable(quic::StreamId id) noexcept override;
+    void readError(quic::StreamId id, quic::QuicError error) noexcept override;
+
+    // quic::QuicSocket::WriteCallback
+    using WebTransportImpl::onStreamWriteReady;
+    void onStreamWriteReady(quic::StreamId id,
+                            uint64_t maxToSend) noexcept override;
+    void onStreamWriteError(quic::StreamId id,
+                            quic::QuicError error) noexcept override;
+
+   protected:
+    folly::Expected<StreamId, ErrorCode> newStream(bool bidi) override;
+    folly::Expected<FCState, ErrorCode> sendStreamData(
+        StreamId id, std::unique_ptr<folly::IOBuf> data, bool fin) override;
+    void resetStreamEgress(StreamId id, uint32_t error) override;
+    void stopStreamIngress(StreamId id, uint32_t error) override;
+    void pauseStreamIngress(StreamId id, bool paused) override;
+    void onSessionEnd() override;
+
+   private:
+    // Bytes buffered in the transport before a stream reports BLOCKED
+    static constexpr uint64_t kMaxStreamWriteBuffer = 64 * 1024;
+
+    struct StreamState {
+      bool reading{false};
+      bool writing{false};
+    };
+    void addStream(quic::StreamId id, bool reading, bool writing);
+    void onStreamDone(quic::StreamId id, bool reading);
+
+    HQSession& session_;
+    quic::StreamId sessionId_;
+    bool registered_{false};
+    folly::F14FastMap<quic::StreamId, StreamState> streams_;
+  };
+
+  class WebTransportBidiPeeker
+      : public quic::QuicSocket::PeekCallback
+      , public quic::QuicSocket::ReadCallback {
+   public:
+    explicit WebTransportBidiPeeker(HQSession& session) : session_(session) {
+    }
+    void onDataAvailable(
+        quic::StreamId id,
+        const HQUnidirStreamDispatcher::Callback::PeekData& data) noexcept
+        override {
+      session_.onBidiStreamPreface(id, data);
+    }
+    void peekError(quic::StreamId id, quic::QuicError error) noexcept override;
+
+    void readAvailable(quic::StreamId id) noexcept override {
+      session_.onPendingBidiStreamReadable(id);
+    }
+    void readError(quic::StreamId id, quic::QuicError error) noexcept override {
+      peekError(id, std::move(error));
+    }
+
+   private:
+    HQSession& session_;
+  };
+
   class VersionUtils {
    public:
     explicit VersionUtils(HQSession& session) : session_(session) {
@@ -2039,6 +2194,8 @@ class HQSession
    * Container to hold the results of HTTP2PriorityQueue::nextEgress
    */
   HTTP2PriorityQueue::NextEgressResult nextEgressResults_;
+  // Keeps the transactions in nextEgressResults_ alive while writing
+  std::vector<HTTPTransaction::DestructorGuard> nextEgressGuards_;
 
   // Cleanup all pending streams. Invoked in session timeout
   size_t cleanupPendingStreams();
@@ -2072,10 +2229,31 @@ class HQSession
   // Default to false for now to match existing behavior
   bool strictValidation_{false};
   bool datagramEnabled_{false};
+  // WebTransport is enabled in our SETTINGS, so peer streams are accepted
+  bool supportsWebTransport_{false};
+  // ...and in the peer's, so a client may use native streams for the
+  // sessions it starts
+  bool webTransportEnabled_{false};
+  WebTransportBidiPeeker wtBidiPeeker_{*this};
+  // Bidirectional streams waiting for their first bytes
+  std::unordered_set<quic::StreamId> pendingBidiStreams_;
+  // WebTransport sessions and streams, keyed by CONNECT and QUIC stream ID
+  folly::F14FastMap<quic::StreamId, HQWebTransport*> wtSessions_;
+  folly::F14FastMap<quic::StreamId, HQWebTransport*> wtStreams_;
+  // Peer streams of sessions the application has not created yet
+  folly::F14FastMap<quic::StreamId,
+                    std::vector<std::pair<quic::StreamId, bool>>>
+      bufferedWtStreams_;
 
   /** Reads in the current loop iteration */
   uint16_t readsPerLoop_{0};
-  std::unordered_set<quic::StreamId> pendingProcessReadSet_;
+  // Data was read since the last processReadData, which resets the timeout
+  bool readActivity_{false};
+  // Streams with data to run through their codecs, in the order their data
+  // arrived. A stream is listed once, while its pendingProcessRead_ is set.
+  std::vector<quic::StreamId> pendingProcessReads_;
+  // The list processed last loop, kept for its capacity
+  std::vector<quic::StreamId> spareProcessReads_;
   std::shared_ptr<QuicProtocolInfo> quicInfo_;
   folly::Optional<HQVersion> version_;
   std::string alpn_;
@@ -2104,12 +2282,7 @@ class HQSession
   std::unordered_map<quic::StreamId, HQStreamTransport> streams_;
 
   // Buffer for datagrams waiting for a stream to be assigned to
-  folly::EvictingCacheMap<
-      quic::StreamId,
-      folly::small_vector<std::unique_ptr<folly::IOBuf>,
-                          kDefaultMaxBufferedDatagrams,
-                          folly::small_vector_policy::NoHeap>>
-      datagramsBuffer_{kMaxStreamsWithBufferedDatagrams};
+  DatagramBuffer datagramsBuffer_;
 
   // Buffer for priority updates without an active stream
   folly::EvictingCacheMap<quic::StreamId, HTTPPriority> priorityUpdatesBuffer_{
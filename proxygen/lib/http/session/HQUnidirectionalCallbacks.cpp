@@ -110,6 +110,16 @@ void HQUnidirStreamDispatcher::onDataAvailable(
       }
       return;
     }
+    case hq::UnidirectionalStreamType::WEBTRANSPORT: {
+      // Same as push: wait until the session id can be read
+      auto sessionId = quic::decodeQuicInteger(cursor);
+      if (sessionId) {
+        consumed += sessionId->second;
+        sink_.onNewWebTransportUniStream(
+            releaseOwnership(id), sessionId->first, consumed);
+      }
+      return;
+    }
     default: {
       LOG(ERROR) << "Unrecognized type=" << static_cast<uint64_t>(type.value());
     }
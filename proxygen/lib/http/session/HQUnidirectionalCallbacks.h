@@ -50,6 +50,14 @@ class HQUnidirStreamDispatcher : public quic::QuicSocket::PeekCallback {
     // Called by the dispatcher when a stream can not be recognized
     virtual void rejectStream(quic::StreamId /* id */) = 0;
 
+    // Called by the dispatcher when a WebTransport stream is identified,
+    // once the session ID following the stream type has been read.
+    virtual void onNewWebTransportUniStream(quic::StreamId id,
+                                            quic::StreamId /* sessionId */,
+                                            size_t /* to consume */) {
+      rejectStream(id);
+    }
+
     // Called by the dispatcher to identify a stream preface
     virtual folly::Optional<hq::UnidirectionalStreamType> parseStreamPreface(
         uint64_t preface) = 0;
@@ -26,7 +26,9 @@ void HQUpstreamSession::startNow() {
 
 void HQUpstreamSession::connectTimeoutExpired() noexcept {
   VLOG(4) << __func__ << " sess=" << *this << ": connection failed";
-  if (connectCb_) {
+  // A session handed over for 0-RTT has no callback, but still fails if the
+  // handshake does not complete in time
+  if (connectCb_ || connCbState_ != ConnCallbackState::DONE) {
     onConnectionError(quic::QuicError(quic::LocalErrorCode::CONNECT_FAILED,
                                       "connect timeout"));
   }
@@ -72,6 +74,7 @@ void HQUpstreamSession::onReplaySafe() noexcept {
 }
 
 void HQUpstreamSession::handleReplaySafe() noexcept {
+  connectTimeout_.cancelTimeout();
   HQSession::onReplaySafe();
   // In the case that zero rtt, onTransportReady is almost called
   // immediately without proof of network reachability, and onReplaySafe is
@@ -79,7 +82,6 @@ void HQUpstreamSession::handleReplaySafe() noexcept {
   if (connectCb_) {
     auto cb = connectCb_;
     connectCb_ = nullptr;
-    connectTimeout_.cancelTimeout();
     cb->onReplaySafe();
   }
 }
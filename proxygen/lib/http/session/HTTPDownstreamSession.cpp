@@ -45,6 +45,9 @@ void HTTPDownstreamSession::setupOnHeadersComplete(HTTPTransaction* txn,
   // ingress and egress messages have completed (or failed).
   HTTPTransaction::Handler* handler = nullptr;
 
+  // A TLS 1.3 transport is not replay safe while it is reading early data
+  msg->setEarlyData(sock_ && !sock_->isReplaySafe());
+
   // In the general case, delegate to the handler factory to generate
   // a handler for the transaction.
   handler = getController()->getRequestHandler(*txn, msg);
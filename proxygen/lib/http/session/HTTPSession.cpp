@@ -15,12 +15,14 @@
 #include <folly/Random.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/portability/Sockets.h>
 #include <folly/tracing/ScopedTraceSection.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/codec/HTTPChecks.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/http/webtransport/CapsuleWebTransport.h>
 #include <wangle/acceptor/ConnectionManager.h>
 #include <wangle/acceptor/SocketOptions.h>
 
@@ -95,6 +97,7 @@ HTTPSession::HTTPSession(const WheelTimerInstance& wheelTimer,
       ingressError_(false),
       flowControlTimeout_(this),
       drainTimeout_(this),
+      ingressCostTimeout_(this),
       reads_(SocketState::PAUSED),
       writes_(SocketState::UNPAUSED),
       ingressUpgraded_(false),
@@ -225,6 +228,10 @@ void HTTPSession::setupCodec() {
     codec_.addFilters(std::unique_ptr<ControlMessageRateLimitFilter>(
         controlMessageRateLimitFilter_));
   }
+  if (codec_->supportsParallelRequests() && !ingressCostFilter_ && sock_) {
+    ingressCostFilter_ = new IngressCostFilter(*this);
+    codec_.addFilters(std::unique_ptr<IngressCostFilter>(ingressCostFilter_));
+  }
 
   codec_.setCallback(this);
 }
@@ -245,6 +252,10 @@ HTTPSession::~HTTPSession() {
     flowControlTimeout_.cancelTimeout();
   }
 
+  if (ingressCostTimeout_.isScheduled()) {
+    ingressCostTimeout_.cancelTimeout();
+  }
+
   runDestroyCallbacks();
 }
 
@@ -335,6 +346,35 @@ void HTTPSession::setEgressBytesLimit(uint64_t bytesLimit) {
   egressBytesLimit_ = bytesLimit;
 }
 
+void HTTPSession::setMaxActiveWrites(uint32_t maxActiveWrites) {
+  maxActiveWrites_ = std::max(maxActiveWrites, 1u);
+  updateWriteCount();
+  if (numActiveWrites_ < maxActiveWrites_) {
+    scheduleWrite();
+  }
+}
+
+bool HTTPSession::setNotSentLowat(uint32_t notSentLowat) {
+  if (notSentLowat == 0) {
+    return true;
+  }
+#ifdef TCP_NOTSENT_LOWAT
+  auto asyncSocket = sock_->getUnderlyingTransport<folly::AsyncSocket>();
+  if (!asyncSocket) {
+    VLOG(3) << *this << " no socket to set TCP_NOTSENT_LOWAT on";
+    return false;
+  }
+  int value = folly::to<int>(notSentLowat);
+  if (asyncSocket->setSockOpt(IPPROTO_TCP, TCP_NOTSENT_LOWAT, &value) != 0) {
+    VLOG(3) << *this << " failed to set TCP_NOTSENT_LOWAT, errno=" << errno;
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
 void HTTPSession::readTimeoutExpired() noexcept {
   VLOG(3) << "session-level timeout on " << *this;
 
@@ -346,7 +386,7 @@ void HTTPSession::readTimeoutExpired() noexcept {
 void HTTPSession::writeTimeoutExpired() noexcept {
   VLOG(4) << "Write timeout for " << *this;
 
-  CHECK(pendingWrite_.hasValue());
+  CHECK(!pendingWrites_.empty());
   DestructorGuard g(this);
 
   setCloseReason(ConnectionCloseReason::TIMEOUT);
@@ -362,6 +402,37 @@ void HTTPSession::flowControlTimeoutExpired() noexcept {
   shutdownTransport(true, true);
 }
 
+void HTTPSession::onIngressCostExceeded(
+    IngressCostLevel level, std::chrono::milliseconds recoveryTime) {
+  VLOG(3) << *this << " ingress cost exceeded, level="
+          << static_cast<uint32_t>(level)
+          << " recoveryTime=" << recoveryTime.count();
+  if (level == IngressCostLevel::GOAWAY && !draining_ && started_) {
+    // Refuse new streams, the ones already admitted may finish
+    draining_ = true;
+    setCloseReason(ConnectionCloseReason::SHUTDOWN);
+    if (codec_->generateImmediateGoaway(
+            writeBuf_, ErrorCode::ENHANCE_YOUR_CALM) > 0) {
+      scheduleWrite();
+    }
+  }
+  if (readsShutdown() || recoveryTime.count() == 0) {
+    return;
+  }
+  // Deprioritise the connection: stop parsing at the next frame and leave
+  // the event loop to other connections until the budget has refilled.
+  codec_->setParserPaused(true);
+  if (readsUnpaused()) {
+    pauseReadsImpl();
+  }
+  wheelTimer_.scheduleTimeout(&ingressCostTimeout_, recoveryTime);
+}
+
+void HTTPSession::ingressCostTimeoutExpired() noexcept {
+  VLOG(4) << *this << " ingress cost penalty expired";
+  resumeReads();
+}
+
 void HTTPSession::describe(std::ostream& os) const {
   os << "proto=" << getCodecProtocolString(codec_->getProtocol());
   if (isDownstream()) {
@@ -1738,6 +1809,14 @@ size_t HTTPSession::sendEOM(HTTPTransaction* txn,
   return encodedSize;
 }
 
+std::unique_ptr<WebTransportImpl> HTTPSession::newWebTransport(
+    HTTPTransaction& txn) {
+  if (!isHTTP2CodecProtocol(codec_->getProtocol())) {
+    return nullptr;
+  }
+  return std::make_unique<CapsuleWebTransport>(txn);
+}
+
 size_t HTTPSession::sendAbort(HTTPTransaction* txn,
                               ErrorCode statusCode) noexcept {
   // Ask the codec to generate an abort indicator for the transaction.
@@ -1795,6 +1874,12 @@ void HTTPSession::setControlMessageRateLimitParams(
   }
 }
 
+void HTTPSession::setIngressCostParams(const IngressCostParams& params) {
+  if (ingressCostFilter_) {
+    ingressCostFilter_->setParams(params);
+  }
+}
+
 /**
  * Send a CERTIFICATE_REQUEST frame. If the underlying protocol doesn't
  * support secondary authentication, this is a no-op and 0 is returned.
@@ -2052,21 +2137,69 @@ HTTPTransaction::Transport::Type HTTPSession::getSessionType() const noexcept {
   return getType();
 }
 
+void HTTPSession::setEgressRecordSizing(bool enabled) {
+  if (enabled) {
+    if (!isHTTP2CodecProtocol(codec_->getProtocol())) {
+      // HTTP/1.x bodies have no frames to fit into records
+      VLOG(4) << *this << " egress record sizing needs HTTP/2";
+      return;
+    }
+    if (!egressRecordSizer_) {
+      egressRecordSizer_.emplace();
+    }
+    return;
+  }
+  egressRecordSizer_.reset();
+  if (egressDataFrameSizeLimit_ != 0) {
+    codec_->setEgressDataFrameSizeLimit(0);
+    egressDataFrameSizeLimit_ = 0;
+  }
+}
+
+void HTTPSession::sizeEgressToRecords(uint32_t& writeMax,
+                                      uint32_t& bodySizeLimit) {
+  uint32_t recordSize = egressRecordSizer_->getRecordSize(getCurrentTime());
+  // Each DATA frame header shares its record with the payload
+  uint32_t slice = recordSize;
+  if (recordSize > 2 * http2::kFrameHeaderSize) {
+    slice -= http2::kFrameHeaderSize;
+  }
+  if (slice != egressDataFrameSizeLimit_) {
+    VLOG(4) << *this << " sizing egress to " << recordSize << " byte records";
+    codec_->setEgressDataFrameSizeLimit(slice);
+    egressDataFrameSizeLimit_ = slice;
+  }
+  // Round down to whole records, and leave a limit below one record alone,
+  // so that neither limit is ever raised
+  if (writeMax >= recordSize) {
+    writeMax = writeMax / recordSize * slice;
+  }
+  if (bodySizeLimit >= slice) {
+    bodySizeLimit = bodySizeLimit / slice * slice;
+  }
+}
+
 unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork,
                                              bool* timestampTx,
                                              bool* timestampAck) {
-  // limit ourselves to one outstanding write at a time (onWriteSuccess calls
-  // scheduleWrite)
-  if (numActiveWrites_ > 0 || writesShutdown()) {
+  // limit ourselves to maxActiveWrites_ outstanding writes at a time
+  // (onWriteSuccess calls scheduleWrite)
+  if (numActiveWrites_ >= maxActiveWrites_ || writesShutdown()) {
     VLOG(4) << "skipping write during this loop, numActiveWrites_="
             << numActiveWrites_ << " writesShutdown()=" << writesShutdown();
     return nullptr;
   }
 
+  uint32_t writeMax = kWriteReadyMax;
+  uint32_t bodySizeLimit = egressBodySizeLimit_;
+  if (egressRecordSizer_ && !txnEgressQueue_.empty()) {
+    sizeEgressToRecords(writeMax, bodySizeLimit);
+  }
+
   // We always tack on at least one body packet to the current write buf
   // This ensures that a short HTTPS response will go out in a single SSL record
   while (!txnEgressQueue_.empty()) {
-    uint32_t toSend = kWriteReadyMax;
+    uint32_t toSend = writeMax;
     if (connFlowControl_) {
       if (connFlowControl_->getAvailableSend() == 0) {
         VLOG(4) << "Session-level send window is full, skipping remaining "
@@ -2084,19 +2217,19 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork,
       // to the first transaction
       nextEgressResults_.erase(++nextEgressResults_.begin(),
                                nextEgressResults_.end());
-      txnMaxToSend = std::min(toSend, egressBodySizeLimit_);
+      txnMaxToSend = std::min(toSend, bodySizeLimit);
       nextEgressResults_.front().second = 1;
     }
-    if (nextEgressResults_.size() > 1 && txnMaxToSend > egressBodySizeLimit_) {
-      // Cap the max to egressBodySizeLimit_, and recompute toSend accordingly
-      txnMaxToSend = egressBodySizeLimit_;
+    if (nextEgressResults_.size() > 1 && txnMaxToSend > bodySizeLimit) {
+      // Cap the max to bodySizeLimit, and recompute toSend accordingly
+      txnMaxToSend = bodySizeLimit;
       toSend = txnMaxToSend / nextEgressResults_.front().second;
     }
     // split allowed by relative weight, with some minimum
     for (auto txnPair : nextEgressResults_) {
       uint32_t txnAllowed = txnPair.second * toSend;
       if (nextEgressResults_.size() > 1) {
-        CHECK_LE(txnAllowed, egressBodySizeLimit_);
+        CHECK_LE(txnAllowed, bodySizeLimit);
       }
       if (connFlowControl_) {
         CHECK_LE(txnAllowed, connFlowControl_->getAvailableSend());
@@ -2122,7 +2255,7 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork,
   *timestampAck = false;
   if (byteEventTracker_) {
     uint64_t needed = byteEventTracker_->preSend(
-        cork, timestampTx, timestampAck, bytesWritten_);
+        cork, timestampTx, timestampAck, bytesScheduled_);
     if (needed > 0) {
       VLOG(5) << *this
               << " writeBuf_.chainLength(): " << writeBuf_.chainLength()
@@ -2206,8 +2339,7 @@ void HTTPSession::runLoopCallback() noexcept {
     flags |= (timestampTx) ? folly::WriteFlags::TIMESTAMP_TX
                            : folly::WriteFlags::NONE;
     flags |= (timestampAck) ? folly::WriteFlags::EOR : folly::WriteFlags::NONE;
-    CHECK(!pendingWrite_.hasValue());
-    pendingWrite_.emplace(len, DestructorGuard(this));
+    pendingWrites_.emplace_back(len, DestructorGuard(this));
 
     if (!writeTimeout_.isScheduled()) {
       // Any performance concern here?
@@ -2219,12 +2351,20 @@ void HTTPSession::runLoopCallback() noexcept {
             << " timestampTx:" << timestampTx
             << " timestampAck:" << timestampAck;
     bytesScheduled_ += len;
+    if (egressRecordSizer_) {
+      egressRecordSizer_->onBytesWritten(len, getCurrentTime());
+    }
     sock_->writeChain(this, std::move(writeBuf), flags);
     if (numActiveWrites_ > 0) {
       updateWriteCount();
       HTTPSessionBase::notifyEgressBodyBuffered(len, false);
       // updateWriteBufSize called in scope guard
-      break;
+      if (numActiveWrites_ >= maxActiveWrites_ ||
+          (writeBuf_.empty() && txnEgressQueue_.empty())) {
+        // The pipeline is full or there is nothing left to send.  Further
+        // priority decisions wait for the next write completion.
+        break;
+      }
     }
     // writeChain can result in a writeError and trigger the shutdown code path
   }
@@ -2257,11 +2397,11 @@ void HTTPSession::scheduleWrite() {
 }
 
 void HTTPSession::updateWriteCount() {
-  if (numActiveWrites_ > 0 && writesUnpaused()) {
+  if (numActiveWrites_ >= maxActiveWrites_ && writesUnpaused()) {
     // Exceeded limit. Pause reading on the incoming stream.
     VLOG(3) << "Pausing egress for " << *this;
     writes_ = SocketState::PAUSED;
-  } else if (numActiveWrites_ == 0 && writesPaused()) {
+  } else if (numActiveWrites_ < maxActiveWrites_ && writesPaused()) {
     // Dropped below limit. Resume reading on the incoming stream if needed.
     VLOG(3) << "Resuming egress for " << *this;
     writes_ = SocketState::UNPAUSED;
@@ -2391,9 +2531,10 @@ void HTTPSession::shutdownTransportWithReset(ProxygenError errorCode,
   if (!writesShutdown()) {
     writes_ = SocketState::SHUTDOWN;
     IOBuf::destroy(writeBuf_.move());
-    if (pendingWrite_.hasValue()) {
-      numActiveWrites_--;
-    }
+    // Writes still queued in the transport will fail with writeErr, which
+    // only drops them from pendingWrites_
+    numActiveWrites_ -= std::min<unsigned>(numActiveWrites_,
+                                           pendingWrites_.size());
     VLOG(4) << *this << " cancel write timer";
     writeTimeout_.cancelTimeout();
     resetSocketOnShutdown_ = true;
@@ -2732,15 +2873,20 @@ void HTTPSession::incrementIncomingStreams(HTTPTransaction* txn) {
 }
 
 void HTTPSession::writeSuccess() noexcept {
-  CHECK(pendingWrite_.hasValue());
+  CHECK(!pendingWrites_.empty());
   DestructorGuard dg(this);
-  auto bytesWritten = pendingWrite_->first;
+  auto bytesWritten = pendingWrites_.front().first;
   bytesWritten_ += bytesWritten;
   transportInfo_.totalBytes += bytesWritten;
   CHECK(writeTimeout_.isScheduled());
-  VLOG(10) << "Cancel write timer on last successful write";
-  writeTimeout_.cancelTimeout();
-  pendingWrite_.reset();
+  pendingWrites_.pop_front();
+  if (pendingWrites_.empty()) {
+    VLOG(10) << "Cancel write timer on last successful write";
+    writeTimeout_.cancelTimeout();
+  } else {
+    // The transport is making progress, restart the timer for the rest
+    wheelTimer_.scheduleTimeout(&writeTimeout_);
+  }
 
   if (infoCallback_) {
     infoCallback_->onWrite(*this, bytesWritten);
@@ -2773,7 +2919,8 @@ void HTTPSession::writeSuccess() noexcept {
     //             in the future we may want to have a pull model
     //             whereby the socket asks us for a given amount of
     //             data to send...
-    if (numActiveWrites_ == 0 && hasMoreWrites()) {
+    if (numActiveWrites_ < maxActiveWrites_ &&
+        (writeBuf_.front() || !txnEgressQueue_.empty())) {
       runLoopCallback();
     } else {
       invokeOnAllTransactions([](HTTPTransaction* txn) {
@@ -2795,8 +2942,10 @@ void HTTPSession::writeErr(size_t bytesWritten,
                            const AsyncSocketException& ex) noexcept {
   VLOG(4) << *this << " write error: " << ex.what();
   DestructorGuard dg(this);
-  DCHECK(pendingWrite_.hasValue());
-  pendingWrite_.reset();
+  DCHECK(!pendingWrites_.empty());
+  if (!pendingWrites_.empty()) {
+    pendingWrites_.pop_front();
+  }
   if (infoCallback_) {
     infoCallback_->onWrite(*this, bytesWritten);
   }
@@ -2821,7 +2970,7 @@ void HTTPSession::onWriteCompleted() {
   }
 
   // Don't shutdown if there might be more writes
-  if (pendingWrite_.hasValue()) {
+  if (!pendingWrites_.empty()) {
     return;
   }
 
@@ -2889,7 +3038,8 @@ void HTTPSession::pauseReadsImpl() {
 
 void HTTPSession::resumeReads() {
   if (!readsPaused() ||
-      (codec_->supportsParallelRequests() && ingressLimitExceeded())) {
+      (codec_->supportsParallelRequests() && ingressLimitExceeded()) ||
+      ingressCostTimeout_.isScheduled()) {
     return;
   }
   resumeReadsImpl();
@@ -2907,10 +3057,10 @@ void HTTPSession::resumeReadsImpl() {
 
 bool HTTPSession::hasMoreWrites() const {
   VLOG(10) << __PRETTY_FUNCTION__ << " numActiveWrites_: " << numActiveWrites_
-           << " pendingWrite_.hasValue(): " << pendingWrite_.hasValue()
+           << " pendingWrites_.size(): " << pendingWrites_.size()
            << " txnEgressQueue_.empty(): " << txnEgressQueue_.empty();
 
-  return (numActiveWrites_ != 0) || pendingWrite_.hasValue() ||
+  return (numActiveWrites_ != 0) || !pendingWrites_.empty() ||
          writeBuf_.front() || !txnEgressQueue_.empty();
 }
 
@@ -2962,6 +3112,10 @@ void HTTPSession::onConnectionSendWindowClosed() {
     if (sessionStats_) {
       sessionStats_->recordSessionStalled();
     }
+    // Buffered egress held by a peer that keeps its window shut
+    if (ingressCostFilter_) {
+      ingressCostFilter_->charge(kIngressWindowStallCost, "window stall");
+    }
   }
   DCHECK(!flowControlTimeout_.isScheduled());
   if (infoCallback_) {
@@ -25,13 +25,16 @@
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/http/codec/IngressCostFilter.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/EgressRecordSizer.h>
 #include <proxygen/lib/http/session/HTTPEvent.h>
 #include <proxygen/lib/http/session/HTTPSessionActivityTracker.h>
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <proxygen/lib/http/session/SecondaryAuthManagerBase.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
+#include <deque>
 #include <queue>
 #include <set>
 #include <vector>
@@ -52,6 +55,7 @@ class HTTPSession
     , protected folly::AsyncTransport::BufferCallback
     , protected HTTPPriorityMapFactoryProvider
     , private FlowControlFilter::Callback
+    , private IngressCostFilter::Callback
     , private HTTPCodec::Callback
     , private folly::EventBase::LoopCallback
     , private folly::AsyncTransport::ReadCallback
@@ -114,6 +118,13 @@ class HTTPSession
 
   void setByteEventTracker(std::shared_ptr<ByteEventTracker> byteEventTracker);
 
+  /**
+   * Size each write, and the DATA frames in it, to whole TLS records whose
+   * size grows as the transfer warms up (see EgressRecordSizer). Off by
+   * default, and only takes effect on HTTP/2 sessions.
+   */
+  void setEgressRecordSizing(bool enabled);
+
   void setSessionStats(HTTPSessionStats* stats) override;
   /**
    * Set flow control properties on the session.
@@ -148,6 +159,10 @@ class HTTPSession
     return connectionToken_;
   }
 
+  // HTTP/2 carries WebTransport in capsules on the CONNECT stream
+  std::unique_ptr<WebTransportImpl> newWebTransport(
+      HTTPTransaction& txn) override;
+
   const folly::SocketAddress& getLocalAddress() const noexcept override {
     return HTTPSessionBase::getLocalAddress();
   }
@@ -177,6 +192,31 @@ class HTTPSession
    */
   void setEgressBytesLimit(uint64_t bytesLimit);
 
+  /**
+   * Set the maximum number of writes that may be outstanding on the
+   * transport at once.  The default of 1 waits for each write to complete
+   * before producing the next one.  Allowing a few writes in flight keeps
+   * the socket fed on high-BDP paths while the session still picks what to
+   * send (and in which priority order) as late as possible.  A write
+   * completes as soon as the kernel accepts it, so this is best combined
+   * with setNotSentLowat: the kernel then takes little more than it can
+   * send, and once a write blocks the socket is not writable again until
+   * the unsent bytes drop below the mark.
+   */
+  void setMaxActiveWrites(uint32_t maxActiveWrites);
+
+  uint32_t getMaxActiveWrites() const {
+    return maxActiveWrites_;
+  }
+
+  /**
+   * Set TCP_NOTSENT_LOWAT on the underlying socket, limiting the unsent
+   * bytes the kernel will buffer.  Data that has not been handed to the
+   * kernel can still be reprioritized.  0 leaves the socket untouched.
+   * Returns false if the option could not be applied.
+   */
+  bool setNotSentLowat(uint32_t notSentLowat);
+
   /**
    * If set to true, HTTPSession will abort the push streams when receiving
    * a STREAM_RST on the associated stream.
@@ -279,6 +319,12 @@ class HTTPSession
       std::chrono::milliseconds directErrorHandlingIntervalDuration =
           kDefaultDirectErrorHandlingDuration);
 
+  /**
+   * Tune or disable the per-connection ingress cost budget used to detect
+   * abusive HTTP/2 clients.  No-op for codecs without parallel requests.
+   */
+  void setIngressCostParams(const IngressCostParams& params);
+
   /**
    * Get the SecondaryAuthManager attached to this session.
    */
@@ -407,6 +453,13 @@ class HTTPSession
                                               bool* timestampTx,
                                               bool* timestampAck);
 
+  /**
+   * With record sizing enabled, rounds the per-loop write and per
+   * transaction body limits down to whole records, and caps the codec's DATA
+   * frames so each one fills a record.
+   */
+  void sizeEgressToRecords(uint32_t& writeMax, uint32_t& bodySizeLimit);
+
   void decrementTransactionCount(HTTPTransaction* txn,
                                  bool ingressEOM,
                                  bool egressEOM);
@@ -434,6 +487,7 @@ class HTTPSession
   void readTimeoutExpired() noexcept;
   void writeTimeoutExpired() noexcept;
   void flowControlTimeoutExpired() noexcept;
+  void ingressCostTimeoutExpired() noexcept;
 
   // AsyncTransport::ReadCallback methods
   void getReadBuffer(void** buf, size_t* bufSize) override;
@@ -773,12 +827,19 @@ class HTTPSession
 
   ControlMessageRateLimitFilter* controlMessageRateLimitFilter_{nullptr};
 
+  IngressCostFilter* ingressCostFilter_{nullptr};
+
   /**
    * Number of writes submitted to the transport for which we haven't yet
    * received completion or failure callbacks.
    */
   unsigned numActiveWrites_{0};
 
+  /**
+   * Upper bound on numActiveWrites_, see setMaxActiveWrites.
+   */
+  uint32_t maxActiveWrites_{1};
+
   /**
    * Indicates if the session is waiting for existing transactions to close.
    * Once all transactions close, the session will be deleted.
@@ -823,6 +884,14 @@ class HTTPSession
   void onConnectionSendWindowOpen() override;
   void onConnectionSendWindowClosed() override;
 
+  /**
+   * Callback function from the ingress cost filter when the peer has spent
+   * its budget.  Reads are paused for recoveryTime, and a GOAWAY is sent
+   * when the debt is large.
+   */
+  void onIngressCostExceeded(IngressCostLevel level,
+                             std::chrono::milliseconds recoveryTime) override;
+
   /**
    * Invoked when the codec processes callbacks for a stream we are no
    * longer tracking.
@@ -926,8 +995,10 @@ class HTTPSession
 
   std::list<ReplaySafetyCallback*> waitingForReplaySafety_;
 
-  folly::Optional<std::pair<uint64_t, HTTPSession::DestructorGuard>>
-      pendingWrite_;
+  // Lengths of the writes handed to the transport, oldest first.  The
+  // transport completes writes in order.
+  std::deque<std::pair<uint64_t, HTTPSession::DestructorGuard>>
+      pendingWrites_;
 
   /**
    * Connection level flow control for SPDY >= 3.1 and HTTP/2
@@ -982,6 +1053,13 @@ class HTTPSession
 
   std::shared_ptr<ByteEventTracker> byteEventTracker_{nullptr};
 
+  /**
+   * Set when egress is sized to TLS records, and the DATA frame payload
+   * limit last given to the codec for it.
+   */
+  folly::Optional<EgressRecordSizer> egressRecordSizer_;
+  uint32_t egressDataFrameSizeLimit_{0};
+
   std::unique_ptr<HTTPSessionActivityTracker> httpSessionActivityTracker_;
 
   HTTPTransaction* lastTxn_{nullptr};
@@ -1061,6 +1139,23 @@ class HTTPSession
   };
   DrainTimeout drainTimeout_;
 
+  class IngressCostTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit IngressCostTimeout(HTTPSession* session) : session_(session) {
+    }
+    ~IngressCostTimeout() override {
+    }
+
+    void timeoutExpired() noexcept override {
+      session_->ingressCostTimeoutExpired();
+    }
+
+   private:
+    HTTPSession* session_;
+  };
+  // Scheduled while reads are paused to let the ingress cost budget refill
+  IngressCostTimeout ingressCostTimeout_;
+
   class PingProber : public folly::HHWheelTimer::Callback {
    public:
     PingProber(HTTPSession& session,
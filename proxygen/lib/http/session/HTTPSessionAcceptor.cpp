@@ -119,6 +119,8 @@ void HTTPSessionAcceptor::onNewConnection(folly::AsyncTransport::UniquePtr sock,
   if (accConfig_.writeBufferLimit > 0) {
     session->setWriteBufferLimit(accConfig_.writeBufferLimit);
   }
+  session->setMaxActiveWrites(accConfig_.maxActiveWrites);
+  session->setNotSentLowat(accConfig_.egressNotSentLowat);
   session->setSessionStats(downstreamSessionStats_);
   Acceptor::addConnection(session);
   startSession(*session);
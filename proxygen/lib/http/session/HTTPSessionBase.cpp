@@ -19,7 +19,7 @@ using wangle::TransportInfo;
 namespace proxygen {
 std::atomic<uint32_t> HTTPSessionBase::kDefaultReadBufLimit{65536};
 uint32_t HTTPSessionBase::maxReadBufferSize_ = 4000;
-uint32_t HTTPSessionBase::egressBodySizeLimit_ = 4096;
+uint32_t HTTPSessionBase::defaultEgressBodySizeLimit_ = 4096;
 uint32_t HTTPSessionBase::kDefaultWriteBufLimit = 65536;
 
 HTTPSessionBase::HTTPSessionBase(const SocketAddress& localAddr,
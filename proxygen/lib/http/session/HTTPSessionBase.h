@@ -148,11 +148,12 @@ class HTTPSessionBase : public wangle::ManagedConnection {
   }
 
   /**
-   * Set the maximum egress body size for any outbound body bytes per loop,
-   * when there are > 1 transactions.
+   * Set the default maximum egress body size for any outbound body bytes per
+   * loop, when there are > 1 transactions. Applies to sessions created
+   * afterwards; see setEgressBodySizeLimit to change a single session.
    */
   static void setFlowControlledBodySizeLimit(uint32_t limit) {
-    egressBodySizeLimit_ = limit;
+    defaultEgressBodySizeLimit_ = limit;
   }
 
   /**
@@ -298,6 +299,18 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     VLOG(4) << "write buffer limit: " << int(limit / 1000) << "KB";
   }
 
+  /**
+   * Get/Set the maximum egress body bytes per transaction per loop when
+   * there are > 1 transactions.
+   */
+  uint32_t getEgressBodySizeLimit() const {
+    return egressBodySizeLimit_;
+  }
+
+  void setEgressBodySizeLimit(uint32_t limit) {
+    egressBodySizeLimit_ = limit;
+  }
+
   void setReadBufferLimit(uint32_t limit) {
     readBufLimit_ = limit;
   }
@@ -637,10 +650,10 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   static uint32_t kDefaultWriteBufLimit;
   /**
-   * Maximum number of bytes to egress per loop when there are > 1
-   * transactions.  Otherwise defaults to kDefaultWriteBufLimit.
+   * Default maximum number of bytes to egress per loop when there are > 1
+   * transactions.
    */
-  static uint32_t egressBodySizeLimit_;
+  static uint32_t defaultEgressBodySizeLimit_;
 
   /** Address of this end of the connection */
   folly::SocketAddress localAddr_;
@@ -713,6 +726,11 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   uint32_t readBufLimit_{kDefaultReadBufLimit};
   uint32_t writeBufLimit_{kDefaultWriteBufLimit};
+  /**
+   * Maximum number of bytes to egress per transaction per loop when there
+   * are > 1 transactions.
+   */
+  uint32_t egressBodySizeLimit_{defaultEgressBodySizeLimit_};
 
   /**
    * Bytes of egress data sent to the socket but not yet written
@@ -30,6 +30,14 @@ class HTTPSessionStats : public TTLBAStats {
   virtual void recordSessionStalled() noexcept = 0;
   virtual void recordPendingBufferedReadBytes(int64_t) noexcept = 0;
   virtual void recordEgressContentLengthMismatches() noexcept = 0;
+  // Request stream bytes an HQSession wrote in one write event, per urgency
+  virtual void recordWriteEventUrgencyBytes(uint8_t /* urgency */,
+                                            uint64_t /* bytes */) noexcept {
+  }
+  // H3 datagrams an HQSession discarded while waiting for their stream
+  virtual void recordDroppedDatagrams(uint32_t /* datagrams */,
+                                      uint64_t /* bytes */) noexcept {
+  }
 };
 
 } // namespace proxygen
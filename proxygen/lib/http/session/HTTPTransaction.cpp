@@ -16,6 +16,7 @@
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/RFC2616.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/http/webtransport/WebTransportImpl.h>
 #include <sstream>
 
 using folly::IOBuf;
@@ -149,6 +150,10 @@ void HTTPTransaction::onDelayedDestroy(bool delayed) {
   }
   VLOG(4) << "destroying transaction " << *this;
   deleting_ = true;
+  if (wtSession_) {
+    // Any streams still open go with the CONNECT stream
+    wtSession_->terminate(folly::none, false);
+  }
   if (handler_) {
     handler_->detachTransaction();
     handler_ = nullptr;
@@ -338,7 +343,11 @@ void HTTPTransaction::processIngressBody(unique_ptr<IOBuf> chain, size_t len) {
   auto chainLen = chain->computeChainDataLength();
   if (handler_) {
     if (!isIngressComplete()) {
-      handler_->onBodyWithOffset(ingressBodyOffset_, std::move(chain));
+      if (wtSession_) {
+        wtSession_->onConnectStreamData(std::move(chain));
+      } else {
+        handler_->onBodyWithOffset(ingressBodyOffset_, std::move(chain));
+      }
     }
 
     if (useFlowControl_ && !isIngressEOMSeen()) {
@@ -517,6 +526,9 @@ void HTTPTransaction::processIngressEOM() {
   }
   if (handler_) {
     if (!wasComplete) {
+      if (wtSession_) {
+        wtSession_->onConnectStreamEnd();
+      }
       handler_->onEOM();
     }
   } else {
@@ -696,6 +708,9 @@ void HTTPTransaction::onError(const HTTPException& error) {
       }
       break;
   }
+  if (wtSession_) {
+    wtSession_->onConnectStreamError();
+  }
   if (notify && handler_) {
     // mark egress complete may result in handler detaching
     handler_->onError(error);
@@ -932,6 +947,25 @@ void HTTPTransaction::sendHeadersWithOptionalEOM(const HTTPMessage& headers,
     updateReadTimeout();
   }
   flushWindowUpdate();
+  if (wtSession_ && !eom) {
+    if (headers.isRequest() ||
+        (headers.getStatusCode() >= 200 && headers.getStatusCode() < 300)) {
+      wtSession_->onConnectHeadersSent();
+    } else if (!headers.is1xxResponse()) {
+      wtSession_->onConnectStreamError();
+    }
+  }
+}
+
+bool HTTPTransaction::sendEarlyHints(const HTTPMessage& hints) {
+  INVARIANT_RETURN(hints.isResponse() && hints.getStatusCode() == 103, false);
+  if (isUpstream() || isPushed() || !canSendHeaders() ||
+      !transport_.getCodec().supportsEarlyHints()) {
+    VLOG(4) << "Not sending early hints " << *this;
+    return false;
+  }
+  sendHeaders(hints);
+  return true;
 }
 
 bool HTTPTransaction::delegatedTransactionChecks(
@@ -1415,6 +1449,16 @@ uint16_t HTTPTransaction::getDatagramSizeLimit() const noexcept {
   return transport_.getDatagramSizeLimit();
 }
 
+WebTransport* HTTPTransaction::getWebTransport() {
+  if (!wtSession_) {
+    wtSession_ = transport_.newWebTransport(*this);
+    if (wtSession_) {
+      wtSession_->onAttached();
+    }
+  }
+  return wtSession_.get();
+}
+
 bool HTTPTransaction::sendDatagram(std::unique_ptr<folly::IOBuf> datagram) {
   if (!validateEgressStateTransition(
           HTTPTransactionEgressSM::Event::sendDatagram)) {
@@ -1609,6 +1653,9 @@ void HTTPTransaction::updateHandlerPauseState() {
     } else {
       handlerEgressPaused_ = false;
       VLOG(4) << "egress resumed txn=" << *this;
+      if (wtSession_) {
+        wtSession_->onConnectStreamWriteReady();
+      }
       handler_->onEgressResumed();
     }
   }
@@ -27,6 +27,7 @@
 #include <proxygen/lib/http/session/HTTPEvent.h>
 #include <proxygen/lib/http/session/HTTPTransactionEgressSM.h>
 #include <proxygen/lib/http/session/HTTPTransactionIngressSM.h>
+#include <proxygen/lib/http/webtransport/WebTransportImpl.h>
 #include <proxygen/lib/utils/Time.h>
 #include <proxygen/lib/utils/TraceEvent.h>
 #include <proxygen/lib/utils/TraceEventObserver.h>
@@ -305,6 +306,29 @@ class HTTPTransactionHandler : public TraceEventObserver {
   virtual void onDatagram(std::unique_ptr<folly::IOBuf> /*datagram*/) noexcept {
   }
 
+  /**
+   * The peer opened a stream in the WebTransport session of this CONNECT
+   * transaction. Only invoked once HTTPTransaction::getWebTransport() has
+   * created the session.
+   */
+  virtual void onWebTransportBidiStream(
+      HTTPCodec::StreamID /*id*/,
+      WebTransport::BidiStreamHandle /*handle*/) noexcept {
+  }
+
+  virtual void onWebTransportUniStream(
+      HTTPCodec::StreamID /*id*/,
+      WebTransport::StreamReadHandle* /*handle*/) noexcept {
+  }
+
+  /**
+   * The WebTransport session ended, with the peer's error code if it sent
+   * one. All of the session's stream handles are invalid.
+   */
+  virtual void onWebTransportSessionClose(
+      folly::Optional<uint32_t> /*error*/) noexcept {
+  }
+
   virtual ~HTTPTransactionHandler() override {
   }
 };
@@ -607,6 +631,12 @@ class HTTPTransaction
       folly::assume_unreachable();
     }
 
+    // nullptr if the transport cannot carry WebTransport
+    virtual std::unique_ptr<WebTransportImpl> newWebTransport(
+        HTTPTransaction& /*txn*/) {
+      return nullptr;
+    }
+
     /**
      * Ask transport to track and ack body delivery.
      */
@@ -1067,6 +1097,19 @@ class HTTPTransaction
   virtual void sendHeadersWithEOM(const HTTPMessage& headers);
   virtual void sendHeadersWithOptionalEOM(const HTTPMessage& headers, bool eom);
 
+  /**
+   * Send a 103 (Early Hints) informational response ahead of the final
+   * response, eg: to let the client start fetching subresources named in
+   * Link headers while the final response is being computed. May be called
+   * more than once, but only before the final response headers.
+   *
+   * @param hints  A 103 response, typically precomputed (see EarlyHints)
+   * @return false if the hints were not sent because this is not a
+   *         downstream transaction, the final response has already started
+   *         or the peer cannot receive 1xx responses (HTTP/1.0).
+   */
+  virtual bool sendEarlyHints(const HTTPMessage& hints);
+
   /**
    * Experimental API
    *
@@ -1572,6 +1615,19 @@ class HTTPTransaction
   uint16_t getDatagramSizeLimit() const noexcept;
   virtual bool sendDatagram(std::unique_ptr<folly::IOBuf> datagram);
 
+  /**
+   * The WebTransport session of this extended CONNECT transaction, created
+   * on the first call. Once it exists the CONNECT stream's body belongs to
+   * it and the handler no longer sees onBody. Call it when the CONNECT is
+   * sent or received, before streams of the session can arrive; an HTTP/3
+   * client must call it before sending the CONNECT, which says whether the
+   * session's streams are native QUIC streams or capsules. Clients that
+   * want native streams should wait for the server's SETTINGS first.
+   *
+   * Returns nullptr if the transport cannot carry WebTransport.
+   */
+  WebTransport* getWebTransport();
+
   folly::Optional<ConnectionToken> getConnectionToken() const noexcept;
 
   static void setEgressBufferLimit(uint64_t limit) {
@@ -1727,6 +1783,8 @@ class HTTPTransaction
    */
   std::unique_ptr<std::queue<HTTPEvent>> deferredIngress_;
 
+  std::unique_ptr<WebTransportImpl> wtSession_;
+
   /**
    * Queue to hold any body bytes to be sent out
    * while egress to the remote is supposed to be paused.
@@ -219,6 +219,9 @@ void HTTPUpstreamSession::detachThreadLocals(bool detachSSLContext) {
   if (controlMessageRateLimitFilter_) {
     controlMessageRateLimitFilter_->detachThreadLocals();
   }
+  if (ingressCostTimeout_.isScheduled()) {
+    ingressCostTimeout_.cancelTimeout();
+  }
   setController(nullptr);
   setSessionStats(nullptr);
   // The codec filters *shouldn't* be accessible while the socket is detached,
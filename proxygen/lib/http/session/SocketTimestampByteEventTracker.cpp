@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/SocketTimestampByteEventTracker.h>
+
+#include <cerrno>
+#include <proxygen/lib/http/session/TTLBAStats.h>
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
+
+namespace {
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+// Timestamps are requested per socket rather than per write, TX/ACK
+// reporting is toggled around sampled writes.  OPT_ID stays on so the byte
+// counter keeps its base across toggles.
+constexpr uint32_t kBaseTimestampFlags =
+    SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+    SOF_TIMESTAMPING_OPT_TSONLY
+#ifdef SOF_TIMESTAMPING_OPT_ID_TCP
+    | SOF_TIMESTAMPING_OPT_ID_TCP
+#endif
+    ;
+constexpr uint32_t kReportTimestampFlags =
+    SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_ACK;
+#endif
+
+/**
+ * The ByteEvent handed to TX/ACK callbacks, getLatency() is the send to
+ * timestamp latency in milliseconds.
+ */
+class TimestampedByteEvent : public proxygen::TransactionByteEvent {
+ public:
+  TimestampedByteEvent(uint64_t byteOffset,
+                       EventType eventType,
+                       proxygen::HTTPTransaction* txn,
+                       std::chrono::microseconds latency,
+                       Callback callback)
+      : TransactionByteEvent(byteOffset, eventType, txn, std::move(callback)),
+        latency_(latency) {
+  }
+
+  int64_t getLatency() override {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(latency_)
+        .count();
+  }
+
+ private:
+  std::chrono::microseconds latency_;
+};
+
+} // namespace
+
+namespace proxygen {
+
+SocketTimestampByteEventTracker::SocketTimestampByteEventTracker(
+    Callback* callback, folly::AsyncSocket* socket, Options options)
+    : ByteEventTracker(callback),
+      socket_(socket),
+      options_(options),
+      txLatency_(options.histogramBucketUs, 0, options.histogramMaxUs),
+      ackLatency_(options.histogramBucketUs, 0, options.histogramMaxUs) {
+  if (!socket_) {
+    return;
+  }
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  keyBase_ = socket_->getRawBytesWritten();
+  uint32_t flags = kBaseTimestampFlags;
+  if (socket_->setSockOpt(SOL_SOCKET, SO_TIMESTAMPING, &flags) != 0) {
+    VLOG(2) << "SO_TIMESTAMPING unavailable, errno=" << errno;
+    socket_ = nullptr;
+    return;
+  }
+  socket_->setErrMessageCallback(this);
+  // HTTPSession only adds TX/ACK events when it can map app to raw offsets
+  socket_->setEorTracking(true);
+  expiryTimeout_ = folly::AsyncTimeout::make(
+      *socket_->getEventBase(), [this]() noexcept {
+        expireTimestampRecords();
+        scheduleExpiry();
+      });
+#else
+  socket_ = nullptr;
+#endif
+}
+
+SocketTimestampByteEventTracker::~SocketTimestampByteEventTracker() {
+  disableSocketTimestampEvents();
+  // The base destructor only drains the base events
+  ByteEventTracker::drainByteEvents();
+}
+
+size_t SocketTimestampByteEventTracker::drainByteEvents() {
+  auto numEvents = ByteEventTracker::drainByteEvents();
+  numEvents += drainTimestampRecords(txEvents_);
+  numEvents += drainTimestampRecords(ackEvents_);
+  maybeStopReporting();
+  return numEvents;
+}
+
+size_t SocketTimestampByteEventTracker::disableSocketTimestampEvents() {
+  disabled_ = true;
+  if (socket_) {
+    setReportTimestamps(false);
+    socket_->setErrMessageCallback(nullptr);
+    socket_ = nullptr;
+  }
+  expiryTimeout_.reset();
+  // No more timestamps will be requested
+  for (size_t i = 0; i < byteEvents_.size(); i++) {
+    byteEvents_[i].timestampTx = false;
+    byteEvents_[i].timestampAck = false;
+  }
+  pendingTimestamp_.reset();
+  return drainTimestampRecords(txEvents_) + drainTimestampRecords(ackEvents_);
+}
+
+void SocketTimestampByteEventTracker::addLastByteEvent(
+    HTTPTransaction* txn,
+    uint64_t byteNo,
+    ByteEvent::Callback callback) noexcept {
+  VLOG(5) << " adding last byte event for " << byteNo;
+  auto& record = addTransactionByteEvent(
+      byteNo, ByteEvent::LAST_BYTE, txn, std::move(callback));
+  if (!disabled_ && options_.sampleRate > 0 &&
+      ++lastByteEvents_ % options_.sampleRate == 0) {
+    record.timestampTx = options_.timestampTx;
+    record.timestampAck = options_.timestampAck;
+  }
+}
+
+void SocketTimestampByteEventTracker::addTrackedByteEvent(
+    HTTPTransaction* txn,
+    uint64_t byteNo,
+    ByteEvent::Callback callback) noexcept {
+  VLOG(5) << " adding tracked byte event for " << byteNo;
+  auto& record = addTransactionByteEvent(
+      byteNo, ByteEvent::TRACKED_BYTE, txn, std::move(callback));
+  if (!disabled_ && options_.timestampTrackedBytes) {
+    record.timestampTx = options_.timestampTx;
+    record.timestampAck = options_.timestampAck;
+  }
+}
+
+uint64_t SocketTimestampByteEventTracker::preSend(bool* /*cork*/,
+                                                  bool* timestampTx,
+                                                  bool* timestampAck,
+                                                  uint64_t bytesWritten) {
+  if (disabled_) {
+    return 0;
+  }
+  // Records are in offset order and usually only a few are ahead of the
+  // write position, so this scan is short.
+  for (size_t i = 0; i < byteEvents_.size(); i++) {
+    const auto& record = byteEvents_[i];
+    if (record.byteOffset <= bytesWritten ||
+        (!record.timestampTx && !record.timestampAck)) {
+      continue;
+    }
+    *timestampTx = record.timestampTx;
+    *timestampAck = record.timestampAck;
+    setReportTimestamps(true);
+    return record.byteOffset - bytesWritten;
+  }
+  return 0;
+}
+
+void SocketTimestampByteEventTracker::addTxByteEvent(
+    uint64_t offset,
+    ByteEvent::EventType eventType,
+    HTTPTransaction* txn,
+    ByteEvent::Callback callback) {
+  addTimestampRecord(
+      txEvents_, TimestampType::TX, offset, eventType, txn, std::move(callback));
+}
+
+void SocketTimestampByteEventTracker::addAckByteEvent(
+    uint64_t offset,
+    ByteEvent::EventType eventType,
+    HTTPTransaction* txn,
+    ByteEvent::Callback callback) {
+  addTimestampRecord(ackEvents_,
+                     TimestampType::ACK,
+                     offset,
+                     eventType,
+                     txn,
+                     std::move(callback));
+}
+
+void SocketTimestampByteEventTracker::addTimestampRecord(
+    std::deque<TimestampRecord>& records,
+    TimestampType type,
+    uint64_t offset,
+    ByteEvent::EventType eventType,
+    HTTPTransaction* txn,
+    ByteEvent::Callback callback) {
+  if (disabled_) {
+    return;
+  }
+  if (records.size() >= options_.maxPendingEvents) {
+    if (stats_) {
+      if (type == TimestampType::TX) {
+        stats_->recordTTBTXExceedLimit();
+      } else {
+        stats_->recordTTLBAExceedLimit();
+      }
+    }
+    return;
+  }
+  auto key = getTimestampKey(offset);
+  // The kernel reports keys in send order, an out of order record could
+  // never be matched
+  if (!records.empty() &&
+      static_cast<int32_t>(key - records.back().key) < 0) {
+    VLOG(2) << "dropping out of order timestamp event offset=" << offset;
+    return;
+  }
+  if (stats_) {
+    if (type == TimestampType::TX) {
+      stats_->recordTTBTXTracked();
+    } else {
+      stats_->recordTTLBATracked();
+    }
+  }
+  txn->incrementPendingByteEvents();
+  records.push_back(TimestampRecord{key,
+                                    eventType,
+                                    txn,
+                                    offset,
+                                    SystemClock::now(),
+                                    getCurrentTime() + options_.timeout,
+                                    storeCallback(std::move(callback))});
+  if (expiryTimeout_ && !expiryTimeout_->isScheduled()) {
+    expiryTimeout_->scheduleTimeout(options_.timeout);
+  }
+}
+
+void SocketTimestampByteEventTracker::onSocketTimestamp(
+    TimestampType type, uint32_t key, SystemTimePoint timestamp) {
+  auto& records = (type == TimestampType::TX) ? txEvents_ : ackEvents_;
+  if (records.empty() || static_cast<int32_t>(key - records.front().key) < 0) {
+    // Timestamps for unsampled writes sent while reporting was on
+    return;
+  }
+  // A callback may disable this tracker, so each record leaves the queue
+  // before it is delivered.
+  while (!records.empty() &&
+         static_cast<int32_t>(key - records.front().key) >= 0) {
+    auto record = records.front();
+    records.pop_front();
+    deliverTimestamp(type, record, timestamp);
+  }
+  maybeStopReporting();
+}
+
+void SocketTimestampByteEventTracker::deliverTimestamp(
+    TimestampType type,
+    const TimestampRecord& record,
+    SystemTimePoint timestamp) {
+  auto latency = std::max(
+      std::chrono::microseconds(0),
+      std::chrono::duration_cast<std::chrono::microseconds>(timestamp -
+                                                            record.sendTime));
+  TimestampedByteEvent event(record.byteOffset,
+                             record.eventType,
+                             record.txn,
+                             latency,
+                             takeCallback(record.callbackIndex));
+  // The event holds its own reference on the transaction now
+  record.txn->decrementPendingByteEvents();
+  if (type == TimestampType::TX) {
+    txLatency_.addValue(latency.count());
+    if (stats_) {
+      stats_->recordTTBTXReceived();
+    }
+    if (record.eventType == ByteEvent::TRACKED_BYTE) {
+      record.txn->onEgressTrackedByteEventTX(event);
+    }
+  } else {
+    ackLatency_.addValue(latency.count());
+    if (stats_) {
+      stats_->recordTTLBAReceived();
+    }
+    if (record.eventType == ByteEvent::LAST_BYTE) {
+      record.txn->onEgressLastByteAck(
+          std::chrono::duration_cast<std::chrono::milliseconds>(latency));
+    } else if (record.eventType == ByteEvent::TRACKED_BYTE) {
+      record.txn->onEgressTrackedByteEventAck(event);
+    }
+  }
+  if (event.callback_) {
+    event.callback_(event);
+  }
+}
+
+size_t SocketTimestampByteEventTracker::drainTimestampRecords(
+    std::deque<TimestampRecord>& records) {
+  size_t numEvents = 0;
+  while (!records.empty()) {
+    auto record = records.front();
+    records.pop_front();
+    takeCallback(record.callbackIndex);
+    record.txn->decrementPendingByteEvents();
+    ++numEvents;
+  }
+  return numEvents;
+}
+
+void SocketTimestampByteEventTracker::expireTimestampRecords() {
+  auto now = getCurrentTime();
+  for (auto type : {TimestampType::TX, TimestampType::ACK}) {
+    auto& records = (type == TimestampType::TX) ? txEvents_ : ackEvents_;
+    // Records are queued in time order too
+    while (!records.empty() && records.front().expireTime <= now) {
+      auto record = records.front();
+      records.pop_front();
+      VLOG(4) << "timestamp timed out for offset=" << record.byteOffset;
+      if (stats_) {
+        if (type == TimestampType::TX) {
+          stats_->recordTTBTXTimeout();
+        } else {
+          stats_->recordTTLBATimeout();
+        }
+      }
+      takeCallback(record.callbackIndex);
+      record.txn->decrementPendingByteEvents();
+    }
+  }
+  maybeStopReporting();
+}
+
+void SocketTimestampByteEventTracker::scheduleExpiry() {
+  if (!expiryTimeout_) {
+    return;
+  }
+  folly::Optional<TimePoint> next;
+  for (const auto* records : {&txEvents_, &ackEvents_}) {
+    if (!records->empty() &&
+        (!next || records->front().expireTime < *next)) {
+      next = records->front().expireTime;
+    }
+  }
+  if (next) {
+    expiryTimeout_->scheduleTimeout(
+        std::max(std::chrono::milliseconds(1),
+                 millisecondsBetween(*next, getCurrentTime())));
+  }
+}
+
+void SocketTimestampByteEventTracker::setReportTimestamps(bool enable) {
+  if (reporting_ == enable || !socket_) {
+    return;
+  }
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  uint32_t flags = kBaseTimestampFlags | (enable ? kReportTimestampFlags : 0);
+  if (socket_->setSockOpt(SOL_SOCKET, SO_TIMESTAMPING, &flags) != 0) {
+    VLOG(2) << "Failed to update SO_TIMESTAMPING, errno=" << errno;
+    return;
+  }
+  reporting_ = enable;
+#endif
+}
+
+void SocketTimestampByteEventTracker::maybeStopReporting() {
+  if (!reporting_ || !txEvents_.empty() || !ackEvents_.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < byteEvents_.size(); i++) {
+    if (byteEvents_[i].timestampTx || byteEvents_[i].timestampAck) {
+      return;
+    }
+  }
+  setReportTimestamps(false);
+}
+
+void SocketTimestampByteEventTracker::errMessage(
+    const cmsghdr& cmsg) noexcept {
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  if (cmsg.cmsg_level == SOL_SOCKET && cmsg.cmsg_type == SCM_TIMESTAMPING) {
+    auto tss = reinterpret_cast<const scm_timestamping*>(CMSG_DATA(&cmsg));
+    // ts[0] is the software timestamp
+    pendingTimestamp_ =
+        SystemTimePoint(std::chrono::duration_cast<SystemClock::duration>(
+            std::chrono::seconds(tss->ts[0].tv_sec) +
+            std::chrono::nanoseconds(tss->ts[0].tv_nsec)));
+    return;
+  }
+  if (!((cmsg.cmsg_level == SOL_IP && cmsg.cmsg_type == IP_RECVERR) ||
+        (cmsg.cmsg_level == SOL_IPV6 && cmsg.cmsg_type == IPV6_RECVERR))) {
+    return;
+  }
+  auto serr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(&cmsg));
+  if (serr->ee_errno != ENOMSG ||
+      serr->ee_origin != SO_EE_ORIGIN_TIMESTAMPING || !pendingTimestamp_) {
+    return;
+  }
+  auto timestamp = *pendingTimestamp_;
+  pendingTimestamp_.reset();
+  if (serr->ee_info == SCM_TSTAMP_SND) {
+    onSocketTimestamp(TimestampType::TX, serr->ee_data, timestamp);
+  } else if (serr->ee_info == SCM_TSTAMP_ACK) {
+    onSocketTimestamp(TimestampType::ACK, serr->ee_data, timestamp);
+  }
+#else
+  (void)cmsg;
+#endif
+}
+
+void SocketTimestampByteEventTracker::errMessageError(
+    const folly::AsyncSocketException& ex) noexcept {
+  VLOG(2) << "error reading socket error queue: " << ex.what();
+  pendingTimestamp_.reset();
+}
+
+} // namespace proxygen
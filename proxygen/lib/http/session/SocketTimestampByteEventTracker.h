@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <folly/Optional.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/stats/Histogram.h>
+#include <proxygen/lib/http/session/ByteEventTracker.h>
+
+namespace proxygen {
+
+/**
+ * ByteEventTracker that measures when tracked bytes leave the host and when
+ * the peer acknowledges them, using kernel SO_TIMESTAMPING on the session's
+ * AsyncSocket.
+ *
+ * A sample of transactions have their last byte (and, optionally, every
+ * tracked byte) timestamped.  preSend splits egress at those offsets so each
+ * one ends a sendmsg, and TX/ACK reporting is switched on for the socket only
+ * while sampled bytes are in flight.  Timestamps are read from the socket's
+ * error queue and matched to pending events by their OPT_ID key, which is a
+ * 32 bit byte counter, so matching is a pop from the front of an offset
+ * ordered queue.
+ *
+ * Send-to-TX and send-to-ACK latencies are reported to the transaction
+ * (trackedByteEventTX/Ack, lastByteAcked), to TTLBAStats and into the
+ * histograms returned by getTxLatencyHistogram/getAckLatencyHistogram.
+ *
+ * Must be installed before the session writes anything: on kernels without
+ * SOF_TIMESTAMPING_OPT_ID_TCP the key counts from the last acknowledged byte
+ * when timestamping was enabled.  Timestamps are only delivered while the
+ * session is reading; HTTPSession calls disableSocketTimestampEvents when
+ * reads shut down.
+ */
+class SocketTimestampByteEventTracker
+    : public ByteEventTracker
+    , private folly::AsyncSocket::ErrMessageCallback {
+ public:
+  struct Options {
+    // Timestamp the last byte of 1 in sampleRate transactions, 0 disables
+    uint32_t sampleRate{1};
+    // Also timestamp every tracked byte (trackEgressBodyOffset)
+    bool timestampTrackedBytes{false};
+    bool timestampTx{true};
+    bool timestampAck{true};
+    // Stop waiting for a timestamp after this long
+    std::chrono::milliseconds timeout{5000};
+    // Outstanding TX and ACK events are each capped at this
+    size_t maxPendingEvents{1000};
+    // Histogram buckets, in microseconds
+    int64_t histogramBucketUs{1000};
+    int64_t histogramMaxUs{1000000};
+  };
+
+  /**
+   * socket may be nullptr, in which case no socket options are set and
+   * timestamps must be fed in through onSocketTimestamp.
+   */
+  SocketTimestampByteEventTracker(Callback* callback,
+                                  folly::AsyncSocket* socket,
+                                  Options options);
+
+  ~SocketTimestampByteEventTracker() override;
+
+  size_t drainByteEvents() override;
+
+  size_t disableSocketTimestampEvents() override;
+
+  void addLastByteEvent(HTTPTransaction* txn,
+                        uint64_t byteNo,
+                        ByteEvent::Callback callback = nullptr) noexcept
+      override;
+  void addTrackedByteEvent(HTTPTransaction* txn,
+                           uint64_t byteNo,
+                           ByteEvent::Callback callback = nullptr) noexcept
+      override;
+
+  void addTxByteEvent(uint64_t offset,
+                      ByteEvent::EventType eventType,
+                      HTTPTransaction* txn,
+                      ByteEvent::Callback callback = nullptr) override;
+  void addAckByteEvent(uint64_t offset,
+                       ByteEvent::EventType eventType,
+                       HTTPTransaction* txn,
+                       ByteEvent::Callback callback = nullptr) override;
+
+  uint64_t preSend(bool* cork,
+                   bool* timestampTx,
+                   bool* timestampAck,
+                   uint64_t bytesWritten) override;
+
+  void setTTLBAStats(TTLBAStats* stats) override {
+    stats_ = stats;
+  }
+
+  enum class TimestampType : uint8_t { TX, ACK };
+
+  /**
+   * Deliver a timestamp for every pending event of the given type whose key
+   * is at or before key.  Called from the error queue handler, public so
+   * timestamps from other sources (and tests) can be injected.
+   */
+  void onSocketTimestamp(TimestampType type,
+                         uint32_t key,
+                         SystemTimePoint timestamp);
+
+  /**
+   * The OPT_ID key the kernel reports for the sendmsg that brings the raw
+   * bytes written on the socket to rawOffset.
+   */
+  uint32_t getTimestampKey(uint64_t rawOffset) const {
+    return static_cast<uint32_t>(rawOffset - keyBase_ - 1);
+  }
+
+  size_t getNumPendingTimestampEvents() const {
+    return txEvents_.size() + ackEvents_.size();
+  }
+
+  // Send-to-TX and send-to-ACK latencies in microseconds
+  const folly::Histogram<int64_t>& getTxLatencyHistogram() const {
+    return txLatency_;
+  }
+  const folly::Histogram<int64_t>& getAckLatencyHistogram() const {
+    return ackLatency_;
+  }
+
+ private:
+  struct TimestampRecord {
+    uint32_t key;
+    ByteEvent::EventType eventType;
+    // Holds a pending byte event reference
+    HTTPTransaction* txn;
+    uint64_t byteOffset;
+    SystemTimePoint sendTime;
+    TimePoint expireTime;
+    uint32_t callbackIndex;
+  };
+
+  void errMessage(const cmsghdr& cmsg) noexcept override;
+  void errMessageError(
+      const folly::AsyncSocketException& ex) noexcept override;
+
+  void addTimestampRecord(std::deque<TimestampRecord>& records,
+                          TimestampType type,
+                          uint64_t offset,
+                          ByteEvent::EventType eventType,
+                          HTTPTransaction* txn,
+                          ByteEvent::Callback callback);
+  void deliverTimestamp(TimestampType type,
+                        const TimestampRecord& record,
+                        SystemTimePoint timestamp);
+  size_t drainTimestampRecords(std::deque<TimestampRecord>& records);
+  void expireTimestampRecords();
+  void scheduleExpiry();
+  // Turns TX/ACK reporting on the socket on or off, a no-op when unchanged
+  void setReportTimestamps(bool enable);
+  void maybeStopReporting();
+
+  folly::AsyncSocket* socket_;
+  const Options options_;
+  TTLBAStats* stats_{nullptr};
+  std::unique_ptr<folly::AsyncTimeout> expiryTimeout_;
+
+  // Both ordered by key
+  std::deque<TimestampRecord> txEvents_;
+  std::deque<TimestampRecord> ackEvents_;
+
+  // Raw bytes written when OPT_ID was enabled
+  uint64_t keyBase_{0};
+  uint64_t lastByteEvents_{0};
+  // SCM_TIMESTAMPING precedes the IP_RECVERR it belongs to
+  folly::Optional<SystemTimePoint> pendingTimestamp_;
+  bool reporting_{false};
+  // Set by disableSocketTimestampEvents, no more timestamps are requested
+  bool disabled_{false};
+
+  folly::Histogram<int64_t> txLatency_;
+  folly::Histogram<int64_t> ackLatency_;
+};
+
+} // namespace proxygen
@@ -13,6 +13,7 @@
 #include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
 #include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
 
+#include <algorithm>
 #include <chrono>
 
 using namespace testing;
@@ -89,3 +90,63 @@ TEST_F(ByteEventTrackerTest, TrackBytes) {
       &txn_, 10, trackedByteEventCb); // same offset
   byteEventTracker_->processByteEvents(byteEventTracker_, 10);
 }
+
+TEST_F(ByteEventTrackerTest, BatchedEventsInOrder) {
+  // Enough events to wrap and grow the ring a few times
+  std::vector<uint64_t> seen;
+  auto trackedByteEventCb = [&](ByteEvent& event) {
+    EXPECT_EQ(event.getTransaction(), &txn_);
+    seen.push_back(event.getByteOffset());
+  };
+  EXPECT_CALL(callback_, onTxnByteEventWrittenToBuf(_)).Times(AnyNumber());
+  uint64_t offset = 0;
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 40; i++) {
+      offset += 10;
+      byteEventTracker_->addTrackedByteEvent(
+          &txn_, offset, i % 2 ? trackedByteEventCb : nullptr);
+    }
+    EXPECT_EQ(txn_.getNumPendingByteEvents(),
+              byteEventTracker_->getNumPendingByteEvents());
+    // Half of this round's events are covered by the first write
+    byteEventTracker_->processByteEvents(byteEventTracker_, offset - 200);
+    EXPECT_EQ(byteEventTracker_->getNumPendingByteEvents(), 20);
+    byteEventTracker_->processByteEvents(byteEventTracker_, offset);
+    EXPECT_EQ(byteEventTracker_->getNumPendingByteEvents(), 0);
+  }
+  EXPECT_EQ(seen.size(), 60);
+  EXPECT_TRUE(std::is_sorted(seen.begin(), seen.end()));
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 0);
+}
+
+TEST_F(ByteEventTrackerTest, PingInsertedBeforeBufferedEvents) {
+  std::vector<ByteEvent::EventType> seen;
+  auto recordType = [&](ByteEvent& event) {
+    seen.push_back(event.getType());
+  };
+  EXPECT_CALL(callback_, onTxnByteEventWrittenToBuf(_)).Times(3);
+  byteEventTracker_->addTrackedByteEvent(&txn_, 10, recordType);
+  byteEventTracker_->addTrackedByteEvent(&txn_, 100, recordType);
+  // The ping reply is scheduled ahead of bytes 11-100, which move back by 17
+  byteEventTracker_->addPingByteEvent(
+      17, proxygen::getCurrentTime(), 10, recordType);
+  EXPECT_CALL(callback_, onPingReplyLatency(_));
+  byteEventTracker_->processByteEvents(byteEventTracker_, 27);
+  EXPECT_EQ(seen,
+            std::vector<ByteEvent::EventType>(
+                {ByteEvent::TRACKED_BYTE, ByteEvent::PING_REPLY_SENT}));
+  byteEventTracker_->processByteEvents(byteEventTracker_, 116);
+  EXPECT_EQ(byteEventTracker_->getNumPendingByteEvents(), 1);
+  byteEventTracker_->processByteEvents(byteEventTracker_, 117);
+  EXPECT_EQ(seen.size(), 3);
+}
+
+TEST_F(ByteEventTrackerTest, DrainReleasesTransaction) {
+  byteEventTracker_->addTrackedByteEvent(&txn_, 10, [](ByteEvent&) {
+    ADD_FAILURE() << "drained events must not fire";
+  });
+  byteEventTracker_->addFirstBodyByteEvent(20, &txn_);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 2);
+  EXPECT_EQ(byteEventTracker_->drainByteEvents(), 2);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 0);
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/DatagramBuffer.h>
+
+#include <folly/portability/GTest.h>
+#include <map>
+#include <string>
+
+using namespace proxygen;
+using folly::IOBuf;
+
+namespace {
+
+std::unique_ptr<IOBuf> makeDatagram(const std::string& payload) {
+  return IOBuf::copyBuffer(payload);
+}
+
+std::vector<std::string> deliver(DatagramBuffer& buffer, uint64_t streamId) {
+  std::vector<std::string> out;
+  buffer.deliver(streamId, [&](std::unique_ptr<IOBuf> datagram) {
+    out.push_back(datagram->moveToFbString().toStdString());
+  });
+  return out;
+}
+
+} // namespace
+
+TEST(DatagramBufferTest, DeliverInOrder) {
+  DatagramBuffer buffer;
+  buffer.add(0, makeDatagram("a"));
+  buffer.add(4, makeDatagram("x"));
+  buffer.add(0, makeDatagram("bb"));
+  EXPECT_EQ(buffer.getNumStreams(), 2);
+  EXPECT_EQ(buffer.getBufferedBytes(), 4);
+  EXPECT_EQ(deliver(buffer, 0), std::vector<std::string>({"a", "bb"}));
+  EXPECT_EQ(buffer.getNumStreams(), 1);
+  EXPECT_EQ(buffer.getBufferedBytes(), 1);
+  EXPECT_TRUE(deliver(buffer, 0).empty());
+  EXPECT_EQ(buffer.getStats().buffered, 3);
+  EXPECT_EQ(buffer.getStats().delivered, 2);
+  EXPECT_EQ(buffer.getStats().dropped, 0);
+}
+
+TEST(DatagramBufferTest, DropNewestPerStream) {
+  DatagramBuffer::Params params;
+  params.maxDatagramsPerStream = 2;
+  params.dropPolicy = DatagramDropPolicy::DROP_NEWEST;
+  DatagramBuffer buffer(params);
+  buffer.add(0, makeDatagram("1"));
+  buffer.add(0, makeDatagram("2"));
+  auto dropped = buffer.add(0, makeDatagram("3"));
+  EXPECT_EQ(dropped.datagrams, 1);
+  EXPECT_EQ(dropped.bytes, 1);
+  EXPECT_EQ(deliver(buffer, 0), std::vector<std::string>({"1", "2"}));
+  EXPECT_EQ(buffer.getStats().dropped, 1);
+  EXPECT_EQ(buffer.getStats().droppedBytes, 1);
+}
+
+TEST(DatagramBufferTest, DropOldestPerStream) {
+  DatagramBuffer::Params params;
+  params.maxDatagramsPerStream = 2;
+  params.dropPolicy = DatagramDropPolicy::DROP_OLDEST;
+  DatagramBuffer buffer(params);
+  for (auto payload : {"1", "2", "3", "4"}) {
+    buffer.add(0, makeDatagram(payload));
+  }
+  // The ring wrapped around; order is still oldest first
+  EXPECT_EQ(deliver(buffer, 0), std::vector<std::string>({"3", "4"}));
+  EXPECT_EQ(buffer.getStats().dropped, 2);
+}
+
+TEST(DatagramBufferTest, StreamBytesLimit) {
+  DatagramBuffer::Params params;
+  params.maxBytesPerStream = 10;
+  params.dropPolicy = DatagramDropPolicy::DROP_OLDEST;
+  DatagramBuffer buffer(params);
+  buffer.add(0, makeDatagram("aaaa"));
+  buffer.add(0, makeDatagram("bbbb"));
+  auto dropped = buffer.add(0, makeDatagram("cccc"));
+  EXPECT_EQ(dropped.datagrams, 1);
+  EXPECT_EQ(dropped.bytes, 4);
+  EXPECT_EQ(buffer.getBufferedBytes(), 8);
+  // Larger than a stream may ever hold
+  dropped = buffer.add(4, makeDatagram(std::string(11, 'x')));
+  EXPECT_EQ(dropped.datagrams, 1);
+  EXPECT_EQ(buffer.getNumStreams(), 1);
+  EXPECT_EQ(deliver(buffer, 0), std::vector<std::string>({"bbbb", "cccc"}));
+}
+
+TEST(DatagramBufferTest, StreamLimit) {
+  DatagramBuffer::Params params;
+  params.maxStreams = 2;
+  params.dropPolicy = DatagramDropPolicy::DROP_NEWEST;
+  DatagramBuffer buffer(params);
+  buffer.add(0, makeDatagram("a"));
+  buffer.add(4, makeDatagram("b"));
+  auto dropped = buffer.add(8, makeDatagram("c"));
+  EXPECT_EQ(dropped.datagrams, 1);
+  EXPECT_EQ(buffer.getNumBuffered(8), 0);
+
+  params.dropPolicy = DatagramDropPolicy::DROP_OLDEST;
+  buffer.setParams(params);
+  buffer.add(0, makeDatagram("d"));
+  // Stream 0 holds the oldest datagram, so all of it goes
+  dropped = buffer.add(8, makeDatagram("c"));
+  EXPECT_EQ(dropped.datagrams, 2);
+  EXPECT_EQ(buffer.getNumBuffered(0), 0);
+  EXPECT_EQ(deliver(buffer, 4), std::vector<std::string>({"b"}));
+  EXPECT_EQ(deliver(buffer, 8), std::vector<std::string>({"c"}));
+}
+
+TEST(DatagramBufferTest, TotalBytesDropOldest) {
+  DatagramBuffer::Params params;
+  params.maxBytes = 6;
+  params.dropPolicy = DatagramDropPolicy::DROP_OLDEST;
+  DatagramBuffer buffer(params);
+  buffer.add(0, makeDatagram("aa"));
+  buffer.add(4, makeDatagram("bb"));
+  buffer.add(0, makeDatagram("cc"));
+  auto dropped = buffer.add(4, makeDatagram("dddd"));
+  EXPECT_EQ(dropped.datagrams, 2);
+  EXPECT_EQ(dropped.bytes, 4);
+  EXPECT_EQ(buffer.getBufferedBytes(), 6);
+  EXPECT_EQ(deliver(buffer, 0), std::vector<std::string>({"cc"}));
+  EXPECT_EQ(deliver(buffer, 4), std::vector<std::string>({"dddd"}));
+}
+
+TEST(DatagramBufferTest, Priority) {
+  DatagramBuffer::Params params;
+  params.maxStreams = 2;
+  params.dropPolicy = DatagramDropPolicy::PRIORITY;
+  DatagramBuffer buffer(params);
+  std::map<uint64_t, uint8_t> urgency{{0, 1}, {4, 5}, {8, 3}, {12, 7}};
+  buffer.setUrgencyFn([&](uint64_t id) { return urgency[id]; });
+  buffer.add(0, makeDatagram("urgent"));
+  buffer.add(4, makeDatagram("background"));
+  // Stream 8 is more urgent than stream 4, which makes room
+  auto dropped = buffer.add(8, makeDatagram("normal"));
+  EXPECT_EQ(dropped.datagrams, 1);
+  EXPECT_EQ(dropped.bytes, 10);
+  EXPECT_EQ(buffer.getNumBuffered(4), 0);
+  // Stream 12 is less urgent than everything buffered
+  dropped = buffer.add(12, makeDatagram("bulk"));
+  EXPECT_EQ(dropped.datagrams, 1);
+  EXPECT_EQ(dropped.bytes, 4);
+  EXPECT_EQ(buffer.getNumBuffered(12), 0);
+  EXPECT_EQ(deliver(buffer, 0), std::vector<std::string>({"urgent"}));
+  EXPECT_EQ(deliver(buffer, 8), std::vector<std::string>({"normal"}));
+}
+
+TEST(DatagramBufferTest, Erase) {
+  DatagramBuffer buffer;
+  buffer.add(0, makeDatagram("abc"));
+  buffer.add(0, makeDatagram("de"));
+  auto dropped = buffer.erase(0);
+  EXPECT_EQ(dropped.datagrams, 2);
+  EXPECT_EQ(dropped.bytes, 5);
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(buffer.getBufferedBytes(), 0);
+  EXPECT_EQ(buffer.erase(0).datagrams, 0);
+  // A drained ring is reused by the next stream
+  buffer.add(4, makeDatagram("f"));
+  EXPECT_EQ(deliver(buffer, 4), std::vector<std::string>({"f"}));
+}
+
+TEST(DatagramBufferTest, ShrinkLimits) {
+  DatagramBuffer::Params params;
+  params.dropPolicy = DatagramDropPolicy::DROP_OLDEST;
+  DatagramBuffer buffer(params);
+  for (auto payload : {"1", "2", "3", "4", "5"}) {
+    buffer.add(0, makeDatagram(payload));
+  }
+  buffer.add(4, makeDatagram("x"));
+  params.maxDatagramsPerStream = 3;
+  params.maxStreams = 1;
+  auto dropped = buffer.setParams(params);
+  // Re-added oldest first: 1 and 2 go to fit the ring, then stream 0 goes
+  // entirely to make room for stream 4
+  EXPECT_EQ(dropped.datagrams, 5);
+  EXPECT_EQ(buffer.getNumStreams(), 1);
+  EXPECT_EQ(deliver(buffer, 4), std::vector<std::string>({"x"}));
+  EXPECT_EQ(buffer.getStats().buffered, 6);
+}
+
+TEST(DatagramBufferTest, DefaultEvictsStaleStreams) {
+  DatagramBuffer buffer;
+  const auto maxStreams = buffer.getParams().maxStreams;
+  // Streams that will never open fill the buffer
+  for (uint64_t id = 0; id < maxStreams; ++id) {
+    buffer.add(id * 4, makeDatagram("stale"));
+  }
+  // A new stream still gets in, at the expense of the oldest
+  auto dropped = buffer.add(maxStreams * 4, makeDatagram("fresh"));
+  EXPECT_EQ(dropped.datagrams, 1);
+  EXPECT_EQ(buffer.getNumBuffered(0), 0);
+  EXPECT_EQ(deliver(buffer, maxStreams * 4),
+            std::vector<std::string>({"fresh"}));
+}
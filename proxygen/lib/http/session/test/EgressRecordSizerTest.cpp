@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/EgressRecordSizer.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using namespace std::chrono;
+
+TEST(EgressRecordSizerTest, RampsUpUnderLoad) {
+  EgressRecordSizer::Params params;
+  params.initialSize = 1000;
+  params.maxSize = 16000;
+  params.rampBytes = 10000;
+  EgressRecordSizer sizer(params);
+  TimePoint now{seconds(1)};
+
+  EXPECT_EQ(sizer.getRecordSize(now), 1000);
+  sizer.onBytesWritten(9999, now);
+  EXPECT_EQ(sizer.getRecordSize(now), 1000);
+  sizer.onBytesWritten(1, now);
+  EXPECT_EQ(sizer.getRecordSize(now), 2000);
+  sizer.onBytesWritten(20000, now);
+  EXPECT_EQ(sizer.getRecordSize(now), 8000);
+  sizer.onBytesWritten(10000, now);
+  EXPECT_EQ(sizer.getRecordSize(now), 16000);
+  // Capped at maxSize, no matter how much is written
+  sizer.onBytesWritten(uint64_t(1) << 50, now);
+  EXPECT_EQ(sizer.getRecordSize(now), 16000);
+}
+
+TEST(EgressRecordSizerTest, ResetsAfterIdle) {
+  EgressRecordSizer::Params params;
+  params.rampBytes = 1000;
+  params.idleTimeout = milliseconds(500);
+  EgressRecordSizer sizer(params);
+  TimePoint now{seconds(1)};
+
+  sizer.onBytesWritten(100000, now);
+  EXPECT_EQ(sizer.getRecordSize(now), params.maxSize);
+
+  // Steady writes keep the size up
+  now += milliseconds(499);
+  sizer.onBytesWritten(100, now);
+  now += milliseconds(499);
+  EXPECT_EQ(sizer.getRecordSize(now), params.maxSize);
+
+  now += milliseconds(1);
+  EXPECT_EQ(sizer.getRecordSize(now), params.initialSize);
+  sizer.onBytesWritten(999, now);
+  EXPECT_EQ(sizer.getRecordSize(now), params.initialSize);
+}
@@ -48,12 +48,34 @@ using HQDownstreamSessionTestHQDeliveryAck = HQDownstreamSessionTest;
 // Use this test class for h3 server push tests
 using HQDownstreamSessionTestHQPush = HQDownstreamSessionTest;
 
+// Use this test class for hq only tests with Datagram support
+using HQDownstreamSessionTestHQDatagram = HQDownstreamSessionTest;
+
+// Use this test class for hq only tests with WebTransport support
+using HQDownstreamSessionTestHQWebTransport = HQDownstreamSessionTest;
+
 namespace {
 HTTPMessage getProgressiveGetRequest() {
   auto req = proxygen::getGetRequest();
   req.getHeaders().add(HTTP_HEADER_PRIORITY, "u=1, i");
   return req;
 }
+
+HTTPMessage getWebTransportConnect() {
+  HTTPMessage req;
+  req.setURL("test.net/path");
+  req.setMethod("CONNECT");
+  req.getHeaders().add(HTTP_HEADER_HOST, "https://test.net/path");
+  req.getHeaders().add("sec-webtransport-http3-draft02", "1");
+  return req;
+}
+
+void acceptWebTransport(MockHTTPHandler& handler) {
+  EXPECT_NE(handler.txn_->getWebTransport(), nullptr);
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  handler.txn_->sendHeaders(resp);
+}
 } // namespace
 
 HTTPCodec::StreamID HQDownstreamSessionTest::sendRequest(const std::string& url,
@@ -650,6 +672,82 @@ TEST_P(HQDownstreamSessionTest, Maxreadsperloop) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, BatchedReadsArrivalOrder) {
+  std::vector<quic::StreamId> ids;
+  std::vector<HTTPCodec::StreamID> dispatched;
+  std::vector<std::unique_ptr<StrictMock<MockHTTPHandler>>> handlers;
+  for (auto n = 0; n < 3; n++) {
+    ids.push_back(sendRequest(getGetRequest()));
+    auto handler = addSimpleStrictHandler();
+    auto rawHandler = handler.get();
+    handler->expectHeaders([&dispatched, rawHandler] {
+      dispatched.push_back(rawHandler->txn_->getID());
+    });
+    handler->expectEOM(
+        [rawHandler] { rawHandler->sendReplyWithBody(200, 100); });
+    handler->expectDetachTransaction();
+    handlers.push_back(std::move(handler));
+  }
+  if (!encoderWriteBuf_.empty()) {
+    socketDriver_->addReadEvent(kQPACKEncoderIngressStreamId,
+                                encoderWriteBuf_.move());
+  }
+  // All three are read in one loop, out of stream ID order
+  std::vector<HTTPCodec::StreamID> arrival{ids[2], ids[0], ids[1]};
+  for (auto id : arrival) {
+    auto& request = getStream(id);
+    socketDriver_->addReadEvent(id, request.buf.move());
+    socketDriver_->addReadEOF(id);
+    request.readEOF = false;
+  }
+  flushRequestsAndLoop();
+  EXPECT_EQ(dispatched, arrival);
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTest, BatchedReadsRequeuedNextLoop) {
+  auto postId = sendRequest(getPostRequest(10), false);
+  auto postHandler = addSimpleStrictHandler();
+  postHandler->expectHeaders();
+  flushRequestsAndLoop();
+
+  // The POST body is held in the transport until the GET is dispatched
+  auto& post = getStream(postId);
+  post.codec->generateBody(
+      post.buf, post.id, makeBuf(10), HTTPCodec::NoPadding, true);
+  socketDriver_->getSocket()->pauseRead(postId);
+  socketDriver_->addReadEvent(postId, post.buf.move());
+  socketDriver_->addReadEOF(postId);
+
+  bool getDone = false;
+  bool passDone = false;
+  sendRequest(getGetRequest());
+  auto getHandler = addSimpleStrictHandler();
+  getHandler->expectHeaders([&] {
+    // Runs once the current pass returns, before the session's next one
+    eventBase_.runInLoop(
+        [&] {
+          EXPECT_TRUE(getDone);
+          passDone = true;
+        },
+        true);
+    // Queues the POST while the pass is running
+    socketDriver_->getSocket()->resumeRead(postId);
+  });
+  getHandler->expectEOM([&] {
+    getDone = true;
+    getHandler->sendReplyWithBody(200, 100);
+  });
+  getHandler->expectDetachTransaction();
+
+  EXPECT_CALL(*postHandler, _onBodyWithOffset(_, _))
+      .WillOnce(InvokeWithoutArgs([&] { EXPECT_TRUE(passDone); }));
+  postHandler->expectEOM([&] { postHandler->sendReplyWithBody(200, 100); });
+  postHandler->expectDetachTransaction();
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTest, OnFlowControlUpdate) {
   auto id = sendRequest();
   auto handler = addSimpleStrictHandler();
@@ -759,6 +857,39 @@ TEST_P(HQDownstreamSessionTest, OnConnectionWindowPartialBody) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, ConnectionWindowSplitByRatio) {
+  flushRequestsAndLoop(); // loop once for SETTINGS, etc
+  auto id1 = sendRequest();
+  auto id2 = sendRequest();
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM(
+      [&handler1] { handler1->sendReplyWithBody(200, 1000); });
+  handler1->expectDetachTransaction();
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM(
+      [&handler2] { handler2->sendReplyWithBody(200, 1000); });
+  handler2->expectDetachTransaction();
+
+  // Enough connection window for about one response; the streams have the
+  // same priority, so they should split it rather than the first taking
+  // all of it
+  socketDriver_->setConnectionFlowControlWindow(1000 + numCtrlStreams_);
+  flushRequestsAndLoop();
+  EXPECT_FALSE(socketDriver_->streams_[id1].writeEOF);
+  EXPECT_FALSE(socketDriver_->streams_[id2].writeEOF);
+  EXPECT_GT(socketDriver_->streams_[id1].writeBuf.chainLength(), 300);
+  EXPECT_GT(socketDriver_->streams_[id2].writeBuf.chainLength(), 300);
+
+  socketDriver_->getSocket()->setConnectionFlowControlWindow(
+      3000 + numCtrlStreams_);
+  CHECK(eventBase_.loop());
+  EXPECT_TRUE(socketDriver_->streams_[id1].writeEOF);
+  EXPECT_TRUE(socketDriver_->streams_[id2].writeEOF);
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTest, SeparateEom) {
   // Only enough conn window to send headers initially.
   auto id = sendRequest();
@@ -1585,6 +1716,47 @@ TEST_P(HQDownstreamSessionTestH1q, ManagedTimeoutReadReset) {
   flushRequestsAndLoop();
 }
 
+TEST_P(HQDownstreamSessionTestH1q, ManagedTimeoutBatchedReadReset) {
+  std::chrono::milliseconds connIdleTimeout{200};
+  auto connManager = wangle::ConnectionManager::makeUnique(
+      &eventBase_, connIdleTimeout, nullptr);
+  connManager->addConnection(hqSession_, true);
+  HQSession::DestructorGuard dg(hqSession_);
+  std::vector<quic::StreamId> ids;
+  std::vector<std::unique_ptr<StrictMock<MockHTTPHandler>>> handlers;
+  for (auto n = 0; n < 2; n++) {
+    ids.push_back(sendRequest(getPostRequest(10), false));
+    auto handler = addSimpleStrictHandler();
+    auto rawHandler = handler.get();
+    handler->expectHeaders();
+    EXPECT_CALL(*handler, _onBodyWithOffset(testing::_, testing::_))
+        .Times(2);
+    handler->expectEOM(
+        [rawHandler] { rawHandler->sendReplyWithBody(200, 100); });
+    handler->expectDetachTransaction();
+    handlers.push_back(std::move(handler));
+  }
+  // Each time, both streams are read in the same loop
+  auto sendBody = [&](bool eom) {
+    for (auto id : ids) {
+      auto& request = getStream(id);
+      request.codec->generateBody(
+          request.buf, request.id, makeBuf(5), HTTPCodec::NoPadding, eom);
+      request.readEOF = eom;
+    }
+    flushRequests();
+  };
+  eventBase_.runAfterDelay([&] { sendBody(false); }, 100);
+  eventBase_.runAfterDelay(
+      [&] {
+        EXPECT_NE(hqSession_->getConnectionCloseReason(),
+                  ConnectionCloseReason::TIMEOUT);
+        sendBody(true);
+      },
+      250);
+  flushRequestsAndLoop();
+}
+
 TEST_P(HQDownstreamSessionTestHQ, ManagedTimeoutUnidirectionalReadReset) {
   std::chrono::milliseconds connIdleTimeout{200};
   auto connManager = wangle::ConnectionManager::makeUnique(
@@ -2925,6 +3097,136 @@ TEST_P(HQDownstreamSessionTest, IdleTimeoutResetWithPingAcknowledged) {
             connIdleTimeout.count() * 2);
 }
 
+TEST_P(HQDownstreamSessionTestHQDatagram, EarlyDatagramsForClosedStream) {
+  auto idh = checkRequest();
+  flushRequestsAndLoop();
+
+  // The first request is done, so its datagrams are not held. Those for a
+  // request the client has yet to open are, until its headers arrive.
+  auto id = sendRequest(getGetRequest(), false);
+  socketDriver_->addDatagram(
+      getH3Datagram(idh.first, folly::IOBuf::copyBuffer("closed")));
+  socketDriver_->addDatagram(
+      getH3Datagram(id, folly::IOBuf::copyBuffer("early")));
+  socketDriver_->addDatagramsAvailableReadEvent(std::chrono::milliseconds(0));
+  eventBase_.loopOnce();
+  EXPECT_EQ(hqSession_->getDatagramBufferStats().buffered, 1);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectDatagram([](std::shared_ptr<folly::IOBuf> datagram) {
+    EXPECT_EQ(datagram->moveToFbString(), "early");
+  });
+  flushRequestsAndLoopN(1);
+  EXPECT_EQ(hqSession_->getDatagramBufferStats().delivered, 1);
+
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  auto& request = getStream(id);
+  request.codec->generateEOM(request.buf, request.id);
+  request.readEOF = true;
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTestHQWebTransport, SimpleGet) {
+  // A request stream is told from a WebTransport one by its first bytes
+  auto idh = checkRequest();
+  flushRequestsAndLoop();
+  EXPECT_EQ(socketDriver_->streams_[idh.first].peekCB, nullptr);
+  EXPECT_TRUE(socketDriver_->streams_[idh.first].writeEOF);
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTestHQWebTransport, NativeStreams) {
+  auto sessionId = sendRequest(getWebTransportConnect(), false);
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler] { acceptWebTransport(*handler); });
+  flushRequestsAndLoopN(1);
+
+  auto uniId = nextUnidirectionalStreamId();
+  auto bidiId = nextStreamId();
+  EXPECT_CALL(*handler, _onWebTransportUniStream(uniId, _));
+  EXPECT_CALL(*handler, _onWebTransportBidiStream(bidiId, _));
+  socketDriver_->addReadEvent(uniId, makeWebTransportPreface(false, sessionId));
+  socketDriver_->addReadEvent(bidiId, makeWebTransportPreface(true, sessionId));
+  eventBase_.loopOnce();
+  EXPECT_EQ(socketDriver_->streams_[bidiId].peekCB, nullptr);
+  EXPECT_FALSE(socketDriver_->streams_[uniId].error.hasValue());
+  EXPECT_FALSE(socketDriver_->streams_[bidiId].error.hasValue());
+
+  // A FIN on the CONNECT stream ends the session and stops its streams
+  EXPECT_CALL(*handler,
+              _onWebTransportSessionClose(folly::Optional<uint32_t>()));
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  getStream(sessionId).readEOF = true;
+  flushRequestsAndLoop();
+  EXPECT_TRUE(socketDriver_->streams_[uniId].error.hasValue());
+  EXPECT_TRUE(socketDriver_->streams_[bidiId].error.hasValue());
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTestHQWebTransport, StreamsBeforeConnect) {
+  // The streams may overtake the CONNECT they belong to
+  auto sessionId = nextStreamId();
+  auto uniId = nextUnidirectionalStreamId();
+  auto bidiId = nextStreamId();
+  socketDriver_->addReadEvent(uniId, makeWebTransportPreface(false, sessionId));
+  socketDriver_->addReadEvent(bidiId, makeWebTransportPreface(true, sessionId));
+  eventBase_.loopOnce();
+  EXPECT_EQ(socketDriver_->streams_[bidiId].peekCB, nullptr);
+  EXPECT_FALSE(socketDriver_->streams_[uniId].error.hasValue());
+  EXPECT_FALSE(socketDriver_->streams_[bidiId].error.hasValue());
+
+  // They are held until the session exists
+  sendRequest(getWebTransportConnect(), false, sessionId);
+  auto handler = addSimpleStrictHandler();
+  EXPECT_CALL(*handler, _onWebTransportUniStream(uniId, _));
+  EXPECT_CALL(*handler, _onWebTransportBidiStream(bidiId, _));
+  handler->expectHeaders([&handler] { acceptWebTransport(*handler); });
+  flushRequestsAndLoopN(1);
+
+  EXPECT_CALL(*handler,
+              _onWebTransportSessionClose(folly::Optional<uint32_t>()));
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  getStream(sessionId).readEOF = true;
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTestHQWebTransport, BufferedStreamLimit) {
+  auto sessionId = nextStreamId();
+  std::vector<quic::StreamId> uniIds;
+  for (size_t i = 0; i <= kMaxBufferedWebTransportStreams; i++) {
+    uniIds.push_back(nextUnidirectionalStreamId());
+    socketDriver_->addReadEvent(uniIds.back(),
+                                makeWebTransportPreface(false, sessionId));
+  }
+  eventBase_.loopOnce();
+  // Only the stream over the limit is rejected
+  for (size_t i = 0; i < kMaxBufferedWebTransportStreams; i++) {
+    EXPECT_FALSE(socketDriver_->streams_[uniIds[i]].error.hasValue());
+  }
+  EXPECT_TRUE(socketDriver_->streams_[uniIds.back()].error.hasValue());
+
+  sendRequest(getWebTransportConnect(), false, sessionId);
+  auto handler = addSimpleStrictHandler();
+  EXPECT_CALL(*handler, _onWebTransportUniStream(_, _))
+      .Times(kMaxBufferedWebTransportStreams);
+  handler->expectHeaders([&handler] { acceptWebTransport(*handler); });
+  flushRequestsAndLoopN(1);
+
+  EXPECT_CALL(*handler,
+              _onWebTransportSessionClose(folly::Optional<uint32_t>()));
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  getStream(sessionId).readEOF = true;
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
 /**
  * Instantiate the Parametrized test cases
  */
@@ -3008,6 +3310,28 @@ INSTANTIATE_TEST_SUITE_P(HQDownstreamSessionBeforeTransportReadyTest,
                              }()),
                          paramsToTestName);
 
+// Instantiate h3 datagram tests
+INSTANTIATE_TEST_SUITE_P(HQDownstreamSessionTest,
+                         HQDownstreamSessionTestHQDatagram,
+                         Values([] {
+                           TestParams tp;
+                           tp.alpn_ = "h3";
+                           tp.datagrams_ = true;
+                           return tp;
+                         }()),
+                         paramsToTestName);
+
+// Instantiate h3 WebTransport tests
+INSTANTIATE_TEST_SUITE_P(HQDownstreamSessionTest,
+                         HQDownstreamSessionTestHQWebTransport,
+                         Values([] {
+                           TestParams tp;
+                           tp.alpn_ = "h3";
+                           tp.webTransport_ = true;
+                           return tp;
+                         }()),
+                         paramsToTestName);
+
 // Instantiate h1q-fb-v1 only tests
 INSTANTIATE_TEST_SUITE_P(HQDownstreamSessionTest,
                          HQDownstreamSessionTestH1qv1,
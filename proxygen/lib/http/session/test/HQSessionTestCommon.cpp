@@ -66,6 +66,19 @@ size_t generateStreamPreface(folly::IOBufQueue& writeBuf,
   return bytesWritten;
 }
 
+std::unique_ptr<folly::IOBuf> makeWebTransportPreface(
+    bool bidi, quic::StreamId sessionId) {
+  folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+  folly::io::QueueAppender appender(&writeBuf, 16);
+  encodeQuicIntegerWithAtLeast(
+      bidi ? kWebTransportBidiSignal
+           : static_cast<uint64_t>(UnidirectionalStreamType::WEBTRANSPORT),
+      1,
+      appender);
+  encodeQuicIntegerWithAtLeast(sessionId, 1, appender);
+  return writeBuf.move();
+}
+
 std::string paramsToTestName(const testing::TestParamInfo<TestParams>& info) {
   std::vector<std::string> paramsV;
   folly::split("-", info.param.alpn_, paramsV);
@@ -83,6 +96,9 @@ std::string paramsToTestName(const testing::TestParamInfo<TestParams>& info) {
   if (info.param.datagrams_) {
     paramsV.push_back("_datagrams");
   }
+  if (info.param.webTransport_) {
+    paramsV.push_back("_webtransport");
+  }
   return folly::join("", paramsV);
 }
 
@@ -106,6 +122,7 @@ folly::Optional<std::pair<UnidirectionalStreamType, size_t>> parseStreamPreface(
     case UnidirectionalStreamType::PUSH:
     case UnidirectionalStreamType::QPACK_ENCODER:
     case UnidirectionalStreamType::QPACK_DECODER:
+    case UnidirectionalStreamType::WEBTRANSPORT:
       if (ALPN_HQ) {
         return std::make_pair(prefaceEnum, res->second);
       } else {
@@ -38,6 +38,7 @@ const proxygen::hq::PushId kUnknownPushId =
     std::numeric_limits<uint64_t>::max();
 constexpr proxygen::hq::PushId kInitialPushId = 12345;
 constexpr uint64_t kPushIdIncrement = 1;
+constexpr uint64_t kWebTransportBidiSignal = 0x41;
 constexpr uint64_t kDefaultUnidirStreamCredit = 3;
 } // namespace
 
@@ -49,6 +50,7 @@ struct TestParams {
   std::size_t numBytesOnPushStream{kUnlimited};
   bool expectOnTransportReady{true};
   bool datagrams_{false};
+  bool webTransport_{false};
   bool checkUniridStreamCallbacks{true};
 };
 
@@ -63,6 +65,11 @@ std::string paramsToTestName(const testing::TestParamInfo<TestParams>& info);
 size_t generateStreamPreface(folly::IOBufQueue& writeBuf,
                              proxygen::hq::UnidirectionalStreamType type);
 
+// The stream type (or bidirectional signal) and session ID that start a
+// WebTransport stream
+std::unique_ptr<folly::IOBuf> makeWebTransportPreface(
+    bool bidi, quic::StreamId sessionId);
+
 folly::Optional<std::pair<proxygen::hq::UnidirectionalStreamType, size_t>>
 parseStreamPreface(folly::io::Cursor& cursor, std::string alpn);
 
@@ -121,6 +128,9 @@ class HQSessionTest
     if (GetParam().datagrams_) {
       egressSettings_.setSetting(proxygen::SettingsId::_HQ_DATAGRAM, 1);
     }
+    if (GetParam().webTransport_) {
+      egressSettings_.setSetting(proxygen::SettingsId::_HQ_WEBTRANSPORT, 1);
+    }
 
     if (!IS_H1Q_FB_V1) {
       egressControlCodec_ = std::make_unique<proxygen::hq::HQControlCodec>(
@@ -275,6 +285,16 @@ class HQSessionTest
           }
         }
           return;
+        case proxygen::hq::UnidirectionalStreamType::WEBTRANSPORT: {
+          auto wtIt = wtUniStreams_.find(id);
+          if (wtIt == wtUniStreams_.end()) {
+            auto sessionId = quic::decodeQuicInteger(cursor);
+            if (sessionId) {
+              wtUniStreams_.emplace(id, sessionId->first);
+            }
+          }
+        }
+          return;
         default:
           CHECK(false) << "Unknown stream preface=" << preface->first;
       }
@@ -425,4 +445,6 @@ class HQSessionTest
   // Egress Control Stream
   std::unique_ptr<proxygen::hq::HQControlCodec> egressControlCodec_;
   folly::F14FastMap<quic::StreamId, proxygen::hq::PushId> pushes_;
+  // WebTransport uni streams the session opened, and their session IDs
+  folly::F14FastMap<quic::StreamId, quic::StreamId> wtUniStreams_;
 };
@@ -39,6 +39,15 @@ using namespace std::chrono;
 namespace {
 constexpr quic::StreamId kQPACKEncoderIngressStreamId = 7;
 constexpr quic::StreamId kQPACKDecoderEgressStreamId = 10;
+
+// The session says on its own whether the CONNECT uses native streams
+HTTPMessage getWebTransportConnect() {
+  HTTPMessage req;
+  req.setURL("test.net/path");
+  req.setMethod("CONNECT");
+  req.getHeaders().add(HTTP_HEADER_HOST, "https://test.net/path");
+  return req;
+}
 } // namespace
 
 std::pair<HTTPCodec::StreamID, std::unique_ptr<HTTPCodec>>
@@ -230,6 +239,8 @@ using HQUpstreamSessionTestHQ = HQUpstreamSessionTest;
 using HQUpstreamSessionTestQPACK = HQUpstreamSessionTest;
 // Use this test class for hq only tests with Datagram support
 using HQUpstreamSessionTestHQDatagram = HQUpstreamSessionTest;
+// Use this test class for hq only tests with WebTransport support
+using HQUpstreamSessionTestHQWebTransport = HQUpstreamSessionTest;
 
 TEST_P(HQUpstreamSessionTest, SimpleGet) {
   auto handler = openTransaction();
@@ -1971,7 +1982,8 @@ TEST_P(HQUpstreamSessionTestHQDatagram, TestReceiveEarlyDatagramsSingleStream) {
   EXPECT_GT(handler->txn_->getDatagramSizeLimit(), 0);
   handler->txn_->sendHeaders(getGetRequest());
   handler->txn_->sendEOM();
-  for (auto i = 0; i < kDefaultMaxBufferedDatagrams * 2; ++i) {
+  const auto maxDatagrams = DatagramBuffer::Params().maxDatagramsPerStream;
+  for (size_t i = 0; i < maxDatagrams * 2; ++i) {
     auto h3Datagram =
         getH3Datagram(id, folly::IOBuf::wrapBuffer("testtest", 8));
     socketDriver_->addDatagram(std::move(h3Datagram));
@@ -1981,7 +1993,7 @@ TEST_P(HQUpstreamSessionTestHQDatagram, TestReceiveEarlyDatagramsSingleStream) {
   sendResponse(id, *std::get<0>(resp), std::move(std::get<1>(resp)), false);
   handler->expectHeaders();
   EXPECT_CALL(*handler, _onDatagram(testing::_))
-      .Times(kDefaultMaxBufferedDatagrams);
+      .Times(maxDatagrams);
   flushAndLoopN(1);
   auto it = streams_.find(id);
   CHECK(it != streams_.end());
@@ -1993,12 +2005,49 @@ TEST_P(HQUpstreamSessionTestHQDatagram, TestReceiveEarlyDatagramsSingleStream) {
   flushAndLoop();
 }
 
+TEST_P(HQUpstreamSessionTestHQDatagram, TestReceiveEarlyDatagramsDropOldest) {
+  DatagramBuffer::Params params;
+  params.maxDatagramsPerStream = 2;
+  params.dropPolicy = DatagramDropPolicy::DROP_OLDEST;
+  hqSession_->setDatagramBufferParams(params);
+  auto handler = openTransaction();
+  auto id = handler->txn_->getID();
+  handler->txn_->sendHeaders(getGetRequest());
+  handler->txn_->sendEOM();
+  for (auto payload : {"one", "two", "six"}) {
+    socketDriver_->addDatagram(
+        getH3Datagram(id, folly::IOBuf::copyBuffer(payload)));
+  }
+  flushAndLoopN(1);
+  auto resp = makeResponse(200, 0);
+  sendResponse(id, *std::get<0>(resp), std::move(std::get<1>(resp)), false);
+  handler->expectHeaders();
+  std::vector<std::string> received;
+  EXPECT_CALL(*handler, _onDatagram(testing::_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](std::shared_ptr<folly::IOBuf> buf) {
+        received.push_back(buf->moveToFbString().toStdString());
+      }));
+  flushAndLoopN(1);
+  EXPECT_EQ(received, std::vector<std::string>({"two", "six"}));
+  EXPECT_EQ(hqSession_->getDatagramBufferStats().dropped, 1);
+  EXPECT_EQ(hqSession_->getDatagramBufferStats().delivered, 2);
+  auto it = streams_.find(id);
+  CHECK(it != streams_.end());
+  it->second.readEOF = true;
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  hqSession_->closeWhenIdle();
+  flushAndLoop();
+}
+
 TEST_P(HQUpstreamSessionTestHQDatagram, TestReceiveEarlyDatagramsMultiStream) {
-  auto deliveredDatagrams = 0;
+  size_t deliveredDatagrams = 0;
   EXPECT_TRUE(httpCallbacks_.datagramEnabled);
   std::vector<std::unique_ptr<StrictMock<MockHTTPHandler>>> handlers;
 
-  for (auto i = 0; i < kMaxStreamsWithBufferedDatagrams * 2; ++i) {
+  const auto maxStreams = DatagramBuffer::Params().maxStreams;
+  for (size_t i = 0; i < maxStreams * 2; ++i) {
     handlers.emplace_back(openTransaction());
     auto handler = handlers.back().get();
     auto id = handler->txn_->getID();
@@ -2027,11 +2076,104 @@ TEST_P(HQUpstreamSessionTestHQDatagram, TestReceiveEarlyDatagramsMultiStream) {
     handler->expectDetachTransaction();
     flushAndLoopN(1);
   }
-  EXPECT_EQ(deliveredDatagrams, kMaxStreamsWithBufferedDatagrams);
+  EXPECT_EQ(deliveredDatagrams, maxStreams);
   hqSession_->closeWhenIdle();
   flushAndLoop();
 }
 
+TEST_P(HQUpstreamSessionTestHQWebTransport, NativeStreams) {
+  auto handler = openTransaction();
+  auto id = handler->txn_->getID();
+  // Created before the CONNECT is sent, which asks for native streams
+  auto wt = handler->txn_->getWebTransport();
+  ASSERT_NE(wt, nullptr);
+  handler->txn_->sendHeaders(getWebTransportConnect());
+  auto bidi = wt->createBidiStream();
+  ASSERT_TRUE(bidi.hasValue());
+  auto uni = wt->createUniStream();
+  ASSERT_TRUE(uni.hasValue());
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  sendResponse(id, resp, nullptr, false);
+  handler->expectHeaders();
+  flushAndLoopN(1);
+
+  FakeHTTPCodecCallback callback;
+  auto serverCodec = makeCodec(id).second;
+  serverCodec->setCallback(&callback);
+  serverCodec->onIngress(*socketDriver_->streams_[id].writeBuf.front());
+  ASSERT_NE(callback.msg, nullptr);
+  EXPECT_TRUE(
+      callback.msg->getHeaders().exists("sec-webtransport-http3-draft02"));
+
+  // Our streams start with their type and the CONNECT stream ID
+  auto bidiId = bidi->writeHandle->getID();
+  folly::io::Cursor cursor(socketDriver_->streams_[bidiId].writeBuf.front());
+  EXPECT_EQ(quic::decodeQuicInteger(cursor)->first, kWebTransportBidiSignal);
+  EXPECT_EQ(quic::decodeQuicInteger(cursor)->first, id);
+  EXPECT_EQ(wtUniStreams_[uni.value()->getID()], id);
+
+  // The server may open bidirectional streams, but only for WebTransport
+  EXPECT_CALL(*handler, _onWebTransportBidiStream(1, _));
+  socketDriver_->addReadEvent(1, makeWebTransportPreface(true, id));
+  flushAndLoopN(1);
+  EXPECT_FALSE(socketDriver_->streams_[1].error.hasValue());
+
+  EXPECT_CALL(*handler,
+              _onWebTransportSessionClose(folly::Optional<uint32_t>()));
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  streams_.find(id)->second.readEOF = true;
+  hqSession_->closeWhenIdle();
+  flushAndLoop();
+  EXPECT_TRUE(socketDriver_->streams_[1].error.hasValue());
+  EXPECT_TRUE(socketDriver_->streams_[bidiId].error.hasValue());
+}
+
+TEST_P(HQUpstreamSessionTestHQWebTransport, CapsulesOnceHeadersSent) {
+  auto handler = openTransaction();
+  auto id = handler->txn_->getID();
+  handler->txn_->sendHeaders(getWebTransportConnect());
+  // Too late to ask for native streams, so they are carried in capsules
+  auto wt = handler->txn_->getWebTransport();
+  ASSERT_NE(wt, nullptr);
+  ASSERT_TRUE(wt->createUniStream().hasValue());
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  sendResponse(id, resp, nullptr, false);
+  handler->expectHeaders();
+  flushAndLoopN(1);
+
+  FakeHTTPCodecCallback callback;
+  auto serverCodec = makeCodec(id).second;
+  serverCodec->setCallback(&callback);
+  serverCodec->onIngress(*socketDriver_->streams_[id].writeBuf.front());
+  ASSERT_NE(callback.msg, nullptr);
+  EXPECT_FALSE(
+      callback.msg->getHeaders().exists("sec-webtransport-http3-draft02"));
+  EXPECT_TRUE(wtUniStreams_.empty());
+
+  EXPECT_CALL(*handler,
+              _onWebTransportSessionClose(folly::Optional<uint32_t>()));
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  streams_.find(id)->second.readEOF = true;
+  hqSession_->closeWhenIdle();
+  flushAndLoop();
+}
+
+TEST_P(HQUpstreamSessionTestHQWebTransport, ServerStreamEndsBeforePreface) {
+  // A stream that ends without a byte is never peeked; a server can't send
+  // a request on it either
+  socketDriver_->addReadEOF(1);
+  flushAndLoopN(1);
+  EXPECT_EQ(socketDriver_->streams_[1].peekCB, nullptr);
+  EXPECT_EQ(socketDriver_->streams_[1].readCB, nullptr);
+  EXPECT_EQ(*socketDriver_->streams_[1].error,
+            HTTP3::ErrorCode::HTTP_STREAM_CREATION_ERROR);
+  hqSession_->closeWhenIdle();
+}
+
 /**
  * Instantiate the Parametrized test cases
  */
@@ -2131,3 +2273,15 @@ INSTANTIATE_TEST_SUITE_P(HQUpstreamSessionTest,
                            return tp;
                          }()),
                          paramsToTestName);
+
+// Instantiate h3 WebTransport tests, with credit for our own uni stream
+INSTANTIATE_TEST_SUITE_P(HQUpstreamSessionTest,
+                         HQUpstreamSessionTestHQWebTransport,
+                         Values([] {
+                           TestParams tp;
+                           tp.alpn_ = "h3";
+                           tp.webTransport_ = true;
+                           tp.unidirectionalStreamsCredit = 4;
+                           return tp;
+                         }()),
+                         paramsToTestName);
@@ -18,6 +18,8 @@
 #include <folly/io/async/TimeoutManager.h>
 #include <folly/io/async/test/MockAsyncTransport.h>
 #include <folly/portability/GTest.h>
+#include <proxygen/lib/http/EarlyHints.h>
+#include <proxygen/lib/http/codec/HTTP2Framer.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/codec/test/TestUtils.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
@@ -28,6 +30,7 @@
 #include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
 #include <proxygen/lib/http/session/test/MockByteEventTracker.h>
 #include <proxygen/lib/http/session/test/TestUtils.h>
+#include <proxygen/lib/http/webtransport/CapsuleCodec.h>
 #include <proxygen/lib/test/TestAsyncTransport.h>
 #include <wangle/acceptor/ConnectionManager.h>
 
@@ -257,6 +260,8 @@ class HTTPDownstreamTest : public testing::Test {
 
   void testChunks(bool trailers);
 
+  void testEarlyHints();
+
   void expect101(CodecProtocol expectedProtocol,
                  const std::string& expectedUpgrade,
                  bool expect100 = false) {
@@ -655,6 +660,23 @@ TEST_F(HTTPDownstreamSessionTest, Http10NoHeaders) {
   flushRequestsAndLoop();
 }
 
+TEST_F(HTTPDownstreamSessionTest, Http10NoEarlyHints) {
+  InSequence enforceOrder;
+  EarlyHints hints(std::vector<std::string>{"</style.css>; rel=preload"});
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders([&] {
+    // HTTP/1.0 clients cannot receive 1xx responses
+    EXPECT_FALSE(handler->txn_->sendEarlyHints(hints.getMessage()));
+  });
+  onEOMTerminateHandlerExpectShutdown(*handler);
+
+  auto req = getGetRequest();
+  req.setHTTPVersion(1, 0);
+  sendRequest(req);
+  flushRequestsAndLoop();
+}
+
 TEST_F(HTTPDownstreamSessionTest, Http10NoHeadersEof) {
   InSequence enforceOrder;
 
@@ -1431,6 +1453,55 @@ TEST_F(HTTPDownstreamSessionTest, HttpWithAckTimingConnError) {
   handler1->txn_->decrementPendingByteEvents();
 }
 
+template <class C>
+void HTTPDownstreamTest<C>::testEarlyHints() {
+  EarlyHints hints(std::vector<EarlyHints::Link>{
+      {"/style.css", "preload", "style"}, {"/app.js", "preload", "script"}});
+  EXPECT_EQ(hints.getLinkValue(),
+            "</style.css>; rel=preload; as=style, "
+            "</app.js>; rel=preload; as=script");
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&] {
+    EXPECT_TRUE(handler->txn_->sendEarlyHints(hints.getMessage()));
+  });
+  handler->expectEOM([&] {
+    handler->sendReplyWithBody(200, 100);
+    // Too late once the final response has been sent
+    EXPECT_FALSE(handler->txn_->sendEarlyHints(hints.getMessage()));
+  });
+  handler->expectDetachTransaction();
+  sendRequest();
+  flushRequestsAndLoop();
+
+  NiceMock<MockHTTPCodecCallback> callbacks;
+  clientCodec_->setCallback(&callbacks);
+  InSequence enforceOrder;
+  EXPECT_CALL(callbacks, onHeadersComplete(_, _))
+      .WillOnce(Invoke([&](HTTPCodec::StreamID,
+                           std::shared_ptr<HTTPMessage> msg) {
+        EXPECT_EQ(msg->getStatusCode(), 103);
+        EXPECT_EQ(msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_LINK),
+                  hints.getLinkValue());
+      }));
+  EXPECT_CALL(callbacks, onHeadersComplete(_, _))
+      .WillOnce(
+          Invoke([](HTTPCodec::StreamID, std::shared_ptr<HTTPMessage> msg) {
+            EXPECT_EQ(msg->getStatusCode(), 200);
+          }));
+  EXPECT_CALL(callbacks, onMessageComplete(_, _));
+  parseOutput(*clientCodec_);
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, EarlyHints) {
+  testEarlyHints();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, EarlyHints) {
+  testEarlyHints();
+}
+
 TEST_F(HTTP2DownstreamSessionTest, TestPing) {
   // send a request with a PING, should get the PING first
   auto handler = addSimpleStrictHandler();
@@ -2253,6 +2324,40 @@ TEST_F(HTTPDownstreamSessionTest, WriteTimeout) {
   flushRequestsAndLoop();
 }
 
+// With several writes allowed in flight, a blocked socket gets
+// maxActiveWrites writes queued and the rest of the body stays in the session
+TEST_F(HTTPDownstreamSessionTest, PipelinedSocketWrites) {
+  httpSession_->setMaxActiveWrites(3);
+  EXPECT_EQ(httpSession_->getMaxActiveWrites(), 3);
+  transport_->pauseWrites();
+  sendRequest();
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler, this] {
+    handler->sendReplyWithBody(200, 300000);
+    eventBase_.runAfterDelay(
+        [this] {
+          EXPECT_EQ(transport_->getNumPendingWriteEvents(), 3);
+          EXPECT_TRUE(transport_->getWriteEvents()->empty());
+          transport_->resumeWrites();
+        },
+        10);
+  });
+  handler->expectDetachTransaction();
+  expectDetachSession();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  flushRequestsAndLoop();
+  size_t written = 0;
+  for (auto& event : *transport_->getWriteEvents()) {
+    for (size_t i = 0; i < event->getCount(); i++) {
+      written += event->getIoVec()[i].iov_len;
+    }
+  }
+  EXPECT_GT(written, 300000);
+}
+
 // Send an abort from the write timeout path while pipelining
 TEST_F(HTTPDownstreamSessionTest, WriteTimeoutPipeline) {
   const char* buf =
@@ -3878,6 +3983,27 @@ TEST_F(HTTP2DownstreamSessionTest, TestControlMsgResetRateLimitTouched) {
   this->eventBase_.loop();
 }
 
+TEST_F(HTTP2DownstreamSessionTest, IngressCostGoaway) {
+  // No refill, so the GOAWAY is sent without pausing reads
+  IngressCostParams params;
+  params.refillPerSecond = 0;
+  params.burst = 30;
+  params.goawayDebt = 10;
+  httpSession_->setIngressCostParams(params);
+
+  // Each PING costs kIngressFrameCost + kIngressControlFrameCost = 6, so
+  // these alone overrun the budget by more than goawayDebt
+  for (int i = 0; i < 7; i++) {
+    clientCodec_->generatePingRequest(requests_);
+  }
+  flushRequestsAndLoop();
+
+  EXPECT_CALL(callbacks_, onGoaway(_, ErrorCode::ENHANCE_YOUR_CALM, _));
+  parseOutput(*clientCodec_);
+  expectDetachSession();
+  httpSession_->dropConnection();
+}
+
 TEST_F(HTTP2DownstreamSessionTest, DirectErrorHandlingLimitTouched) {
   httpSession_->setControlMessageRateLimitParams(100, 10, milliseconds(0));
 
@@ -4043,6 +4169,35 @@ TEST_F(HTTP2DownstreamSessionTest, TestLongContentLength) {
   gracefulShutdown();
 }
 
+TEST_F(HTTP2DownstreamSessionTest, WebTransportCapsules) {
+  // Over HTTP/2 the session's streams travel in capsules on the CONNECT
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::CONNECT);
+  req.getHeaders().add(HTTP_HEADER_HOST, "test.net:443");
+  auto streamID = sendRequest(req, false);
+  folly::IOBufQueue capsules{folly::IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeStream(capsules, 2, makeBuf(10), true);
+  clientCodec_->generateBody(
+      requests_, streamID, capsules.move(), HTTPCodec::NoPadding, true);
+  auto handler = addSimpleStrictHandler();
+
+  handler->expectHeaders([&handler] {
+    EXPECT_NE(handler->txn_->getWebTransport(), nullptr);
+    HTTPMessage resp;
+    resp.setStatusCode(200);
+    handler->txn_->sendHeaders(resp);
+  });
+  EXPECT_CALL(*handler, _onWebTransportUniStream(2, _));
+  // The end of the CONNECT stream closes the session
+  EXPECT_CALL(*handler,
+              _onWebTransportSessionClose(folly::Optional<uint32_t>()));
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop();
+
+  gracefulShutdown();
+}
+
 TEST_F(HTTP2DownstreamSessionTest, TestMalformedContentLength) {
   auto req = getPostRequest();
   req.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, "malformed");
@@ -4436,3 +4591,134 @@ TEST_F(HTTP2DownstreamSessionTest, CancelPingProbesOnRequest) {
   EXPECT_EQ(httpSession_->getConnectionCloseReason(),
             ConnectionCloseReason::TIMEOUT);
 }
+
+namespace {
+
+// Bytes the session has written, in write order
+IOBufQueue getWritten(TestAsyncTransport* transport) {
+  IOBufQueue written{IOBufQueue::cacheChainLength()};
+  for (auto& event : *transport->getWriteEvents()) {
+    for (size_t i = 0; i < event->getCount(); i++) {
+      written.append(IOBuf::copyBuffer(event->getIoVec()[i].iov_base,
+                                       event->getIoVec()[i].iov_len));
+    }
+  }
+  return written;
+}
+
+// Payload lengths of the HTTP/2 DATA frames the session has written
+std::vector<uint32_t> getDataFrameLengths(TestAsyncTransport* transport) {
+  auto written = getWritten(transport);
+  std::vector<uint32_t> lengths;
+  Cursor cursor(written.front());
+  while (cursor.totalLength() >= http2::kFrameHeaderSize) {
+    uint32_t length = cursor.readBE<uint16_t>();
+    length = (length << 8) | cursor.read<uint8_t>();
+    auto type = cursor.read<uint8_t>();
+    cursor.skip(http2::kFrameHeaderSize - 4);
+    if (type == static_cast<uint8_t>(http2::FrameType::DATA)) {
+      lengths.push_back(length);
+    }
+    cursor.skip(length);
+  }
+  return lengths;
+}
+
+} // namespace
+
+TEST_F(HTTPDownstreamSessionTest, EgressRecordSizingNeedsHTTP2) {
+  // Ignored for HTTP/1.1, so the first write is not cut to records
+  httpSession_->setEgressRecordSizing(true);
+  sendRequest();
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100000); });
+  handler->expectDetachTransaction();
+  expectDetachSession();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  flushRequestsAndLoop(true);
+
+  auto writeEvents = transport_->getWriteEvents();
+  ASSERT_FALSE(writeEvents->empty());
+  size_t firstWrite = 0;
+  for (size_t i = 0; i < writeEvents->front()->getCount(); i++) {
+    firstWrite += writeEvents->front()->getIoVec()[i].iov_len;
+  }
+  // The headers and a whole kWriteReadyMax of body
+  EXPECT_GT(firstWrite, 65536);
+  EXPECT_GT(getWritten(transport_).chainLength(), 100000);
+}
+
+TEST_F(HTTP2DownstreamSessionTest, EgressRecordSizingOffByDefault) {
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 20000); });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  // Frames are as large as the peer allows
+  EXPECT_EQ(getDataFrameLengths(transport_),
+            (std::vector<uint32_t>{16384, 20000 - 16384}));
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, EgressRecordSizing) {
+  httpSession_->setEgressRecordSizing(true);
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 20000); });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  // A new connection starts at 1400 byte records, each holding one DATA
+  // frame with its header
+  auto lengths = getDataFrameLengths(transport_);
+  ASSERT_FALSE(lengths.empty());
+  uint32_t total = 0;
+  for (size_t i = 0; i < lengths.size(); i++) {
+    if (i + 1 < lengths.size()) {
+      EXPECT_EQ(lengths[i] + http2::kFrameHeaderSize, 1400);
+    } else {
+      EXPECT_LE(lengths[i] + http2::kFrameHeaderSize, 1400);
+    }
+    total += lengths[i];
+  }
+  EXPECT_EQ(total, 20000);
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, EgressRecordSizingKeepsSmallerLimit) {
+  // Below one record, so it must not be rounded up to one
+  httpSession_->setEgressBodySizeLimit(1000);
+  httpSession_->setEgressRecordSizing(true);
+  auto handler1 = addSimpleNiceHandler();
+  auto handler2 = addSimpleNiceHandler();
+  for (auto handler : {handler1.get(), handler2.get()}) {
+    handler->expectHeaders();
+    handler->expectEOM([handler] { handler->sendReplyWithBody(200, 5000); });
+    handler->expectDetachTransaction();
+  }
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  // The two streams take turns, at most 1000 bytes at a time
+  auto lengths = getDataFrameLengths(transport_);
+  uint32_t total = 0;
+  for (auto length : lengths) {
+    EXPECT_LE(length, 1000);
+    total += length;
+  }
+  EXPECT_EQ(total, 10000);
+  expectDetachSession();
+}
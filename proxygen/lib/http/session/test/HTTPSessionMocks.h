@@ -265,6 +265,30 @@ class MockHTTPHandler
   }
   MOCK_METHOD(void, _onExTransaction, (HTTPTransaction*));
 
+  void onWebTransportBidiStream(
+      HTTPCodec::StreamID id,
+      WebTransport::BidiStreamHandle handle) noexcept override {
+    _onWebTransportBidiStream(id, handle);
+  }
+  MOCK_METHOD(void,
+              _onWebTransportBidiStream,
+              (HTTPCodec::StreamID, WebTransport::BidiStreamHandle));
+
+  void onWebTransportUniStream(
+      HTTPCodec::StreamID id,
+      WebTransport::StreamReadHandle* handle) noexcept override {
+    _onWebTransportUniStream(id, handle);
+  }
+  MOCK_METHOD(void,
+              _onWebTransportUniStream,
+              (HTTPCodec::StreamID, WebTransport::StreamReadHandle*));
+
+  void onWebTransportSessionClose(
+      folly::Optional<uint32_t> error) noexcept override {
+    _onWebTransportSessionClose(error);
+  }
+  MOCK_METHOD(void, _onWebTransportSessionClose, (folly::Optional<uint32_t>));
+
   void expectTransaction(std::function<void(HTTPTransaction* txn)> callback) {
     EXPECT_CALL(*this, _setTransaction(testing::_))
         .WillOnce(testing::Invoke(callback))
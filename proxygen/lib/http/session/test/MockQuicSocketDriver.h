@@ -316,6 +316,32 @@ class MockQuicSocketDriver : public folly::EventBase::LoopCallback {
               return folly::unit;
             }));
 
+    EXPECT_CALL(*sock_, peek(testing::_, testing::_))
+        .WillRepeatedly(testing::Invoke(
+            [this](StreamId id,
+                   const folly::Function<void(
+                       StreamId, const folly::Range<PeekIterator>&) const>&
+                       peekCallback)
+                -> folly::Expected<folly::Unit, LocalErrorCode> {
+              auto& stream = streams_[id];
+              if (stream.readState == ERROR) {
+                return folly::makeUnexpected(
+                    quic::LocalErrorCode::INTERNAL_ERROR);
+              }
+              // Like the transport, an empty range once all data is read
+              std::deque<StreamBuffer> fakeReadBuffer;
+              if (!stream.readBuf.empty()) {
+                stream.readBuf.gather(stream.readBuf.chainLength());
+                fakeReadBuffer.emplace_back(stream.readBuf.front()->clone(),
+                                            stream.readOffset,
+                                            stream.readEOF);
+              }
+              peekCallback(id,
+                           folly::Range<PeekIterator>(fakeReadBuffer.cbegin(),
+                                                      fakeReadBuffer.size()));
+              return folly::unit;
+            }));
+
     EXPECT_CALL(*sock_, readNaked(testing::_, testing::_))
         .WillRepeatedly(testing::Invoke(
             [this](StreamId id, size_t maxLen) -> MockQuicSocket::ReadResult {
@@ -0,0 +1,610 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * End-to-end benchmarks for the session layer.
+ *
+ * HTTP/1.1 and HTTP/2 run a real HTTPUpstreamSession against a real
+ * HTTPDownstreamSession connected by an in-memory transport pair, so both
+ * codecs, both sessions and the transaction state machines are exercised.
+ * HTTP/3 runs an HQDownstreamSession over MockQuicSocketDriver, with
+ * requests pre-encoded by a client HQStreamCodec.
+ *
+ * Besides time per request, each benchmark reports:
+ *   allocs_per_req  operator new calls per request (malloc is not counted)
+ *   cpu_ns_per_kb   thread CPU time per KB of request and response body
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/codec/HQStreamCodec.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/http/session/test/MockQuicSocketDriver.h>
+#include <proxygen/lib/http/session/test/TestUtils.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+
+#include <atomic>
+#include <ctime>
+
+using namespace proxygen;
+
+namespace {
+std::atomic<uint64_t> gNumAllocs{0};
+} // namespace
+
+void* operator new(size_t size) {
+  gNumAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t /*size*/) noexcept {
+  free(p);
+}
+
+namespace {
+
+enum class Protocol { HTTP1, HTTP2, HTTP3 };
+
+struct Workload {
+  size_t requestBodySize{0};
+  size_t responseBodySize{0};
+  // Requests kept in flight, only HTTP/2 and HTTP/3 can exceed 1
+  uint32_t concurrency{1};
+};
+
+std::unique_ptr<folly::IOBuf> makeBuf(size_t len) {
+  auto buf = folly::IOBuf::create(len);
+  memset(buf->writableData(), 'a', len);
+  buf->append(len);
+  return buf;
+}
+
+std::chrono::nanoseconds threadCpuTime() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+/**
+ * One half of an in-memory connection. Writes complete immediately and
+ * the bytes are handed to the peer's read callback from a loop callback,
+ * like a socket with an infinitely fast network.
+ */
+class LoopbackTransport
+    : public TestAsyncTransport
+    , private folly::EventBase::LoopCallback {
+ public:
+  explicit LoopbackTransport(folly::EventBase* evb)
+      : TestAsyncTransport(evb), evb_(evb) {
+  }
+
+  void setPeer(LoopbackTransport* peer) {
+    peer_ = peer;
+  }
+
+  void setReadCB(ReadCallback* callback) override {
+    TestAsyncTransport::setReadCB(callback);
+    if (callback && !pending_.empty() && !isLoopCallbackScheduled()) {
+      evb_->runInLoop(this);
+    }
+  }
+
+  void writeChain(WriteCallback* callback,
+                  std::unique_ptr<folly::IOBuf>&& iob,
+                  folly::WriteFlags /*flags*/) override {
+    if (peer_) {
+      peer_->deliver(std::move(iob));
+    }
+    callback->writeSuccess();
+  }
+
+  void writev(WriteCallback* callback,
+              const struct iovec* vec,
+              size_t count,
+              folly::WriteFlags flags) override {
+    folly::IOBufQueue queue;
+    for (size_t i = 0; i < count; i++) {
+      queue.append(folly::IOBuf::copyBuffer(vec[i].iov_base, vec[i].iov_len));
+    }
+    writeChain(callback, queue.move(), flags);
+  }
+
+ private:
+  ~LoopbackTransport() override {
+    if (peer_) {
+      peer_->peer_ = nullptr;
+    }
+    cancelLoopCallback();
+  }
+
+  void deliver(std::unique_ptr<folly::IOBuf> buf) {
+    pending_.append(std::move(buf));
+    if (getReadCallback() && !isLoopCallbackScheduled()) {
+      evb_->runInLoop(this);
+    }
+  }
+
+  void runLoopCallback() noexcept override {
+    DestructorGuard dg(this);
+    while (!pending_.empty()) {
+      auto callback = getReadCallback();
+      if (!callback) {
+        return;
+      }
+      if (callback->isBufferMovable()) {
+        callback->readBufferAvailable(pending_.move());
+        continue;
+      }
+      void* buf = nullptr;
+      size_t len = 0;
+      callback->getReadBuffer(&buf, &len);
+      len = std::min(len, pending_.chainLength());
+      folly::io::Cursor(pending_.front()).pull(buf, len);
+      pending_.trimStart(len);
+      callback->readDataAvailable(len);
+    }
+  }
+
+  folly::EventBase* evb_;
+  LoopbackTransport* peer_{nullptr};
+  folly::IOBufQueue pending_{folly::IOBufQueue::cacheChainLength()};
+};
+
+class Harness;
+
+// Replies to every request with a fixed size 200 once the request is done
+class ServerHandler : public HTTPTransactionHandler {
+ public:
+  explicit ServerHandler(Harness& harness) : harness_(harness) {
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void detachTransaction() noexcept override;
+  void onHeadersComplete(std::unique_ptr<HTTPMessage>) noexcept override {
+  }
+  void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {
+  }
+  void onEOM() noexcept override;
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+  void onError(const HTTPException& error) noexcept override {
+    LOG(FATAL) << "Server error: " << error.what();
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  Harness& harness_;
+  HTTPTransaction* txn_{nullptr};
+};
+
+class ClientHandler : public HTTPTransactionHandler {
+ public:
+  explicit ClientHandler(Harness& harness) : harness_(harness) {
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void detachTransaction() noexcept override;
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    CHECK_EQ(msg->getStatusCode(), 200);
+  }
+  void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {
+  }
+  void onEOM() noexcept override {
+  }
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+  void onError(const HTTPException& error) noexcept override {
+    LOG(FATAL) << "Client error: " << error.what();
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+  HTTPTransaction* txn_{nullptr};
+
+ private:
+  Harness& harness_;
+};
+
+class Harness : public HTTPSessionController {
+ public:
+  explicit Harness(const Workload& workload)
+      : workload_(workload),
+        responseBody_(makeBuf(workload.responseBodySize)),
+        requestBody_(makeBuf(workload.requestBodySize)) {
+  }
+
+  ~Harness() override = default;
+
+  void run(size_t iters) {
+    size_t started = 0;
+    size_t base = completed_;
+    while (completed_ - base < iters) {
+      while (started < iters &&
+             started - (completed_ - base) < workload_.concurrency) {
+        if (!startRequest()) {
+          break;
+        }
+        started++;
+      }
+      evb_.loopOnce(EVLOOP_NONBLOCK);
+      afterLoop();
+    }
+  }
+
+  HTTPMessage makeRequest() const {
+    HTTPMessage req;
+    req.setMethod(workload_.requestBodySize ? HTTPMethod::POST
+                                            : HTTPMethod::GET);
+    req.setURL("/bench");
+    req.setHTTPVersion(1, 1);
+    req.getHeaders().set(HTTP_HEADER_HOST, "www.example.com");
+    req.getHeaders().set(HTTP_HEADER_USER_AGENT, "proxygen-bench");
+    req.getHeaders().set(HTTP_HEADER_ACCEPT, "*/*");
+    if (workload_.requestBodySize) {
+      req.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                           folly::to<std::string>(workload_.requestBodySize));
+    }
+    return req;
+  }
+
+  void sendResponse(HTTPTransaction* txn) {
+    HTTPMessage resp;
+    resp.setStatusCode(200);
+    resp.setStatusMessage("OK");
+    resp.setHTTPVersion(1, 1);
+    resp.getHeaders().set(HTTP_HEADER_CONTENT_TYPE, "text/plain");
+    resp.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                          folly::to<std::string>(workload_.responseBodySize));
+    if (workload_.responseBodySize == 0) {
+      txn->sendHeadersWithEOM(resp);
+      return;
+    }
+    txn->sendHeaders(resp);
+    txn->sendBody(responseBody_->clone());
+    txn->sendEOM();
+  }
+
+  virtual void onServerDone(HTTPCodec::StreamID /*id*/) {
+  }
+
+  void onClientDone() {
+    completed_++;
+  }
+
+  // HTTPSessionController
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction& /*txn*/,
+                                            HTTPMessage* /*msg*/) override {
+    return new ServerHandler(*this);
+  }
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction* /*txn*/,
+      const HTTPException& /*error*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction* /*txn*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+  void attachSession(HTTPSessionBase* /*session*/) override {
+  }
+  void detachSession(const HTTPSessionBase* /*session*/) override {
+  }
+
+ protected:
+  virtual bool startRequest() = 0;
+  virtual void afterLoop() {
+  }
+
+  folly::EventBase evb_;
+  Workload workload_;
+  std::unique_ptr<folly::IOBuf> responseBody_;
+  std::unique_ptr<folly::IOBuf> requestBody_;
+  size_t completed_{0};
+};
+
+void ServerHandler::detachTransaction() noexcept {
+  harness_.onServerDone(txn_->getID());
+  delete this;
+}
+
+void ServerHandler::onEOM() noexcept {
+  harness_.sendResponse(txn_);
+}
+
+void ClientHandler::detachTransaction() noexcept {
+  harness_.onClientDone();
+  delete this;
+}
+
+// HTTP/1.1 or HTTP/2 client and server sessions over a LoopbackTransport
+class HTTPHarness : public Harness {
+ public:
+  HTTPHarness(Protocol protocol, const Workload& workload)
+      : Harness(workload),
+        timer_(folly::HHWheelTimer::newTimer(
+            &evb_,
+            std::chrono::milliseconds(
+                folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+            folly::AsyncTimeout::InternalEnum::NORMAL,
+            std::chrono::milliseconds(5000))) {
+    auto clientTransport = new LoopbackTransport(&evb_);
+    auto serverTransport = new LoopbackTransport(&evb_);
+    clientTransport->setPeer(serverTransport);
+    serverTransport->setPeer(clientTransport);
+
+    std::unique_ptr<HTTPCodec> clientCodec;
+    std::unique_ptr<HTTPCodec> serverCodec;
+    if (protocol == Protocol::HTTP2) {
+      clientCodec = std::make_unique<HTTP2Codec>(TransportDirection::UPSTREAM);
+      serverCodec =
+          std::make_unique<HTTP2Codec>(TransportDirection::DOWNSTREAM);
+    } else {
+      clientCodec =
+          std::make_unique<HTTP1xCodec>(TransportDirection::UPSTREAM);
+      serverCodec =
+          std::make_unique<HTTP1xCodec>(TransportDirection::DOWNSTREAM);
+    }
+    folly::SocketAddress addr("127.0.0.1", 443);
+    server_ = new HTTPDownstreamSession(
+        timer_.get(),
+        folly::AsyncTransport::UniquePtr(serverTransport),
+        addr,
+        addr,
+        this,
+        std::move(serverCodec),
+        mockTransportInfo,
+        nullptr);
+    client_ = new HTTPUpstreamSession(
+        timer_.get(),
+        folly::AsyncTransport::UniquePtr(clientTransport),
+        addr,
+        addr,
+        std::move(clientCodec),
+        mockTransportInfo,
+        nullptr);
+    server_->startNow();
+    client_->startNow();
+    // Connection preface and SETTINGS
+    evb_.loop();
+  }
+
+  ~HTTPHarness() override {
+    client_->dropConnection();
+    server_->dropConnection();
+    evb_.loop();
+  }
+
+ protected:
+  bool startRequest() override {
+    auto handler = new ClientHandler(*this);
+    auto txn = client_->newTransaction(handler);
+    if (!txn) {
+      delete handler;
+      return false;
+    }
+    auto req = makeRequest();
+    if (workload_.requestBodySize == 0) {
+      txn->sendHeadersWithEOM(req);
+    } else {
+      txn->sendHeaders(req);
+      txn->sendBody(requestBody_->clone());
+      txn->sendEOM();
+    }
+    return true;
+  }
+
+ private:
+  folly::HHWheelTimer::UniquePtr timer_;
+  HTTPDownstreamSession* server_{nullptr};
+  HTTPUpstreamSession* client_{nullptr};
+};
+
+// HQDownstreamSession over MockQuicSocketDriver. Requests are encoded once
+// with a QPACK encoder that has no dynamic table, so the same bytes are
+// valid on every stream.
+class HQHarness : public Harness {
+ public:
+  explicit HQHarness(const Workload& workload) : Harness(workload) {
+    session_ = new HQDownstreamSession(
+        std::chrono::milliseconds(5000), this, mockTransportInfo, nullptr);
+    driver_ = std::make_unique<quic::MockQuicSocketDriver>(
+        &evb_,
+        session_,
+        session_,
+        quic::MockQuicSocketDriver::TransportEnum::SERVER,
+        "h3");
+    session_->setSocket(driver_->getSocket());
+    driver_->setMaxUniStreams(10);
+    EXPECT_CALL(*driver_->getSocket(), getStreamTransportInfo(testing::_))
+        .WillRepeatedly(
+            testing::Return(quic::QuicSocket::StreamTransportInfo{}));
+    EXPECT_CALL(*driver_->getSocket(), getTransportInfo())
+        .WillRepeatedly(testing::Return(quic::QuicSocket::TransportInfo{}));
+    session_->onTransportReady();
+    // The driver only replenishes flow control on flushWrites(), never
+    // block on it here
+    driver_->setConnectionFlowControlWindow(uint64_t(1) << 48);
+    evb_.loopOnce();
+
+    QPACKCodec qpack;
+    folly::IOBufQueue encoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+    folly::IOBufQueue decoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+    HTTPSettings settings;
+    hq::HQStreamCodec codec(
+        0,
+        TransportDirection::UPSTREAM,
+        qpack,
+        encoderWriteBuf,
+        decoderWriteBuf,
+        [] { return std::numeric_limits<uint64_t>::max(); },
+        settings);
+    folly::IOBufQueue buf{folly::IOBufQueue::cacheChainLength()};
+    auto id = codec.createStream();
+    auto req = makeRequest();
+    codec.generateHeader(buf, id, req, workload_.requestBodySize == 0);
+    if (workload_.requestBodySize) {
+      codec.generateBody(buf, id, requestBody_->clone(), folly::none, true);
+    }
+    CHECK(encoderWriteBuf.empty());
+    request_ = buf.move();
+  }
+
+  ~HQHarness() override {
+    session_->dropConnection();
+    evb_.loop();
+  }
+
+  void onServerDone(HTTPCodec::StreamID id) override {
+    // The driver may still be delivering callbacks for this stream
+    doneStreams_.push_back(id);
+    completed_++;
+  }
+
+ protected:
+  bool startRequest() override {
+    auto id = nextStreamId_;
+    nextStreamId_ += 4;
+    driver_->addReadEvent(
+        id, request_->clone(), true, std::chrono::milliseconds(0));
+    driver_->setStreamFlowControlWindow(id, uint64_t(1) << 32);
+    return true;
+  }
+
+  void afterLoop() override {
+    for (auto id : doneStreams_) {
+      driver_->streams_[id].writeBuf.move();
+    }
+    doneStreams_.clear();
+  }
+
+ private:
+  HQDownstreamSession* session_{nullptr};
+  std::unique_ptr<quic::MockQuicSocketDriver> driver_;
+  std::unique_ptr<folly::IOBuf> request_;
+  std::vector<HTTPCodec::StreamID> doneStreams_;
+  quic::StreamId nextStreamId_{0};
+};
+
+void runWorkload(folly::UserCounters& counters,
+                 size_t iters,
+                 Protocol protocol,
+                 const Workload& workload) {
+  folly::BenchmarkSuspender suspender;
+  std::unique_ptr<Harness> harness;
+  if (protocol == Protocol::HTTP3) {
+    harness = std::make_unique<HQHarness>(workload);
+  } else {
+    harness = std::make_unique<HTTPHarness>(protocol, workload);
+  }
+  auto allocs = gNumAllocs.load(std::memory_order_relaxed);
+  auto cpu = threadCpuTime();
+  suspender.dismiss();
+
+  harness->run(iters);
+
+  suspender.rehire();
+  allocs = gNumAllocs.load(std::memory_order_relaxed) - allocs;
+  auto cpuNs = (threadCpuTime() - cpu).count();
+  auto bodyBytes =
+      std::max<size_t>(workload.requestBodySize + workload.responseBodySize, 1);
+  counters["allocs_per_req"] = allocs / iters;
+  counters["cpu_ns_per_kb"] = cpuNs * 1024 / (iters * bodyBytes);
+  harness.reset();
+}
+
+const Workload kSmallGet{0, 1024, 1};
+const Workload kSmallGetConcurrent{0, 1024, 16};
+const Workload kLargeGet{0, 64 * 1024, 1};
+const Workload kPost{16 * 1024, 1024, 1};
+
+} // namespace
+
+BENCHMARK_COUNTERS(H1SmallGet, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP1, kSmallGet);
+}
+
+BENCHMARK_COUNTERS(H1LargeGet, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP1, kLargeGet);
+}
+
+BENCHMARK_COUNTERS(H1Post, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP1, kPost);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(H2SmallGet, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP2, kSmallGet);
+}
+
+BENCHMARK_COUNTERS(H2SmallGetConcurrent, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP2, kSmallGetConcurrent);
+}
+
+BENCHMARK_COUNTERS(H2LargeGet, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP2, kLargeGet);
+}
+
+BENCHMARK_COUNTERS(H2Post, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP2, kPost);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(H3SmallGet, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP3, kSmallGet);
+}
+
+BENCHMARK_COUNTERS(H3SmallGetConcurrent, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP3, kSmallGetConcurrent);
+}
+
+BENCHMARK_COUNTERS(H3LargeGet, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP3, kLargeGet);
+}
+
+BENCHMARK_COUNTERS(H3Post, counters, iters) {
+  runWorkload(counters, iters, Protocol::HTTP3, kPost);
+}
+
+int main(int argc, char** argv) {
+  // MockQuicSocketDriver is built on gmock
+  testing::InitGoogleMock(&argc, argv);
+  testing::FLAGS_gmock_verbose = "error";
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
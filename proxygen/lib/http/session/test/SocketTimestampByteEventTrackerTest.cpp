@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+#include <proxygen/lib/http/session/SocketTimestampByteEventTracker.h>
+#include <proxygen/lib/http/session/test/ByteEventTrackerMocks.h>
+#include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
+#include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+
+#include <chrono>
+
+using namespace testing;
+using namespace proxygen;
+
+using TimestampType = SocketTimestampByteEventTracker::TimestampType;
+
+class SocketTimestampByteEventTrackerTest : public Test {
+ public:
+  void SetUp() override {
+    txn_.setTransportCallback(&transportCallback_);
+    EXPECT_CALL(callback_, onTxnByteEventWrittenToBuf(_)).Times(AnyNumber());
+  }
+
+  void makeTracker(SocketTimestampByteEventTracker::Options options) {
+    // No socket, timestamps are injected through onSocketTimestamp
+    tracker_ = std::make_shared<SocketTimestampByteEventTracker>(
+        &callback_, nullptr, options);
+  }
+
+ protected:
+  folly::EventBase eventBase_;
+  WheelTimerInstance transactionTimeouts_{std::chrono::milliseconds(500),
+                                          &eventBase_};
+  NiceMock<MockHTTPTransactionTransport> transport_;
+  StrictMock<MockHTTPHandler> handler_;
+  HTTP2PriorityQueue txnEgressQueue_;
+  HTTPTransaction txn_{TransportDirection::DOWNSTREAM,
+                       HTTPCodec::StreamID(1),
+                       1,
+                       transport_,
+                       txnEgressQueue_,
+                       transactionTimeouts_.getWheelTimer(),
+                       transactionTimeouts_.getDefaultTimeout()};
+  NiceMock<MockHTTPTransactionTransportCallback> transportCallback_;
+  MockByteEventTrackerCallback callback_;
+  std::shared_ptr<SocketTimestampByteEventTracker> tracker_;
+};
+
+TEST_F(SocketTimestampByteEventTrackerTest, PreSendSplitsAtSampledBytes) {
+  SocketTimestampByteEventTracker::Options options;
+  options.sampleRate = 2;
+  options.timestampTx = false;
+  makeTracker(options);
+
+  bool cork = false;
+  bool timestampTx = false;
+  bool timestampAck = false;
+  tracker_->addTrackedByteEvent(&txn_, 50);
+  tracker_->addLastByteEvent(&txn_, 100);
+  EXPECT_EQ(tracker_->preSend(&cork, &timestampTx, &timestampAck, 0), 0);
+
+  // The second transaction's last byte is sampled
+  tracker_->addLastByteEvent(&txn_, 300);
+  EXPECT_EQ(tracker_->preSend(&cork, &timestampTx, &timestampAck, 0), 300);
+  EXPECT_FALSE(timestampTx);
+  EXPECT_TRUE(timestampAck);
+  EXPECT_EQ(tracker_->preSend(&cork, &timestampTx, &timestampAck, 120), 180);
+
+  // The event written to the buffer carries the request
+  EXPECT_CALL(callback_,
+              onTxnByteEventWrittenToBuf(
+                  AllOf(Property(&ByteEvent::getByteOffset, 300),
+                        Truly([](const ByteEvent& event) {
+                          return event.timestampAck_;
+                        }))));
+  tracker_->processByteEvents(tracker_, 300);
+  EXPECT_EQ(tracker_->preSend(&cork, &timestampTx, &timestampAck, 300), 0);
+}
+
+TEST_F(SocketTimestampByteEventTrackerTest, AckCorrelatesByKey) {
+  makeTracker(SocketTimestampByteEventTracker::Options());
+  tracker_->addTxByteEvent(1000, ByteEvent::TRACKED_BYTE, &txn_);
+  tracker_->addAckByteEvent(1000, ByteEvent::TRACKED_BYTE, &txn_);
+  tracker_->addAckByteEvent(2000, ByteEvent::LAST_BYTE, &txn_);
+  EXPECT_EQ(tracker_->getNumPendingTimestampEvents(), 3);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 3);
+
+  auto now = SystemClock::now();
+  EXPECT_CALL(transportCallback_, trackedByteEventTX(_));
+  tracker_->onSocketTimestamp(
+      TimestampType::TX, tracker_->getTimestampKey(1000), now);
+
+  // A timestamp for an earlier, unsampled write matches nothing
+  tracker_->onSocketTimestamp(
+      TimestampType::ACK, tracker_->getTimestampKey(500), now);
+  EXPECT_EQ(tracker_->getNumPendingTimestampEvents(), 2);
+
+  // One ACK covering both offsets delivers both, in order
+  InSequence seq;
+  EXPECT_CALL(transportCallback_, trackedByteEventAck(_));
+  EXPECT_CALL(transportCallback_, lastByteAcked(_));
+  tracker_->onSocketTimestamp(TimestampType::ACK,
+                              tracker_->getTimestampKey(2000),
+                              now + std::chrono::milliseconds(5));
+  EXPECT_EQ(tracker_->getNumPendingTimestampEvents(), 0);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 0);
+  EXPECT_EQ(tracker_->getTxLatencyHistogram().computeTotalCount(), 1);
+  EXPECT_EQ(tracker_->getAckLatencyHistogram().computeTotalCount(), 2);
+}
+
+TEST_F(SocketTimestampByteEventTrackerTest, KeyWraps) {
+  makeTracker(SocketTimestampByteEventTracker::Options());
+  // Offsets either side of the 32 bit key wrapping
+  uint64_t before = (1ULL << 32) - 10;
+  uint64_t after = (1ULL << 32) + 10;
+  tracker_->addAckByteEvent(before, ByteEvent::LAST_BYTE, &txn_);
+  tracker_->addAckByteEvent(after, ByteEvent::LAST_BYTE, &txn_);
+  EXPECT_GT(tracker_->getTimestampKey(before),
+            tracker_->getTimestampKey(after));
+
+  EXPECT_CALL(transportCallback_, lastByteAcked(_)).Times(1);
+  tracker_->onSocketTimestamp(
+      TimestampType::ACK, tracker_->getTimestampKey(before), SystemClock::now());
+  EXPECT_EQ(tracker_->getNumPendingTimestampEvents(), 1);
+  EXPECT_CALL(transportCallback_, lastByteAcked(_)).Times(1);
+  tracker_->onSocketTimestamp(
+      TimestampType::ACK, tracker_->getTimestampKey(after), SystemClock::now());
+  EXPECT_EQ(tracker_->getNumPendingTimestampEvents(), 0);
+}
+
+TEST_F(SocketTimestampByteEventTrackerTest, DisableDrains) {
+  makeTracker(SocketTimestampByteEventTracker::Options());
+  tracker_->addLastByteEvent(&txn_, 100);
+  tracker_->addTxByteEvent(100, ByteEvent::LAST_BYTE, &txn_);
+  tracker_->addAckByteEvent(100, ByteEvent::LAST_BYTE, &txn_);
+  EXPECT_EQ(tracker_->disableSocketTimestampEvents(), 2);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 1);
+
+  bool cork = false;
+  bool timestampTx = false;
+  bool timestampAck = false;
+  EXPECT_EQ(tracker_->preSend(&cork, &timestampTx, &timestampAck, 0), 0);
+  tracker_->addAckByteEvent(200, ByteEvent::LAST_BYTE, &txn_);
+  EXPECT_EQ(tracker_->getNumPendingTimestampEvents(), 0);
+  EXPECT_EQ(tracker_->drainByteEvents(), 1);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 0);
+}
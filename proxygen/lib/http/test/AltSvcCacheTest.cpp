@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/AltSvcCache.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using namespace std::chrono;
+
+namespace {
+
+class TestAltSvcCache : public SynchronizedLruAltSvcCache {
+ public:
+  TestAltSvcCache() : SynchronizedLruAltSvcCache(10) {
+  }
+
+  void advance(seconds delta) {
+    now_ += delta;
+  }
+
+ protected:
+  system_clock::time_point now() const override {
+    return now_;
+  }
+
+ private:
+  system_clock::time_point now_{seconds(1000000)};
+};
+
+} // namespace
+
+TEST(AltSvcParseTest, Basic) {
+  system_clock::time_point now{seconds(100)};
+  auto services = parseAltSvc(
+      R"(h3=":443"; ma=3600, h2="alt.example.com:8443", h3-29=":443")", now);
+  ASSERT_EQ(services.size(), 3);
+  EXPECT_EQ(services[0].protocolId, "h3");
+  EXPECT_EQ(services[0].host, "");
+  EXPECT_EQ(services[0].port, 443);
+  EXPECT_EQ(services[0].expires, now + seconds(3600));
+  EXPECT_EQ(services[1].protocolId, "h2");
+  EXPECT_EQ(services[1].host, "alt.example.com");
+  EXPECT_EQ(services[1].port, 8443);
+  // Default max age is a day
+  EXPECT_EQ(services[1].expires, now + seconds(86400));
+  EXPECT_EQ(services[2].protocolId, "h3-29");
+}
+
+TEST(AltSvcParseTest, Malformed) {
+  system_clock::time_point now{seconds(100)};
+  // Bad ones are skipped, good ones kept
+  auto services = parseAltSvc(
+      R"(h3, h3=":0", h3=":99999", h3=":443"; ma=abc, h3="[::1]:443")", now);
+  ASSERT_EQ(services.size(), 1);
+  EXPECT_EQ(services[0].host, "::1");
+  EXPECT_TRUE(parseAltSvc("", now).empty());
+  EXPECT_TRUE(parseAltSvc("clear", now).empty());
+  EXPECT_TRUE(isAltSvcClear(" clear "));
+  // ma=0 means already expired
+  EXPECT_TRUE(parseAltSvc(R"(h3=":443"; ma=0)", now).empty());
+}
+
+TEST(AltSvcCacheTest, Lookup) {
+  TestAltSvcCache cache;
+  auto origin = AltSvcCache::originKey("www.example.com", 443);
+  EXPECT_EQ(origin, "https://www.example.com:443");
+  EXPECT_FALSE(cache.getAlternative(origin, "h3"));
+
+  cache.processAltSvc(origin, R"(h2=":443", h3=":8443"; ma=60)");
+  auto alt = cache.getAlternative(origin, "h3");
+  ASSERT_TRUE(alt);
+  EXPECT_EQ(alt->port, 8443);
+  EXPECT_FALSE(cache.getAlternative("https://other:443", "h3"));
+
+  cache.advance(seconds(61));
+  EXPECT_FALSE(cache.getAlternative(origin, "h3"));
+  EXPECT_TRUE(cache.getAlternative(origin, "h2"));
+}
+
+TEST(AltSvcCacheTest, ReplaceAndClear) {
+  TestAltSvcCache cache;
+  auto origin = AltSvcCache::originKey("www.example.com", 443);
+  cache.processAltSvc(origin, R"(h3=":443")");
+  cache.processAltSvc(origin, R"(h2=":443")");
+  EXPECT_FALSE(cache.getAlternative(origin, "h3"));
+  EXPECT_TRUE(cache.getAlternative(origin, "h2"));
+
+  // Garbage is ignored rather than clearing
+  cache.processAltSvc(origin, "garbage");
+  EXPECT_TRUE(cache.getAlternative(origin, "h2"));
+
+  cache.processAltSvc(origin, "clear");
+  EXPECT_FALSE(cache.getAlternative(origin, "h2"));
+}
+
+TEST(AltSvcCacheTest, BrokenBackoff) {
+  TestAltSvcCache cache;
+  cache.setBrokenBackoff(seconds(10), seconds(25));
+  auto origin = AltSvcCache::originKey("www.example.com", 443);
+  cache.processAltSvc(origin, R"(h3=":443")");
+
+  cache.markBroken(origin, "h3");
+  EXPECT_TRUE(cache.isBroken(origin, "h3"));
+  EXPECT_FALSE(cache.getAlternative(origin, "h3"));
+  cache.advance(seconds(10));
+  EXPECT_FALSE(cache.isBroken(origin, "h3"));
+  EXPECT_TRUE(cache.getAlternative(origin, "h3"));
+
+  // A second failure doubles the backoff
+  cache.markBroken(origin, "h3");
+  cache.advance(seconds(19));
+  EXPECT_TRUE(cache.isBroken(origin, "h3"));
+  cache.advance(seconds(1));
+  EXPECT_FALSE(cache.isBroken(origin, "h3"));
+
+  // Capped at the max
+  cache.markBroken(origin, "h3");
+  cache.advance(seconds(25));
+  EXPECT_FALSE(cache.isBroken(origin, "h3"));
+
+  // A new advertisement does not clear brokenness
+  cache.markBroken(origin, "h3");
+  cache.processAltSvc(origin, R"(h3=":443")");
+  EXPECT_FALSE(cache.getAlternative(origin, "h3"));
+
+  // Success does, and resets the backoff
+  cache.markWorking(origin, "h3");
+  EXPECT_TRUE(cache.getAlternative(origin, "h3"));
+  cache.markBroken(origin, "h3");
+  cache.advance(seconds(10));
+  EXPECT_FALSE(cache.isBroken(origin, "h3"));
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/EarlyDataPolicy.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using namespace std::chrono;
+
+namespace {
+
+class TestEarlyDataPolicy : public EarlyDataPolicy {
+ public:
+  explicit TestEarlyDataPolicy(Options options)
+      : EarlyDataPolicy(std::move(options)) {
+  }
+
+  void advance(milliseconds delta) {
+    now_ += delta;
+  }
+
+ protected:
+  TimePoint now() const override {
+    return now_;
+  }
+
+ private:
+  TimePoint now_{seconds(1000)};
+};
+
+HTTPMessage makeRequest(HTTPMethod method,
+                        const std::string& url,
+                        bool earlyData = true) {
+  HTTPMessage request;
+  request.setMethod(method);
+  request.setURL(url);
+  request.getHeaders().add(HTTP_HEADER_HOST, "www.example.com");
+  request.setEarlyData(earlyData);
+  return request;
+}
+
+} // namespace
+
+TEST(EarlyDataPolicyTest, IsEarlyData) {
+  auto request = makeRequest(HTTPMethod::GET, "/", false);
+  EXPECT_FALSE(EarlyDataPolicy::isEarlyData(request));
+  request.getHeaders().add("Early-Data", "1");
+  EXPECT_TRUE(EarlyDataPolicy::isEarlyData(request));
+  EXPECT_TRUE(EarlyDataPolicy::isEarlyData(makeRequest(HTTPMethod::GET, "/")));
+
+  // Copies keep the flag
+  HTTPMessage copy(makeRequest(HTTPMethod::GET, "/"));
+  EXPECT_TRUE(copy.isEarlyData());
+}
+
+TEST(EarlyDataPolicyTest, CanSendInEarlyData) {
+  EXPECT_TRUE(EarlyDataPolicy::canSendInEarlyData(
+      makeRequest(HTTPMethod::GET, "/")));
+  EXPECT_TRUE(EarlyDataPolicy::canSendInEarlyData(
+      makeRequest(HTTPMethod::HEAD, "/")));
+  EXPECT_FALSE(EarlyDataPolicy::canSendInEarlyData(
+      makeRequest(HTTPMethod::POST, "/")));
+  EXPECT_FALSE(EarlyDataPolicy::canSendInEarlyData(
+      makeRequest(HTTPMethod::PUT, "/")));
+}
+
+TEST(EarlyDataPolicyTest, MethodsAndPaths) {
+  EarlyDataPolicy::Options options;
+  options.pathPrefixes = {"/static/", "/api/read"};
+  EarlyDataPolicy policy(options);
+
+  EXPECT_TRUE(policy.shouldProcess(makeRequest(HTTPMethod::GET, "/static/a")));
+  EXPECT_TRUE(
+      policy.shouldProcess(makeRequest(HTTPMethod::GET, "/api/read?x=1")));
+  EXPECT_FALSE(policy.shouldProcess(makeRequest(HTTPMethod::GET, "/")));
+  EXPECT_FALSE(
+      policy.shouldProcess(makeRequest(HTTPMethod::POST, "/static/a")));
+
+  // Anything goes after the handshake
+  EXPECT_TRUE(policy.shouldProcess(makeRequest(HTTPMethod::POST, "/", false)));
+}
+
+TEST(EarlyDataPolicyTest, AntiReplay) {
+  EarlyDataPolicy::Options options;
+  options.methods = {HTTPMethod::GET, HTTPMethod::POST};
+  options.antiReplayWindow = seconds(10);
+  TestEarlyDataPolicy policy(options);
+
+  auto post = makeRequest(HTTPMethod::POST, "/api/like");
+  EXPECT_TRUE(policy.shouldProcess(post, "conn1"));
+  // A replay within the window is refused
+  EXPECT_FALSE(policy.shouldProcess(post, "conn1"));
+  // A different context or request is not a replay
+  EXPECT_TRUE(policy.shouldProcess(post, "conn2"));
+  auto other = makeRequest(HTTPMethod::POST, "/api/like");
+  other.getHeaders().add(HTTP_HEADER_COOKIE, "id=2");
+  EXPECT_TRUE(policy.shouldProcess(other, "conn1"));
+
+  policy.advance(seconds(10));
+  EXPECT_TRUE(policy.shouldProcess(post, "conn1"));
+
+  // Safe methods are not tracked
+  auto get = makeRequest(HTTPMethod::GET, "/");
+  EXPECT_TRUE(policy.shouldProcess(get));
+  EXPECT_TRUE(policy.shouldProcess(get));
+}
@@ -8,6 +8,7 @@
 
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
+#include <proxygen/lib/http/HTTPHeaders.h>
 
 using namespace proxygen;
 
@@ -84,3 +85,55 @@ TEST_F(HTTPCommonHeadersTests, TestGetHeaderCodeFromTableCommonHeaderName) {
               HTTPCommonHeaders::getCodeFromTableName(
                   &externalHeader, HTTPCommonHeaderTableType::TABLE_CAMELCASE));
 }
+
+TEST_F(HTTPCommonHeadersTests, TestCustomNames) {
+  auto code = HTTPCommonHeaders::registerCustomName("X-Custom-Trace-Id");
+  ASSERT_NE(code, HTTP_HEADER_OTHER);
+  EXPECT_TRUE(HTTPCommonHeaders::isCustomCode(code));
+  EXPECT_GE(HTTPCommonHeaders::numCustomCodes(), 1);
+
+  // Registration is idempotent and ignores case, generated names keep their
+  // code
+  EXPECT_EQ(HTTPCommonHeaders::registerCustomName("x-custom-trace-id"), code);
+  EXPECT_EQ(HTTPCommonHeaders::registerCustomName("Content-Length"),
+            HTTP_HEADER_CONTENT_LENGTH);
+  EXPECT_FALSE(HTTPCommonHeaders::isCustomCode(HTTP_HEADER_CONTENT_LENGTH));
+  EXPECT_EQ(HTTPCommonHeaders::registerCustomName(""), HTTP_HEADER_OTHER);
+  EXPECT_EQ(HTTPCommonHeaders::registerCustomName("bad name"),
+            HTTP_HEADER_OTHER);
+
+  EXPECT_EQ(HTTPCommonHeaders::hash("X-CUSTOM-TRACE-ID"), code);
+  EXPECT_EQ(HTTPCommonHeaders::hash("X-Custom-Trace-I"), HTTP_HEADER_OTHER);
+  EXPECT_EQ(*HTTPCommonHeaders::getPointerToName(code), "X-Custom-Trace-Id");
+  auto lowercase = HTTPCommonHeaders::getPointerToName(
+      code, HTTPCommonHeaderTableType::TABLE_LOWERCASE);
+  EXPECT_EQ(*lowercase, "x-custom-trace-id");
+  EXPECT_TRUE(HTTPCommonHeaders::isNameFromTable(
+      lowercase, HTTPCommonHeaderTableType::TABLE_LOWERCASE));
+  EXPECT_EQ(HTTPCommonHeaders::getCodeFromTableName(
+                lowercase, HTTPCommonHeaderTableType::TABLE_LOWERCASE),
+            code);
+}
+
+TEST_F(HTTPCommonHeadersTests, TestCustomNamesInHeaders) {
+  auto code = HTTPCommonHeaders::registerCustomName("X-Custom-Route");
+  ASSERT_NE(code, HTTP_HEADER_OTHER);
+
+  HTTPHeaders headers;
+  headers.add("x-custom-route", "a");
+  headers.add(code, "b");
+  EXPECT_TRUE(headers.exists(code));
+  EXPECT_EQ(headers.getNumberOfValues(code), 2);
+  EXPECT_EQ(headers.getNumberOfValues("X-CUSTOM-ROUTE"), 2);
+  headers.forEachWithCode([&](HTTPHeaderCode c,
+                              const std::string& name,
+                              const std::string& /*value*/) {
+    EXPECT_EQ(c, code);
+    EXPECT_EQ(name, "X-Custom-Route");
+  });
+
+  HTTPHeaders copy(headers);
+  EXPECT_TRUE(headers.remove(code));
+  EXPECT_FALSE(headers.exists("X-Custom-Route"));
+  EXPECT_EQ(copy.getNumberOfValues(code), 2);
+}
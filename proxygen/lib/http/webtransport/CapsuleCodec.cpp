@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/webtransport/CapsuleCodec.h>
+
+#include <folly/Conv.h>
+#include <glog/logging.h>
+#include <initializer_list>
+
+using folly::IOBuf;
+using folly::IOBufQueue;
+using folly::io::Cursor;
+
+namespace {
+
+constexpr uint64_t kMaxVarint = (uint64_t(1) << 62) - 1;
+
+// Writes the capsule type and length in front of payloadLength bytes
+size_t writeCapsuleHeader(IOBufQueue& out,
+                          proxygen::CapsuleType type,
+                          uint64_t payloadLength) {
+  return proxygen::encodeVarint(static_cast<uint64_t>(type), out) +
+         proxygen::encodeVarint(payloadLength, out);
+}
+
+// A capsule whose payload is a list of varints
+size_t writeVarintCapsule(IOBufQueue& out,
+                          proxygen::CapsuleType type,
+                          std::initializer_list<uint64_t> values) {
+  uint64_t payloadLength = 0;
+  for (auto value : values) {
+    payloadLength += proxygen::getVarintSize(value);
+  }
+  auto written = writeCapsuleHeader(out, type, payloadLength);
+  for (auto value : values) {
+    written += proxygen::encodeVarint(value, out);
+  }
+  return written;
+}
+
+} // namespace
+
+namespace proxygen {
+
+folly::Optional<std::pair<uint64_t, size_t>> decodeVarint(Cursor& cursor) {
+  if (!cursor.canAdvance(1)) {
+    return folly::none;
+  }
+  uint8_t first = cursor.read<uint8_t>();
+  size_t length = size_t(1) << (first >> 6);
+  uint64_t value = first & 0x3f;
+  if (!cursor.canAdvance(length - 1)) {
+    cursor.retreat(1);
+    return folly::none;
+  }
+  for (size_t i = 1; i < length; i++) {
+    value = (value << 8) | cursor.read<uint8_t>();
+  }
+  return std::make_pair(value, length);
+}
+
+size_t getVarintSize(uint64_t value) {
+  if (value < (uint64_t(1) << 6)) {
+    return 1;
+  } else if (value < (uint64_t(1) << 14)) {
+    return 2;
+  } else if (value < (uint64_t(1) << 30)) {
+    return 4;
+  } else if (value <= kMaxVarint) {
+    return 8;
+  }
+  return 0;
+}
+
+size_t encodeVarint(uint64_t value, IOBufQueue& out) {
+  auto length = getVarintSize(value);
+  folly::io::QueueAppender appender(&out, 64);
+  switch (length) {
+    case 1:
+      appender.writeBE<uint8_t>(value);
+      break;
+    case 2:
+      appender.writeBE<uint16_t>(0x4000 | value);
+      break;
+    case 4:
+      appender.writeBE<uint32_t>(0x80000000 | value);
+      break;
+    case 8:
+      appender.writeBE<uint64_t>(0xc000000000000000 | value);
+      break;
+    default:
+      LOG(DFATAL) << "Value too large for a varint: " << value;
+  }
+  return length;
+}
+
+void CapsuleCodec::onIngress(std::unique_ptr<IOBuf> data) {
+  if (error_) {
+    return;
+  }
+  ingress_.append(std::move(data));
+  while (!error_ && !ingress_.empty()) {
+    Cursor cursor(ingress_.front());
+    auto type = decodeVarint(cursor);
+    if (!type) {
+      return;
+    }
+    auto length = decodeVarint(cursor);
+    if (!length) {
+      return;
+    }
+    if (length->first > maxCapsuleSize_) {
+      onError(folly::to<std::string>("Capsule too large: ", length->first));
+      return;
+    }
+    auto headerLength = type->second + length->second;
+    if (ingress_.chainLength() < headerLength + length->first) {
+      return;
+    }
+    ingress_.trimStart(headerLength);
+    std::unique_ptr<IOBuf> payload;
+    if (length->first > 0) {
+      payload = ingress_.split(length->first);
+    } else {
+      payload = IOBuf::create(0);
+    }
+    if (!parseCapsule(static_cast<CapsuleType>(type->first),
+                      std::move(payload))) {
+      return;
+    }
+  }
+}
+
+bool CapsuleCodec::parseCapsule(CapsuleType type,
+                                std::unique_ptr<IOBuf> payload) {
+  Cursor cursor(payload.get());
+  auto payloadLength = payload->computeChainDataLength();
+  // Reads a varint, failing the capsule if it runs past the payload
+  auto readVarint = [&](uint64_t& out) {
+    auto value = decodeVarint(cursor);
+    if (!value) {
+      return false;
+    }
+    out = value->first;
+    return true;
+  };
+  // Capsules made of varints are malformed if anything follows them
+  auto atEnd = [&] { return cursor.totalLength() == 0; };
+  uint64_t streamId = 0;
+  uint64_t value = 0;
+  switch (type) {
+    case CapsuleType::DATAGRAM:
+      callback_->onDatagramCapsule(std::move(payload));
+      return true;
+    case CapsuleType::CLOSE_WEBTRANSPORT_SESSION: {
+      if (!cursor.canAdvance(sizeof(uint32_t)) ||
+          payloadLength - sizeof(uint32_t) > kMaxCloseSessionMessageSize) {
+        break;
+      }
+      auto error = cursor.readBE<uint32_t>();
+      auto message = cursor.readFixedString(cursor.totalLength());
+      callback_->onCloseSessionCapsule(error, std::move(message));
+      return true;
+    }
+    case CapsuleType::DRAIN_WEBTRANSPORT_SESSION:
+      callback_->onDrainSessionCapsule();
+      return true;
+    case CapsuleType::WT_STREAM:
+    case CapsuleType::WT_STREAM_WITH_FIN: {
+      auto id = decodeVarint(cursor);
+      if (!id) {
+        break;
+      }
+      // The rest of the payload is stream data, handed over as is
+      std::unique_ptr<IOBuf> data;
+      if (payloadLength > id->second) {
+        IOBufQueue queue{IOBufQueue::cacheChainLength()};
+        queue.append(std::move(payload));
+        queue.trimStart(id->second);
+        data = queue.move();
+      }
+      callback_->onStreamCapsule(
+          id->first, std::move(data), type == CapsuleType::WT_STREAM_WITH_FIN);
+      return true;
+    }
+    case CapsuleType::WT_RESET_STREAM:
+      if (!readVarint(streamId) || !readVarint(value) || !atEnd()) {
+        break;
+      }
+      callback_->onResetStreamCapsule(streamId, value);
+      return true;
+    case CapsuleType::WT_STOP_SENDING:
+      if (!readVarint(streamId) || !readVarint(value) || !atEnd()) {
+        break;
+      }
+      callback_->onStopSendingCapsule(streamId, value);
+      return true;
+    case CapsuleType::WT_MAX_DATA:
+      if (!readVarint(value) || !atEnd()) {
+        break;
+      }
+      callback_->onMaxDataCapsule(value);
+      return true;
+    case CapsuleType::WT_MAX_STREAM_DATA:
+      if (!readVarint(streamId) || !readVarint(value) || !atEnd()) {
+        break;
+      }
+      callback_->onMaxStreamDataCapsule(streamId, value);
+      return true;
+    case CapsuleType::WT_MAX_STREAMS_BIDI:
+    case CapsuleType::WT_MAX_STREAMS_UNI:
+      if (!readVarint(value) || !atEnd()) {
+        break;
+      }
+      callback_->onMaxStreamsCapsule(type == CapsuleType::WT_MAX_STREAMS_BIDI,
+                                     value);
+      return true;
+    case CapsuleType::WT_DATA_BLOCKED:
+      if (!readVarint(value) || !atEnd()) {
+        break;
+      }
+      callback_->onDataBlockedCapsule(value);
+      return true;
+    default:
+      VLOG(4) << "Skipping unknown capsule type="
+              << static_cast<uint64_t>(type) << " length=" << payloadLength;
+      return true;
+  }
+  onError(folly::to<std::string>("Malformed capsule type=",
+                                 static_cast<uint64_t>(type)));
+  return false;
+}
+
+void CapsuleCodec::onError(const std::string& reason) {
+  error_ = true;
+  ingress_.move();
+  callback_->onCapsuleError(reason);
+}
+
+size_t CapsuleCodec::writeDatagram(IOBufQueue& out,
+                                   std::unique_ptr<IOBuf> data) {
+  uint64_t length = data ? data->computeChainDataLength() : 0;
+  auto written = writeCapsuleHeader(out, CapsuleType::DATAGRAM, length);
+  out.append(std::move(data));
+  return written + length;
+}
+
+size_t CapsuleCodec::writeCloseSession(IOBufQueue& out,
+                                       uint32_t error,
+                                       folly::StringPiece message) {
+  if (message.size() > kMaxCloseSessionMessageSize) {
+    message = message.subpiece(0, kMaxCloseSessionMessageSize);
+  }
+  auto written = writeCapsuleHeader(out,
+                                    CapsuleType::CLOSE_WEBTRANSPORT_SESSION,
+                                    sizeof(uint32_t) + message.size());
+  folly::io::QueueAppender appender(&out, sizeof(uint32_t) + message.size());
+  appender.writeBE<uint32_t>(error);
+  appender.push(reinterpret_cast<const uint8_t*>(message.data()),
+                message.size());
+  return written + sizeof(uint32_t) + message.size();
+}
+
+size_t CapsuleCodec::writeDrainSession(IOBufQueue& out) {
+  return writeCapsuleHeader(out, CapsuleType::DRAIN_WEBTRANSPORT_SESSION, 0);
+}
+
+size_t CapsuleCodec::writeStream(IOBufQueue& out,
+                                 uint64_t streamId,
+                                 std::unique_ptr<IOBuf> data,
+                                 bool fin) {
+  uint64_t dataLength = data ? data->computeChainDataLength() : 0;
+  auto written = writeCapsuleHeader(
+      out,
+      fin ? CapsuleType::WT_STREAM_WITH_FIN : CapsuleType::WT_STREAM,
+      getVarintSize(streamId) + dataLength);
+  written += encodeVarint(streamId, out);
+  // Chain the caller's buffer in rather than copying it
+  out.append(std::move(data));
+  return written + dataLength;
+}
+
+size_t CapsuleCodec::writeResetStream(IOBufQueue& out,
+                                      uint64_t streamId,
+                                      uint64_t error) {
+  return writeVarintCapsule(
+      out, CapsuleType::WT_RESET_STREAM, {streamId, error});
+}
+
+size_t CapsuleCodec::writeStopSending(IOBufQueue& out,
+                                      uint64_t streamId,
+                                      uint64_t error) {
+  return writeVarintCapsule(
+      out, CapsuleType::WT_STOP_SENDING, {streamId, error});
+}
+
+size_t CapsuleCodec::writeMaxData(IOBufQueue& out, uint64_t maxData) {
+  return writeVarintCapsule(out, CapsuleType::WT_MAX_DATA, {maxData});
+}
+
+size_t CapsuleCodec::writeMaxStreamData(IOBufQueue& out,
+                                        uint64_t streamId,
+                                        uint64_t maxData) {
+  return writeVarintCapsule(
+      out, CapsuleType::WT_MAX_STREAM_DATA, {streamId, maxData});
+}
+
+size_t CapsuleCodec::writeMaxStreams(IOBufQueue& out,
+                                     bool bidi,
+                                     uint64_t maxStreams) {
+  return writeVarintCapsule(out,
+                            bidi ? CapsuleType::WT_MAX_STREAMS_BIDI
+                                 : CapsuleType::WT_MAX_STREAMS_UNI,
+                            {maxStreams});
+}
+
+size_t CapsuleCodec::writeDataBlocked(IOBufQueue& out, uint64_t maxData) {
+  return writeVarintCapsule(out, CapsuleType::WT_DATA_BLOCKED, {maxData});
+}
+
+} // namespace proxygen
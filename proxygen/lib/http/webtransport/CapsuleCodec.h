@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+#include <string>
+
+namespace proxygen {
+
+/**
+ * Capsules (RFC 9297) carried in the body of a WebTransport CONNECT stream.
+ * Over HTTP/2 every stream and datagram of the session travels in one
+ * (draft-ietf-webtrans-http2); over HTTP/3 only the session level capsules
+ * are used.
+ */
+enum class CapsuleType : uint64_t {
+  DATAGRAM = 0x00,
+  CLOSE_WEBTRANSPORT_SESSION = 0x2843,
+  DRAIN_WEBTRANSPORT_SESSION = 0x78ae,
+  WT_RESET_STREAM = 0x190b4d39,
+  WT_STOP_SENDING = 0x190b4d3a,
+  WT_STREAM = 0x190b4d3b,
+  WT_STREAM_WITH_FIN = 0x190b4d3c,
+  WT_MAX_DATA = 0x190b4d3d,
+  WT_MAX_STREAM_DATA = 0x190b4d3e,
+  WT_MAX_STREAMS_BIDI = 0x190b4d3f,
+  WT_MAX_STREAMS_UNI = 0x190b4d40,
+  WT_DATA_BLOCKED = 0x190b4d41,
+};
+
+// A capsule larger than this is a connection error, the parser would
+// otherwise buffer without bound waiting for it
+constexpr uint64_t kDefaultMaxCapsuleSize = 1024 * 1024;
+// The length of a CLOSE_WEBTRANSPORT_SESSION message is limited to 1024
+constexpr size_t kMaxCloseSessionMessageSize = 1024;
+
+/**
+ * QUIC variable length integers (RFC 9000, section 16), shared by capsules
+ * and the WebTransport stream prefaces. decode returns the value and its
+ * encoded length, or folly::none if the cursor is too short.
+ */
+folly::Optional<std::pair<uint64_t, size_t>> decodeVarint(
+    folly::io::Cursor& cursor);
+// Returns the encoded length, or 0 if value does not fit in 62 bits
+size_t encodeVarint(uint64_t value, folly::IOBufQueue& out);
+size_t getVarintSize(uint64_t value);
+
+/**
+ * Parses capsules out of a CONNECT stream body. Data need not arrive on
+ * capsule boundaries; partial capsules are buffered until complete.
+ * Payloads (stream data and datagrams) are split off the input without
+ * copying. Unknown capsule types are skipped, as RFC 9297 requires.
+ */
+class CapsuleCodec {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() = default;
+
+    virtual void onDatagramCapsule(std::unique_ptr<folly::IOBuf> data) = 0;
+    virtual void onCloseSessionCapsule(uint32_t error,
+                                       std::string message) = 0;
+    virtual void onDrainSessionCapsule() = 0;
+    virtual void onStreamCapsule(uint64_t streamId,
+                                 std::unique_ptr<folly::IOBuf> data,
+                                 bool fin) = 0;
+    virtual void onResetStreamCapsule(uint64_t streamId, uint64_t error) = 0;
+    virtual void onStopSendingCapsule(uint64_t streamId, uint64_t error) = 0;
+    virtual void onMaxDataCapsule(uint64_t maxData) = 0;
+    virtual void onMaxStreamDataCapsule(uint64_t /*streamId*/,
+                                        uint64_t /*maxData*/) {
+    }
+    virtual void onMaxStreamsCapsule(bool /*bidi*/, uint64_t /*maxStreams*/) {
+    }
+    virtual void onDataBlockedCapsule(uint64_t /*maxData*/) {
+    }
+    // The input is malformed; no further capsules are parsed
+    virtual void onCapsuleError(const std::string& reason) = 0;
+  };
+
+  explicit CapsuleCodec(Callback* callback,
+                        uint64_t maxCapsuleSize = kDefaultMaxCapsuleSize)
+      : callback_(callback), maxCapsuleSize_(maxCapsuleSize) {
+  }
+
+  /**
+   * Parses as many complete capsules as possible out of the buffered input
+   * plus data. Callbacks must not destroy the codec.
+   */
+  void onIngress(std::unique_ptr<folly::IOBuf> data);
+
+  size_t getBufferedBytes() const {
+    return ingress_.chainLength();
+  }
+
+  // Writers append one capsule to out and return its length
+  static size_t writeDatagram(folly::IOBufQueue& out,
+                              std::unique_ptr<folly::IOBuf> data);
+  static size_t writeCloseSession(folly::IOBufQueue& out,
+                                  uint32_t error,
+                                  folly::StringPiece message);
+  static size_t writeDrainSession(folly::IOBufQueue& out);
+  // data may be null for a FIN without data
+  static size_t writeStream(folly::IOBufQueue& out,
+                            uint64_t streamId,
+                            std::unique_ptr<folly::IOBuf> data,
+                            bool fin);
+  static size_t writeResetStream(folly::IOBufQueue& out,
+                                 uint64_t streamId,
+                                 uint64_t error);
+  static size_t writeStopSending(folly::IOBufQueue& out,
+                                 uint64_t streamId,
+                                 uint64_t error);
+  static size_t writeMaxData(folly::IOBufQueue& out, uint64_t maxData);
+  static size_t writeMaxStreamData(folly::IOBufQueue& out,
+                                   uint64_t streamId,
+                                   uint64_t maxData);
+  static size_t writeMaxStreams(folly::IOBufQueue& out,
+                                bool bidi,
+                                uint64_t maxStreams);
+  static size_t writeDataBlocked(folly::IOBufQueue& out, uint64_t maxData);
+
+ private:
+  // Returns false if parsing must stop
+  bool parseCapsule(CapsuleType type, std::unique_ptr<folly::IOBuf> payload);
+  void onError(const std::string& reason);
+
+  Callback* callback_;
+  uint64_t maxCapsuleSize_;
+  folly::IOBufQueue ingress_{folly::IOBufQueue::cacheChainLength()};
+  bool error_{false};
+};
+
+} // namespace proxygen
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/webtransport/CapsuleWebTransport.h>
+
+#include <limits>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+namespace proxygen {
+
+CapsuleWebTransport::CapsuleWebTransport(HTTPTransaction& txn,
+                                         Options options)
+    : WebTransportImpl(txn, options) {
+  StreamId self = txn_.isUpstream() ? 0 : 1;
+  StreamId peer = 1 - self;
+  nextStreamId_[0] = self | 0x2;
+  nextStreamId_[1] = self;
+  nextPeerStreamId_[0] = peer | 0x2;
+  nextPeerStreamId_[1] = peer;
+}
+
+uint16_t CapsuleWebTransport::getDatagramSizeLimit() const {
+  // DATAGRAM capsules are not limited by a packet size
+  return std::numeric_limits<uint16_t>::max();
+}
+
+folly::Expected<folly::Unit, WebTransport::ErrorCode>
+CapsuleWebTransport::sendDatagram(std::unique_ptr<IOBuf> datagram) {
+  if (isClosed()) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  if (datagram &&
+      datagram->computeChainDataLength() > getDatagramSizeLimit()) {
+    return folly::makeUnexpected(ErrorCode::SEND_ERROR);
+  }
+  IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeDatagram(capsule, std::move(datagram));
+  sendCapsule(capsule);
+  return folly::unit;
+}
+
+void CapsuleWebTransport::onConnectStreamWriteReady() {
+  auto blocked = std::move(blockedStreams_);
+  blockedStreams_.clear();
+  for (auto id : blocked) {
+    if (isClosed() || txn_.isEgressPaused()) {
+      // Whatever is left waits for the next resume
+      blockedStreams_.insert(id);
+      continue;
+    }
+    onStreamWriteReady(id);
+  }
+}
+
+folly::Expected<WebTransport::StreamId, WebTransport::ErrorCode>
+CapsuleWebTransport::newStream(bool bidi) {
+  if (txn_.isEgressEOMSeen()) {
+    return folly::makeUnexpected(ErrorCode::STREAM_CREATION_ERROR);
+  }
+  auto id = nextStreamId_[bidi];
+  nextStreamId_[bidi] += 4;
+  return id;
+}
+
+folly::Expected<WebTransport::FCState, WebTransport::ErrorCode>
+CapsuleWebTransport::sendStreamData(StreamId id,
+                                    std::unique_ptr<IOBuf> data,
+                                    bool fin) {
+  if (txn_.isEgressEOMSeen()) {
+    return folly::makeUnexpected(ErrorCode::SEND_ERROR);
+  }
+  IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeStream(capsule, id, std::move(data), fin);
+  sendCapsule(capsule);
+  if (txn_.isEgressPaused()) {
+    blockedStreams_.insert(id);
+    return FCState::BLOCKED;
+  }
+  return FCState::UNBLOCKED;
+}
+
+void CapsuleWebTransport::resetStreamEgress(StreamId id, uint32_t error) {
+  blockedStreams_.erase(id);
+  IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeResetStream(capsule, id, error);
+  sendCapsule(capsule);
+}
+
+void CapsuleWebTransport::stopStreamIngress(StreamId id, uint32_t error) {
+  IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeStopSending(capsule, id, error);
+  sendCapsule(capsule);
+}
+
+void CapsuleWebTransport::onStreamCapsuleImpl(StreamId id,
+                                              std::unique_ptr<IOBuf> data,
+                                              bool fin) {
+  bool bidi = isBidiStream(id);
+  if (isPeerStream(id) && id >= nextPeerStreamId_[bidi]) {
+    nextPeerStreamId_[bidi] = id + 4;
+    onNewIngressStream(id, bidi);
+  }
+  onIngressStreamData(id, std::move(data), fin);
+}
+
+void CapsuleWebTransport::onResetStreamCapsuleImpl(StreamId id,
+                                                   uint32_t error) {
+  onIngressStreamReset(id, error);
+}
+
+void CapsuleWebTransport::onStopSendingCapsuleImpl(StreamId id,
+                                                   uint32_t error) {
+  onIngressStopSending(id, error);
+}
+
+} // namespace proxygen
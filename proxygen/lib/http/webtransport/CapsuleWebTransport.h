@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/lib/http/webtransport/WebTransportImpl.h>
+
+namespace proxygen {
+
+/**
+ * A WebTransport session carried entirely in capsules on the CONNECT
+ * stream (draft-ietf-webtrans-http2). Used over HTTP/2, and over HTTP/3
+ * when the connection does not have native WebTransport enabled.
+ *
+ * All streams share the CONNECT stream, so writes report BLOCKED while the
+ * transaction's egress is paused, and ingress is only pushed back on
+ * through session flow control.
+ */
+class CapsuleWebTransport : public WebTransportImpl {
+ public:
+  explicit CapsuleWebTransport(HTTPTransaction& txn,
+                               Options options = Options());
+
+  uint16_t getDatagramSizeLimit() const override;
+  folly::Expected<folly::Unit, ErrorCode> sendDatagram(
+      std::unique_ptr<folly::IOBuf> datagram) override;
+
+  void onConnectStreamWriteReady() override;
+
+ protected:
+  folly::Expected<StreamId, ErrorCode> newStream(bool bidi) override;
+  folly::Expected<FCState, ErrorCode> sendStreamData(
+      StreamId id, std::unique_ptr<folly::IOBuf> data, bool fin) override;
+  void resetStreamEgress(StreamId id, uint32_t error) override;
+  void stopStreamIngress(StreamId id, uint32_t error) override;
+  void onSessionEnd() override {
+    blockedStreams_.clear();
+  }
+
+ private:
+  void onStreamCapsuleImpl(StreamId id,
+                           std::unique_ptr<folly::IOBuf> data,
+                           bool fin) override;
+  void onResetStreamCapsuleImpl(StreamId id, uint32_t error) override;
+  void onStopSendingCapsuleImpl(StreamId id, uint32_t error) override;
+
+  // Indexed by isBidiStream()
+  StreamId nextStreamId_[2];
+  StreamId nextPeerStreamId_[2];
+  // Streams that were told BLOCKED while the CONNECT stream was paused
+  folly::F14FastSet<StreamId> blockedStreams_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/webtransport/WebTransport.h>
+
+#include <ostream>
+
+namespace {
+
+// draft-ietf-webtrans-http3: application error codes map onto
+// [kFirst, kLast], skipping the reserved codepoints 0x1f * N + 0x21
+constexpr uint64_t kFirstErrorCode = 0x52e4a40fa8db;
+constexpr uint64_t kLastErrorCode = 0x52e5ac983162;
+
+} // namespace
+
+namespace proxygen {
+
+uint64_t WebTransport::toHTTP3ErrorCode(uint32_t error) {
+  return kFirstErrorCode + error + error / 0x1e;
+}
+
+folly::Optional<uint32_t> WebTransport::fromHTTP3ErrorCode(uint64_t code) {
+  if (code < kFirstErrorCode || code > kLastErrorCode ||
+      (code - 0x21) % 0x1f == 0) {
+    return folly::none;
+  }
+  auto shifted = code - kFirstErrorCode;
+  return static_cast<uint32_t>(shifted - shifted / 0x1f);
+}
+
+std::ostream& operator<<(std::ostream& os, WebTransport::ErrorCode error) {
+  switch (error) {
+    case WebTransport::ErrorCode::GENERIC_ERROR:
+      return os << "GENERIC_ERROR";
+    case WebTransport::ErrorCode::INVALID_STREAM_ID:
+      return os << "INVALID_STREAM_ID";
+    case WebTransport::ErrorCode::STREAM_CREATION_ERROR:
+      return os << "STREAM_CREATION_ERROR";
+    case WebTransport::ErrorCode::SEND_ERROR:
+      return os << "SEND_ERROR";
+    case WebTransport::ErrorCode::SESSION_TERMINATED:
+      return os << "SESSION_TERMINATED";
+  }
+  return os << "UNKNOWN";
+}
+
+} // namespace proxygen
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/Unit.h>
+#include <folly/io/IOBuf.h>
+#include <iosfwd>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * A WebTransport session, established by an extended CONNECT request with
+ * :protocol webtransport. Over HTTP/3 its streams are QUIC streams and its
+ * datagrams are HTTP/3 datagrams (draft-ietf-webtrans-http3); over HTTP/2,
+ * or over HTTP/3 when the peer did not enable WebTransport, everything is
+ * carried in capsules on the CONNECT stream (draft-ietf-webtrans-http2).
+ *
+ * Obtained from HTTPTransaction::getWebTransport() on the CONNECT
+ * transaction; streams the peer opens are announced to that transaction's
+ * handler. Data is passed as IOBuf chains, without copies in either
+ * direction.
+ *
+ * Handles stay valid until the stream is finished in that direction: a
+ * write handle until it is written with fin or reset, a read handle until
+ * fin or an error is delivered to its callback. All of them become invalid
+ * once the session ends.
+ */
+class WebTransport {
+ public:
+  using StreamId = uint64_t;
+
+  enum class ErrorCode : uint8_t {
+    GENERIC_ERROR,
+    INVALID_STREAM_ID,
+    STREAM_CREATION_ERROR,
+    SEND_ERROR,
+    SESSION_TERMINATED,
+  };
+
+  // Whether a writer should keep writing or wait for onStreamWriteReady
+  enum class FCState : uint8_t { BLOCKED, UNBLOCKED };
+
+  // Stream error code sent to every stream of a session that went away
+  static constexpr uint32_t kSessionGone = 0x170d7b68;
+
+  class StreamReadHandle;
+  class StreamWriteHandle;
+
+  class ReadCallback {
+   public:
+    virtual ~ReadCallback() = default;
+    // fin is set with the stream's last data, which may be null
+    virtual void onStreamData(StreamReadHandle* handle,
+                              std::unique_ptr<folly::IOBuf> data,
+                              bool fin) noexcept = 0;
+    // The peer reset the stream, or the session ended
+    virtual void onStreamError(StreamReadHandle* handle,
+                               uint32_t error) noexcept = 0;
+  };
+
+  class WriteCallback {
+   public:
+    virtual ~WriteCallback() = default;
+    // Data written after BLOCKED was returned has been sent on
+    virtual void onStreamWriteReady(StreamWriteHandle* handle) noexcept = 0;
+    // The peer asked us to stop; the stream has been reset and the handle
+    // is invalid after this returns
+    virtual void onStopSending(StreamWriteHandle* /*handle*/,
+                               uint32_t /*error*/) noexcept {
+    }
+  };
+
+  class StreamReadHandle {
+   public:
+    virtual ~StreamReadHandle() = default;
+    virtual StreamId getID() const = 0;
+    // Data received before a callback is set is buffered, and delivered
+    // from this call
+    virtual void setReadCallback(ReadCallback* callback) = 0;
+    // Stop delivering data, letting flow control push back on the peer
+    virtual void pauseReading() = 0;
+    virtual void resumeReading() = 0;
+    // Ask the peer to stop sending; invalidates the handle
+    virtual folly::Expected<folly::Unit, ErrorCode> stopSending(
+        uint32_t error) = 0;
+  };
+
+  class StreamWriteHandle {
+   public:
+    virtual ~StreamWriteHandle() = default;
+    virtual StreamId getID() const = 0;
+    virtual void setWriteCallback(WriteCallback* callback) = 0;
+    /**
+     * Queue data on the stream, closing it if fin is set. The data is always
+     * accepted; BLOCKED means the stream or session buffer is full and the
+     * caller should wait for onStreamWriteReady before writing more.
+     */
+    virtual folly::Expected<FCState, ErrorCode> writeStreamData(
+        std::unique_ptr<folly::IOBuf> data, bool fin) = 0;
+    // Abandon the stream; invalidates the handle
+    virtual folly::Expected<folly::Unit, ErrorCode> resetStream(
+        uint32_t error) = 0;
+  };
+
+  struct BidiStreamHandle {
+    StreamReadHandle* readHandle{nullptr};
+    StreamWriteHandle* writeHandle{nullptr};
+  };
+
+  virtual ~WebTransport() = default;
+
+  virtual folly::Expected<StreamWriteHandle*, ErrorCode> createUniStream() = 0;
+  virtual folly::Expected<BidiStreamHandle, ErrorCode> createBidiStream() = 0;
+
+  virtual uint16_t getDatagramSizeLimit() const = 0;
+  // Datagrams are unreliable; one larger than the limit is dropped
+  virtual folly::Expected<folly::Unit, ErrorCode> sendDatagram(
+      std::unique_ptr<folly::IOBuf> datagram) = 0;
+
+  /**
+   * End the session, resetting all of its streams. The peer gets the error
+   * and message.
+   */
+  virtual folly::Expected<folly::Unit, ErrorCode> closeSession(
+      uint32_t error = 0, folly::StringPiece message = "") = 0;
+
+  /**
+   * WebTransport stream errors are 32 bits; HTTP/3 carries them in a
+   * reserved range of its 62 bit error codes.
+   */
+  static uint64_t toHTTP3ErrorCode(uint32_t error);
+  // folly::none if code is outside the WebTransport range
+  static folly::Optional<uint32_t> fromHTTP3ErrorCode(uint64_t code);
+};
+
+std::ostream& operator<<(std::ostream& os, WebTransport::ErrorCode error);
+
+} // namespace proxygen
@@ -0,0 +1,590 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/webtransport/WebTransportImpl.h>
+
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+namespace {
+
+// draft-ietf-webtrans-http2 WT_FLOW_CONTROL_ERROR
+constexpr uint32_t kFlowControlError = 0x045d4487;
+
+} // namespace
+
+namespace proxygen {
+
+class WebTransportImpl::ReadHandle : public WebTransport::StreamReadHandle {
+ public:
+  ReadHandle(WebTransportImpl& impl, StreamId id) : impl_(impl), id_(id) {
+  }
+
+  StreamId getID() const override {
+    return id_;
+  }
+
+  void setReadCallback(ReadCallback* callback) override {
+    impl_.setReadCallback(this, callback);
+  }
+
+  void pauseReading() override {
+    impl_.pauseReading(this, true);
+  }
+
+  void resumeReading() override {
+    impl_.pauseReading(this, false);
+  }
+
+  folly::Expected<folly::Unit, ErrorCode> stopSending(
+      uint32_t error) override {
+    return impl_.stopSending(this, error);
+  }
+
+  WebTransportImpl& impl_;
+  const StreamId id_;
+  ReadCallback* callback_{nullptr};
+  // Received but not yet delivered to the callback
+  IOBufQueue buffered_{IOBufQueue::cacheChainLength()};
+  bool finReceived_{false};
+  bool paused_{false};
+};
+
+class WebTransportImpl::WriteHandle : public WebTransport::StreamWriteHandle {
+ public:
+  WriteHandle(WebTransportImpl& impl, StreamId id) : impl_(impl), id_(id) {
+  }
+
+  StreamId getID() const override {
+    return id_;
+  }
+
+  void setWriteCallback(WriteCallback* callback) override {
+    callback_ = callback;
+  }
+
+  folly::Expected<FCState, ErrorCode> writeStreamData(
+      std::unique_ptr<IOBuf> data, bool fin) override {
+    return impl_.writeStreamData(this, std::move(data), fin);
+  }
+
+  folly::Expected<folly::Unit, ErrorCode> resetStream(
+      uint32_t error) override {
+    return impl_.resetStream(this, error);
+  }
+
+  WebTransportImpl& impl_;
+  const StreamId id_;
+  WriteCallback* callback_{nullptr};
+  // Written but held back by session flow control
+  IOBufQueue pending_{IOBufQueue::cacheChainLength()};
+  bool pendingFin_{false};
+  bool finQueued_{false};
+  bool finSent_{false};
+  // The transport is buffering more than it wants to
+  bool transportBlocked_{false};
+  // BLOCKED was returned, so onStreamWriteReady is owed
+  bool waitingForReady_{false};
+};
+
+WebTransportImpl::WebTransportImpl(HTTPTransaction& txn, Options options)
+    : txn_(txn), options_(options), capsuleCodec_(this) {
+  recvLimit_ = options_.sessionRecvWindow;
+  IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeMaxData(capsule, recvLimit_);
+  sendCapsule(capsule);
+}
+
+WebTransportImpl::~WebTransportImpl() = default;
+
+folly::Expected<WebTransport::StreamWriteHandle*, WebTransport::ErrorCode>
+WebTransportImpl::createUniStream() {
+  if (closed_) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  auto id = newStream(false);
+  if (id.hasError()) {
+    return folly::makeUnexpected(id.error());
+  }
+  return addWriteHandle(*id);
+}
+
+folly::Expected<WebTransport::BidiStreamHandle, WebTransport::ErrorCode>
+WebTransportImpl::createBidiStream() {
+  if (closed_) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  auto id = newStream(true);
+  if (id.hasError()) {
+    return folly::makeUnexpected(id.error());
+  }
+  return BidiStreamHandle{addReadHandle(*id), addWriteHandle(*id)};
+}
+
+folly::Expected<folly::Unit, WebTransport::ErrorCode>
+WebTransportImpl::closeSession(uint32_t error, folly::StringPiece message) {
+  if (closed_) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  HTTPTransaction::DestructorGuard g(&txn_);
+  sendCloseSession(error, message);
+  terminate(error, false);
+  return folly::unit;
+}
+
+void WebTransportImpl::sendCloseSession(uint32_t error,
+                                        folly::StringPiece message) {
+  IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeCloseSession(capsule, error, message);
+  sendCapsule(capsule);
+  if (!txn_.isEgressEOMSeen()) {
+    txn_.sendEOM();
+  }
+}
+
+void WebTransportImpl::onConnectStreamData(std::unique_ptr<IOBuf> data) {
+  HTTPTransaction::DestructorGuard g(&txn_);
+  capsuleCodec_.onIngress(std::move(data));
+}
+
+void WebTransportImpl::onConnectStreamEnd() {
+  // A FIN without CLOSE_WEBTRANSPORT_SESSION closes the session cleanly
+  HTTPTransaction::DestructorGuard g(&txn_);
+  if (!closed_ && !txn_.isEgressEOMSeen() && txn_.isEgressStarted()) {
+    txn_.sendEOM();
+  }
+  terminate(folly::none, true);
+}
+
+void WebTransportImpl::onConnectStreamError() {
+  HTTPTransaction::DestructorGuard g(&txn_);
+  terminate(folly::none, true);
+}
+
+void WebTransportImpl::onConnectHeadersSent() {
+  if (!pendingCapsules_.empty() && !txn_.isEgressEOMSeen()) {
+    txn_.sendBody(pendingCapsules_.move());
+  }
+}
+
+bool WebTransportImpl::isConnectStreamWritable() const {
+  return txn_.isEgressStarted() && !txn_.isEgressEOMSeen();
+}
+
+void WebTransportImpl::sendCapsule(IOBufQueue& capsule) {
+  if (txn_.isEgressEOMSeen()) {
+    capsule.move();
+    return;
+  }
+  if (!txn_.isEgressStarted()) {
+    pendingCapsules_.append(capsule.move());
+    return;
+  }
+  txn_.sendBody(capsule.move());
+}
+
+bool WebTransportImpl::isPeerStream(StreamId id) const {
+  return (id & 0x1) == (txn_.isUpstream() ? 1 : 0);
+}
+
+void WebTransportImpl::terminate(folly::Optional<uint32_t> error,
+                                 bool notify) {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  sessionBlocked_.clear();
+  auto readHandles = std::move(readHandles_);
+  auto writeHandles = std::move(writeHandles_);
+  readHandles_.clear();
+  writeHandles_.clear();
+  for (auto& it : writeHandles) {
+    resetStreamEgress(it.first, kSessionGone);
+  }
+  for (auto& it : readHandles) {
+    if (!it.second->finReceived_) {
+      stopStreamIngress(it.first, kSessionGone);
+    }
+  }
+  onSessionEnd();
+  if (!notify) {
+    return;
+  }
+  for (auto& it : readHandles) {
+    if (it.second->callback_) {
+      it.second->callback_->onStreamError(it.second.get(), kSessionGone);
+    }
+  }
+  auto handler = txn_.getHandler();
+  if (handler) {
+    handler->onWebTransportSessionClose(error);
+  }
+}
+
+WebTransportImpl::ReadHandle* WebTransportImpl::addReadHandle(StreamId id) {
+  auto handle = std::make_unique<ReadHandle>(*this, id);
+  auto ptr = handle.get();
+  readHandles_[id] = std::move(handle);
+  return ptr;
+}
+
+WebTransportImpl::WriteHandle* WebTransportImpl::addWriteHandle(StreamId id) {
+  auto handle = std::make_unique<WriteHandle>(*this, id);
+  auto ptr = handle.get();
+  writeHandles_[id] = std::move(handle);
+  return ptr;
+}
+
+void WebTransportImpl::onNewIngressStream(StreamId id, bool bidi) {
+  if (closed_) {
+    return;
+  }
+  auto readHandle = addReadHandle(id);
+  auto handler = txn_.getHandler();
+  if (bidi) {
+    auto writeHandle = addWriteHandle(id);
+    if (handler) {
+      handler->onWebTransportBidiStream(
+          id, BidiStreamHandle{readHandle, writeHandle});
+    }
+  } else if (handler) {
+    handler->onWebTransportUniStream(id, readHandle);
+  }
+}
+
+void WebTransportImpl::setReadCallback(ReadHandle* handle,
+                                       ReadCallback* callback) {
+  handle->callback_ = callback;
+  deliverIngress(handle->id_);
+}
+
+void WebTransportImpl::pauseReading(ReadHandle* handle, bool paused) {
+  if (handle->paused_ == paused) {
+    return;
+  }
+  handle->paused_ = paused;
+  auto id = handle->id_;
+  if (!handle->finReceived_) {
+    pauseStreamIngress(id, paused);
+  }
+  if (!paused) {
+    deliverIngress(id);
+  }
+}
+
+folly::Expected<folly::Unit, WebTransport::ErrorCode>
+WebTransportImpl::stopSending(ReadHandle* handle, uint32_t error) {
+  if (closed_) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  auto id = handle->id_;
+  auto it = readHandles_.find(id);
+  if (it == readHandles_.end() || it->second.get() != handle) {
+    return folly::makeUnexpected(ErrorCode::INVALID_STREAM_ID);
+  }
+  if (!handle->finReceived_) {
+    stopStreamIngress(id, error);
+  }
+  auto unread = handle->buffered_.chainLength();
+  readHandles_.erase(it);
+  onIngressConsumed(unread);
+  return folly::unit;
+}
+
+void WebTransportImpl::onIngressStreamData(StreamId id,
+                                           std::unique_ptr<IOBuf> data,
+                                           bool fin) {
+  if (closed_) {
+    return;
+  }
+  uint64_t length = data ? data->computeChainDataLength() : 0;
+  bytesReceived_ += length;
+  if (bytesReceived_ > recvLimit_) {
+    VLOG(3) << "WebTransport session flow control error, received="
+            << bytesReceived_ << " limit=" << recvLimit_;
+    HTTPTransaction::DestructorGuard g(&txn_);
+    sendCloseSession(kFlowControlError, "flow control error");
+    terminate(kFlowControlError, true);
+    return;
+  }
+  auto it = readHandles_.find(id);
+  if (it == readHandles_.end()) {
+    // Stopped by the application; the data counts as consumed
+    VLOG(4) << "Discarding data for WebTransport stream id=" << id;
+    onIngressConsumed(length);
+    return;
+  }
+  auto handle = it->second.get();
+  handle->buffered_.append(std::move(data));
+  handle->finReceived_ |= fin;
+  deliverIngress(id);
+}
+
+void WebTransportImpl::deliverIngress(StreamId id) {
+  auto it = readHandles_.find(id);
+  if (it == readHandles_.end()) {
+    return;
+  }
+  auto handle = it->second.get();
+  if (!handle->callback_ || handle->paused_ ||
+      (handle->buffered_.empty() && !handle->finReceived_)) {
+    return;
+  }
+  auto data = handle->buffered_.move();
+  uint64_t length = data ? data->computeChainDataLength() : 0;
+  bool fin = handle->finReceived_;
+  auto callback = handle->callback_;
+  HTTPTransaction::DestructorGuard g(&txn_);
+  onIngressConsumed(length);
+  if (fin) {
+    // Keep the handle alive for the callback, but out of the map so it
+    // is invalid to the application afterwards
+    auto owned = std::move(it->second);
+    readHandles_.erase(id);
+    callback->onStreamData(owned.get(), std::move(data), true);
+  } else {
+    callback->onStreamData(handle, std::move(data), false);
+  }
+}
+
+void WebTransportImpl::onIngressConsumed(uint64_t bytes) {
+  bytesConsumed_ += bytes;
+  auto threshold = options_.sessionRecvWindow / 2;
+  if (closed_ || (bytesConsumed_ < recvLimit_ &&
+                  recvLimit_ - bytesConsumed_ > threshold)) {
+    return;
+  }
+  // Grant another window once half of the current one is used
+  recvLimit_ = bytesConsumed_ + options_.sessionRecvWindow;
+  IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeMaxData(capsule, recvLimit_);
+  sendCapsule(capsule);
+}
+
+void WebTransportImpl::onIngressStreamReset(StreamId id, uint32_t error) {
+  auto it = readHandles_.find(id);
+  if (it == readHandles_.end()) {
+    return;
+  }
+  auto owned = std::move(it->second);
+  readHandles_.erase(it);
+  HTTPTransaction::DestructorGuard g(&txn_);
+  onIngressConsumed(owned->buffered_.chainLength());
+  if (owned->callback_) {
+    owned->callback_->onStreamError(owned.get(), error);
+  }
+}
+
+void WebTransportImpl::onIngressStopSending(StreamId id, uint32_t error) {
+  auto it = writeHandles_.find(id);
+  if (it == writeHandles_.end()) {
+    return;
+  }
+  auto owned = std::move(it->second);
+  writeHandles_.erase(it);
+  sessionBlocked_.erase(id);
+  HTTPTransaction::DestructorGuard g(&txn_);
+  resetStreamEgress(id, error);
+  if (owned->callback_) {
+    owned->callback_->onStopSending(owned.get(), error);
+  }
+}
+
+folly::Expected<WebTransport::FCState, WebTransport::ErrorCode>
+WebTransportImpl::writeStreamData(WriteHandle* handle,
+                                  std::unique_ptr<IOBuf> data,
+                                  bool fin) {
+  if (closed_) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  auto id = handle->id_;
+  auto it = writeHandles_.find(id);
+  if (it == writeHandles_.end() || it->second.get() != handle ||
+      handle->finQueued_) {
+    return folly::makeUnexpected(ErrorCode::INVALID_STREAM_ID);
+  }
+  handle->pending_.append(std::move(data));
+  handle->pendingFin_ = fin;
+  handle->finQueued_ = fin;
+  auto res = flushStream(handle);
+  if (res.hasError() || handle->finSent_) {
+    writeHandles_.erase(id);
+    sessionBlocked_.erase(id);
+    return res;
+  }
+  if (*res == FCState::BLOCKED) {
+    handle->waitingForReady_ = true;
+  }
+  return res;
+}
+
+folly::Expected<WebTransport::FCState, WebTransport::ErrorCode>
+WebTransportImpl::flushStream(WriteHandle* handle) {
+  auto id = handle->id_;
+  uint64_t length = handle->pending_.chainLength();
+  uint64_t credit = length;
+  if (sendLimit_) {
+    credit = *sendLimit_ > bytesSent_ ? *sendLimit_ - bytesSent_ : 0;
+  }
+  auto toSend = std::min(length, credit);
+  bool fin = handle->pendingFin_ && toSend == length;
+  if (toSend < length) {
+    sessionBlocked_.insert(id);
+    if (dataBlockedSentAt_ != sendLimit_) {
+      dataBlockedSentAt_ = sendLimit_;
+      IOBufQueue capsule{IOBufQueue::cacheChainLength()};
+      CapsuleCodec::writeDataBlocked(capsule, *sendLimit_);
+      sendCapsule(capsule);
+    }
+  } else {
+    sessionBlocked_.erase(id);
+  }
+  if (toSend > 0 || fin) {
+    std::unique_ptr<IOBuf> data;
+    if (toSend > 0) {
+      data = handle->pending_.split(toSend);
+    }
+    bytesSent_ += toSend;
+    auto res = sendStreamData(id, std::move(data), fin);
+    if (res.hasError()) {
+      return res;
+    }
+    if (fin) {
+      handle->pendingFin_ = false;
+      handle->finSent_ = true;
+    }
+    if (*res == FCState::BLOCKED) {
+      handle->transportBlocked_ = true;
+    }
+  }
+  return (handle->transportBlocked_ || !handle->pending_.empty())
+             ? FCState::BLOCKED
+             : FCState::UNBLOCKED;
+}
+
+void WebTransportImpl::onStreamWriteReady(StreamId id) {
+  auto it = writeHandles_.find(id);
+  if (it != writeHandles_.end()) {
+    it->second->transportBlocked_ = false;
+    resumeStream(it->second.get());
+  }
+}
+
+void WebTransportImpl::resumeStream(WriteHandle* handle) {
+  auto id = handle->id_;
+  if (!handle->pending_.empty()) {
+    auto res = flushStream(handle);
+    if (res.hasError() || handle->finSent_) {
+      writeHandles_.erase(id);
+      sessionBlocked_.erase(id);
+      return;
+    }
+  }
+  if (handle->transportBlocked_ || !handle->pending_.empty()) {
+    return;
+  }
+  if (handle->waitingForReady_ && handle->callback_) {
+    handle->waitingForReady_ = false;
+    HTTPTransaction::DestructorGuard g(&txn_);
+    handle->callback_->onStreamWriteReady(handle);
+  }
+}
+
+folly::Expected<folly::Unit, WebTransport::ErrorCode>
+WebTransportImpl::resetStream(WriteHandle* handle, uint32_t error) {
+  if (closed_) {
+    return folly::makeUnexpected(ErrorCode::SESSION_TERMINATED);
+  }
+  auto id = handle->id_;
+  auto it = writeHandles_.find(id);
+  if (it == writeHandles_.end() || it->second.get() != handle) {
+    return folly::makeUnexpected(ErrorCode::INVALID_STREAM_ID);
+  }
+  writeHandles_.erase(it);
+  sessionBlocked_.erase(id);
+  resetStreamEgress(id, error);
+  return folly::unit;
+}
+
+void WebTransportImpl::onDatagramCapsule(std::unique_ptr<IOBuf> data) {
+  auto handler = txn_.getHandler();
+  if (handler && !closed_) {
+    handler->onDatagram(std::move(data));
+  }
+}
+
+void WebTransportImpl::onCloseSessionCapsule(uint32_t error,
+                                             std::string message) {
+  VLOG(4) << "WebTransport session closed by peer, error=" << error
+          << " message=" << message;
+  if (closed_) {
+    return;
+  }
+  if (!txn_.isEgressEOMSeen() && txn_.isEgressStarted()) {
+    txn_.sendEOM();
+  }
+  terminate(error, true);
+}
+
+void WebTransportImpl::onDrainSessionCapsule() {
+  // The peer wants the session wound down; the application decides when
+  VLOG(4) << "WebTransport session drain requested by peer";
+}
+
+void WebTransportImpl::onStreamCapsule(StreamId id,
+                                       std::unique_ptr<IOBuf> data,
+                                       bool fin) {
+  if (!closed_) {
+    onStreamCapsuleImpl(id, std::move(data), fin);
+  }
+}
+
+void WebTransportImpl::onResetStreamCapsule(StreamId id, uint64_t error) {
+  if (!closed_) {
+    onResetStreamCapsuleImpl(id, static_cast<uint32_t>(error));
+  }
+}
+
+void WebTransportImpl::onStopSendingCapsule(StreamId id, uint64_t error) {
+  if (!closed_) {
+    onStopSendingCapsuleImpl(id, static_cast<uint32_t>(error));
+  }
+}
+
+void WebTransportImpl::onMaxDataCapsule(uint64_t maxData) {
+  if (sendLimit_ && maxData <= *sendLimit_) {
+    return;
+  }
+  sendLimit_ = maxData;
+  // Streams are flushed in no particular order; the set is copied since
+  // flushing and the callbacks change it
+  std::vector<StreamId> blocked(sessionBlocked_.begin(),
+                                sessionBlocked_.end());
+  for (auto id : blocked) {
+    if (closed_) {
+      return;
+    }
+    auto it = writeHandles_.find(id);
+    if (it != writeHandles_.end() && sessionBlocked_.count(id) > 0) {
+      resumeStream(it->second.get());
+    }
+  }
+}
+
+void WebTransportImpl::onCapsuleError(const std::string& reason) {
+  VLOG(3) << "WebTransport capsule error: " << reason;
+  HTTPTransaction::DestructorGuard g(&txn_);
+  terminate(folly::none, true);
+  if (!txn_.isEgressEOMSeen()) {
+    txn_.sendAbort();
+  }
+}
+
+} // namespace proxygen
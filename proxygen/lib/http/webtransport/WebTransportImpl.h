@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
+#include <proxygen/lib/http/webtransport/CapsuleCodec.h>
+#include <proxygen/lib/http/webtransport/WebTransport.h>
+
+namespace proxygen {
+
+class HTTPTransaction;
+
+/**
+ * The parts of a WebTransport session that do not depend on how streams
+ * are carried: stream handles, buffering of ingress until the application
+ * reads it, session flow control, and the capsules on the CONNECT stream.
+ * Subclasses move stream data and datagrams over the actual transport.
+ *
+ * Session flow control uses WT_MAX_DATA capsules. Ingress is always held
+ * to the limit we advertise, so a peer cannot make the session buffer
+ * without bound. Egress is only limited once the peer sends one, since
+ * HTTP/3 peers are not required to implement it.
+ *
+ * Owned by the CONNECT transaction, which feeds it the stream's body and
+ * tells it when the stream ends.
+ */
+class WebTransportImpl
+    : public WebTransport
+    , private CapsuleCodec::Callback {
+ public:
+  struct Options {
+    // Bytes the peer may send across all streams ahead of the application
+    // reading them
+    uint64_t sessionRecvWindow{1024 * 1024};
+  };
+
+  WebTransportImpl(HTTPTransaction& txn, Options options);
+  ~WebTransportImpl() override;
+
+  folly::Expected<StreamWriteHandle*, ErrorCode> createUniStream() override;
+  folly::Expected<BidiStreamHandle, ErrorCode> createBidiStream() override;
+  folly::Expected<folly::Unit, ErrorCode> closeSession(
+      uint32_t error, folly::StringPiece message) override;
+
+  // The transaction now holds the session; peer streams may be announced
+  virtual void onAttached() {
+  }
+
+  // From the CONNECT transaction
+  void onConnectStreamData(std::unique_ptr<folly::IOBuf> data);
+  void onConnectStreamEnd();
+  void onConnectStreamError();
+  void onConnectHeadersSent();
+  virtual void onConnectStreamWriteReady() {
+  }
+
+  // Tears the session down; the handler hears about it only if notify
+  void terminate(folly::Optional<uint32_t> error, bool notify);
+
+  bool isClosed() const {
+    return closed_;
+  }
+
+  size_t getNumStreams() const {
+    return readHandles_.size() + writeHandles_.size();
+  }
+
+ protected:
+  /**
+   * Transport hooks. newStream allocates a stream ID; the others act on
+   * one stream. Once the session has ended they are only called to reset
+   * and stop its remaining streams, right before onSessionEnd.
+   */
+  virtual folly::Expected<StreamId, ErrorCode> newStream(bool bidi) = 0;
+  virtual folly::Expected<FCState, ErrorCode> sendStreamData(
+      StreamId id, std::unique_ptr<folly::IOBuf> data, bool fin) = 0;
+  virtual void resetStreamEgress(StreamId id, uint32_t error) = 0;
+  virtual void stopStreamIngress(StreamId id, uint32_t error) = 0;
+  virtual void pauseStreamIngress(StreamId /*id*/, bool /*paused*/) {
+  }
+  // The session is over; drop per stream transport state
+  virtual void onSessionEnd() {
+  }
+
+  // Events from the transport
+  void onNewIngressStream(StreamId id, bool bidi);
+  void onIngressStreamData(StreamId id,
+                           std::unique_ptr<folly::IOBuf> data,
+                           bool fin);
+  void onIngressStreamReset(StreamId id, uint32_t error);
+  void onIngressStopSending(StreamId id, uint32_t error);
+  void onStreamWriteReady(StreamId id);
+
+  /**
+   * Writes a capsule on the CONNECT stream. Capsules written before the
+   * CONNECT stream's headers go out are held until they do.
+   */
+  void sendCapsule(folly::IOBufQueue& capsule);
+  bool isConnectStreamWritable() const;
+
+  // Stream IDs are allocated the way QUIC does: the low bit is the
+  // initiator (0 for the client) and the next bit is set for uni streams
+  bool isPeerStream(StreamId id) const;
+  static bool isBidiStream(StreamId id) {
+    return (id & 0x2) == 0;
+  }
+
+  HTTPTransaction& txn_;
+  const Options options_;
+
+ private:
+  class ReadHandle;
+  class WriteHandle;
+
+  // CapsuleCodec::Callback
+  void onDatagramCapsule(std::unique_ptr<folly::IOBuf> data) override;
+  void onCloseSessionCapsule(uint32_t error, std::string message) override;
+  void onDrainSessionCapsule() override;
+  void onStreamCapsule(StreamId id,
+                       std::unique_ptr<folly::IOBuf> data,
+                       bool fin) override;
+  void onResetStreamCapsule(StreamId id, uint64_t error) override;
+  void onStopSendingCapsule(StreamId id, uint64_t error) override;
+  void onMaxDataCapsule(uint64_t maxData) override;
+  void onCapsuleError(const std::string& reason) override;
+
+  // Capsules that only exist on the HTTP/2 mapping go to the subclass
+  virtual void onStreamCapsuleImpl(StreamId /*id*/,
+                                   std::unique_ptr<folly::IOBuf> /*data*/,
+                                   bool /*fin*/) {
+  }
+  virtual void onResetStreamCapsuleImpl(StreamId /*id*/, uint32_t /*error*/) {
+  }
+  virtual void onStopSendingCapsuleImpl(StreamId /*id*/, uint32_t /*error*/) {
+  }
+
+  // Handle operations
+  ReadHandle* addReadHandle(StreamId id);
+  WriteHandle* addWriteHandle(StreamId id);
+  void setReadCallback(ReadHandle* handle, ReadCallback* callback);
+  void pauseReading(ReadHandle* handle, bool paused);
+  folly::Expected<folly::Unit, ErrorCode> stopSending(ReadHandle* handle,
+                                                      uint32_t error);
+  folly::Expected<FCState, ErrorCode> writeStreamData(
+      WriteHandle* handle, std::unique_ptr<folly::IOBuf> data, bool fin);
+  folly::Expected<folly::Unit, ErrorCode> resetStream(WriteHandle* handle,
+                                                      uint32_t error);
+
+  // Delivers buffered ingress on id while the reader can take it
+  void deliverIngress(StreamId id);
+  // Sends what session flow control allows of the handle's buffered data
+  folly::Expected<FCState, ErrorCode> flushStream(WriteHandle* handle);
+  // Flushes the handle and tells its writer once nothing holds it back
+  void resumeStream(WriteHandle* handle);
+  void onIngressConsumed(uint64_t bytes);
+  void sendCloseSession(uint32_t error, folly::StringPiece message);
+
+  CapsuleCodec capsuleCodec_;
+  folly::F14FastMap<StreamId, std::unique_ptr<ReadHandle>> readHandles_;
+  folly::F14FastMap<StreamId, std::unique_ptr<WriteHandle>> writeHandles_;
+  // Streams with data waiting for session flow control credit
+  folly::F14FastSet<StreamId> sessionBlocked_;
+  folly::IOBufQueue pendingCapsules_{folly::IOBufQueue::cacheChainLength()};
+
+  // Egress session flow control, none until the peer sends WT_MAX_DATA
+  folly::Optional<uint64_t> sendLimit_;
+  uint64_t bytesSent_{0};
+  // Ingress session flow control
+  uint64_t recvLimit_{0};
+  uint64_t bytesReceived_{0};
+  uint64_t bytesConsumed_{0};
+
+  // The egress limit a WT_DATA_BLOCKED capsule was last sent for
+  folly::Optional<uint64_t> dataBlockedSentAt_;
+  bool closed_{false};
+};
+
+} // namespace proxygen
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/webtransport/CapsuleCodec.h>
+
+#include <folly/portability/GTest.h>
+#include <vector>
+
+using namespace proxygen;
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+namespace {
+
+class TestCallback : public CapsuleCodec::Callback {
+ public:
+  void onDatagramCapsule(std::unique_ptr<IOBuf> data) override {
+    datagrams.push_back(data->moveToFbString().toStdString());
+  }
+  void onCloseSessionCapsule(uint32_t error, std::string message) override {
+    closeError = error;
+    closeMessage = std::move(message);
+  }
+  void onDrainSessionCapsule() override {
+    drained = true;
+  }
+  void onStreamCapsule(uint64_t streamId,
+                       std::unique_ptr<IOBuf> data,
+                       bool fin) override {
+    streamIds.push_back(streamId);
+    streamData += data ? data->moveToFbString().toStdString() : "";
+    streamFin = fin;
+  }
+  void onResetStreamCapsule(uint64_t streamId, uint64_t error) override {
+    resets.emplace_back(streamId, error);
+  }
+  void onStopSendingCapsule(uint64_t streamId, uint64_t error) override {
+    stopSendings.emplace_back(streamId, error);
+  }
+  void onMaxDataCapsule(uint64_t value) override {
+    maxData = value;
+  }
+  void onCapsuleError(const std::string& /*reason*/) override {
+    errors++;
+  }
+
+  std::vector<std::string> datagrams;
+  folly::Optional<uint32_t> closeError;
+  std::string closeMessage;
+  bool drained{false};
+  std::vector<uint64_t> streamIds;
+  std::string streamData;
+  bool streamFin{false};
+  std::vector<std::pair<uint64_t, uint64_t>> resets;
+  std::vector<std::pair<uint64_t, uint64_t>> stopSendings;
+  folly::Optional<uint64_t> maxData;
+  size_t errors{0};
+};
+
+} // namespace
+
+TEST(CapsuleCodecTest, Varint) {
+  for (uint64_t value :
+       {uint64_t(0), uint64_t(63), uint64_t(64), uint64_t(16383),
+        uint64_t(16384), uint64_t(1073741823), uint64_t(1073741824),
+        (uint64_t(1) << 62) - 1}) {
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    auto length = encodeVarint(value, queue);
+    EXPECT_EQ(length, getVarintSize(value));
+    EXPECT_EQ(queue.chainLength(), length);
+    folly::io::Cursor cursor(queue.front());
+    auto decoded = decodeVarint(cursor);
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->first, value);
+    EXPECT_EQ(decoded->second, length);
+  }
+  EXPECT_EQ(getVarintSize(uint64_t(1) << 62), 0);
+}
+
+TEST(CapsuleCodecTest, TruncatedVarint) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  encodeVarint(1073741824, queue);
+  queue.trimEnd(1);
+  folly::io::Cursor cursor(queue.front());
+  EXPECT_FALSE(decodeVarint(cursor).has_value());
+  // Nothing was consumed
+  EXPECT_EQ(cursor.getCurrentPosition(), 0);
+}
+
+TEST(CapsuleCodecTest, RoundTrip) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeDatagram(queue, IOBuf::copyBuffer("dgram"));
+  CapsuleCodec::writeStream(queue, 4, IOBuf::copyBuffer("hello"), false);
+  CapsuleCodec::writeStream(queue, 4, IOBuf::copyBuffer(" world"), true);
+  CapsuleCodec::writeResetStream(queue, 8, 17);
+  CapsuleCodec::writeStopSending(queue, 12, 19);
+  CapsuleCodec::writeMaxData(queue, 1 << 20);
+  CapsuleCodec::writeDrainSession(queue);
+  CapsuleCodec::writeCloseSession(queue, 42, "bye");
+
+  TestCallback callback;
+  CapsuleCodec codec(&callback);
+  codec.onIngress(queue.move());
+
+  ASSERT_EQ(callback.datagrams.size(), 1);
+  EXPECT_EQ(callback.datagrams[0], "dgram");
+  EXPECT_EQ(callback.streamIds, std::vector<uint64_t>({4, 4}));
+  EXPECT_EQ(callback.streamData, "hello world");
+  EXPECT_TRUE(callback.streamFin);
+  ASSERT_EQ(callback.resets.size(), 1);
+  EXPECT_EQ(callback.resets[0], std::make_pair(uint64_t(8), uint64_t(17)));
+  ASSERT_EQ(callback.stopSendings.size(), 1);
+  EXPECT_EQ(callback.stopSendings[0],
+            std::make_pair(uint64_t(12), uint64_t(19)));
+  EXPECT_EQ(callback.maxData, uint64_t(1 << 20));
+  EXPECT_TRUE(callback.drained);
+  EXPECT_EQ(callback.closeError, uint32_t(42));
+  EXPECT_EQ(callback.closeMessage, "bye");
+  EXPECT_EQ(callback.errors, 0);
+  EXPECT_EQ(codec.getBufferedBytes(), 0);
+}
+
+TEST(CapsuleCodecTest, ByteAtATime) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeStream(queue, 2, IOBuf::copyBuffer("abcdef"), true);
+  CapsuleCodec::writeMaxData(queue, 100000);
+  auto buf = queue.move();
+  buf->coalesce();
+
+  TestCallback callback;
+  CapsuleCodec codec(&callback);
+  for (size_t i = 0; i < buf->length(); i++) {
+    codec.onIngress(IOBuf::copyBuffer(buf->data() + i, 1));
+  }
+  EXPECT_EQ(callback.streamIds, std::vector<uint64_t>({2}));
+  EXPECT_EQ(callback.streamData, "abcdef");
+  EXPECT_TRUE(callback.streamFin);
+  EXPECT_EQ(callback.maxData, uint64_t(100000));
+  EXPECT_EQ(callback.errors, 0);
+}
+
+TEST(CapsuleCodecTest, StreamFinWithoutData) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeStream(queue, 6, nullptr, true);
+  TestCallback callback;
+  CapsuleCodec codec(&callback);
+  codec.onIngress(queue.move());
+  EXPECT_EQ(callback.streamIds, std::vector<uint64_t>({6}));
+  EXPECT_TRUE(callback.streamData.empty());
+  EXPECT_TRUE(callback.streamFin);
+}
+
+TEST(CapsuleCodecTest, UnknownCapsuleSkipped) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  encodeVarint(0x17, queue);
+  encodeVarint(3, queue);
+  queue.append(IOBuf::copyBuffer("xyz"));
+  CapsuleCodec::writeMaxData(queue, 7);
+  TestCallback callback;
+  CapsuleCodec codec(&callback);
+  codec.onIngress(queue.move());
+  EXPECT_EQ(callback.maxData, uint64_t(7));
+  EXPECT_EQ(callback.errors, 0);
+}
+
+TEST(CapsuleCodecTest, TooLarge) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  CapsuleCodec::writeDatagram(queue, IOBuf::copyBuffer("0123456789"));
+  TestCallback callback;
+  CapsuleCodec codec(&callback, 8);
+  codec.onIngress(queue.move());
+  EXPECT_TRUE(callback.datagrams.empty());
+  EXPECT_EQ(callback.errors, 1);
+  // Input after an error is ignored
+  CapsuleCodec::writeMaxData(queue, 7);
+  codec.onIngress(queue.move());
+  EXPECT_FALSE(callback.maxData.has_value());
+  EXPECT_EQ(callback.errors, 1);
+}
+
+TEST(CapsuleCodecTest, Malformed) {
+  // A WT_MAX_DATA capsule whose varint runs past the payload
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  encodeVarint(static_cast<uint64_t>(CapsuleType::WT_MAX_DATA), queue);
+  encodeVarint(1, queue);
+  folly::io::QueueAppender appender(&queue, 1);
+  appender.writeBE<uint8_t>(0x40);
+  TestCallback callback;
+  CapsuleCodec codec(&callback);
+  codec.onIngress(queue.move());
+  EXPECT_FALSE(callback.maxData.has_value());
+  EXPECT_EQ(callback.errors, 1);
+}
+
+TEST(CapsuleCodecTest, TrailingBytes) {
+  // Capsules made of varints may not carry anything after them
+  std::vector<std::pair<CapsuleType, size_t>> capsules{
+      {CapsuleType::WT_RESET_STREAM, 2},
+      {CapsuleType::WT_STOP_SENDING, 2},
+      {CapsuleType::WT_MAX_DATA, 1},
+      {CapsuleType::WT_MAX_STREAM_DATA, 2},
+      {CapsuleType::WT_MAX_STREAMS_BIDI, 1},
+      {CapsuleType::WT_MAX_STREAMS_UNI, 1},
+      {CapsuleType::WT_DATA_BLOCKED, 1}};
+  for (const auto& capsule : capsules) {
+    auto type = capsule.first;
+    auto numVarints = capsule.second;
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    encodeVarint(static_cast<uint64_t>(type), queue);
+    encodeVarint(numVarints + 1, queue);
+    folly::io::QueueAppender appender(&queue, numVarints + 1);
+    for (size_t i = 0; i < numVarints; i++) {
+      appender.writeBE<uint8_t>(7);
+    }
+    appender.writeBE<uint8_t>(0);
+    TestCallback callback;
+    CapsuleCodec codec(&callback);
+    codec.onIngress(queue.move());
+    EXPECT_TRUE(callback.resets.empty());
+    EXPECT_TRUE(callback.stopSendings.empty());
+    EXPECT_FALSE(callback.maxData.has_value());
+    EXPECT_EQ(callback.errors, 1) << static_cast<uint64_t>(type);
+  }
+}
+
+TEST(CapsuleCodecTest, CloseMessageTruncated) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  std::string message(kMaxCloseSessionMessageSize + 10, 'a');
+  CapsuleCodec::writeCloseSession(queue, 1, message);
+  TestCallback callback;
+  CapsuleCodec codec(&callback);
+  codec.onIngress(queue.move());
+  EXPECT_EQ(callback.closeError, uint32_t(1));
+  EXPECT_EQ(callback.closeMessage.size(), kMaxCloseSessionMessageSize);
+  EXPECT_EQ(callback.errors, 0);
+}
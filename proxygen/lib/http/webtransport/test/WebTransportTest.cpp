@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/webtransport/WebTransport.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+
+TEST(WebTransportTest, HTTP3ErrorCodeRange) {
+  EXPECT_EQ(WebTransport::toHTTP3ErrorCode(0), 0x52e4a40fa8db);
+  EXPECT_EQ(WebTransport::toHTTP3ErrorCode(0xffffffff), 0x52e5ac983162);
+}
+
+TEST(WebTransportTest, HTTP3ErrorCodeRoundTrip) {
+  for (uint32_t error : {0u, 1u, 0x1du, 0x1eu, 0x1fu, 0x3cu, 12345u,
+                         WebTransport::kSessionGone, 0xfffffffeu,
+                         0xffffffffu}) {
+    auto code = WebTransport::toHTTP3ErrorCode(error);
+    // Codes of the form 0x1f * N + 0x21 are reserved for greasing
+    EXPECT_NE((code - 0x21) % 0x1f, 0);
+    EXPECT_EQ(WebTransport::fromHTTP3ErrorCode(code), error);
+  }
+}
+
+TEST(WebTransportTest, HTTP3ErrorCodeOutsideRange) {
+  EXPECT_FALSE(WebTransport::fromHTTP3ErrorCode(0x100).has_value());
+  EXPECT_FALSE(
+      WebTransport::fromHTTP3ErrorCode(0x52e4a40fa8db - 1).has_value());
+  EXPECT_FALSE(
+      WebTransport::fromHTTP3ErrorCode(0x52e5ac983162 + 1).has_value());
+  // A greasing codepoint inside the range
+  uint64_t grease = 0x52e4a40fa8db + 0x1e;
+  ASSERT_EQ((grease - 0x21) % 0x1f, 0);
+  EXPECT_FALSE(WebTransport::fromHTTP3ErrorCode(grease).has_value());
+}
@@ -96,6 +96,15 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
    */
   int64_t writeBufferLimit{-1};
 
+  /**
+   * Egress pipelining for HTTPSession.  maxActiveWrites bounds the number of
+   * writes outstanding on the socket, and a non-zero egressNotSentLowat sets
+   * TCP_NOTSENT_LOWAT so the kernel holds little unsent data.  See
+   * HTTPSession::setMaxActiveWrites.
+   */
+  uint32_t maxActiveWrites{1};
+  uint32_t egressNotSentLowat{0};
+
   /**
    * Determines if HTTP2 ping is enabled on connection
    **/
@@ -103,6 +103,11 @@ class TestAsyncTransport
     return &writeEvents_;
   }
 
+  // Writes submitted while writes were paused, not yet completed
+  size_t getNumPendingWriteEvents() const {
+    return pendingWriteEvents_.size();
+  }
+
   uint32_t getEORCount() {
     return eorCount_;
   }
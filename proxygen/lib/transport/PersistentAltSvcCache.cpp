@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/transport/PersistentAltSvcCache.h>
+
+#include <folly/Conv.h>
+
+namespace {
+constexpr auto SERVICES = "services";
+constexpr auto BROKEN = "broken";
+constexpr auto PROTOCOL = "proto";
+constexpr auto HOST = "host";
+constexpr auto PORT = "port";
+constexpr auto EXPIRES = "expires";
+constexpr auto FAILURES = "failures";
+constexpr auto UNTIL = "until";
+
+int64_t toSeconds(std::chrono::system_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+std::chrono::system_clock::time_point fromSeconds(int64_t seconds) {
+  return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+}
+} // namespace
+
+namespace proxygen {
+
+PersistentAltSvcCache::PersistentAltSvcCache(
+    const std::string& filename, wangle::PersistentCacheConfig config)
+    : cache_(filename, std::move(config)) {
+}
+
+folly::Optional<AltSvcRecord> PersistentAltSvcCache::getRecord(
+    const std::string& origin) {
+  return cache_.get(origin);
+}
+
+void PersistentAltSvcCache::putRecord(const std::string& origin,
+                                      AltSvcRecord record) {
+  cache_.put(origin, std::move(record));
+}
+
+void PersistentAltSvcCache::removeRecord(const std::string& origin) {
+  cache_.remove(origin);
+}
+
+} // namespace proxygen
+
+namespace folly {
+
+template <>
+dynamic toDynamic(const proxygen::AltSvcRecord& record) {
+  dynamic services = dynamic::array;
+  for (const auto& service : record.services) {
+    dynamic s = dynamic::object;
+    s[PROTOCOL] = service.protocolId;
+    s[HOST] = service.host;
+    s[PORT] = service.port;
+    s[EXPIRES] = toSeconds(service.expires);
+    services.push_back(std::move(s));
+  }
+  dynamic broken = dynamic::array;
+  for (const auto& b : record.broken) {
+    dynamic entry = dynamic::object;
+    entry[PROTOCOL] = b.protocolId;
+    entry[FAILURES] = b.failures;
+    entry[UNTIL] = toSeconds(b.until);
+    broken.push_back(std::move(entry));
+  }
+  dynamic d = dynamic::object;
+  d[SERVICES] = std::move(services);
+  d[BROKEN] = std::move(broken);
+  return d;
+}
+
+template <>
+proxygen::AltSvcRecord convertTo(const dynamic& d) {
+  proxygen::AltSvcRecord record;
+  for (const auto& s : d[SERVICES]) {
+    proxygen::AltService service;
+    service.protocolId = s[PROTOCOL].asString();
+    service.host = s[HOST].asString();
+    service.port = folly::to<uint16_t>(s[PORT].asInt());
+    service.expires = fromSeconds(s[EXPIRES].asInt());
+    record.services.push_back(std::move(service));
+  }
+  for (const auto& b : d[BROKEN]) {
+    proxygen::AltSvcRecord::Broken broken;
+    broken.protocolId = b[PROTOCOL].asString();
+    broken.failures = folly::to<uint32_t>(b[FAILURES].asInt());
+    broken.until = fromSeconds(b[UNTIL].asInt());
+    record.broken.push_back(std::move(broken));
+  }
+  return record;
+}
+} // namespace folly
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/dynamic.h>
+#include <proxygen/lib/http/AltSvcCache.h>
+#include <wangle/client/persistence/FilePersistentCache.h>
+
+#include <string>
+
+namespace proxygen {
+
+/**
+ * AltSvcCache kept in a file, so advertised alternatives (and broken
+ * backoffs) survive a restart and the first connection after one can
+ * already use HTTP/3.
+ */
+class PersistentAltSvcCache : public AltSvcCache {
+ public:
+  PersistentAltSvcCache(const std::string& filename,
+                        wangle::PersistentCacheConfig config);
+
+ protected:
+  folly::Optional<AltSvcRecord> getRecord(const std::string& origin) override;
+  void putRecord(const std::string& origin, AltSvcRecord record) override;
+  void removeRecord(const std::string& origin) override;
+
+ private:
+  wangle::FilePersistentCache<std::string, AltSvcRecord> cache_;
+};
+
+} // namespace proxygen
+
+namespace folly {
+template <>
+dynamic toDynamic(const proxygen::AltSvcRecord& record);
+template <>
+proxygen::AltSvcRecord convertTo(const dynamic& d);
+} // namespace folly
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/transport/PersistentAltSvcCache.h>
+
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+
+using namespace testing;
+using namespace std::chrono;
+
+namespace proxygen { namespace test {
+
+class PersistentAltSvcCacheTest : public Test {
+ public:
+  void SetUp() override {
+    file_ = (dir_.path() / "altsvc").string();
+    createCache();
+  }
+
+  void TearDown() override {
+    cache_.reset();
+  }
+
+  void createCache() {
+    cache_.reset();
+    cache_ = std::make_unique<PersistentAltSvcCache>(
+        file_,
+        wangle::PersistentCacheConfig::Builder()
+            .setCapacity(50)
+            .setSyncInterval(seconds(1))
+            .build());
+  }
+
+  folly::test::TemporaryDirectory dir_;
+  std::string file_;
+  std::unique_ptr<PersistentAltSvcCache> cache_;
+  const std::string origin_{AltSvcCache::originKey("example.com", 443)};
+};
+
+TEST_F(PersistentAltSvcCacheTest, Serialize) {
+  AltSvcRecord record;
+  record.services.push_back(
+      {"h3", "alt.example.com", 8443, system_clock::time_point(seconds(100))});
+  record.services.push_back({"h2", "", 443, {}});
+  record.broken.push_back({"h3", 3, system_clock::time_point(seconds(200))});
+
+  auto loaded = folly::convertTo<AltSvcRecord>(folly::toDynamic(record));
+  ASSERT_EQ(loaded.services.size(), 2);
+  EXPECT_EQ(loaded.services[0].protocolId, "h3");
+  EXPECT_EQ(loaded.services[0].host, "alt.example.com");
+  EXPECT_EQ(loaded.services[0].port, 8443);
+  EXPECT_EQ(loaded.services[0].expires, record.services[0].expires);
+  EXPECT_EQ(loaded.services[1].protocolId, "h2");
+  EXPECT_EQ(loaded.services[1].host, "");
+  ASSERT_EQ(loaded.broken.size(), 1);
+  EXPECT_EQ(loaded.broken[0].protocolId, "h3");
+  EXPECT_EQ(loaded.broken[0].failures, 3);
+  EXPECT_EQ(loaded.broken[0].until, record.broken[0].until);
+}
+
+TEST_F(PersistentAltSvcCacheTest, SurvivesRestart) {
+  cache_->processAltSvc(origin_, R"(h3="alt.example.com:8443", h2=":443")");
+  cache_->markBroken(origin_, "h2");
+
+  createCache();
+
+  auto alt = cache_->getAlternative(origin_, "h3");
+  ASSERT_TRUE(alt);
+  EXPECT_EQ(alt->host, "alt.example.com");
+  EXPECT_EQ(alt->port, 8443);
+  // So does the backoff
+  EXPECT_TRUE(cache_->isBroken(origin_, "h2"));
+  EXPECT_FALSE(cache_->getAlternative(origin_, "h2"));
+  EXPECT_FALSE(cache_->getAlternative(AltSvcCache::originKey("other", 443),
+                                      "h3"));
+}
+
+TEST_F(PersistentAltSvcCacheTest, Clear) {
+  cache_->processAltSvc(origin_, R"(h3=":443")");
+  cache_->processAltSvc(origin_, "clear");
+
+  createCache();
+
+  EXPECT_FALSE(cache_->getAlternative(origin_, "h3"));
+}
+
+TEST_F(PersistentAltSvcCacheTest, CorruptedCache) {
+  cache_->processAltSvc(origin_, R"(h3=":443")");
+  cache_.reset();
+
+  folly::writeFile(std::string("HI!!!"), file_.c_str());
+
+  createCache();
+  EXPECT_FALSE(cache_->getAlternative(origin_, "h3"));
+}
+
+}} // namespace proxygen::test
@@ -8,122 +8,379 @@
 
 #include <proxygen/lib/utils/Base64.h>
 
+#include <array>
+#include <cstring>
 #include <glog/logging.h>
+#include <proxygen/lib/utils/ByteScan.h>
 
-#include <folly/Range.h>
-#include <folly/portability/OpenSSL.h>
-#include <openssl/buffer.h>
+#if FOLLY_SSE_PREREQ(2, 0) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define PROXYGEN_BASE64_SSSE3 1
+// Builds that don't target SSSE3 compile the kernels for it anyway and only
+// use them if the CPU has it
+#ifdef __SSSE3__
+#define PROXYGEN_BASE64_TARGET
+#else
+#define PROXYGEN_BASE64_TARGET __attribute__((target("ssse3")))
+#endif
+#endif
 
 namespace {
-struct BIODeleter {
- public:
-  void operator()(BIO* bio) const {
-    BIO_free_all(bio);
-  };
-};
 
-} // namespace
+constexpr char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr char kUrlAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
 
-namespace proxygen {
+constexpr uint8_t kInvalid = 0x80;
 
-// Decodes a base64url encoded string
-std::string Base64::urlDecode(const std::string& urlB64message) {
-  std::unique_ptr<BIO, BIODeleter> bio, b64;
-  uint8_t padding = (4 - urlB64message.length() % 4) % 4;
-  if (padding == 3) {
-    return std::string();
+using DecodeTable = std::array<uint8_t, 256>;
+
+constexpr DecodeTable makeDecodeTable(bool url) {
+  DecodeTable table{};
+  for (auto& value : table) {
+    value = kInvalid;
   }
+  for (uint8_t i = 0; i < 64; ++i) {
+    table[uint8_t(kAlphabet[i])] = i;
+    if (url) {
+      table[uint8_t(kUrlAlphabet[i])] = i;
+    }
+  }
+  return table;
+}
+
+constexpr DecodeTable kDecodeTable = makeDecodeTable(false);
+// base64url decoding takes either alphabet, as it did through OpenSSL
+constexpr DecodeTable kUrlDecodeTable = makeDecodeTable(true);
+
+#ifdef PROXYGEN_BASE64_SSSE3
+using namespace proxygen::bytescan;
 
-  std::string b64message(urlB64message.length() + padding, 0);
-  std::transform(urlB64message.begin(),
-                 urlB64message.end(),
-                 b64message.begin(),
-                 [](char c) {
-                   if (c == '-') {
-                     return '+';
-                   } else if (c == '_') {
-                     return '/';
-                   }
-                   return c;
-                 });
-  for (auto i = urlB64message.length(); i < urlB64message.length() + padding;
-       i++) {
-    b64message[i] = '=';
+bool haveSSSE3() {
+#ifdef __SSSE3__
+  return true;
+#else
+  static const bool supported =
+      (__builtin_cpu_init(), __builtin_cpu_supports("ssse3"));
+  return supported;
+#endif
+}
+
+/**
+ * Encodes the first 12 bytes of in to 16 characters.  The shuffle puts each
+ * 3 byte group in a 32 bit lane, the multiplies move its four 6 bit indexes
+ * into their own bytes, and a 16 entry table of offsets maps the indexes to
+ * the alphabet.  See http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+ */
+template <bool kUrl>
+PROXYGEN_BASE64_TARGET Vec encodeVec(Vec in) {
+  in = _mm_shuffle_epi8(
+      in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  auto ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                            _mm_set1_epi32(0x04000040));
+  auto bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                            _mm_set1_epi32(0x01000010));
+  auto indexes = _mm_or_si128(ac, bd);
+
+  // 0 for 'a'-'z', 1-10 for '0'-'9', 11 and 12 for the last two and 13 for
+  // 'A'-'Z'
+  auto range = _mm_subs_epu8(indexes, splat(51));
+  range = either(range, both(_mm_cmpgt_epi8(splat(26), indexes), splat(13)));
+  auto offsets = _mm_setr_epi8('a' - 26,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               '0' - 52,
+                               (kUrl ? '-' : '+') - 62,
+                               (kUrl ? '_' : '/') - 63,
+                               'A',
+                               0,
+                               0);
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indexes);
+}
+
+/**
+ * Decodes 16 characters to 12 bytes, or returns false if any of them is not
+ * in the alphabet.  Each character is classified by range and has the
+ * offset of its range added; the multiply-adds then pack each 4 indexes
+ * into a 24 bit lane, and a shuffle drops the empty bytes.
+ */
+template <bool kUrl>
+PROXYGEN_BASE64_TARGET bool decodeVec(const uint8_t* in, uint8_t* out) {
+  auto v = load(in);
+  auto upper = inRange(v, 'A', 'Z');
+  auto lower = inRange(v, 'a', 'z');
+  auto digit = inRange(v, '0', '9');
+  auto plus = eq(v, '+');
+  auto slash = eq(v, '/');
+  auto valid = either(either(upper, lower), either(digit, either(plus, slash)));
+  auto offsets = either(either(both(upper, splat(uint8_t(-'A'))),
+                               both(lower, splat(uint8_t(26 - 'a')))),
+                        either(both(digit, splat(uint8_t(52 - '0'))),
+                               either(both(plus, splat(62 - '+')),
+                                      both(slash, splat(63 - '/')))));
+  if (kUrl) {
+    auto dash = eq(v, '-');
+    auto underscore = eq(v, '_');
+    valid = either(valid, either(dash, underscore));
+    offsets = either(offsets,
+                     either(both(dash, splat(62 - '-')),
+                            both(underscore, splat(uint8_t(63 - '_')))));
+  }
+  if (firstLane(none(valid)) != kVecSize) {
+    return false;
   }
-  return decode(b64message, padding);
+  auto indexes = _mm_add_epi8(v, offsets);
+  auto packed = _mm_madd_epi16(
+      _mm_maddubs_epi16(indexes, _mm_set1_epi32(0x01400140)),
+      _mm_set1_epi32(0x00011000));
+  packed = _mm_shuffle_epi8(
+      packed,
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+  auto last =
+      static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 8)));
+  memcpy(out + 8, &last, sizeof(last));
+  return true;
 }
 
-std::string Base64::decode(const std::string& b64message, int padding) {
-  if (b64message.length() % 4 != 0 || padding >= 3) {
-    return std::string();
+// Returns the number of bytes of in encoded, a multiple of 12
+template <bool kUrl>
+PROXYGEN_BASE64_TARGET size_t encodeBlocks(folly::ByteRange in, char* out) {
+  size_t i = 0;
+  // Loads 16 bytes to encode 12
+  for (; i + kVecSize <= in.size(); i += 12, out += kVecSize) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     encodeVec<kUrl>(load(in.data() + i)));
   }
+  return i;
+}
 
-  std::unique_ptr<BIO, BIODeleter> bio, b64;
-  size_t decodeLen = b64message.length() * 3 / 4 - padding;
-  std::string result(decodeLen, '\0');
+// Returns the number of characters of in decoded, a multiple of 16.  This
+// stops before a block with a character outside the alphabet.
+template <bool kUrl>
+PROXYGEN_BASE64_TARGET size_t decodeBlocks(folly::ByteRange in, uint8_t* out) {
+  size_t i = 0;
+  for (; i + kVecSize <= in.size(); i += kVecSize, out += 12) {
+    if (!decodeVec<kUrl>(in.data() + i, out)) {
+      break;
+    }
+  }
+  return i;
+}
+#endif
 
-  bio.reset(BIO_new_mem_buf((void*)b64message.data(), -1));
-  if (!bio) {
-    return std::string();
+template <bool kUrl>
+size_t encodeImpl(folly::ByteRange in, char* out) {
+  const char* alphabet = kUrl ? kUrlAlphabet : kAlphabet;
+  auto start = out;
+  size_t i = 0;
+#ifdef PROXYGEN_BASE64_SSSE3
+  if (haveSSSE3()) {
+    i = encodeBlocks<kUrl>(in, out);
+    out += i / 12 * kVecSize;
   }
-  b64.reset(BIO_new(BIO_f_base64()));
-  if (!b64) {
-    return std::string();
+#endif
+  for (; i + 3 <= in.size(); i += 3, out += 4) {
+    uint32_t group = in[i] << 16 | in[i + 1] << 8 | in[i + 2];
+    out[0] = alphabet[group >> 18];
+    out[1] = alphabet[(group >> 12) & 0x3f];
+    out[2] = alphabet[(group >> 6) & 0x3f];
+    out[3] = alphabet[group & 0x3f];
   }
-  bio.reset(BIO_push(b64.release(), bio.release()));
+  if (i < in.size()) {
+    uint32_t group = in[i] << 16 | (i + 1 < in.size() ? in[i + 1] << 8 : 0);
+    *out++ = alphabet[group >> 18];
+    *out++ = alphabet[(group >> 12) & 0x3f];
+    if (i + 1 < in.size()) {
+      *out++ = alphabet[(group >> 6) & 0x3f];
+    } else if (!kUrl) {
+      *out++ = '=';
+    }
+    if (!kUrl) {
+      *out++ = '=';
+    }
+  }
+  return out - start;
+}
 
-  // Do not use newlines to flush buffer
-  BIO_set_flags(bio.get(), BIO_FLAGS_BASE64_NO_NL);
-  BIO_read(bio.get(), (char*)result.data(), b64message.length());
-  DCHECK_LE(result.length(), decodeLen);
-  if (result.length() < decodeLen) {
-    return std::string();
+folly::StringPiece stripPadding(folly::StringPiece in) {
+  if (in.size() % 4 == 0) {
+    for (size_t i = 0; i < 2 && in.removeSuffix('='); ++i) {
+    }
   }
+  return in;
+}
+
+template <bool kUrl>
+folly::Optional<size_t> decodeImpl(folly::StringPiece b64message,
+                                   uint8_t* out) {
+  if (!kUrl && b64message.size() % 4 != 0) {
+    return folly::none;
+  }
+  auto in = folly::ByteRange(stripPadding(b64message));
+  if (in.size() % 4 == 1) {
+    return folly::none;
+  }
+  const auto& table = kUrl ? kUrlDecodeTable : kDecodeTable;
+  auto start = out;
+  size_t i = 0;
+#ifdef PROXYGEN_BASE64_SSSE3
+  if (haveSSSE3()) {
+    // The table loop below rejects the block decodeBlocks stopped at, if any
+    i = decodeBlocks<kUrl>(in, out);
+    out += i / kVecSize * 12;
+  }
+#endif
+  for (; i + 4 <= in.size(); i += 4, out += 3) {
+    uint8_t a = table[in[i]];
+    uint8_t b = table[in[i + 1]];
+    uint8_t c = table[in[i + 2]];
+    uint8_t d = table[in[i + 3]];
+    if ((a | b | c | d) & kInvalid) {
+      return folly::none;
+    }
+    uint32_t group = a << 18 | b << 12 | c << 6 | d;
+    out[0] = group >> 16;
+    out[1] = (group >> 8) & 0xff;
+    out[2] = group & 0xff;
+  }
+  if (i < in.size()) {
+    // 2 or 3 characters left.  Like OpenSSL, the unused low bits of the last
+    // one are not checked.
+    uint8_t a = table[in[i]];
+    uint8_t b = table[in[i + 1]];
+    uint8_t c = i + 2 < in.size() ? table[in[i + 2]] : 0;
+    if ((a | b | c) & kInvalid) {
+      return folly::none;
+    }
+    *out++ = a << 2 | b >> 4;
+    if (i + 2 < in.size()) {
+      *out++ = (b << 4 | c >> 2) & 0xff;
+    }
+  }
+  return out - start;
+}
+
+template <bool kUrl>
+std::string encodeToString(folly::ByteRange buffer) {
+  std::string result(kUrl ? proxygen::Base64::urlEncodedSize(buffer.size())
+                          : proxygen::Base64::encodedSize(buffer.size()),
+                     '\0');
+  auto written = encodeImpl<kUrl>(buffer, &result[0]);
+  DCHECK_EQ(written, result.size());
   return result;
 }
 
-std::string Base64::encode(folly::ByteRange buffer) {
-  std::unique_ptr<BIO, BIODeleter> bio, b64;
-  BUF_MEM* bufferPtr;
+template <bool kUrl>
+void encodeToQueue(folly::ByteRange buffer, folly::IOBufQueue& out) {
+  auto size = kUrl ? proxygen::Base64::urlEncodedSize(buffer.size())
+                   : proxygen::Base64::encodedSize(buffer.size());
+  if (size == 0) {
+    return;
+  }
+  auto space = out.preallocate(size, size);
+  out.postallocate(encodeImpl<kUrl>(buffer, static_cast<char*>(space.first)));
+}
 
-  b64.reset(BIO_new(BIO_f_base64()));
-  if (!b64) {
-    throw std::bad_alloc();
+template <bool kUrl>
+bool decodeToQueue(folly::StringPiece b64message, folly::IOBufQueue& out) {
+  auto size = proxygen::Base64::decodedSize(b64message);
+  if (size == 0) {
+    return decodeImpl<kUrl>(b64message, nullptr).has_value();
   }
-  bio.reset(BIO_new(BIO_s_mem()));
-  if (!bio) {
-    throw std::bad_alloc();
+  auto space = out.preallocate(size, size);
+  auto written =
+      decodeImpl<kUrl>(b64message, static_cast<uint8_t*>(space.first));
+  if (!written) {
+    return false;
   }
-  bio.reset(BIO_push(b64.release(), bio.release()));
+  DCHECK_EQ(*written, size);
+  out.postallocate(*written);
+  return true;
+}
+
+} // namespace
+
+namespace proxygen {
+
+size_t Base64::decodedSize(folly::StringPiece b64message) {
+  auto size = stripPadding(b64message).size();
+  return size / 4 * 3 + (size % 4 ? size % 4 - 1 : 0);
+}
 
-  // Ignore newlines - write everything in one line
-  BIO_set_flags(bio.get(), BIO_FLAGS_BASE64_NO_NL);
-  BIO_write(bio.get(), buffer.data(), buffer.size());
-  (void)BIO_flush(bio.get());
-  BIO_get_mem_ptr(bio.get(), &bufferPtr);
+size_t Base64::encode(folly::ByteRange buffer, char* out) {
+  return encodeImpl<false>(buffer, out);
+}
+
+size_t Base64::urlEncode(folly::ByteRange buffer, char* out) {
+  return encodeImpl<true>(buffer, out);
+}
+
+folly::Optional<size_t> Base64::decode(folly::StringPiece b64message,
+                                       uint8_t* out) {
+  return decodeImpl<false>(b64message, out);
+}
+
+folly::Optional<size_t> Base64::urlDecode(folly::StringPiece b64message,
+                                          uint8_t* out) {
+  return decodeImpl<true>(b64message, out);
+}
+
+void Base64::encode(folly::ByteRange buffer, folly::IOBufQueue& out) {
+  encodeToQueue<false>(buffer, out);
+}
+
+void Base64::urlEncode(folly::ByteRange buffer, folly::IOBufQueue& out) {
+  encodeToQueue<true>(buffer, out);
+}
 
-  std::string result(bufferPtr->data, bufferPtr->length);
+bool Base64::decode(folly::StringPiece b64message, folly::IOBufQueue& out) {
+  return decodeToQueue<false>(b64message, out);
+}
+
+bool Base64::urlDecode(folly::StringPiece b64message, folly::IOBufQueue& out) {
+  return decodeToQueue<true>(b64message, out);
+}
+
+// Decodes a base64url encoded string
+std::string Base64::urlDecode(const std::string& urlB64message) {
+  std::string result(decodedSize(urlB64message), '\0');
+  auto written =
+      urlDecode(urlB64message, reinterpret_cast<uint8_t*>(&result[0]));
+  if (!written) {
+    return std::string();
+  }
+  DCHECK_EQ(*written, result.size());
   return result;
 }
 
+std::string Base64::decode(const std::string& b64message, int padding) {
+  if (b64message.length() % 4 != 0 || padding < 0 || padding >= 3) {
+    return std::string();
+  }
+  std::string result(decodedSize(b64message), '\0');
+  auto written = decode(b64message, reinterpret_cast<uint8_t*>(&result[0]));
+  if (!written || *written != b64message.length() / 4 * 3 - padding) {
+    return std::string();
+  }
+  return result;
+}
+
+std::string Base64::encode(folly::ByteRange buffer) {
+  return encodeToString<false>(buffer);
+}
+
 // Encodes a binary safe base 64 string
 std::string Base64::urlEncode(folly::ByteRange buffer) {
-  std::string result = encode(buffer);
-  folly::StringPiece sp(result.data(), result.length());
-  uint8_t padding = 0;
-  std::transform(sp.begin(), sp.end(), result.begin(), [&padding](char c) {
-    if (c == '+') {
-      return '-';
-    } else if (c == '/') {
-      return '_';
-    } else if (c == '=') {
-      padding++;
-    }
-    return c;
-  });
-  DCHECK_LE(padding, result.length());
-  result.resize(result.length() - padding);
-  return result;
+  return encodeToString<true>(buffer);
 }
 
 } // namespace proxygen
@@ -8,20 +8,61 @@
 
 #pragma once
 
+#include <folly/Optional.h>
 #include <folly/Range.h>
+#include <folly/io/IOBufQueue.h>
 #include <string>
 
 namespace proxygen {
 
-// This is a wrapper around openssl base64 encoding.  It is a temporary wrapper
-// around openssl, until a more optimized version lands in folly
-
+/**
+ * Base64 (RFC 4648 section 4) and base64url (section 5) codecs.  Encoding
+ * adds '=' padding to base64 and none to base64url.  url decoding takes
+ * padded or unpadded input in either alphabet.
+ *
+ * x86 builds with GCC or Clang encode 12 bytes or decode 16 characters per
+ * step with SSSE3.  Unless the build targets SSSE3 (-mssse3 or later), the
+ * CPU is checked for it once at runtime.  Other builds, CPUs without SSSE3
+ * and the tails use a table per character.
+ *
+ * Besides the std::string versions, each codec can write to a buffer of the
+ * size given by encodedSize / urlEncodedSize / decodedSize, or append to an
+ * IOBufQueue, so large tokens don't need an extra copy.
+ */
 class Base64 {
  public:
+  // Returns an empty string if b64message is malformed or does not end with
+  // exactly padding '=' characters
   static std::string decode(const std::string& b64message, int padding);
   static std::string urlDecode(const std::string& b64message);
   static std::string encode(folly::ByteRange buffer);
   static std::string urlEncode(folly::ByteRange buffer);
+
+  static size_t encodedSize(size_t size) {
+    return (size + 2) / 3 * 4;
+  }
+
+  static size_t urlEncodedSize(size_t size) {
+    return (size * 4 + 2) / 3;
+  }
+
+  // The decoded size of a well formed b64message, in either alphabet
+  static size_t decodedSize(folly::StringPiece b64message);
+
+  // These return the number of bytes written to out
+  static size_t encode(folly::ByteRange buffer, char* out);
+  static size_t urlEncode(folly::ByteRange buffer, char* out);
+  // or nothing if b64message is malformed, leaving out partly written
+  static folly::Optional<size_t> decode(folly::StringPiece b64message,
+                                        uint8_t* out);
+  static folly::Optional<size_t> urlDecode(folly::StringPiece b64message,
+                                           uint8_t* out);
+
+  static void encode(folly::ByteRange buffer, folly::IOBufQueue& out);
+  static void urlEncode(folly::ByteRange buffer, folly::IOBufQueue& out);
+  // Appends nothing and returns false if b64message is malformed
+  static bool decode(folly::StringPiece b64message, folly::IOBufQueue& out);
+  static bool urlDecode(folly::StringPiece b64message, folly::IOBufQueue& out);
 };
 
 } // namespace proxygen
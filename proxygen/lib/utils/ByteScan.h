@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Portability.h>
+#include <folly/Range.h>
+#include <folly/lang/Bits.h>
+
+#if FOLLY_SSE_PREREQ(2, 0)
+#include <emmintrin.h>
+#define PROXYGEN_BYTESCAN_SIMD 1
+#elif FOLLY_NEON
+#include <arm_neon.h>
+#define PROXYGEN_BYTESCAN_SIMD 1
+#endif
+
+/**
+ * Building blocks for classifying bytes 16 at a time, for the scanners
+ * that run over every byte of a request such as header and URL validation
+ * and base64 decoding.  PROXYGEN_BYTESCAN_SIMD is defined where SSE2 or
+ * NEON is available; the scanners keep a byte at a time path for other
+ * targets and for tails shorter than a vector.
+ *
+ * Comparisons return vectors with all ones in the lanes where they hold
+ * and zero elsewhere.
+ */
+namespace proxygen { namespace bytescan {
+
+#ifdef PROXYGEN_BYTESCAN_SIMD
+constexpr size_t kVecSize = 16;
+
+#if FOLLY_SSE_PREREQ(2, 0)
+using Vec = __m128i;
+
+inline Vec load(const uint8_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+inline Vec splat(uint8_t c) {
+  return _mm_set1_epi8(static_cast<char>(c));
+}
+inline Vec eq(Vec v, uint8_t c) {
+  return _mm_cmpeq_epi8(v, splat(c));
+}
+// lo <= v <= hi, unsigned
+inline Vec inRange(Vec v, uint8_t lo, uint8_t hi) {
+  Vec d = _mm_sub_epi8(v, splat(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(d, splat(hi - lo)), d);
+}
+inline Vec either(Vec a, Vec b) {
+  return _mm_or_si128(a, b);
+}
+inline Vec both(Vec a, Vec b) {
+  return _mm_and_si128(a, b);
+}
+// a and not b
+inline Vec butNot(Vec a, Vec b) {
+  return _mm_andnot_si128(b, a);
+}
+inline Vec none(Vec v) {
+  return _mm_xor_si128(v, _mm_cmpeq_epi8(v, v));
+}
+// Index of the first set lane, kVecSize if there is none
+inline size_t firstLane(Vec m) {
+  auto mask = static_cast<uint32_t>(_mm_movemask_epi8(m));
+  return mask ? folly::findFirstSet(mask) - 1 : kVecSize;
+}
+#else
+using Vec = uint8x16_t;
+
+inline Vec load(const uint8_t* p) {
+  return vld1q_u8(p);
+}
+inline Vec splat(uint8_t c) {
+  return vdupq_n_u8(c);
+}
+inline Vec eq(Vec v, uint8_t c) {
+  return vceqq_u8(v, splat(c));
+}
+inline Vec inRange(Vec v, uint8_t lo, uint8_t hi) {
+  return vandq_u8(vcgeq_u8(v, splat(lo)), vcleq_u8(v, splat(hi)));
+}
+inline Vec either(Vec a, Vec b) {
+  return vorrq_u8(a, b);
+}
+inline Vec both(Vec a, Vec b) {
+  return vandq_u8(a, b);
+}
+inline Vec butNot(Vec a, Vec b) {
+  return vbicq_u8(a, b);
+}
+inline Vec none(Vec v) {
+  return vmvnq_u8(v);
+}
+inline size_t firstLane(Vec m) {
+  // Narrowing keeps 4 bits per lane, since NEON has no movemask
+  uint64_t mask = vget_lane_u64(
+      vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+  return mask ? (folly::findFirstSet(mask) - 1) / 4 : kVecSize;
+}
+#endif
+#endif
+
+/**
+ * Offset of the first byte of range that matches, or range.size().  Whole
+ * vectors are classified with matchVec and the tail with matchByte, which
+ * has to agree with it.
+ */
+template <typename MatchVec, typename MatchByte>
+size_t findFirst(folly::ByteRange range,
+                 MatchVec&& matchVec,
+                 MatchByte&& matchByte) {
+  size_t i = 0;
+#ifdef PROXYGEN_BYTESCAN_SIMD
+  for (; i + kVecSize <= range.size(); i += kVecSize) {
+    auto lane = firstLane(matchVec(load(range.data() + i)));
+    if (lane != kVecSize) {
+      return i + lane;
+    }
+  }
+#else
+  (void)matchVec;
+#endif
+  for (; i < range.size(); ++i) {
+    if (matchByte(range[i])) {
+      return i;
+    }
+  }
+  return range.size();
+}
+
+}} // namespace proxygen::bytescan
@@ -13,7 +13,7 @@
 
 namespace proxygen {
 
-// Base64 encode using openssl, may return empty string on allocation failure
+// Base64 encode, with padding
 std::string base64Encode(folly::ByteRange text);
 
 // MD5 encode using openssl
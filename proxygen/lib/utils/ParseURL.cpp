@@ -9,7 +9,9 @@
 #include <proxygen/lib/utils/ParseURL.h>
 
 #include <algorithm>
+#include <cctype>
 #include <folly/portability/Sockets.h>
+#include <proxygen/lib/utils/ByteScan.h>
 #include <proxygen/lib/utils/UtilInl.h>
 
 #include <proxygen/external/http_parser/http_parser.h>
@@ -40,18 +42,243 @@ namespace proxygen {
 
 // Helper function to check if URL has valid scheme.
 // http_parser only support full form scheme with double slash,
-// and the scheme must be all alphabetic charecter.
+// and the scheme must be all alphabetic charecter.  Since ':' is not
+// alphabetic, the first "://" has to follow the alphabetic prefix, so only
+// the scheme is scanned rather than the whole URL.
 static bool validateScheme(folly::StringPiece url) {
-  auto schemeEnd = url.find("://");
-  if (schemeEnd == std::string::npos || schemeEnd == 0) {
-    return false;
+  size_t schemeEnd = 0;
+  while (schemeEnd < url.size() &&
+         std::isalpha(static_cast<uint8_t>(url[schemeEnd]))) {
+    schemeEnd++;
   }
+  return schemeEnd > 0 && url.subpiece(schemeEnd).startsWith("://");
+}
+
+namespace {
 
-  auto scheme = url.subpiece(0, schemeEnd);
-  return std::all_of(
-      scheme.begin(), scheme.end(), [](auto _) { return std::isalpha(_); });
+struct URLScan {
+  size_t pathStart{std::string::npos};
+  size_t queryStart{std::string::npos};
+  size_t hashStart{std::string::npos};
+  bool valid{true};
+};
+
+/**
+ * One pass over a URL that is not in full form: finds the first '/', '?'
+ * and '#', and checks every byte the way validateURL does.  Vectors with
+ * none of those bytes, the bulk of most URLs, are cleared in one go.
+ */
+URLScan scanURL(folly::StringPiece url, URLValidateMode mode) {
+  URLScan scan;
+  bool strict = mode == URLValidateMode::STRICT;
+  auto invalidByte = [strict](uint8_t c) {
+    return c <= 0x20 || c == 0x7f || (c > 0x7f && strict);
+  };
+  auto found = [](size_t& pos, size_t at) {
+    if (pos == std::string::npos) {
+      pos = at;
+    }
+  };
+  auto bytes = folly::ByteRange(url);
+  size_t i = 0;
+#ifdef PROXYGEN_BYTESCAN_SIMD
+  using namespace bytescan;
+  for (; i + kVecSize <= bytes.size(); i += kVecSize) {
+    auto v = load(bytes.data() + i);
+    auto invalid = either(inRange(v, 0, 0x20), eq(v, 0x7f));
+    if (strict) {
+      invalid = either(invalid, inRange(v, 0x80, 0xff));
+    }
+    auto slash = eq(v, '/');
+    auto query = eq(v, '?');
+    auto hash = eq(v, '#');
+    auto lane = firstLane(either(either(invalid, slash), either(query, hash)));
+    if (lane == kVecSize) {
+      continue;
+    }
+    if (firstLane(invalid) != kVecSize) {
+      scan.valid = false;
+      return scan;
+    }
+    if ((lane = firstLane(slash)) != kVecSize) {
+      found(scan.pathStart, i + lane);
+    }
+    if ((lane = firstLane(query)) != kVecSize) {
+      found(scan.queryStart, i + lane);
+    }
+    if ((lane = firstLane(hash)) != kVecSize) {
+      found(scan.hashStart, i + lane);
+    }
+  }
+#endif
+  for (; i < bytes.size(); ++i) {
+    uint8_t c = bytes[i];
+    if (invalidByte(c)) {
+      scan.valid = false;
+      return scan;
+    } else if (c == '/') {
+      found(scan.pathStart, i);
+    } else if (c == '?') {
+      found(scan.queryStart, i);
+    } else if (c == '#') {
+      found(scan.hashStart, i);
+    }
+  }
+  return scan;
 }
 
+/**
+ * Output of ParseURL::normalize().  While the output matches the start of
+ * the input it is only a length; the string is built from the first byte
+ * that differs, so a URL that is already normal costs no allocation.
+ */
+class NormalizedURL {
+ public:
+  explicit NormalizedURL(folly::StringPiece in) : in_(in) {
+  }
+
+  void push(char c) {
+    if (!built_ && len_ < in_.size() && in_[len_] == c) {
+      len_++;
+      return;
+    }
+    build();
+    out_.push_back(c);
+  }
+
+  // Appends the input bytes [pos, end)
+  void copy(size_t pos, size_t end) {
+    if (!built_ && pos == len_) {
+      len_ = end;
+      return;
+    }
+    for (; pos < end; ++pos) {
+      push(in_[pos]);
+    }
+  }
+
+  size_t size() const {
+    return built_ ? out_.size() : len_;
+  }
+
+  char operator[](size_t i) const {
+    return built_ ? out_[i] : in_[i];
+  }
+
+  void truncate(size_t size) {
+    if (built_) {
+      out_.resize(size);
+    } else {
+      len_ = size;
+    }
+  }
+
+  folly::Optional<std::string> finish() {
+    if (!built_ && len_ == in_.size()) {
+      return folly::none;
+    }
+    build();
+    return std::move(out_);
+  }
+
+ private:
+  void build() {
+    if (!built_) {
+      out_.assign(in_.data(), len_);
+      built_ = true;
+    }
+  }
+
+  folly::StringPiece in_;
+  std::string out_;
+  size_t len_{0};
+  bool built_{false};
+};
+
+bool isUnreserved(uint8_t c) {
+  return std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+/**
+ * Copies [pos, end) of out's input with percent-encoding normalized:
+ * escapes of unreserved characters are decoded and the others get upper
+ * case hex digits.
+ */
+void normalizeEscapes(NormalizedURL& out,
+                      folly::StringPiece in,
+                      size_t pos,
+                      size_t end) {
+  while (pos < end) {
+    auto escape = in.find('%', pos);
+    if (escape == std::string::npos || escape >= end) {
+      out.copy(pos, end);
+      return;
+    }
+    out.copy(pos, escape);
+    pos = escape + 1;
+    if (escape + 2 >= end || !std::isxdigit(uint8_t(in[escape + 1])) ||
+        !std::isxdigit(uint8_t(in[escape + 2]))) {
+      out.push('%');
+      continue;
+    }
+    auto hi = uint8_t(std::toupper(uint8_t(in[escape + 1])));
+    auto lo = uint8_t(std::toupper(uint8_t(in[escape + 2])));
+    auto hexValue = [](uint8_t h) { return h <= '9' ? h - '0' : h - 'A' + 10; };
+    auto c = uint8_t(hexValue(hi) << 4 | hexValue(lo));
+    if (isUnreserved(c)) {
+      out.push(char(c));
+    } else {
+      out.push('%');
+      out.push(char(hi));
+      out.push(char(lo));
+    }
+    pos = escape + 3;
+  }
+}
+
+/**
+ * Copies the path [pos, end), which starts with '/', with escapes
+ * normalized and "." and ".." segments removed as in RFC 3986 5.2.4.  Each
+ * segment is written out normalized first, so "%2E" counts as a dot too.
+ */
+void normalizePath(NormalizedURL& out,
+                   folly::StringPiece in,
+                   size_t pos,
+                   size_t end) {
+  auto pathStart = out.size();
+  while (pos < end) {
+    auto segmentEnd = in.find('/', pos + 1);
+    bool last = segmentEnd == std::string::npos || segmentEnd >= end;
+    if (last) {
+      segmentEnd = end;
+    }
+    auto segmentStart = out.size();
+    out.push('/');
+    normalizeEscapes(out, in, pos + 1, segmentEnd);
+    auto segmentSize = out.size() - segmentStart - 1;
+    bool dot = segmentSize == 1 && out[segmentStart + 1] == '.';
+    bool dotDot = segmentSize == 2 && out[segmentStart + 1] == '.' &&
+                  out[segmentStart + 2] == '.';
+    if (dot || dotDot) {
+      out.truncate(segmentStart);
+      if (dotDot) {
+        // Drop the previous segment too, but never past the start of the path
+        auto parent = out.size();
+        while (parent > pathStart && out[parent - 1] != '/') {
+          parent--;
+        }
+        out.truncate(parent > pathStart ? parent - 1 : pathStart);
+      }
+      if (last) {
+        out.push('/');
+      }
+    }
+    pos = segmentEnd;
+  }
+}
+
+} // namespace
+
 void ParseURL::parse(bool strict) noexcept {
   if (url_.size() == 1 && url_[0] == '/') {
     path_ = url_;
@@ -110,17 +337,19 @@ void ParseURL::parseNonFully(bool strict) noexcept {
     return;
   }
 
-  // Check if the URL has only printable characters and no control character.
-  if (!validateURL(url_,
-                   strict ? URLValidateMode::STRICT
-                          : URLValidateMode::STRICT_COMPAT)) {
+  // Check if the URL has only printable characters and no control character,
+  // while finding where the components start.
+  auto scan = scanURL(url_,
+                      strict ? URLValidateMode::STRICT
+                             : URLValidateMode::STRICT_COMPAT);
+  if (!scan.valid) {
     valid_ = false;
     return;
   }
 
-  auto pathStart = url_.find('/');
-  auto queryStart = url_.find('?');
-  auto hashStart = url_.find('#');
+  auto pathStart = scan.pathStart;
+  auto queryStart = scan.queryStart;
+  auto hashStart = scan.hashStart;
 
   auto queryEnd = std::min(hashStart, std::string::npos);
   auto pathEnd = std::min(queryStart, hashStart);
@@ -181,6 +410,55 @@ bool ParseURL::parseAuthority() noexcept {
   }
 }
 
+folly::Optional<std::string> ParseURL::normalize() const {
+  if (!valid_) {
+    return folly::none;
+  }
+  NormalizedURL out(url_);
+  size_t pos = 0;
+  auto lowerCase = [&](folly::StringPiece piece) {
+    auto start = offsetInURL(piece);
+    out.copy(pos, start);
+    for (auto c : piece) {
+      out.push(char(std::tolower(uint8_t(c))));
+    }
+    pos = start + piece.size();
+  };
+  if (!scheme_.empty()) {
+    lowerCase(scheme_);
+  }
+  if (!host_.empty()) {
+    lowerCase(host_);
+  }
+  if (!path_.empty()) {
+    auto start = offsetInURL(path_);
+    out.copy(pos, start);
+    pos = start + path_.size();
+    if (path_.front() == '/') {
+      normalizePath(out, url_, start, pos);
+    } else {
+      normalizeEscapes(out, url_, start, pos);
+    }
+  }
+  if (!query_.empty()) {
+    auto start = offsetInURL(query_);
+    out.copy(pos, start);
+    pos = start + query_.size();
+    normalizeEscapes(out, url_, start, pos);
+  }
+  out.copy(pos, url_.size());
+  return out.finish();
+}
+
+size_t ParseURL::offsetInURL(folly::StringPiece piece) const {
+  if (piece.data() >= url_.data() && piece.data() <= url_.end()) {
+    return piece.data() - url_.data();
+  }
+  // The host of a URL that is not fully formed points into authority_, a
+  // copy of the start of url_
+  return piece.data() - authority_.data();
+}
+
 bool ParseURL::hostIsIPAddress() {
   if (!valid_) {
     return false;
@@ -153,6 +153,13 @@ class ParseURL {
   FOLLY_NODISCARD folly::Optional<folly::StringPiece> getQueryParam(
       folly::StringPiece name) const noexcept;
 
+  /* The URL in the normal form of RFC 3986 6.2.2: scheme and host in lower
+   * case, percent-encoded unreserved characters decoded, other escapes in
+   * upper case hex, and "." and ".." segments removed from the path.  Returns
+   * nothing, without allocating, when the URL is already normal or invalid.
+   */
+  FOLLY_NODISCARD folly::Optional<std::string> normalize() const;
+
  private:
   void moveHostAndAuthority(ParseURL&& goner) {
     if (!valid_) {
@@ -194,6 +201,8 @@ class ParseURL {
 
   bool parseAuthority() noexcept;
 
+  size_t offsetInURL(folly::StringPiece piece) const;
+
   folly::StringPiece url_;
   folly::StringPiece scheme_;
   std::string authority_;
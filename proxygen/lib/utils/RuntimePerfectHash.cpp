@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/RuntimePerfectHash.h>
+
+#include <folly/String.h>
+#include <glog/logging.h>
+#include <limits>
+
+namespace {
+// Seeds tried per table size before doubling it
+constexpr uint32_t kSeedAttempts = 64;
+
+inline uint8_t toLower(char c) {
+  auto u = static_cast<uint8_t>(c);
+  return (u >= 'A' && u <= 'Z') ? (u | 0x20) : u;
+}
+} // namespace
+
+namespace proxygen {
+
+RuntimePerfectHash::RuntimePerfectHash(const std::vector<std::string>& keys) {
+  CHECK_LT(keys.size(), std::numeric_limits<uint16_t>::max());
+  keys_.reserve(keys.size());
+  for (const auto& key : keys) {
+    keys_.push_back(key);
+    folly::toLowerAscii(keys_.back());
+  }
+  if (keys_.empty()) {
+    return;
+  }
+  size_t tableSize = 4;
+  while (tableSize < keys_.size() * 2) {
+    tableSize <<= 1;
+  }
+  // Each doubling makes a collision free seed much more likely, so this
+  // terminates quickly for the key counts we expect (a few hundred at most)
+  for (uint64_t attempt = 1;; attempt++) {
+    if (tryBuild(attempt * 0x9E3779B97F4A7C15ULL, tableSize)) {
+      return;
+    }
+    if (attempt % kSeedAttempts == 0) {
+      tableSize <<= 1;
+    }
+  }
+}
+
+uint64_t RuntimePerfectHash::hash(const char* name,
+                                  size_t len,
+                                  uint64_t seed) {
+  // FNV-1a over the lowercased bytes, with a final mix so the low bits used
+  // for the slot depend on every input byte
+  uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+  for (size_t i = 0; i < len; i++) {
+    h ^= toLower(name[i]);
+    h *= 0x100000001b3ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+bool RuntimePerfectHash::tryBuild(uint64_t seed, size_t tableSize) {
+  slots_.assign(tableSize, 0);
+  mask_ = tableSize - 1;
+  seed_ = seed;
+  for (size_t i = 0; i < keys_.size(); i++) {
+    auto& slot = slots_[hash(keys_[i].data(), keys_[i].size(), seed_) & mask_];
+    if (slot != 0) {
+      CHECK_NE(keys_[slot - 1], keys_[i]) << "duplicate key " << keys_[i];
+      return false;
+    }
+    slot = static_cast<uint16_t>(i + 1);
+  }
+  return true;
+}
+
+int32_t RuntimePerfectHash::find(const char* name, size_t len) const {
+  if (slots_.empty()) {
+    return kNotFound;
+  }
+  auto slot = slots_[hash(name, len, seed_) & mask_];
+  if (slot == 0) {
+    return kNotFound;
+  }
+  const auto& key = keys_[slot - 1];
+  if (key.size() != len) {
+    return kNotFound;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (toLower(name[i]) != static_cast<uint8_t>(key[i])) {
+      return kNotFound;
+    }
+  }
+  return slot - 1;
+}
+
+} // namespace proxygen
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/*
+ * Case-insensitive perfect hash over a set of ASCII strings, built at
+ * runtime.  This is the runtime counterpart of the gperf generated tables
+ * (see perfect_hash_table_template.h) for key sets that are only known at
+ * process startup.  build() searches for a seed that maps every key to its
+ * own slot in a power of two table, so find() costs one hash and at most one
+ * string compare.
+ *
+ * Instances are immutable after build() and safe to read concurrently.
+ */
+class RuntimePerfectHash {
+ public:
+  static constexpr int32_t kNotFound = -1;
+
+  /*
+   * Keys must be unique ignoring ASCII case.  The index of a key in this
+   * vector is what find() returns.
+   */
+  explicit RuntimePerfectHash(const std::vector<std::string>& keys);
+
+  int32_t find(const char* name, size_t len) const;
+
+  int32_t find(const std::string& name) const {
+    return find(name.data(), name.size());
+  }
+
+  size_t size() const {
+    return keys_.size();
+  }
+
+ private:
+  static uint64_t hash(const char* name, size_t len, uint64_t seed);
+
+  bool tryBuild(uint64_t seed, size_t tableSize);
+
+  // Lowercased copies of the keys
+  std::vector<std::string> keys_;
+  // keys_ index + 1 per slot, 0 means empty
+  std::vector<uint16_t> slots_;
+  uint64_t seed_{0};
+  uint64_t mask_{0};
+};
+
+} // namespace proxygen
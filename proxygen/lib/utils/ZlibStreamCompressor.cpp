@@ -90,6 +90,20 @@ void ZlibStreamCompressor::init() {
   }
 }
 
+void ZlibStreamCompressor::reset() {
+  if (!init_) {
+    return;
+  }
+  zlibStream_.next_in = Z_NULL;
+  zlibStream_.avail_in = 0;
+  zlibStream_.avail_out = 0;
+  zlibStream_.next_out = Z_NULL;
+  status_ = deflateReset(&zlibStream_);
+  if (status_ != Z_OK) {
+    LOG(ERROR) << "error resetting zlib stream. r=" << status_;
+  }
+}
+
 ZlibStreamCompressor::ZlibStreamCompressor(CompressionType type, int level)
     : type_(type), level_(level) {
 }
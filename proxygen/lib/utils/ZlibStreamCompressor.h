@@ -30,6 +30,9 @@ class ZlibStreamCompressor : public StreamCompressor {
 
   void init();
 
+  // Start a new stream, keeping the allocated zlib state
+  void reset();
+
   std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf* in,
                                          bool trailer = true) override;
 
@@ -33,6 +33,16 @@ void ZlibStreamDecompressor::init(CompressionType type) {
   status_ = inflateInit2(&zlibStream_, windowBits);
 }
 
+void ZlibStreamDecompressor::reset() {
+  DCHECK(type_ != CompressionType::NONE) << "Must be initialized";
+  zlibStream_.next_in = Z_NULL;
+  zlibStream_.avail_in = 0;
+  zlibStream_.avail_out = 0;
+  zlibStream_.next_out = Z_NULL;
+  outputLimitExceeded_ = false;
+  status_ = inflateReset(&zlibStream_);
+}
+
 ZlibStreamDecompressor::ZlibStreamDecompressor(
     CompressionType type,
     uint64_t zlib_decompressor_buffer_growth,
@@ -51,6 +61,12 @@ ZlibStreamDecompressor::~ZlibStreamDecompressor() {
 }
 
 std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in) {
+  return decompress(in, std::numeric_limits<uint64_t>::max());
+}
+
+std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in,
+                                                          uint64_t maxOutput) {
+  uint64_t outputLength = 0;
   auto out = IOBuf::create(decompressor_buffer_growth_);
   auto appender = folly::io::Appender(out.get(), decompressor_buffer_growth_);
 
@@ -85,7 +101,12 @@ std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in) {
     zlibStream_.next_in = const_cast<uint8_t*>(crtBuf->data() + offset);
     zlibStream_.avail_in = origAvailIn;
     zlibStream_.next_out = appender.writableData();
-    zlibStream_.avail_out = appender.length();
+    // Leave room for one byte past the limit, to tell hitting it exactly
+    // from exceeding it
+    auto room = maxOutput - outputLength;
+    zlibStream_.avail_out =
+        room < appender.length() ? room + 1 : appender.length();
+    const size_t origAvailOut = zlibStream_.avail_out;
     status_ = inflate(&zlibStream_, Z_PARTIAL_FLUSH);
     if (status_ != Z_OK && status_ != Z_STREAM_END) {
       LOG(INFO) << "error uncompressing buffer: r=" << status_;
@@ -96,8 +117,15 @@ std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in) {
     auto inConsumed = origAvailIn - zlibStream_.avail_in;
     offset += inConsumed;
     // Move output buffer ahead
-    auto outMove = appender.length() - zlibStream_.avail_out;
+    auto outMove = origAvailOut - zlibStream_.avail_out;
     appender.append(outMove);
+    outputLength += outMove;
+    if (outputLength > maxOutput) {
+      status_ = Z_BUF_ERROR;
+      outputLimitExceeded_ = true;
+      VLOG(4) << "error uncompressing buffer: output exceeds " << maxOutput;
+      return nullptr;
+    }
   }
 
   return out;
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <limits>
 #include <memory>
 #include <proxygen/lib/utils/StreamDecompressor.h>
 #include <zlib.h>
@@ -45,8 +46,20 @@ class ZlibStreamDecompressor : public StreamDecompressor {
 
   void init(CompressionType type);
 
+  // Start a new stream, keeping the allocated zlib state
+  void reset();
+
   std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override;
 
+  // Stops inflating and fails once the output would exceed maxOutput bytes,
+  // so a small input cannot expand into an unbounded allocation
+  std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in,
+                                           uint64_t maxOutput);
+
+  bool outputLimitExceeded() const {
+    return outputLimitExceeded_;
+  }
+
   int getStatus() {
     return status_;
   }
@@ -65,5 +78,6 @@ class ZlibStreamDecompressor : public StreamDecompressor {
   uint64_t decompressor_buffer_minsize_{kZlibDecompressorBufferMinsizeDefault};
   z_stream zlibStream_;
   int status_{-1};
+  bool outputLimitExceeded_{false};
 };
 } // namespace proxygen
@@ -37,6 +37,10 @@ enum %%name_enum%% : uint8_t {
 
 const uint8_t %%name_enum%%CommonOffset = 2;
 
+// Codes from num_codes up to this bound are handed out at runtime by
+// registerCustomName
+const uint64_t %%name_enum%%MaxCodes = 256;
+
 enum class %%table_type_name%%: uint8_t {
   TABLE_CAMELCASE = 0,
   TABLE_LOWERCASE = 1,
@@ -44,7 +48,8 @@ enum class %%table_type_name%%: uint8_t {
 
 class %%name%% {
  public:
-  // Perfect hash function to match specified names
+  // Perfect hash function to match specified names, including any names
+  // added with registerCustomName
   FB_EXPORT static %%name_enum%% hash(const char* name, size_t len);
 
   FB_EXPORT inline static %%name_enum%% hash(const std::string& name) {
@@ -61,6 +66,26 @@ class %%name%% {
    */
 $$$$$
 
+  /**
+   * Assign a code to a name that is not in the generated list, so it gets
+   * the same treatment as the built-in ones: hash() returns the code and
+   * getPointerToName() a shared name in both tables.  The code space is
+   * shared with the generated codes, so only %%name_enum%%MaxCodes -
+   * num_codes names can be registered.  After that, or for a name that is
+   * not a valid token, %%enum_prefix%%_OTHER is returned.  Registering a
+   * name again, or a generated one, returns its existing code.
+   *
+   * Meant for process startup.  Concurrent hash() calls are safe, they see
+   * the new name once this returns.
+   */
+  FB_EXPORT static %%name_enum%% registerCustomName(const std::string& name);
+
+  FB_EXPORT static uint64_t numCustomCodes();
+
+  inline static bool isCustomCode(%%name_enum%% code) {
+    return code >= num_codes;
+  }
+
   static const std::string* getPointerToTable(
     %%table_type_name%% type);
 
@@ -85,7 +110,10 @@ $$$$$
       return %%enum_prefix%%_NONE;
     } else {
       auto diff = headerName - getPointerToTable(type);
-      if (diff >= %%name_enum%%CommonOffset && diff < (long)num_codes) {
+      // Custom names live in the same tables after the generated ones, and
+      // pointers to unregistered slots are never handed out
+      if (diff >= %%name_enum%%CommonOffset &&
+          diff < (long)%%name_enum%%MaxCodes) {
         return static_cast<%%name_enum%%>(diff);
       } else {
         return %%enum_prefix%%_OTHER;
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/portability/OpenSSL.h>
+#include <openssl/buffer.h>
+#include <proxygen/lib/utils/Base64.h>
+
+using namespace proxygen;
+
+// Compares Base64 with the OpenSSL BIO chains it used before, at the sizes
+// of a websocket key, a JWT and a large cookie.
+//
+// buck build @mode/opt proxygen/lib/utils/test:base64_benchmark
+// ./buck-out/gen/proxygen/lib/utils/test/base64_benchmark
+
+namespace {
+
+struct BIODeleter {
+  void operator()(BIO* bio) const {
+    BIO_free_all(bio);
+  }
+};
+
+std::string legacyEncode(folly::ByteRange buffer) {
+  std::unique_ptr<BIO, BIODeleter> bio, b64;
+  BUF_MEM* bufferPtr;
+  b64.reset(BIO_new(BIO_f_base64()));
+  bio.reset(BIO_new(BIO_s_mem()));
+  bio.reset(BIO_push(b64.release(), bio.release()));
+  BIO_set_flags(bio.get(), BIO_FLAGS_BASE64_NO_NL);
+  BIO_write(bio.get(), buffer.data(), buffer.size());
+  (void)BIO_flush(bio.get());
+  BIO_get_mem_ptr(bio.get(), &bufferPtr);
+  return std::string(bufferPtr->data, bufferPtr->length);
+}
+
+std::string legacyDecode(const std::string& b64message, int padding) {
+  std::unique_ptr<BIO, BIODeleter> bio, b64;
+  std::string result(b64message.length() * 3 / 4 - padding, '\0');
+  bio.reset(BIO_new_mem_buf((void*)b64message.data(), -1));
+  b64.reset(BIO_new(BIO_f_base64()));
+  bio.reset(BIO_push(b64.release(), bio.release()));
+  BIO_set_flags(bio.get(), BIO_FLAGS_BASE64_NO_NL);
+  BIO_read(bio.get(), (char*)result.data(), b64message.length());
+  return result;
+}
+
+std::string makeData(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>(i * 131 + 7);
+  }
+  return data;
+}
+
+folly::ByteRange range(const std::string& str) {
+  return folly::ByteRange(reinterpret_cast<const uint8_t*>(str.data()),
+                          str.size());
+}
+
+const std::string kWebsocketKey = makeData(16);
+const std::string kJWT = makeData(600);
+const std::string kCookie = makeData(3000);
+
+void legacyEncodeBench(const std::string& data, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(legacyEncode(range(data)));
+  }
+}
+
+void encodeBench(const std::string& data, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(Base64::encode(range(data)));
+  }
+}
+
+void legacyDecodeBench(const std::string& data, int iters) {
+  std::string encoded;
+  BENCHMARK_SUSPEND {
+    encoded = Base64::encode(range(data));
+  }
+  int padding = (3 - data.size() % 3) % 3;
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(legacyDecode(encoded, padding));
+  }
+}
+
+void decodeBench(const std::string& data, int iters) {
+  std::string encoded;
+  BENCHMARK_SUSPEND {
+    encoded = Base64::encode(range(data));
+  }
+  int padding = (3 - data.size() % 3) % 3;
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(Base64::decode(encoded, padding));
+  }
+}
+
+void decodeBufferBench(const std::string& data, int iters) {
+  std::string encoded;
+  std::vector<uint8_t> out;
+  BENCHMARK_SUSPEND {
+    encoded = Base64::urlEncode(range(data));
+    out.resize(Base64::decodedSize(encoded));
+  }
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(Base64::urlDecode(encoded, out.data()));
+  }
+}
+
+} // namespace
+
+BENCHMARK(LegacyEncodeWebsocketKey, iters) {
+  legacyEncodeBench(kWebsocketKey, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeWebsocketKey, iters) {
+  encodeBench(kWebsocketKey, iters);
+}
+
+BENCHMARK(LegacyEncodeJWT, iters) {
+  legacyEncodeBench(kJWT, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeJWT, iters) {
+  encodeBench(kJWT, iters);
+}
+
+BENCHMARK(LegacyEncodeCookie, iters) {
+  legacyEncodeBench(kCookie, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeCookie, iters) {
+  encodeBench(kCookie, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(LegacyDecodeWebsocketKey, iters) {
+  legacyDecodeBench(kWebsocketKey, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeWebsocketKey, iters) {
+  decodeBench(kWebsocketKey, iters);
+}
+
+BENCHMARK(LegacyDecodeJWT, iters) {
+  legacyDecodeBench(kJWT, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeJWT, iters) {
+  decodeBench(kJWT, iters);
+}
+
+BENCHMARK_RELATIVE(UrlDecodeJWTToBuffer, iters) {
+  decodeBufferBench(kJWT, iters);
+}
+
+BENCHMARK(LegacyDecodeCookie, iters) {
+  legacyDecodeBench(kCookie, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeCookie, iters) {
+  decodeBench(kCookie, iters);
+}
+
+BENCHMARK_RELATIVE(UrlDecodeCookieToBuffer, iters) {
+  decodeBufferBench(kCookie, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -62,3 +62,81 @@ TEST(Base64, EncodeDecodeHighBits) {
   EXPECT_EQ(Base64::urlDecode("_--_"), std::string("\xff\xef\xbf", 3));
   EXPECT_EQ(Base64::urlEncode(range("\xff\xef\xbf", 3)), "_--_");
 }
+
+TEST(Base64, DecodeInvalid) {
+  EXPECT_EQ(Base64::decode("YQ==", 1), "");
+  EXPECT_EQ(Base64::decode("YQ=", 1), "");
+  EXPECT_EQ(Base64::decode("Y===", 2), "");
+  EXPECT_EQ(Base64::decode("YW-_", 0), "");
+  EXPECT_EQ(Base64::decode("YW J", 0), "");
+  EXPECT_EQ(Base64::urlDecode("Y"), "");
+  EXPECT_EQ(Base64::urlDecode("YQ="), "");
+  EXPECT_EQ(Base64::urlDecode("Y=Q="), "");
+  // base64url decoding also takes the base64 alphabet and padding
+  EXPECT_EQ(Base64::urlDecode("/++/"), std::string("\xff\xef\xbf", 3));
+  EXPECT_EQ(Base64::urlDecode("YQ=="), "a");
+}
+
+TEST(Base64, LongRoundTrip) {
+  // Long enough for the vectorized loops, with every byte value
+  std::string data;
+  for (size_t i = 0; i < 1000; ++i) {
+    data.push_back(static_cast<char>(i * 7));
+  }
+  for (size_t size = 0; size < data.size(); size += 37) {
+    auto buffer = range(data.data(), size);
+    auto expected = data.substr(0, size);
+    auto encoded = Base64::encode(buffer);
+    EXPECT_EQ(encoded.size(), Base64::encodedSize(size));
+    EXPECT_EQ(Base64::decode(encoded, (3 - size % 3) % 3), expected);
+    auto urlEncoded = Base64::urlEncode(buffer);
+    EXPECT_EQ(urlEncoded.size(), Base64::urlEncodedSize(size));
+    EXPECT_EQ(urlEncoded.find_first_of("+/="), std::string::npos);
+    EXPECT_EQ(Base64::urlDecode(urlEncoded), expected);
+
+    if (size > 100) {
+      // An invalid character past the first vector
+      encoded[size / 2] = '*';
+      EXPECT_EQ(Base64::decode(encoded, (3 - size % 3) % 3), "");
+      urlEncoded[size / 2] = '=';
+      EXPECT_EQ(Base64::urlDecode(urlEncoded), "");
+    }
+  }
+}
+
+TEST(Base64, Buffers) {
+  auto buffer = range("hello, world");
+  char encoded[16];
+  ASSERT_EQ(Base64::encodedSize(buffer.size()), 16);
+  EXPECT_EQ(Base64::encode(buffer, encoded), 16);
+  EXPECT_EQ(std::string(encoded, 16), "aGVsbG8sIHdvcmxk");
+
+  uint8_t decoded[12];
+  ASSERT_EQ(Base64::decodedSize("aGVsbG8sIHdvcmxk"), 12);
+  auto size = Base64::decode("aGVsbG8sIHdvcmxk", decoded);
+  ASSERT_TRUE(size.has_value());
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(decoded), *size),
+            "hello, world");
+  EXPECT_FALSE(Base64::decode("aGVsbG8", decoded).has_value());
+
+  ASSERT_EQ(Base64::decodedSize("aGVsbG8"), 5);
+  size = Base64::urlDecode("aGVsbG8", decoded);
+  ASSERT_TRUE(size.has_value());
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(decoded), *size), "hello");
+  EXPECT_EQ(Base64::urlEncode(range("hello"), encoded), 7);
+  EXPECT_EQ(std::string(encoded, 7), "aGVsbG8");
+}
+
+TEST(Base64, IOBufQueue) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  Base64::encode(range("hello"), queue);
+  Base64::urlEncode(range("\xff\xef\xbf", 3), queue);
+  EXPECT_EQ(queue.move()->moveToFbString(), "aGVsbG8=_--_");
+
+  EXPECT_TRUE(Base64::decode("aGVsbG8=", queue));
+  EXPECT_FALSE(Base64::decode("aGVsbG8", queue));
+  EXPECT_TRUE(Base64::urlDecode("_--_", queue));
+  EXPECT_FALSE(Base64::urlDecode("_", queue));
+  EXPECT_EQ(queue.chainLength(), 8);
+  EXPECT_EQ(queue.move()->moveToFbString(), "hello\xff\xef\xbf");
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <folly/Benchmark.h>
+#include <proxygen/lib/utils/ParseURL.h>
+#include <proxygen/lib/utils/UtilInl.h>
+
+using namespace proxygen;
+
+// Compares ParseURL against the scans it used before, on a corpus of
+// request targets shaped like those seen by a typical edge proxy.
+//
+// buck build @mode/opt proxygen/lib/utils/test:parse_url_benchmark
+// ./buck-out/gen/proxygen/lib/utils/test/parse_url_benchmark
+
+namespace {
+
+const std::vector<std::string> kOriginForm = {
+    "/",
+    "/favicon.ico",
+    "/index.html",
+    "/static/js/main.3f9a1c2e.chunk.js",
+    "/static/css/app.8d2f0b11.css",
+    "/api/v1/users/1234567/profile?fields=name,picture&locale=en_US",
+    "/api/graphql?doc_id=4820176204710128&variables=%7B%22id%22%3A%22123%22%7D",
+    "/search?q=http+proxy+performance&hl=en&source=hp&ei=AbCdEfGhIjKl",
+    "/images/products/2023/11/SKU-88213-large.jpg?w=640&h=480&fit=crop",
+    "/watch?v=dQw4w9WgXcQ&list=PLFgquLnL59alCl_2TQvOiD5Vgm1hCaGSI&index=3",
+    "/wp-content/uploads/2022/05/banner-home-1920x600.webp",
+    "/cdn-cgi/challenge-platform/h/b/orchestrate/jsch/v1?ray=7d1c2e3f4a5b6c7d",
+    "/ajax/bz?__a=1&__user=0&__req=1f&__hs=19345.HYP:comet_pkg.2.1.0.2.1",
+    "/v2/track?event=page_view&ts=1700000000000&sid=9b8a7c6d5e4f3a2b1c0d",
+    "/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q/r/s/t/u/v/w/x/y/z/index.json",
+    "/login?next=%2Fsettings%2Fsecurity%3Ftab%3Dsessions#top",
+};
+
+const std::vector<std::string> kAbsoluteForm = {
+    "http://www.example.com/",
+    "http://cdn.example.net/static/js/vendor.min.js?v=20231104",
+    "https://api.example.org:8443/v1/objects/abc123?expand=owner",
+    "http://10.0.0.17:8080/healthcheck",
+    "http://[2001:db8::1]:80/metrics?format=prometheus",
+    "http://images.example.com/thumbs/640x360/9f86d081884c7d659a2feaa0c55.jpg",
+};
+
+const std::vector<std::string> kAuthorityForm = {
+    "www.example.com:443",
+    "api.example.org:8443",
+    "10.0.0.17:8080",
+    "[2001:db8::1]:443",
+};
+
+// ParseURL::parseNonFully before the single pass scan: validation and each
+// delimiter were separate passes over the URL
+bool legacyParseNonFully(folly::StringPiece url) {
+  if (url.empty() || !validateURL(url, URLValidateMode::STRICT)) {
+    return false;
+  }
+  auto pathStart = url.find('/');
+  auto queryStart = url.find('?');
+  auto hashStart = url.find('#');
+  folly::doNotOptimizeAway(pathStart);
+  folly::doNotOptimizeAway(queryStart);
+  folly::doNotOptimizeAway(hashStart);
+  return !(queryStart != std::string::npos && hashStart < queryStart);
+}
+
+// validateScheme before it stopped at the end of the scheme
+bool legacyValidateScheme(folly::StringPiece url) {
+  auto schemeEnd = url.find("://");
+  if (schemeEnd == std::string::npos || schemeEnd == 0) {
+    return false;
+  }
+  auto scheme = url.subpiece(0, schemeEnd);
+  return std::all_of(
+      scheme.begin(), scheme.end(), [](auto _) { return std::isalpha(_); });
+}
+
+void legacyScanBench(const std::vector<std::string>& urls, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    for (const auto& url : urls) {
+      if (!legacyValidateScheme(url)) {
+        folly::doNotOptimizeAway(legacyParseNonFully(url));
+      }
+    }
+  }
+}
+
+void parseBench(const std::vector<std::string>& urls, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    for (const auto& url : urls) {
+      ParseURL u(url, true);
+      folly::doNotOptimizeAway(u.valid());
+    }
+  }
+}
+
+void normalizeBench(const std::vector<std::string>& urls, int iters) {
+  std::vector<ParseURL> parsed;
+  BENCHMARK_SUSPEND {
+    for (const auto& url : urls) {
+      parsed.emplace_back(url, true);
+    }
+  }
+  for (int i = 0; i < iters; ++i) {
+    for (const auto& u : parsed) {
+      folly::doNotOptimizeAway(u.normalize());
+    }
+  }
+}
+
+} // namespace
+
+// The legacy benchmarks only time the scans parseNonFully replaced, while
+// the others build a whole ParseURL, so a ratio near 100% is already a win
+BENCHMARK(LegacyScanOriginForm, iters) {
+  legacyScanBench(kOriginForm, iters);
+}
+
+BENCHMARK_RELATIVE(ParseOriginForm, iters) {
+  parseBench(kOriginForm, iters);
+}
+
+BENCHMARK(LegacyScanAuthorityForm, iters) {
+  legacyScanBench(kAuthorityForm, iters);
+}
+
+BENCHMARK_RELATIVE(ParseAuthorityForm, iters) {
+  parseBench(kAuthorityForm, iters);
+}
+
+BENCHMARK(ParseAbsoluteForm, iters) {
+  parseBench(kAbsoluteForm, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(NormalizeOriginForm, iters) {
+  normalizeBench(kOriginForm, iters);
+}
+
+BENCHMARK(NormalizeAbsoluteForm, iters) {
+  normalizeBench(kAbsoluteForm, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -257,3 +257,95 @@ TEST(ParseURL, GetQueryParam) {
   EXPECT_EQ(u->getQueryParam("bak"), "");
   EXPECT_FALSE(u->getQueryParam("fooo").has_value());
 }
+
+TEST(ParseURL, LongURL) {
+  // Long enough for the vectorized scan, with the delimiters and invalid
+  // bytes at either side of a vector boundary
+  string path = "/" + string(40, 'a');
+  testParseURL("www.example.com" + path + "?" + string(20, 'q') + "#f",
+               "",
+               path,
+               string(20, 'q'),
+               "www.example.com",
+               0,
+               "www.example.com");
+  testParseURL(string(15, 'h') + "/" + string(15, 'p') + "?q",
+               "",
+               "/" + string(15, 'p'),
+               "q",
+               string(15, 'h'),
+               0,
+               string(15, 'h'));
+  testParseURL(string(31, 'a') + " /b", "", "", "", "", 0, "", false);
+  testParseURL(string(32, 'a') + "\x7f/b", "", "", "", "", 0, "", false);
+  testParseURL(string(17, 'a') + "/\xff",
+               "",
+               "/\xff",
+               "",
+               string(17, 'a'),
+               0,
+               string(17, 'a'));
+  testParseURL(string(17, 'a') + "/\xff", "", "", "", "", 0, "", false, true);
+  testParseURL(string(20, 'a') + "#" + string(20, 'f') + "?q",
+               "",
+               "",
+               "",
+               "",
+               0,
+               "",
+               false);
+}
+
+void testNormalize(const string& url,
+                   const string& expected,
+                   const bool strict = false) {
+  auto u = ParseURL::parseURLMaybeInvalid(url, strict);
+  ASSERT_TRUE(u.valid()) << url;
+  auto normalized = u.normalize();
+  if (expected == url) {
+    EXPECT_FALSE(normalized.has_value()) << *normalized;
+  } else {
+    ASSERT_TRUE(normalized.has_value()) << url;
+    EXPECT_EQ(expected, *normalized);
+  }
+}
+
+TEST(ParseURL, NormalizeUnchanged) {
+  testNormalize("/", "/");
+  testNormalize("/foo/bar?x=1&y=%2F#frag", "/foo/bar?x=1&y=%2F#frag");
+  testNormalize("http://www.example.com/a/b/", "http://www.example.com/a/b/");
+  testNormalize("www.example.com:8080/a%20b", "www.example.com:8080/a%20b");
+  testNormalize("/a..b/.c/..d/%", "/a..b/.c/..d/%");
+  // The fragment is left alone
+  testNormalize("/a#/./%41", "/a#/./%41");
+
+  auto u = ParseURL::parseURLMaybeInvalid("127.0.0.1:80/foo#bar?qqq");
+  ASSERT_FALSE(u.valid());
+  EXPECT_FALSE(u.normalize().has_value());
+}
+
+TEST(ParseURL, NormalizeCase) {
+  testNormalize("HTTP://WWW.Example.COM:80/Path?Q=A",
+                "http://www.example.com:80/Path?Q=A");
+  testNormalize("Example.COM/Path", "example.com/Path");
+  testNormalize("[::ABCD]:443/", "[::abcd]:443/");
+}
+
+TEST(ParseURL, NormalizePercentEncoding) {
+  testNormalize("/%7euser/%41%62%2D%5f%2e%30", "/~user/Ab-_.0");
+  testNormalize("/a%2fb%3a?q=%3d%7E", "/a%2Fb%3A?q=%3D~");
+  testNormalize("/bad%zz%4", "/bad%zz%4");
+}
+
+TEST(ParseURL, NormalizeDotSegments) {
+  testNormalize("/a/./b", "/a/b");
+  testNormalize("/a/b/../c", "/a/c");
+  testNormalize("/a/b/..", "/a/");
+  testNormalize("/a/b/.", "/a/b/");
+  testNormalize("/../../a", "/a");
+  testNormalize("/..", "/");
+  testNormalize("/a//../b", "/a/b");
+  testNormalize("/a/%2E%2e/b/%2e", "/b/");
+  testNormalize("http://h/a/b/c/./../../g?x=./..", "http://h/a/g?x=./..");
+  testNormalize("Host/x/../y", "host/y");
+}
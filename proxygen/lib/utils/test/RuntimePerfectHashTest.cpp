@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/RuntimePerfectHash.h>
+
+using namespace proxygen;
+
+TEST(RuntimePerfectHashTest, Empty) {
+  RuntimePerfectHash hash({});
+  EXPECT_EQ(hash.size(), 0);
+  EXPECT_EQ(hash.find("anything"), RuntimePerfectHash::kNotFound);
+}
+
+TEST(RuntimePerfectHashTest, FindIgnoresCase) {
+  RuntimePerfectHash hash({"X-Trace-Id", "x-route", "Authorization-Token"});
+  EXPECT_EQ(hash.find("X-Trace-Id"), 0);
+  EXPECT_EQ(hash.find("x-trace-id"), 0);
+  EXPECT_EQ(hash.find("X-ROUTE"), 1);
+  EXPECT_EQ(hash.find("authorization-token"), 2);
+  EXPECT_EQ(hash.find("x-trace-i"), RuntimePerfectHash::kNotFound);
+  EXPECT_EQ(hash.find("x-trace-idx"), RuntimePerfectHash::kNotFound);
+  EXPECT_EQ(hash.find(""), RuntimePerfectHash::kNotFound);
+}
+
+TEST(RuntimePerfectHashTest, ManyKeys) {
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < 500; i++) {
+    keys.push_back(folly::to<std::string>("X-Header-", i));
+  }
+  RuntimePerfectHash hash(keys);
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(hash.find(keys[i]), static_cast<int32_t>(i));
+  }
+  EXPECT_EQ(hash.find("X-Header-500"), RuntimePerfectHash::kNotFound);
+}
@@ -145,3 +145,53 @@ TEST_F(ZlibTests, CompressDecompressSmallBuffer) {
     compressThenDecompress(CompressionType::GZIP, 4, makeBuf(127));
   });
 }
+
+TEST_F(ZlibTests, CompressDecompressReset) {
+  ASSERT_NO_FATAL_FAILURE({
+    auto compressor =
+        std::make_unique<ZlibStreamCompressor>(CompressionType::GZIP, 6);
+    auto decompressor =
+        std::make_unique<ZlibStreamDecompressor>(CompressionType::GZIP);
+    // Each reset starts an independent stream on the same objects
+    for (auto i = 0; i < 3; i++) {
+      auto buf = makeBuf(100 * (i + 1));
+      auto compressed = compressor->compress(buf.get(), true);
+      ASSERT_FALSE(compressor->hasError());
+      auto decompressed = decompressor->decompress(compressed.get());
+      ASSERT_TRUE(decompressor->finished());
+      IOBufEqualTo eq;
+      ASSERT_TRUE(eq(buf, decompressed));
+      compressor->reset();
+      decompressor->reset();
+    }
+  });
+}
+
+TEST_F(ZlibTests, DecompressMaxOutput) {
+  auto zeros = IOBuf::create(1000000);
+  memset(zeros->writableData(), 0, zeros->capacity());
+  zeros->append(1000000);
+  ZlibStreamCompressor compressor(CompressionType::GZIP, 9);
+  auto compressed = compressor.compress(zeros.get(), true);
+  ASSERT_FALSE(compressor.hasError());
+  ASSERT_LT(compressed->computeChainDataLength(), 2000);
+
+  // Exactly at the limit is fine
+  ZlibStreamDecompressor decompressor(CompressionType::GZIP);
+  auto out = decompressor.decompress(compressed.get(), 1000000);
+  ASSERT_TRUE(out);
+  EXPECT_TRUE(decompressor.finished());
+  EXPECT_FALSE(decompressor.outputLimitExceeded());
+  EXPECT_EQ(out->computeChainDataLength(), 1000000);
+
+  // One byte less stops early rather than inflating everything first
+  decompressor.reset();
+  EXPECT_FALSE(decompressor.decompress(compressed.get(), 999999));
+  EXPECT_TRUE(decompressor.hasError());
+  EXPECT_TRUE(decompressor.outputLimitExceeded());
+
+  decompressor.reset();
+  EXPECT_FALSE(decompressor.outputLimitExceeded());
+  EXPECT_FALSE(decompressor.decompress(compressed.get(), 1000));
+  EXPECT_TRUE(decompressor.outputLimitExceeded());
+}